@@ -18,23 +18,30 @@ DEFINES += QT_DEPRECATED_WARNINGS
 
 INCLUDEPATH += include/ include/drivers/
 
+LIBS += -lz
+
 SOURCES += \
     src/AnalogIn.cpp \
     src/AnalogOut.cpp \
     src/Channel.cpp \
+    src/CyclicExecutor.cpp \
     src/DigitalIn.cpp \
     src/DigitalOut.cpp \
     src/EncoderCounter.cpp \
     src/HTTPClient.cpp \
+    src/HTTPParser.cpp \
     src/HTTPScript.cpp \
     src/HTTPServer.cpp \
     src/HighpassFilter.cpp \
+    src/Histogram.cpp \
     src/LowpassFilter.cpp \
     src/Module.cpp \
     src/Mutex.cpp \
     src/RealtimeThread.cpp \
+    src/Telemetry.cpp \
     src/Thread.cpp \
     src/Timer.cpp \
+    src/Trace.cpp \
     src/XMLParser.cpp \
     src/drivers/AdvantechPCIe1680.cpp \
     src/drivers/BeagleBone.cpp \
@@ -51,11 +58,13 @@ SOURCES += \
     src/drivers/BeckhoffEL7342.cpp \
     src/drivers/CAN.cpp \
     src/drivers/CANMessage.cpp \
+    src/drivers/CANMessageBuffer.cpp \
     src/drivers/CANopen.cpp \
     src/drivers/CoE.cpp \
     src/drivers/DS406Encoder.cpp \
     src/drivers/ElmoWhistle.cpp \
     src/drivers/EtherCAT.cpp \
+    src/drivers/EtherCATSimulator.cpp \
     src/drivers/Ethernet.cpp \
     src/drivers/GrivixAutoCharge.cpp \
     src/drivers/HetronicRC.cpp \
@@ -69,6 +78,7 @@ SOURCES += \
     src/drivers/PCANpci.cpp \
     src/drivers/PCANpcie.cpp \
     src/drivers/PCI.cpp \
+    src/drivers/PacketSocket.cpp \
     src/drivers/PhoenixCanBK.cpp \
     src/drivers/RPLidar.cpp \
     src/drivers/RPLidarA2.cpp \
@@ -87,19 +97,24 @@ HEADERS += \
     include/AnalogIn.h \
     include/AnalogOut.h \
     include/Channel.h \
+    include/CyclicExecutor.h \
     include/DigitalIn.h \
     include/DigitalOut.h \
     include/EncoderCounter.h \
     include/HTTPClient.h \
+    include/HTTPParser.h \
     include/HTTPScript.h \
     include/HTTPServer.h \
     include/HighpassFilter.h \
+    include/Histogram.h \
     include/LowpassFilter.h \
     include/Module.h \
     include/Mutex.h \
     include/RealtimeThread.h \
+    include/Telemetry.h \
     include/Thread.h \
     include/Timer.h \
+    include/Trace.h \
     include/XMLParser.h \
     include/drivers/AdvantechPCIe1680.h \
     include/drivers/BeagleBone.h \
@@ -116,11 +131,13 @@ HEADERS += \
     include/drivers/BeckhoffEL7342.h \
     include/drivers/CAN.h \
     include/drivers/CANMessage.h \
+    include/drivers/CANMessageBuffer.h \
     include/drivers/CANopen.h \
     include/drivers/CoE.h \
     include/drivers/DS406Encoder.h \
     include/drivers/ElmoWhistle.h \
     include/drivers/EtherCAT.h \
+    include/drivers/EtherCATSimulator.h \
     include/drivers/Ethernet.h \
     include/drivers/GrivixAutoCharge.h \
     include/drivers/HetronicRC.h \
@@ -134,6 +151,7 @@ HEADERS += \
     include/drivers/PCANpci.h \
     include/drivers/PCANpcie.h \
     include/drivers/PCI.h \
+    include/drivers/PacketSocket.h \
     include/drivers/PhoenixCanBK.h \
     include/drivers/RPLidar.h \
     include/drivers/RPLidarA2.h \
@@ -0,0 +1,87 @@
+/*
+ * CyclicExecutor.h
+ * Copyright (c) 2026, ZHAW
+ * All rights reserved.
+ *
+ *  Created on: 17.10.2026
+ *      Author: Marcel Honegger
+ */
+
+#ifndef CYCLIC_EXECUTOR_H_
+#define CYCLIC_EXECUTOR_H_
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <stdint.h>
+#include "Mutex.h"
+#include "RealtimeThread.h"
+
+/**
+ * The <code>CyclicExecutor</code> class runs many periodic tasks from a single realtime thread.
+ * The period of every task must be a multiple of the period of the executor, so that all tasks
+ * run at harmonic rates. In every period of the executor, the tasks that are due are executed
+ * one after the other, in the order they were added. An optional offset allows to distribute
+ * tasks with a longer period over different periods of the executor.
+ * <br/>
+ * Instead of owning a realtime thread, device drivers may implement the <code>Task</code>
+ * interface and register themselves with an executor, as shown below:
+ * <pre><code>
+ * CyclicExecutor cyclicExecutor("cyclicExecutor", RealtimeThread::RT_MAX_PRIORITY-10, 0.001);
+ *
+ * CANopen canOpen(pcanPCI);
+ * MaxonEPOS4 maxonEPOS4x(canOpen, cyclicExecutor, 20, 0.002);  <span style="color:#008000">// executed every 2nd period</span>
+ * MaxonEPOS4 maxonEPOS4y(canOpen, cyclicExecutor, 21, 0.002);
+ * Timer timer(cyclicExecutor);                                  <span style="color:#008000">// executed every period</span>
+ * </code></pre>
+ * Machines with many devices should use one executor per processor core, instead of one
+ * realtime thread per device, to avoid that many threads wake up independently.
+ * <br/>
+ * Tasks must not block, and they must not add or remove tasks of the executor that executes them.
+ * The statistics of the realtime thread, given by <code>toString()</code>, show if the tasks
+ * of an executor fit into its period.
+ */
+class CyclicExecutor : public RealtimeThread {
+    
+    public:
+        
+        /**
+         * The <code>Task</code> interface needs to be implemented by periodic tasks
+         * that are executed by a cyclic executor.
+         */
+        class Task {
+            
+            public:
+                
+                virtual         ~Task();
+                virtual void    execute();
+        };
+        
+                    CyclicExecutor(std::string name, int32_t priority, double period);
+        virtual     ~CyclicExecutor();
+        void        addTask(Task& task, double period);
+        void        addTask(Task& task, double period, double offset);
+        void        removeTask(Task& task);
+        uint32_t    getNumberOfTasks();
+        
+    private:
+        
+        static const size_t STACK_SIZE = 256*1024;  // stack size of the thread of this executor in [bytes]
+        
+        /**
+         * An entry describes when a task is executed.
+         */
+        struct Entry {
+            Task*       task;       // the task to execute
+            uint32_t    divider;    // period of the task as a multiple of the period of the executor
+            uint32_t    counter;    // number of periods of the executor until the task is executed again
+        };
+        
+        Mutex               mutex;          // mutex to lock critical sections
+        std::vector<Entry>  entries;        // tasks in the order of their execution
+        
+        void        run();
+};
+
+#endif /* CYCLIC_EXECUTOR_H_ */
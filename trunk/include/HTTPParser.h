@@ -0,0 +1,108 @@
+/*
+ * HTTPParser.h
+ * Copyright (c) 2026, ZHAW
+ * All rights reserved.
+ *
+ *  Created on: 17.10.2026
+ *      Author: Marcel Honegger
+ */
+
+#ifndef HTTP_PARSER_H_
+#define HTTP_PARSER_H_
+
+#include <cstdlib>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/**
+ * The <code>HTTPParser</code> class parses http requests incrementally, as their data is
+ * received. Every byte is examined only once, even if a request is received in many parts,
+ * and the parser stops at the end of a request, so that pipelined requests can be parsed one
+ * after the other. The content of a request is either delimited by a 'Content-Length' header
+ * field, or transmitted with the chunked transfer coding.
+ * <br/>
+ * The strings of a parser are reused for the following requests, so that parsing doesn't
+ * allocate memory once the buffers are large enough:
+ * <pre><code>
+ * HTTPParser parser;
+ * ...
+ * size_t size = parser.parse(data, length);
+ * if (parser.getStatus() == HTTPParser::COMPLETE) {
+ *     ... parser.getMethod() ... parser.getPath() ...
+ *     parser.reset();
+ * }
+ * </code></pre>
+ */
+class HTTPParser {
+    
+    public:
+        
+        static const uint32_t   MAX_FIELDS = 64;    /**< Maximum number of header fields of a request. */
+        
+        /**
+         * The status of the request that is parsed.
+         */
+        enum Status {
+            INCOMPLETE,             /**< More data is needed to complete the request. */
+            COMPLETE,               /**< The request is complete. */
+            BAD_REQUEST,            /**< The request is malformed. */
+            TOO_LARGE,              /**< The request exceeds the maximum size, or has too many header fields. */
+            NOT_IMPLEMENTED         /**< The request uses a transfer coding that isn't supported. */
+        };
+                            
+                            HTTPParser();
+        virtual             ~HTTPParser();
+        void                setMaxSize(size_t maxSize);
+        void                reset();
+        size_t              parse(const char* data, size_t size);
+        Status              getStatus();
+        const std::string&  getMethod();
+        const std::string&  getTarget();
+        std::string         getPath();
+        void                getArguments(std::vector<std::string>& names, std::vector<std::string>& values);
+        const std::string&  getVersion();
+        std::string         getField(std::string name);
+        bool                isKeepAlive();
+        const std::string&  getContent();
+        static void         decode(const char* data, size_t size, bool form, std::string& text);
+        static std::string  decode(const std::string& text, bool form);
+        
+    private:
+        
+        enum State {
+            METHOD,
+            TARGET,
+            VERSION,
+            FIELD_NAME,
+            FIELD_VALUE,
+            CONTENT,
+            CHUNK_SIZE,
+            CHUNK_EXTENSION,
+            CHUNK_DATA,
+            CHUNK_DATA_END,
+            TRAILER,
+            END
+        };
+        
+        size_t                      maxSize;        // maximum size of a request, in [bytes]
+        State                       state;          // state of the parser
+        Status                      status;         // status of the request
+        size_t                      size;           // number of bytes of the request that were parsed
+        std::string                 method;         // method of the request, i.e. 'GET'
+        std::string                 target;         // request target, i.e. '/cgi-bin/myScript?x=0.5'
+        std::string                 version;        // http version of the request, i.e. 'HTTP/1.1'
+        std::vector<std::string>    names;          // names of the header fields, in lower case
+        std::vector<std::string>    values;         // values of the header fields
+        uint32_t                    fields;         // number of header fields
+        bool                        chunked;        // flag indicating the chunked transfer coding
+        bool                        keepAlive;      // flag indicating that the connection is kept alive after this request
+        uint64_t                    remaining;      // number of bytes of the content or of a chunk that weren't parsed yet
+        bool                        emptyLine;      // flag indicating that the current line is empty so far
+        std::string                 content;        // content of the request
+        
+        void                fieldComplete();
+        void                headerComplete();
+};
+
+#endif /* HTTP_PARSER_H_ */
@@ -11,21 +11,71 @@
 #define HTTP_SCRIPT_H_
 
 #include <cstdlib>
+#include <cstdarg>
+#include <stdint.h>
 #include <string>
 #include <vector>
 
 /**
  * This is the abstract http script superclass that needs to be derived
  * by application specific http scripts.
+ * <br/>
+ * A script either implements the <code>call()</code> method that returns a string,
+ * which the http server places within an xhtml page, or the <code>call()</code> method
+ * with a response object. The latter allows a script to return any type of content, like
+ * JSON text or raw binary data, by writing it into the buffer of the response object and
+ * setting the content type. The buffer is reused for further calls, so that no memory needs
+ * to be allocated for every call:
+ * <pre><code>
+ * void MyHTTPScript::call(vector<string>& names, vector<string>& values, Response& response) {
+ *
+ *     response.setContentType("application/json");
+ *     response.print("{\"x\":%.6f,\"y\":%.6f}", x, y);
+ * }
+ *
+ * void MyScanScript::call(vector<string>& names, vector<string>& values, Response& response) {
+ *
+ *     response.setContentType("application/octet-stream");
+ *     response.write(distances, sizeof(float)*numberOfDistances);
+ * }
+ * </code></pre>
+ * The http server compresses large responses with gzip, if the client accepts this encoding.
  * @see HTTPServer
  */
 class HTTPScript {
 
     public:
 
+        /**
+         * The <code>Response</code> class holds the content of the response of a script.
+         */
+        class Response {
+
+            public:
+
+                                Response();
+                virtual         ~Response();
+                void            clear();
+                void            setContentType(std::string contentType);
+                std::string     getContentType();
+                void            setCompressible(bool compressible);
+                bool            isCompressible();
+                void            write(const void* data, size_t size);
+                void            write(const std::string& text);
+                void            print(const char* format, ...);
+                std::string&    getContent();
+
+            private:
+
+                std::string     contentType;    // content type of the response, i.e. 'application/json'
+                bool            compressible;   // flag indicating that the content may be compressed
+                std::string     content;        // content of the response
+        };
+
                                 HTTPScript();
         virtual                 ~HTTPScript();
         virtual std::string     call(std::vector<std::string> names, std::vector<std::string> values);
+        virtual void            call(std::vector<std::string>& names, std::vector<std::string>& values, Response& response);
 };
 
 #endif /* HTTP_SCRIPT_H_ */
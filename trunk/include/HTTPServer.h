@@ -13,6 +13,9 @@
 #include <string>
 #include <vector>
 #include <list>
+#include <deque>
+#include <map>
+#include <unordered_map>
 #include <sstream>
 #include <iostream>
 #include <iomanip>
@@ -24,14 +27,17 @@
 #include <cstring>
 #include <unistd.h>
 #include <stdint.h>
+#include <pthread.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include "HTTPParser.h"
+#include "HTTPScript.h"
 #include "Thread.h"
 
-class HTTPScript;
-class HTTPClientThread;
+class Telemetry;
+struct z_stream_s;
 
 /**
  * The <code>HTTPServer</code> class implements a simple webserver that is able to
@@ -90,13 +96,59 @@ class HTTPClientThread;
  * <br/>
  * The response of the <code>call()</code> method is a <code>string</code> object
  * which is placed within an xhtml page, which in turn is returned by the http
- * server to the requesting http client.
+ * server to the requesting http client. Scripts that return JSON text or binary
+ * data implement the <code>call()</code> method with a response object instead,
+ * see <code>HTTPScript</code>. Responses of scripts that are larger than 1 KB are
+ * compressed with gzip, if the client accepts this encoding.
+ * <br/>
+ * The http server handles all connections with a single thread and an event loop, which
+ * reads requests and writes responses without blocking. Connections are kept alive with
+ * HTTP/1.1, and clients may send several requests without waiting for the responses, i.e.
+ * to poll scripts periodically. Static files are delivered by the server thread itself,
+ * while scripts are called by a small, fixed pool of worker threads, so that slow scripts
+ * don't delay other connections. The responses of a connection are always returned in the
+ * order of its requests.
+ * <br/>
+ * Small static files are kept in memory together with their response header, and are
+ * revalidated with the modification time of the file for every request. Larger files are
+ * transmitted with <code>sendfile()</code>. Responses carry an <code>ETag</code> and a
+ * <code>Last-Modified</code> header field, so that browsers may revalidate the files of a
+ * web interface with conditional requests, which are answered with '304 Not Modified'.
+ * <br/>
+ * The number of connections, the size of requests, the number of requests per connection
+ * and the number of script calls waiting for a worker thread are limited, and idle
+ * connections are closed after a timeout. These limits may be changed before the server
+ * is started:
+ * <pre><code>
+ *   httpServer->setMaxConnections(16);
+ *   httpServer->setNumberOfWorkers(1);
+ *   httpServer->setKeepAliveTimeout(10000);      <span style="color:#008000">// close idle connections after 10 seconds</span>
+ *   httpServer->start();
+ * </code></pre>
+ * <br/>
+ * Live values of signals, like the channels of periphery modules, may be streamed to clients
+ * with Server-Sent Events, instead of polling scripts. The signals are sampled into a
+ * <code>Telemetry</code> object by a realtime thread, and the object is registered with the
+ * http server with a name:
+ * <pre><code>
+ *   httpServer->add("robot", &telemetry);
+ * </code></pre>
+ * A client subscribes to signals with a request like the following, with the names of the
+ * signals and the rate of the samples it wants to receive, given in [Hz]:
+ * <pre><code>
+ *   var source = new EventSource("/events/robot?signals=x,y&rate=100");
+ * </code></pre>
+ * All signals are sent if no names are given, and all samples are sent if no rate is given.
+ * The first event of a stream has the type 'signals', and its data is a comma separated
+ * list of the names of the signals. All further events carry the samples since the previous
+ * event, with one line per sample, which contains the time in [s] and the values of the
+ * signals, separated by commas. The events are sent at most every 20 ms, so that a single
+ * connection carries samples at rates of several kHz.
  * @see HTTPScript
+ * @see Telemetry
  */
 class HTTPServer : public Thread {
     
-    friend class HTTPClientThread;
-    
     public:
         
                         HTTPServer();
@@ -104,38 +156,175 @@ class HTTPServer : public Thread {
                         HTTPServer(uint16_t portNumber, std::string path, std::string indexPage);
         virtual         ~HTTPServer();
         void            add(std::string name, HTTPScript* httpScript);
+        void            add(std::string name, Telemetry* telemetry);
+        void            setMaxConnections(uint32_t maxConnections);
+        uint32_t        getMaxConnections();
+        void            setMaxRequestSize(uint32_t maxRequestSize);
+        uint32_t        getMaxRequestSize();
+        void            setMaxRequestsPerConnection(uint32_t maxRequestsPerConnection);
+        uint32_t        getMaxRequestsPerConnection();
+        void            setMaxPendingRequests(uint32_t maxPendingRequests);
+        uint32_t        getMaxPendingRequests();
+        void            setKeepAliveTimeout(int32_t keepAliveTimeout);
+        int32_t         getKeepAliveTimeout();
+        void            setNumberOfWorkers(uint32_t numberOfWorkers);
+        uint32_t        getNumberOfWorkers();
+        uint32_t        getNumberOfConnections();
     
     private:
         
         static const size_t     STACK_SIZE = 64*1024;       // stack size of server thread in [bytes]
         static const uint16_t   PORT_NUMBER = 80;           // default port number of this server
-        static const uint32_t   BUFFER_SIZE = 2048;         // size of the input/read buffer, in [bytes]
+        static const uint32_t   BUFFER_SIZE = 16384;        // size of the input/read buffer, in [bytes]
         static const uint32_t   BIND_RETRY_DELAY = 1000;    // delay before retrying to bind, in [ms]
-        static const uint32_t   READ_RETRY_DELAY = 10;      // delay before retrying to read input, in [ms]
-
+        static const int32_t    LISTEN_BACKLOG = 128;       // number of connections the kernel queues before they are accepted
+        static const int32_t    EVENT_TIMEOUT = 1000;       // timeout of the event loop to check for idle connections, in [ms]
+        static const uint32_t   EVENTS = 64;                // number of events handled by one iteration of the event loop
+        static const size_t     OUTPUT_LIMIT = 1024*1024;   // size of pending output that stops the processing of further requests, in [bytes]
+        static const uint32_t   MAX_CONNECTIONS = 64;       // default maximum number of open connections
+        static const uint32_t   MAX_REQUEST_SIZE = 65536;   // default maximum size of a request with header and content, in [bytes]
+        static const uint32_t   MAX_REQUESTS_PER_CONNECTION = 10000;    // default maximum number of requests per connection
+        static const uint32_t   MAX_PENDING_REQUESTS = 32;  // default maximum number of script calls waiting for a worker thread
+        static const int32_t    KEEP_ALIVE_TIMEOUT = 60000; // default timeout of idle connections, in [ms]
+        static const uint32_t   WORKERS = 2;                // default number of worker threads
+        static const size_t     CACHE_SIZE = 4*1024*1024;   // total size of files kept in the cache, in [bytes]
+        static const size_t     CACHED_FILE_SIZE = 64*1024; // size of the largest file kept in the cache, in [bytes]
+        static const int32_t    STREAM_PERIOD = 20;         // shortest period of the events of a stream, in [ms]
+        static const size_t     COMPRESSION_SIZE = 1024;    // size of the smallest response of a script that is compressed, in [bytes]
+        
+        /**
+         * The <code>Stream</code> struct holds the state of a stream of signals.
+         */
+        struct Stream {
+            Telemetry*              telemetry;      // telemetry object with the signals
+            std::vector<uint32_t>   signals;        // indices of the signals that are streamed
+            uint64_t                sample;         // number of the next sample to read
+            int64_t                 samplePeriod;   // shortest time between streamed samples, in [ns]
+            int64_t                 sampleTime;     // time of the next sample to stream, in [ns]
+            int32_t                 period;         // period of the events, in [ms]
+            int32_t                 time;           // time of the next event, in [ms]
+            std::vector<int64_t>    times;          // buffer for the times of the samples that are read
+            std::vector<double>     values;         // buffer for the values of the samples that are read
+            std::string             event;          // buffer for the event that is transmitted
+        };
+        
+        /**
+         * The <code>Connection</code> struct holds the state of a connection with a client.
+         */
+        struct Connection {
+            int32_t         socket;         // socket of this connection
+            std::string     input;          // received data that wasn't processed yet
+            size_t          parsed;         // number of bytes of the input that were already parsed
+            HTTPParser      parser;         // parser of the current request of this connection
+            std::string     output;         // data to transmit that wasn't written to the socket yet
+            uint32_t        requests;       // number of requests received with this connection
+            int32_t         file;           // file whose content is transmitted after the output, or -1
+            off_t           fileOffset;     // number of bytes of the file that were already transmitted
+            off_t           fileSize;       // size of the file, in [bytes]
+            Stream*         stream;         // stream of signals transmitted with this connection, or NULL
+            int32_t         time;           // time of the last activity of this connection, in [ms]
+            bool            busy;           // flag indicating that a worker thread processes a request of this connection
+            bool            writing;        // flag indicating that the event loop waits for the socket to accept more output
+            bool            closing;        // flag indicating that the connection is closed when all output is written
+            bool            received;       // flag indicating that the client shut down its side of the connection, and won't send further requests
+            bool            closed;         // flag indicating that the client closed the connection
+        };
+        
+        /**
+         * The <code>CachedFile</code> struct holds the response header of a file, and its content if the file is small.
+         */
+        struct CachedFile {
+            time_t          modificationTime;   // time of the last modification of the file
+            off_t           size;               // size of the file, in [bytes]
+            std::string     entityTag;          // entity tag of this version of the file
+            std::string     lastModified;       // time of the last modification, formatted for the 'Last-Modified' header field
+            std::string     header;             // response header without the 'Connection' field
+            std::string     content;            // content of the file
+            bool            cached;             // flag indicating that the content of the file is cached
+        };
+        
+        /**
+         * The <code>Job</code> struct holds a script call that is processed by a worker thread.
+         */
+        struct Job {
+            Connection*                 connection;     // connection that received the request
+            HTTPScript*                 httpScript;     // script to call
+            std::vector<std::string>    names;          // names of the arguments
+            std::vector<std::string>    values;         // values of the arguments
+            bool                        head;           // flag indicating a HEAD request, which is answered without content
+            bool                        keepAlive;      // flag indicating that the connection is kept alive after the response
+            bool                        gzip;           // flag indicating that the client accepts responses compressed with gzip
+            std::string                 response;       // response with header and content
+        };
+        
+        /**
+         * The <code>Worker</code> class implements a thread that calls scripts.
+         */
+        class Worker : public Thread {
+            
+            public:
+                
+                                Worker(HTTPServer* httpServer);
+                virtual         ~Worker();
+                void            run();
+            
+            private:
+                
+                HTTPServer*             httpServer;
+                HTTPScript::Response    response;           // reusable response of the scripts
+                bool                    compression;        // flag indicating that the compressor is ready
+                z_stream_s*             compressor;         // compressor for responses encoded with gzip
+                std::string             compressedContent;  // reusable buffer for compressed content
+                
+                bool            compress(const std::string& content);
+        };
+        
         uint16_t                        portNumber;
         std::string                     path;
         std::string                     indexPage;
         std::vector<std::string>        httpScriptNames;
         std::vector<HTTPScript*>        httpScripts;
-        std::list<HTTPClientThread*>    httpClients;
-
-        std::string     urlDecoder(std::string url);
-        void            run();
-};
-
-class HTTPClientThread : public Thread {
-    
-    public:
+        std::vector<std::string>        telemetryNames;
+        std::vector<Telemetry*>         telemetries;
+        uint32_t                        maxConnections;
+        uint32_t                        maxRequestSize;
+        uint32_t                        maxRequestsPerConnection;
+        uint32_t                        maxPendingRequests;
+        int32_t                         keepAliveTimeout;
+        uint32_t                        numberOfWorkers;
+        volatile bool                   running;        // flag indicating that the server and its worker threads are running
+        int32_t                         serverSocket;   // listening socket of this server
+        int32_t                         pollFD;         // file descriptor of the epoll instance
+        int32_t                         wakeupPipe[2];  // pipe to wake up the event loop when a worker thread completed a job
+        pthread_mutex_t                 jobMutex;       // mutex to lock the queues of jobs
+        pthread_cond_t                  jobCondition;   // condition to signal worker threads that a job is pending
+        std::deque<Job*>                pendingJobs;    // jobs waiting for a worker thread
+        std::deque<Job*>                completedJobs;  // jobs completed by a worker thread
+        std::vector<Worker*>            workers;        // pool of worker threads
+        std::map<int32_t, Connection*>  connections;    // open connections, the key is the socket
+        std::unordered_map<std::string, CachedFile*> cachedFiles;  // cached files, the key is the filename
+        size_t                          cacheSize;      // total size of the content of cached files, in [bytes]
         
-                        HTTPClientThread(HTTPServer* httpServer, int32_t clientSocket);
-        virtual         ~HTTPClientThread();
-        void            run();
-    
-    private:
+        static const std::unordered_map<std::string, std::string>  contentTypes;  // content types, the key is the extension of a filename
         
-        HTTPServer*     httpServer;
-        int32_t         clientSocket;
+        void            init(uint16_t portNumber, std::string path, std::string indexPage);
+        void            run();
+        void            accept();
+        void            receive(Connection* connection);
+        void            transmit(Connection* connection);
+        void            process(Connection* connection);
+        void            complete();
+        void            subscribe(Connection* connection, std::string path, bool head, bool keepAlive);
+        void            publish(Connection* connection);
+        void            close(Connection* connection);
+        void            watch(Connection* connection, bool writing);
+        Job*            call(Connection* connection, std::string path, bool head, bool keepAlive);
+        void            getFile(Connection* connection, std::string path, std::string ifNoneMatch, std::string ifModifiedSince, bool head, bool keepAlive);
+        std::string     postFile(std::string path, std::string content, bool keepAlive);
+        bool            isValidPath(const std::string& path);
+        std::string     getContentType(std::string filename);
+        std::string     response(std::string status, std::string contentType, std::string contentEncoding, const std::string& content, bool head, bool keepAlive);
+        std::string     errorResponse(std::string status, std::string message, bool keepAlive);
 };
 
 #endif /* HTTP_SERVER_H_ */
@@ -0,0 +1,74 @@
+/*
+ * Histogram.h
+ * Copyright (c) 2026, ZHAW
+ * All rights reserved.
+ *
+ *  Created on: 17.10.2026
+ *      Author: Marcel Honegger
+ */
+
+#ifndef HISTOGRAM_H_
+#define HISTOGRAM_H_
+
+#include <cstdlib>
+#include <stdint.h>
+#include <atomic>
+
+/**
+ * The <code>Histogram</code> class counts the distribution of integer values, like latencies
+ * or execution times given in [ns], with a log-linear bucket layout. Values below 32 have
+ * their own buckets, and every power of 2 above is divided into 16 linear sub-buckets. The
+ * relative error of percentiles is therefore at most 1/16, over the whole range of values.
+ * Values from 2<sup>36</sup> on, i.e. 68 seconds given in nanoseconds, are counted in the
+ * last bucket.
+ * <br/>
+ * Recording a value takes constant time and integer operations only, and doesn't allocate
+ * memory, so that it may be used in a periodic realtime loop. The counters of a histogram are
+ * atomic, which allows another thread to copy a histogram while it is being updated, i.e.
+ * with the seqlock of the <code>RealtimeThread</code> class. A histogram may only be updated
+ * by one thread at a time.
+ * <pre><code>
+ * Histogram histogram;
+ * histogram.record(latency);
+ * ...
+ * uint64_t p99 = histogram.getPercentile(99.0);
+ * </code></pre>
+ */
+class Histogram {
+    
+    public:
+        
+        static const uint16_t   NUMBER_OF_BUCKETS = 528;    /**< Number of buckets of a histogram. */
+                    
+                    Histogram();
+                    Histogram(const Histogram& histogram);
+        virtual     ~Histogram();
+        Histogram&  operator=(const Histogram& histogram);
+        void        reset();
+        void        record(uint64_t value);
+        uint64_t    getCount();
+        uint64_t    getMin();
+        uint64_t    getMax();
+        uint64_t    getMean();
+        uint64_t    getPercentile(double percentile);
+        uint64_t    getBucketCount(uint16_t bucket);
+        static uint16_t getBucket(uint64_t value);
+        static uint64_t getLowerBound(uint16_t bucket);
+        static uint64_t getUpperBound(uint16_t bucket);
+        
+    private:
+        
+        static const uint8_t    SUB_BUCKET_BITS = 4;        // number of bits of a value that select a linear sub-bucket
+        static const uint16_t   SUB_BUCKETS = 1 << SUB_BUCKET_BITS; // number of linear sub-buckets per power of 2
+        static const uint8_t    MAX_EXPONENT = 35;          // exponent of the highest power of 2 with own buckets
+        
+        std::atomic<uint64_t>   buckets[NUMBER_OF_BUCKETS]; // counters of the buckets
+        std::atomic<uint64_t>   count;                      // number of recorded values
+        std::atomic<uint64_t>   sum;                        // sum of the recorded values
+        std::atomic<uint64_t>   min;                        // smallest recorded value
+        std::atomic<uint64_t>   max;                        // largest recorded value
+        
+        void        copy(const Histogram& histogram);
+};
+
+#endif /* HISTOGRAM_H_ */
@@ -16,12 +16,15 @@
 #include <cerrno>
 #include <csignal>
 #include <string>
+#include <vector>
 #include <sstream>
 #include <iostream>
 #include <stdint.h>
+#include <atomic>
 #include <unistd.h>
 #include <pthread.h>
 #include <limits.h>
+#include "Histogram.h"
 
 #if defined __QNX__
 
@@ -61,6 +64,41 @@
  *
  * myThread.stop();
  * </code></pre>
+ * A realtime thread may be pinned to a given CPU, or to one of the CPUs that are isolated
+ * from the scheduler of the operating system with the <code>isolcpus</code> kernel parameter.
+ * Threads that are pinned to isolated CPUs are distributed among these CPUs in the order they
+ * are started. The stack of a realtime thread is prefaulted when the thread starts, and the
+ * memory of the process should be locked with <code>lockMemory()</code> before realtime
+ * threads are created, so that periodic tasks don't suffer from page faults:
+ * <pre><code>
+ * RealtimeThread::lockMemory();
+ *
+ * MyThread myThread("myThread", 8192);
+ * myThread.setAffinity(RealtimeThread::CPU_ISOLATED);    <span style="color:#008000">// pin to an isolated CPU</span>
+ * myThread.start();
+ * </code></pre>
+ * By default, the period of a realtime thread is given by a periodic timer. Alternatively,
+ * a realtime thread may wait for absolute release times, which are multiples of its period
+ * on the monotonic clock of the system, plus a given offset. Threads with the same period
+ * are then released in a deterministic order, and offsets allow to stagger them within the
+ * period. The overrun policy defines what happens if a thread misses release times:
+ * <pre><code>
+ * myThread.setAbsoluteTiming(true);
+ * myThread.setOffset(0.0002);                                   <span style="color:#008000">// released 200 us after the others</span>
+ * myThread.setOverrunPolicy(RealtimeThread::OVERRUN_CATCH_UP);  <span style="color:#008000">// run missed periods back-to-back</span>
+ * </code></pre>
+ * On Linux, a realtime thread may also be scheduled with <code>SCHED_DEADLINE</code> instead of
+ * <code>SCHED_FIFO</code>, by giving it an execution time budget per period. The kernel then
+ * checks if the CPUs can accommodate this budget when the thread is started, and it throttles
+ * the thread when it exceeds its budget. If the kernel doesn't admit the thread, it keeps
+ * running with <code>SCHED_FIFO</code> and its priority level. Threads scheduled with
+ * <code>SCHED_DEADLINE</code> always wait for absolute release times, and periods where the
+ * thread exceeded its budget are counted as overruns:
+ * <pre><code>
+ * myThread.setPeriod(0.001);
+ * myThread.setRuntime(0.0002);                                  <span style="color:#008000">// budget of 200 us per period</span>
+ * myThread.start();
+ * </code></pre>
  * @see Thread
  */
 class RealtimeThread {
@@ -69,6 +107,29 @@ class RealtimeThread {
         
         static const int32_t RT_MIN_PRIORITY;   /**< Lowest priority level for realtime threads. */
         static const int32_t RT_MAX_PRIORITY;   /**< Highest priority level for realtime threads. */
+        static const int32_t CPU_ANY = -1;      /**< Affinity of a realtime thread that may run on any CPU. */
+        static const int32_t CPU_ISOLATED = -2; /**< Affinity of a realtime thread that runs on an isolated CPU. */
+        static const uint8_t OVERRUN_SKIP = 0;      /**< Overrun policy that skips missed release times. */
+        static const uint8_t OVERRUN_CATCH_UP = 1;  /**< Overrun policy that runs missed periods without waiting. */
+        static const uint8_t OVERRUN_NOTIFY = 2;    /**< Overrun policy that skips missed release times, and calls the <code>overrun()</code> method. */
+        
+        /**
+         * The <code>Statistics</code> class holds a snapshot of the statistics of a realtime
+         * thread, which is given by the <code>getStatistics()</code> method. The latency is the
+         * time between the release time of a period and the time the thread actually woke up,
+         * and the duration is the execution time of the thread within a period. Both are
+         * recorded in histograms in [ns], after the thread ran for a few seconds.
+         */
+        class Statistics {
+            
+            public:
+                
+                uint64_t    runs;           /**< Number of periods recorded in the histograms. */
+                uint64_t    overruns;       /**< Number of periods that took more than twice the period, or exceeded the execution time budget. */
+                uint64_t    missedPeriods;  /**< Number of release times that were missed since the thread was started. */
+                Histogram   latency;        /**< Histogram of the wakeup latency, given in [ns]. */
+                Histogram   duration;       /**< Histogram of the execution time per period, given in [ns]. */
+        };
         
                         RealtimeThread();
                         RealtimeThread(std::string name, size_t stackSize);
@@ -82,28 +143,74 @@ class RealtimeThread {
         int32_t         getPriority();
         void            setPeriod(double period);
         double          getPeriod();
+        void            setAffinity(int32_t affinity);
+        int32_t         getAffinity();
+        int32_t         getCPU();
+        void            setAbsoluteTiming(bool absoluteTiming);
+        bool            isAbsoluteTiming();
+        void            setOffset(double offset);
+        double          getOffset();
+        void            setOverrunPolicy(uint8_t overrunPolicy);
+        uint8_t         getOverrunPolicy();
+        uint64_t        getMissedPeriods();
+        void            getStatistics(Statistics& statistics);
+        void            setRuntime(double runtime);
+        double          getRuntime();
+        void            setDeadline(double deadline);
+        double          getDeadline();
+        bool            isDeadlineScheduled();
         bool            isAlive();
         virtual void    start();
         virtual void    stop();
         virtual void    run() {};
+        virtual void    overrun(uint64_t missedPeriods);
         bool            waitForNextPeriod();
         int32_t         join();
         int32_t         join(int32_t millis);
         std::string     toString();
+        static bool     lockMemory();
+        static std::vector<int32_t> getIsolatedCPUs();
     
     private:
         
         static const double     DELAY;      // delay for collecting statistical info in [s]
+        static const size_t     STACK_RESERVE = 16*1024;    // part at the end of the stack that isn't prefaulted, given in [bytes]
     
         static pthread_mutex_t  mutex;
         static bool             signalsInitialized;
         static bool*            signalNumbers;
+        static bool             memoryLocked;           // flag indicating that the memory of the process is locked
+        static uint32_t         numberOfIsolatedThreads;    // number of threads that were pinned to isolated CPUs
+        
+        struct SchedAttr {
+            uint32_t    size;               // size of this structure, given in [bytes]
+            uint32_t    schedPolicy;        // scheduling policy, i.e. SCHED_DEADLINE
+            uint64_t    schedFlags;         // flags of the scheduling policy
+            int32_t     schedNice;          // nice value for SCHED_OTHER
+            uint32_t    schedPriority;      // priority level for SCHED_FIFO
+            uint64_t    schedRuntime;       // execution time budget per period, given in [ns]
+            uint64_t    schedDeadline;      // relative deadline, given in [ns]
+            uint64_t    schedPeriod;        // period, given in [ns]
+        };
         
         pthread_attr_t  threadAttr;
         sched_param     schedParam;
         pthread_t       threadID;
         std::string     name;
         int32_t         threadState;
+        int32_t         affinity;
+        int32_t         cpu;
+        bool            stackPrefaulted;
+        bool            absoluteTiming;
+        uint8_t         overrunPolicy;
+        double          offset;
+        int64_t         periodTime;         // period in [ns]
+        int64_t         releaseTimeNext;    // next absolute release time on the monotonic clock in [ns]
+        std::atomic<uint64_t>   missedPeriods;
+        double          runtime;            // execution time budget per period with SCHED_DEADLINE in [s], or 0 for SCHED_FIFO
+        double          deadline;           // relative deadline with SCHED_DEADLINE in [s], or 0 for the period
+        bool            deadlineScheduled;  // flag indicating that the kernel admitted this thread with SCHED_DEADLINE
+        bool            absoluteRelease;    // flag indicating that this thread waits for absolute release times
         
         #if defined __QNX__
         
@@ -118,23 +225,22 @@ class RealtimeThread {
         
         #endif
         
-        uint64_t        runs;
-        uint64_t        overruns;
+        std::atomic<uint32_t>   sequence;   // sequence number of the seqlock that protects the statistics, odd while they are written
+        std::atomic<uint64_t>   runs;
+        std::atomic<uint64_t>   overruns;
+        Histogram       latency;            // histogram of the wakeup latency in [ns]
+        Histogram       duration;           // histogram of the execution time in [ns]
         uint64_t        freeRuns;
-        double          releaseTime;
+        int64_t         releaseTimeLast;    // time of the last release in [ns]
         double          period;
-        double          periodActual;
-        double          periodMin;
-        double          periodMax;
-        double          periodMean;
-        double          periodDeviation;
-        double          durationActual;
-        double          durationMin;
-        double          durationMax;
-        double          durationMean;
-        double          durationDeviation;
         
+        void            updateStatistics(int64_t time0, int64_t time1, int64_t releaseTime, uint64_t missed);
+        void            beginUpdate();
+        void            endUpdate();
+        static int64_t  getTime();
         static uint32_t getSignalNumber();
+        static size_t   getFreeStackSize(size_t stackSize);
+        static void     prefaultStack(size_t size);
         static void     runHandler(RealtimeThread* realtimeThread);
 };
 
@@ -0,0 +1,103 @@
+/*
+ * Telemetry.h
+ * Copyright (c) 2026, ZHAW
+ * All rights reserved.
+ *
+ *  Created on: 17.10.2026
+ *      Author: Marcel Honegger
+ */
+
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include <cstdlib>
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+class Channel;
+class AnalogIn;
+class AnalogOut;
+class DigitalIn;
+class DigitalOut;
+class EncoderCounter;
+
+/**
+ * The <code>Telemetry</code> class records the values of a set of named signals, like the
+ * channels of periphery modules or variables of a controller, so that they can be streamed
+ * to clients of an <code>HTTPServer</code>. The signals are sampled by a realtime thread,
+ * which writes the values into a ring buffer without locks, system calls or memory
+ * allocations. Other threads read the samples concurrently, without disturbing the realtime
+ * thread, and skip samples that were overwritten in the meantime.
+ * <br/>
+ * Signals must be added before the realtime thread starts to sample them, adding a signal
+ * after the first sample throws an exception. Channels are added with the name they were
+ * given with their <code>setName()</code> method:
+ * <pre><code>
+ * Telemetry telemetry;
+ * telemetry.add(analogIn);
+ * telemetry.add(encoderCounter);
+ * telemetry.add("velocity", velocity);
+ * httpServer.add("robot", &telemetry);
+ * ...
+ * void MyController::run() {
+ *     while (waitForNextPeriod()) {
+ *         ...
+ *         telemetry.sample();
+ *     }
+ * }
+ * </code></pre>
+ * Clients subscribe to signals with a request like
+ * <code>/events/robot?signals=x,y&rate=100</code>, see <code>HTTPServer</code>.
+ */
+class Telemetry {
+    
+    public:
+        
+        static const uint32_t   SAMPLES = 4096;     /**< Number of samples of the ring buffer. */
+                        
+                        Telemetry();
+        virtual         ~Telemetry();
+        void            add(AnalogIn& analogIn);
+        void            add(AnalogOut& analogOut);
+        void            add(DigitalIn& digitalIn);
+        void            add(DigitalOut& digitalOut);
+        void            add(EncoderCounter& encoderCounter);
+        void            add(std::string name, double& value);
+        uint32_t        getNumberOfSignals();
+        std::string     getName(uint32_t signal);
+        int32_t         getSignal(std::string name);
+        void            sample();
+        uint64_t        getNumberOfSamples();
+        uint32_t        read(uint64_t& sample, std::vector<int64_t>& times, std::vector<double>& values);
+        
+    private:
+        
+        enum Type {
+            ANALOG_IN,
+            ANALOG_OUT,
+            DIGITAL_IN,
+            DIGITAL_OUT,
+            ENCODER_COUNTER,
+            VALUE
+        };
+        
+        struct Signal {
+            std::string     name;       // name of the signal
+            Type            type;       // type of the source of the signal
+            Channel*        channel;    // channel that is sampled, or NULL
+            double*         value;      // variable that is sampled, or NULL
+        };
+        
+        std::vector<Signal>     signals;    // signals that are sampled
+        std::atomic<int64_t>*   times;      // ring of the times of the samples, on the monotonic clock in [ns]
+        std::atomic<double>*    values;     // ring of the values of the samples, with the values of all signals per sample
+        std::atomic<uint64_t>   next;       // number of samples that were begun to be written
+        std::atomic<uint64_t>   head;       // number of samples that were written
+        
+        void            add(std::string name, Type type, Channel* channel, double* value);
+};
+
+#endif /* TELEMETRY_H_ */
@@ -13,15 +13,18 @@
 #include <cstdlib>
 #include <stdint.h>
 #include "RealtimeThread.h"
+#include "CyclicExecutor.h"
 
 /**
  * The <code>Timer</code> class implements a simple timer counting milliseconds.
+ * A timer either uses its own realtime thread, or it is executed by a cyclic executor.
  */
-class Timer : public RealtimeThread {
+class Timer : public CyclicExecutor::Task {
     
     public:
     
                     Timer();
+                    Timer(CyclicExecutor& cyclicExecutor);
         virtual     ~Timer();
         void        start();
         void        stop();
@@ -33,10 +36,29 @@ class Timer : public RealtimeThread {
         
         static const size_t STACK_SIZE = 64*1024;   // stack size of thread in [bytes]
         
-        uint32_t    time;
-        bool        running;
+        /**
+         * The <code>Handler</code> class implements the private thread of a timer
+         * that isn't executed by a cyclic executor.
+         */
+        class Handler : public RealtimeThread {
+            
+            public:
+                
+                            Handler(Timer* timer);
+                virtual     ~Handler();
+                void        run();
+            
+            private:
+                
+                Timer*      timer;
+        };
         
-        void        run();
+        Handler*        handler;
+        CyclicExecutor* cyclicExecutor;
+        uint32_t        time;
+        bool            running;
+        
+        void        execute();
 };
 
 #endif /* TIMER_H_ */
@@ -0,0 +1,126 @@
+/*
+ * Trace.h
+ * Copyright (c) 2026, ZHAW
+ * All rights reserved.
+ *
+ *  Created on: 17.10.2026
+ *      Author: Marcel Honegger
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <cstdlib>
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <pthread.h>
+
+/**
+ * The <code>Trace</code> class records timestamped events of the threads of an application,
+ * which show where the time goes within the periods of realtime threads. Every thread writes
+ * its events into its own ring buffer, without locks, system calls or memory allocations, so
+ * that tracing doesn't disturb realtime threads. When a ring buffer is full, the oldest events
+ * are overwritten.
+ * <br/>
+ * Tracing is disabled by default, and recording an event then only costs a test of a flag.
+ * The realtime threads, the EtherCAT and CANopen stacks and their device drivers are already
+ * instrumented. Additional code may be instrumented with spans that begin and end with the
+ * scope of a <code>Trace::Span</code> object, or with pairs of <code>begin()</code> and
+ * <code>end()</code> calls. Names of events must be string literals, or other strings that
+ * exist as long as the trace. The recorded events can be written into a file with the JSON
+ * trace event format, which can be viewed as a timeline with <code>chrome://tracing</code>
+ * or the Perfetto UI.
+ * <pre><code>
+ * Trace::enable();
+ * ...
+ * void MyDevice::readDatagram() {
+ *     Trace::Span span("MyDevice::readDatagram");
+ *     ...
+ * }
+ * ...
+ * Trace::write("/tmp/trace.json");
+ * </code></pre>
+ * Realtime threads register themselves with their name before they start to run, other
+ * threads may call the <code>setThreadName()</code> method. The ring buffers of registered
+ * threads are allocated when tracing is enabled, so that they aren't allocated in a periodic
+ * loop. Threads that didn't register get their ring buffer with their first event while
+ * tracing is enabled. The ring buffer of a thread that exited is reused by another thread,
+ * once its events were cleared.
+ */
+class Trace {
+    
+    public:
+        
+        static const uint32_t   EVENTS = 8192;      /**< Number of events of the ring buffer of a thread. */
+        
+        /**
+         * The <code>Span</code> class records a span of a given name, which begins when this
+         * object is created, and which ends when this object is deleted, i.e. at the end of
+         * the scope of a local object.
+         */
+        class Span {
+            
+            public:
+                            
+                            Span(const char* name);
+                virtual     ~Span();
+                
+            private:
+                
+                const char* name;   // name of this span
+        };
+        
+        static void         enable();
+        static void         disable();
+        static bool         isEnabled();
+        static void         setThreadName(std::string threadName);
+        static void         begin(const char* name);
+        static void         end(const char* name);
+        static void         instant(const char* name);
+        static void         clear();
+        static std::string  toJSON();
+        static void         write(std::string filename);
+        
+    private:
+        
+        struct Event {
+            std::atomic<int64_t>        time;       // time of the event on the monotonic clock, in [ns]
+            std::atomic<const char*>    name;       // name of the event
+            std::atomic<char>           phase;      // phase of the event, 'B', 'E' or 'i'
+        };
+        
+        struct Buffer {
+            uint32_t                    threadID;   // sequential number of the buffer, shown as the thread
+            std::string                 threadName; // name of the thread that owns this buffer
+            bool                        released;   // flag indicating that the thread of this buffer exited
+            std::atomic<uint64_t>       next;       // number of events that were begun to be written since the buffer was created
+            std::atomic<uint64_t>       head;       // number of events written since the buffer was created
+            std::atomic<uint64_t>       tail;       // number of the first event that wasn't cleared
+            Event                       events[EVENTS]; // ring of events
+        };
+        
+        struct Thread {
+            std::string                 threadName; // name of the thread, or an empty string
+            std::atomic<Buffer*>        buffer;     // ring buffer of the thread, or NULL
+        };
+        
+        static std::atomic<bool>        enabled;    // flag indicating that events are recorded
+        static pthread_mutex_t          mutex;      // mutex to lock the lists of threads and buffers
+        static pthread_once_t           once;       // initialization of the key
+        static pthread_key_t            key;        // key with a destructor that releases the ring buffer of an exiting thread
+        static std::vector<Thread*>     threads;    // threads that were registered and didn't exit yet
+        static std::vector<Buffer*>     buffers;    // buffers of all threads that recorded events
+        static thread_local Thread*     thread;     // the calling thread
+        
+        static void         createKey();
+        static void         releaseThread(void* thread);
+        static Thread*      getThread();
+        static Buffer*      getBuffer();
+        static Buffer*      allocateBuffer(Thread* thread);
+        static void         record(const char* name, char phase);
+};
+
+#endif /* TRACE_H_ */
@@ -62,7 +62,7 @@ class BeckhoffEL1000 : public Module, CoE::SlaveDevice {
         Mutex       mutex;                  // mutex to lock critical sections
         uint8_t     inputBuffer;
         
-        EtherCAT::Datagram*     txPDO;
+        EtherCAT::ProcessData*  txPDO;
         
         void        writeDatagram();
         void        readDatagram();
@@ -61,7 +61,7 @@ class BeckhoffEL2000 : public Module, CoE::SlaveDevice {
         Mutex       mutex;                  // mutex to lock critical sections
         uint8_t     outputBuffer;
         
-        EtherCAT::Datagram*     rxPDO;
+        EtherCAT::ProcessData*  rxPDO;
         
         void        writeDatagram();
         void        readDatagram();
@@ -68,7 +68,7 @@ class BeckhoffEL3102 : public Module, CoE::SlaveDevice {
         Mutex       mutex;                                  // mutex to lock critical sections
         int16_t     inputBuffer[NUMBER_OF_ANALOG_INPUTS];   // buffer for input values
         
-        EtherCAT::Datagram*     txPDO;
+        EtherCAT::ProcessData*  txPDO;
         
         void        writeDatagram();
         void        readDatagram();
@@ -67,7 +67,7 @@ class BeckhoffEL4004 : public Module, CoE::SlaveDevice {
         Mutex       mutex;                                  // mutex to lock critical sections
         int16_t     outputBuffer[NUMBER_OF_ANALOG_OUTPUTS]; // buffer for output values
         
-        EtherCAT::Datagram*     rxPDO;
+        EtherCAT::ProcessData*  rxPDO;
         
         void        writeDatagram();
         void        readDatagram();
@@ -58,12 +58,15 @@ class BeckhoffEL4732 : public Module, CoE::SlaveDevice {
 
         EtherCAT&   etherCAT;                               // reference to EtherCAT stack
         CoE&        coe;                                    // reference to CANopen over EtherCAT driver
+        uint16_t    deviceAddress;                          // relative device address
+        double      period;                                 // period of the SYNC0 signal, given in [s]
         Mutex       mutex;                                  // mutex to lock critical sections
         int16_t     outputBuffer[NUMBER_OF_ANALOG_OUTPUTS]; // buffer for output values
 
-        EtherCAT::Datagram*     rxPDO1;
-        EtherCAT::Datagram*     rxPDO2;
+        EtherCAT::ProcessData*  rxPDO1;
+        EtherCAT::ProcessData*  rxPDO2;
         
+        void        configure();
         void        writeDatagram();
         void        readDatagram();
 };
@@ -62,8 +62,8 @@ class BeckhoffEL5101 : public CoE::SlaveDevice {
         uint16_t    value;          // buffer for input value
         uint16_t    latch;          // buffer for input value
         
-        EtherCAT::Datagram*     rxPDO;
-        EtherCAT::Datagram*     txPDO;
+        EtherCAT::ProcessData*  rxPDO;
+        EtherCAT::ProcessData*  txPDO;
         
         void        writeDatagram();
         void        readDatagram();
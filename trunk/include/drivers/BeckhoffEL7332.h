@@ -67,15 +67,17 @@ class BeckhoffEL7332 : public Module, CoE::SlaveDevice {
 
         EtherCAT&   etherCAT;           // reference to EtherCAT stack
         CoE&        coe;                // reference to CANopen over EtherCAT driver
+        uint16_t    deviceAddress;      // relative device address
         Mutex       mutex;              // mutex to lock critical sections
         uint16_t    controlChannel1;    // output buffer for channel 1
         uint16_t    controlChannel2;    // output buffer for channel 2
         int16_t     velocityChannel1;   // output buffer for channel 1
         int16_t     velocityChannel2;   // output buffer for channel 2
         
-        EtherCAT::Datagram*     txPDO;
-        EtherCAT::Datagram*     rxPDO;
+        EtherCAT::ProcessData*  txPDO;
+        EtherCAT::ProcessData*  rxPDO;
         
+        void        configure();
         void        writeDatagram();
         void        readDatagram();
 };
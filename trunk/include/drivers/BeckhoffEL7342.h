@@ -72,6 +72,7 @@ class BeckhoffEL7342 : public Module, CoE::SlaveDevice {
 
         EtherCAT&   etherCAT;           // reference to EtherCAT stack
         CoE&        coe;                // reference to CANopen over EtherCAT driver
+        uint16_t    deviceAddress;      // relative device address
         Mutex       mutex;              // mutex to lock critical sections
         uint16_t    controlChannel1;    // output buffer for channel 1
         uint16_t    controlChannel2;    // output buffer for channel 2
@@ -80,9 +81,10 @@ class BeckhoffEL7342 : public Module, CoE::SlaveDevice {
         int32_t     positionChannel1;   // input buffer for position value 1
         int32_t     positionChannel2;   // input buffer for position value 2
 
-        EtherCAT::Datagram*     txPDO;
-        EtherCAT::Datagram*     rxPDO;
+        EtherCAT::ProcessData*  txPDO;
+        EtherCAT::ProcessData*  rxPDO;
 
+        void        configure();
         void        writeDatagram();
         void        readDatagram();
 };
@@ -28,6 +28,9 @@ class CAN {
         virtual void            frequency(uint32_t hz);
 		virtual int32_t         write(CANMessage canMessage);
 		virtual int32_t         read(CANMessage& canMessage);
+        virtual int32_t         read(CANMessage& canMessage, uint64_t& timestamp);
+        virtual uint32_t        getTransmitOverflows();
+        virtual uint32_t        getReceiveOverflows();
 };
 
 #endif /* CAN_H_ */
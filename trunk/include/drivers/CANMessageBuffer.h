@@ -0,0 +1,65 @@
+/*
+ * CANMessageBuffer.h
+ * Copyright (c) 2026, ZHAW
+ * All rights reserved.
+ *
+ *  Created on: 17.10.2026
+ *      Author: Marcel Honegger
+ */
+
+#ifndef CAN_MESSAGE_BUFFER_H_
+#define CAN_MESSAGE_BUFFER_H_
+
+#include <cstdlib>
+#include <atomic>
+#include <stdint.h>
+#include "CANMessage.h"
+
+/**
+ * The <code>CANMessageBuffer</code> class implements a ring buffer with a fixed capacity for
+ * CAN messages. It is used by CAN device drivers as software transmit and receive buffer
+ * between application threads and the realtime thread of the driver.
+ * <br/>
+ * The buffer is lock-free: writing and reading a message never blocks, and doesn't allocate
+ * memory. Several threads may write messages into the buffer concurrently, and several threads
+ * may read messages from it. Each slot of the buffer has a sequence number, which tells if the
+ * slot is free to be written, or if it contains a message to be read.
+ * <br/>
+ * Messages may be stored with a timestamp, i.e. their time of reception. Messages that can't be
+ * written because the buffer is full are counted as overflows.
+ */
+class CANMessageBuffer {
+    
+    public:
+        
+                    CANMessageBuffer(uint16_t size);
+        virtual     ~CANMessageBuffer();
+        uint32_t    getCapacity();
+        bool        write(const CANMessage& canMessage);
+        bool        write(const CANMessage& canMessage, uint64_t timestamp);
+        bool        read(CANMessage& canMessage);
+        bool        read(CANMessage& canMessage, uint64_t& timestamp);
+        uint32_t    getOverflows();
+        void        resetOverflows();
+        
+    private:
+        
+        struct Slot {
+            std::atomic<uint32_t>   sequence;       // sequence number of this slot
+            CANMessage              canMessage;     // CAN message stored in this slot
+            uint64_t                timestamp;      // time of reception of this message, or 0
+        };
+        
+        static const uint16_t   CACHE_LINE_SIZE = 64;   // size of a cache line of the processor, given in [bytes]
+        
+        Slot*                   slots;                      // array of slots with CAN messages
+        uint32_t                mask;                       // mask to get the index of a slot from a position
+        uint8_t                 padding1[CACHE_LINE_SIZE];  // separates the positions of writers and readers in the cache
+        std::atomic<uint32_t>   writePosition;              // position of the next slot to write
+        uint8_t                 padding2[CACHE_LINE_SIZE];
+        std::atomic<uint32_t>   readPosition;               // position of the next slot to read
+        uint8_t                 padding3[CACHE_LINE_SIZE];
+        std::atomic<uint32_t>   overflows;                  // number of messages that couldn't be written
+};
+
+#endif /* CAN_MESSAGE_BUFFER_H_ */
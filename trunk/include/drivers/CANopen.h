@@ -13,8 +13,11 @@
 #include <cstdlib>
 #include <string>
 #include <sstream>
+#include <vector>
+#include <map>
 #include <stdexcept>
 #include <stdint.h>
+#include <atomic>
 #include <pthread.h>
 #include "Mutex.h"
 #include "CANMessage.h"
@@ -27,6 +30,42 @@ class CAN;
  * CANopen slave devices, like industrial I/O or servo drives. It allows to
  * transmit CANopen objects to given nodes, to receive objects from nodes, and
  * to communicate with the service data object (SDO) server of a CANopen device.
+ * <br/>
+ * The handler of this driver reads all messages received by the CAN device driver
+ * in every period, and dispatches them with a table that maps the COB-ID of a message
+ * to the registered device driver and the buffer of the respective node. For every node,
+ * the number of received and lost objects and the latency between the reception of an
+ * object and its dispatch are recorded. The latency is only known when the CAN device
+ * driver provides timestamps of received messages, like the <code>SocketCAN</code> driver.
+ * <br/>
+ * This driver may also act as SYNC producer. In every SYNC period, it asks all
+ * registered device drivers to transmit their receive process data objects (RPDOs),
+ * so that they are transmitted back-to-back, and then it transmits the SYNC object.
+ * Slave devices with synchronous transmit process data objects (TPDOs) reply to the
+ * SYNC object, and these objects are dispatched by the handler of this driver.
+ * <br/>
+ * Service data objects are transferred asynchronously by the handler of this driver.
+ * Every node has a queue of service data objects, and the handler keeps one transfer
+ * per node in progress, so that the transfers to different nodes run in parallel.
+ * Expedited, segmented and block transfers are supported. A transfer completes either
+ * by waiting for it, or with a callback method, as shown below:
+ * <pre><code>
+ * CANopen::ServiceDataObject serviceDataObject(0x6060, 0x00, 1);
+ * serviceDataObject.setValue(0x08, 1);
+ * canOpen.download(nodeID, serviceDataObject);
+ * ...
+ * if (!serviceDataObject.waitForCompletion()) cerr << "abort code: " << serviceDataObject.getAbortCode() << endl;
+ * </code></pre>
+ * The methods <code>writeSDO()</code> and <code>readSDO()</code> use this mechanism to
+ * transfer expedited service data objects, and wait until the transfer is completed.
+ * <br/>
+ * The mapping and the communication parameters of process data objects are described with
+ * <code>ProcessDataObject</code> objects, which are applied in bulk with the method
+ * <code>configureProcessDataObjects()</code>. This driver keeps a snapshot of the values of
+ * the object dictionary of every node that were transferred with service data objects, and
+ * it skips writes of values that are already set. When a device driver is created again
+ * while the nodes are running, i.e. to recover from a fault, most of the configuration
+ * traffic is avoided. The snapshot of a node is discarded when the node is reset.
  */
 class CANopen : public RealtimeThread {
     
@@ -36,12 +75,131 @@ class CANopen : public RealtimeThread {
          * This Delegate is an interface for receivers of CANopen objects.
          * Device drivers that use the CANopen stack should implement this class
          * and register themselves with the CANopen device driver.
+         * <br/>
+         * When the SYNC producer of the CANopen device driver is enabled, the
+         * <code>transmitObjects()</code> method of all registered delegates is
+         * called once per SYNC period, just before the SYNC object is transmitted.
+         * Device drivers may implement this method to transmit their process
+         * data objects synchronously, instead of using their own thread.
          */
         class Delegate {
             
             public:
                 
                 virtual void    receiveObject(uint32_t functionCode, uint8_t object[]);
+                virtual void    transmitObjects();
+        };
+        
+        /**
+         * The <code>ServiceDataObject</code> class describes the transfer of a service
+         * data object with the SDO server of a CANopen node. It contains a buffer for the
+         * value of the object, and the state of the transfer. The <code>completed()</code>
+         * method may be overridden to handle the result of a transfer without waiting for it.
+         */
+        class ServiceDataObject {
+            
+            friend class CANopen;
+            
+            public:
+                
+                static const uint8_t    STATE_IDLE = 0;         /**< State of a service data object that wasn't transferred yet. */
+                static const uint8_t    STATE_PENDING = 1;      /**< State of a service data object while it is transferred. */
+                static const uint8_t    STATE_COMPLETED = 2;    /**< State of a service data object after a successful transfer. */
+                static const uint8_t    STATE_ABORTED = 3;      /**< State of a service data object after a failed transfer. */
+                
+                uint8_t*        data;       // buffer with the value of this object
+                uint16_t        length;     // length of the value of this object, given in [bytes]
+                                
+                                ServiceDataObject(uint16_t index, uint8_t subindex, uint16_t size);
+                                ServiceDataObject(uint16_t index, uint8_t subindex, uint16_t size, bool block);
+                virtual         ~ServiceDataObject();
+                uint16_t        getIndex();
+                uint8_t         getSubindex();
+                void            setValue(uint32_t value, uint16_t length);
+                uint32_t        getValue();
+                uint8_t         getState();
+                uint32_t        getAbortCode();
+                bool            waitForCompletion();
+                virtual void    completed();
+            
+            private:
+                
+                static const uint8_t    PHASE_IDLE = 0;             // phases of a transfer
+                static const uint8_t    PHASE_INITIATE = 1;
+                static const uint8_t    PHASE_SEGMENT = 2;
+                static const uint8_t    PHASE_BLOCK_INITIATE = 3;
+                static const uint8_t    PHASE_BLOCK = 4;
+                static const uint8_t    PHASE_BLOCK_END = 5;
+                
+                uint16_t                index;
+                uint8_t                 subindex;
+                uint16_t                size;           // size of the buffer in [bytes]
+                bool                    block;          // flag for a block transfer
+                std::atomic<uint8_t>    state;          // state of the transfer, i.e. STATE_PENDING
+                uint8_t                 result;         // state of this object after the completion callback
+                uint32_t                abortCode;
+                bool                    download;       // flag for a download, or an upload otherwise
+                uint8_t                 phase;          // phase of the transfer, i.e. PHASE_INITIATE
+                uint16_t                offset;         // number of bytes transferred
+                uint8_t                 toggle;         // toggle bit of the next segment
+                uint16_t                blockOffset;    // number of bytes transferred before the current block
+                uint8_t                 blockSize;      // number of segments per block
+                uint8_t                 sequence;       // sequence number of the last segment of the current block
+                bool                    last;           // the last segment of a block transfer was transferred
+                uint32_t                retries;        // number of repeated initiate requests
+                int32_t                 time;           // time of the last request or response, given in [ms]
+                ServiceDataObject*      next;           // next object in the queue of a node
+        };
+        
+        /**
+         * The <code>ProcessDataObject</code> class describes the mapping and the communication
+         * parameters of a receive or transmit process data object of a node. The entries that
+         * are mapped into this object are added in the order they appear in the object. This
+         * description also allows device drivers to pack and unpack the values of these entries,
+         * as shown below:
+         * <pre><code>
+         * CANopen::ProcessDataObject rpdo1(CANopen::RPDO1);
+         * rpdo1.addEntry(0x6040, 0x00, 16);   <span style="color:#008000">// controlword, 16 bit</span>
+         * rpdo1.addEntry(0x607A, 0x00, 32);   <span style="color:#008000">// target position, 32 bit</span>
+         * ...
+         * uint8_t object[8];
+         * rpdo1.pack(object, 0, controlword);
+         * rpdo1.pack(object, 1, targetPosition);
+         * canOpen.transmitObject(CANopen::RPDO1, nodeID, object, rpdo1.getLength());
+         * </code></pre>
+         */
+        class ProcessDataObject {
+            
+            friend class CANopen;
+            
+            public:
+                
+                                ProcessDataObject(uint32_t functionCode);
+                                ProcessDataObject(uint32_t functionCode, uint8_t transmissionType);
+                virtual         ~ProcessDataObject();
+                uint32_t        getFunctionCode();
+                void            setTransmissionType(uint8_t transmissionType);
+                void            setInhibitTime(uint16_t inhibitTime);
+                void            setEventTimer(uint16_t eventTimer);
+                void            addEntry(uint16_t index, uint8_t subindex, uint8_t length);
+                uint8_t         getNumberOfEntries();
+                uint8_t         getLength();
+                void            pack(uint8_t object[], uint8_t entry, uint32_t value);
+                uint32_t        unpack(uint8_t object[], uint8_t entry);
+            
+            private:
+                
+                static const uint8_t    INHIBIT_TIME = 0x01;    // flags of optional communication parameters
+                static const uint8_t    EVENT_TIMER = 0x02;
+                
+                uint32_t                functionCode;       // function code of this object, i.e. RPDO1 or TPDO2
+                uint8_t                 transmissionType;   // transmission type, i.e. 1 for synchronous, or 255 for event driven transmission
+                uint16_t                inhibitTime;        // minimum time between transmissions, given in [100 us]
+                uint16_t                eventTimer;         // time between event driven transmissions, given in [ms]
+                uint8_t                 parameters;         // flags of the optional communication parameters that are set
+                std::vector<uint32_t>   entries;            // mapped entries, encoded as index << 16 | subindex << 8 | length
+                std::vector<uint8_t>    offsets;            // offsets of the mapped entries in this object, given in [bits]
+                uint8_t                 length;             // length of this object, given in [bits]
         };
         
         static const uint32_t NMT = 0x000;          /**< CANopen function code. */
@@ -73,11 +231,21 @@ class CANopen : public RealtimeThread {
         void        transmitObject(uint32_t functionCode, uint32_t nodeID, uint8_t object[], uint8_t length = 8, CANType type = CANData);
         void        transmitNMTObject(uint8_t command, uint32_t nodeID);
         void        transmitSYNCObject();
+        void        setSYNCPeriod(double period);
+        double      getSYNCPeriod();
         void        requestNodeguardObject(uint32_t nodeID);
         bool        receiveObject(uint32_t functionCode, uint32_t nodeID, uint8_t object[]);
         void        resetObject(uint32_t functionCode, uint32_t nodeID);
         void        writeSDO(uint32_t nodeID, uint16_t index, uint8_t subindex, uint32_t value, uint8_t length);
         uint32_t    readSDO(uint32_t nodeID, uint16_t index, uint8_t subindex);
+        void        upload(uint32_t nodeID, ServiceDataObject& serviceDataObject);
+        void        download(uint32_t nodeID, ServiceDataObject& serviceDataObject);
+        void        configureProcessDataObjects(uint32_t nodeID, std::vector<ProcessDataObject*>& processDataObjects);
+        uint32_t    getNumberOfReceivedObjects(uint32_t nodeID);
+        uint32_t    getNumberOfLostObjects(uint32_t nodeID);
+        double      getLatencyMean(uint32_t nodeID);
+        double      getLatencyMax(uint32_t nodeID);
+        void        resetStatistics();
         
     private:
         
@@ -87,13 +255,28 @@ class CANopen : public RealtimeThread {
         
         static const uint32_t   FUNCTION_CODE_BITMASK = 0x780;  // bitmasks for decoding the CAN identifier
         static const uint32_t   NODE_ID_BITMASK = 0x07F;
+        static const uint32_t   COB_ID_BITMASK = 0x7FF;
+        static const uint32_t   COB_IDS = 0x800;                // number of COB-IDs with standard CAN identifiers
+        
+        /**
+         * A receiver describes how an object with a given COB-ID is dispatched.
+         */
+        struct Receiver {
+            uint32_t    functionCode;       // function code of this object
+            uint32_t    nodeID;             // node ID of this object
+            uint8_t*    object;             // buffer for this object, or NULL if the object isn't buffered
+            bool*       received;           // flag indicating that this object was received
+            bool        pending;            // flag indicating that the object in the buffer wasn't read yet
+        };
         
         static const uint32_t   TIMEOUT = 1000;         // max time to wait for a reply on an SDO request in [ms]
         static const uint32_t   RETRIES = 5;            // max number of retries to get an SDO, within the timeout limit
+        static const uint8_t    BLOCK_SIZE = 32;        // number of segments per block of a block upload
         
         CAN&                can;
         Delegate*           delegate[128];              // registered CANopen slave device drivers
         Mutex               mutex;                      // mutex to lock critical sections
+        Mutex               sdoMutex;                   // mutex to lock the queues of service data objects
         
         bool                emergencyObjectReceived[128];
         bool                tpdo1Received[128];
@@ -111,6 +294,32 @@ class CANopen : public RealtimeThread {
         uint8_t             tsdo[128][8];
         uint8_t             nodeguardObject[128][8];
         
+        Receiver            receivers[COB_IDS];         // table to dispatch objects, indexed by their COB-ID
+        
+        std::atomic<uint32_t>   syncPeriods;            // period of the SYNC producer as a multiple of the period of the handler, or 0
+        uint32_t            syncCounter;                // number of periods of the handler since the last SYNC object, only used by the handler
+        
+        ServiceDataObject*  firstServiceDataObject[128];    // queues of service data objects of every node
+        ServiceDataObject*  lastServiceDataObject[128];
+        
+        std::map<uint32_t, uint32_t>    objectDictionary[128];  // snapshots of the object dictionaries of every node, the key is index << 8 | subindex
+        
+        uint32_t            numberOfReceivedObjects[128];   // statistics of every node
+        uint32_t            numberOfLostObjects[128];
+        uint32_t            numberOfMeasuredLatencies[128];
+        double              latencySum[128];
+        double              latencyMax[128];
+        
+        Receiver&           getReceiver(uint32_t functionCode, uint32_t nodeID);
+        bool                isSet(std::map<uint32_t, uint32_t>& snapshot, uint16_t index, uint8_t subindex, uint32_t value);
+        ServiceDataObject*  write(uint32_t nodeID, uint16_t index, uint8_t subindex, uint32_t value, uint8_t length);
+        void                transfer(uint32_t nodeID, ServiceDataObject& serviceDataObject, bool download);
+        void                transmitRequest(uint32_t nodeID, ServiceDataObject* serviceDataObject);
+        void                transmitSegments(uint32_t nodeID, ServiceDataObject* serviceDataObject);
+        void                transmitAbortRequest(uint32_t nodeID, ServiceDataObject* serviceDataObject, uint32_t abortCode);
+        void                processResponse(uint32_t nodeID, uint8_t response[], ServiceDataObject*& completed);
+        void                processTransfers(ServiceDataObject*& completed);
+        void                complete(uint32_t nodeID, uint32_t abortCode, ServiceDataObject*& completed);
         void                run();
 };
 
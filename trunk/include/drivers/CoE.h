@@ -12,9 +12,12 @@
 
 #include <cstdlib>
 #include <cstdio>
+#include <atomic>
 #include <vector>
+#include <string>
 #include <stdint.h>
 #include "EtherCAT.h"
+#include "Mutex.h"
 #include "RealtimeThread.h"
 
 /**
@@ -23,6 +26,53 @@
  * slave device to configure that device. It also offers a method to register
  * EtherCAT datagrams that contain process data (input and output).
  * <br/><br/>
+ * Alternatively, slave device drivers may register sections of a logical process image
+ * with the <code>registerProcessData()</code> method. This class then configures an FMMU
+ * of the given slave device to map its process data RAM into this logical process image,
+ * and exchanges the process data of all slave devices with a single LRW datagram, instead
+ * of one datagram per slave device.
+ * <br/>
+ * All registered datagrams are laid out in a preallocated EtherCAT frame when they are
+ * registered, so that the periodic communication loop does neither allocate memory nor
+ * copy datagrams.
+ * <br/><br/>
+ * Slave device drivers that declare their SYNC managers with <code>configureSyncManager()</code>
+ * and register themselves with <code>addSlaveDevice(slaveDevice, deviceAddress)</code> are
+ * brought up by this class. It writes the SYNC manager and FMMU registers of all pending
+ * slave devices with a few frames, requests state transitions with a single datagram per frame
+ * and polls the application layer status of all slave devices at once, instead of waiting
+ * fixed times. By default, every slave device is brought up when it is added. In order to
+ * bring up an entire segment in parallel, the startup may be deferred as follows:
+ * <pre><code>
+ * CoE coe(etherCAT, 0.001);
+ * coe.deferStartup();
+ *
+ * BeckhoffEL3104 analogInputs(etherCAT, coe, 0x0000);
+ * BeckhoffEL4004 analogOutputs(etherCAT, coe, 0xFFFF);
+ * ...
+ * coe.startup();   // brings all slave devices to the state OPERATIONAL
+ * </code></pre>
+ * <br/><br/>
+ * Slave device drivers that use distributed clocks call <code>activateDistributedClock()</code>
+ * from their <code>SlaveDevice::configure()</code> method. The first time this method is called,
+ * this class measures the propagation delays on the segment, aligns the system times of all
+ * slave devices with distributed clocks to the first of these devices, the reference clock, and
+ * compensates their initial drift. It then adds an ARMW datagram to the periodic frame, which
+ * distributes the time of the reference clock to all other slave devices in every cycle. SYNC
+ * signals of slave devices are thereby aligned with each other, and the timing of their process
+ * data handling doesn't depend on the jitter of the periodic communication loop anymore.
+ * <br/><br/>
+ * CANopen service data objects are transferred asynchronously, see the <code>ServiceDataObject</code>
+ * class. The mailbox datagrams of all pending transfers are transmitted with a second frame in every
+ * cycle, which is in flight together with the frame with process data, so that the periodic exchange
+ * of process data is not delayed by mailbox communication:
+ * <pre><code>
+ * CoE::ServiceDataObject serviceDataObject(0x1008, 0x00, 64);    // device name
+ * coe.upload(0x0000, serviceDataObject);
+ * ...
+ * if (serviceDataObject.waitForCompletion()) cout << string((char*)serviceDataObject.data, serviceDataObject.length) << endl;
+ * </code></pre>
+ * <br/><br/>
  * This class implements a high priority, periodic realtime thread that handles the
  * EtherCAT communication. The period of this thread can be configured in the constructor
  * of this class. It corresponds to the cycle time of the communication loop on the
@@ -51,6 +101,60 @@ class CoE : public RealtimeThread {
                 uint16_t    getMessageType();
         };
         
+        /**
+         * The <code>ServiceDataObject</code> class describes an asynchronous transfer of a CANopen
+         * service data object (SDO) from or to a slave device. Such a transfer is started with the
+         * <code>CoE::upload()</code> or <code>CoE::download()</code> methods, and it is processed by
+         * the communication handler with the mailbox datagrams it transmits in every cycle.
+         * <br/>
+         * The completion of a transfer may either be awaited with the <code>waitForCompletion()</code>
+         * method, or it may be handled by overriding the <code>completed()</code> callback method.
+         * The buffer of a service data object is allocated once, so that an object may be reused
+         * for many transfers. Values that don't fit into a single mailbox are transferred with
+         * segments, and a whole object may be transferred with complete access.
+         */
+        class ServiceDataObject {
+            
+            friend class CoE;
+            
+            public:
+                
+                static const uint8_t    STATE_IDLE = 0;         /**< State of a service data object that wasn't transferred yet. */
+                static const uint8_t    STATE_PENDING = 1;      /**< State of a service data object while it is transferred. */
+                static const uint8_t    STATE_COMPLETED = 2;    /**< State of a service data object after a successful transfer. */
+                static const uint8_t    STATE_ABORTED = 3;      /**< State of a service data object after a failed transfer. */
+                
+                uint8_t*        data;       // buffer with the value of this object
+                uint16_t        length;     // length of the value of this object, given in [bytes]
+                                
+                                ServiceDataObject(uint16_t index, uint8_t subindex, uint16_t size);
+                                ServiceDataObject(uint16_t index, uint8_t subindex, uint16_t size, bool completeAccess);
+                virtual         ~ServiceDataObject();
+                uint16_t        getIndex();
+                uint8_t         getSubindex();
+                void            setValue(uint32_t value, uint16_t length);
+                uint32_t        getValue();
+                uint8_t         getState();
+                uint32_t        getAbortCode();
+                bool            waitForCompletion();
+                virtual void    completed();
+            
+            private:
+                
+                uint16_t                index;
+                uint8_t                 subindex;
+                uint16_t                size;       // size of the buffer in [bytes]
+                bool                    completeAccess;
+                std::atomic<uint8_t>    state;      // state of the transfer, published with release semantics by the communication handler
+                uint8_t                 result;     // state of this object after the completion callback
+                uint32_t                abortCode;
+                bool                    download;   // flag for a download, or an upload otherwise
+                bool                    initiated;  // the transfer was initiated, and segments follow
+                uint16_t                offset;     // number of bytes transferred
+                uint8_t                 toggle;     // toggle bit of the next segment
+                ServiceDataObject*      next;       // next object in the queue of a mailbox
+        };
+        
         /**
          * The <code>SlaveDevice</code> class offers callback methods for an EtherCAT master.
          * It needs to be implemented by EtherCAT slave device drivers.
@@ -61,6 +165,7 @@ class CoE : public RealtimeThread {
                 
                                 SlaveDevice();
                 virtual         ~SlaveDevice();
+                virtual void    configure();
                 virtual void    writeDatagram();
                 virtual void    readDatagram();
         };
@@ -77,20 +182,113 @@ class CoE : public RealtimeThread {
                                 CoE(EtherCAT& etherCAT, double period);
         virtual                 ~CoE();
         void                    addSlaveDevice(SlaveDevice* slaveDevice);
+        void                    addSlaveDevice(SlaveDevice* slaveDevice, uint16_t deviceAddress);
+        void                    configureSyncManager(uint16_t deviceAddress, uint8_t syncManager, uint16_t physicalAddress, uint16_t length, uint8_t control, bool enable);
+        void                    deferStartup();
+        void                    startup();
+        void                    activateDistributedClock(uint16_t deviceAddress, uint8_t activation, uint32_t cycleTime, int32_t shiftTime);
+        uint64_t                getSystemTime();
+        int32_t                 getSystemTimeDifference(uint16_t deviceAddress);
+        void                    upload(uint16_t deviceAddress, ServiceDataObject& serviceDataObject);
+        void                    download(uint16_t deviceAddress, ServiceDataObject& serviceDataObject);
         void                    registerDatagram(EtherCAT::Datagram* datagram);
+        EtherCAT::ProcessData*  registerProcessData(uint16_t deviceAddress, uint16_t physicalAddress, uint16_t length, uint8_t type);
         void                    writeSDO(uint16_t deviceAddress, uint16_t mailboxOutAddress, uint16_t mailboxOutSize, uint16_t mailboxInAddress, uint16_t mailboxInSize, uint16_t index, uint8_t subindex, uint32_t value, uint16_t length);
         uint32_t                readSDO(uint16_t deviceAddress, uint16_t mailboxOutAddress, uint16_t mailboxOutSize, uint16_t mailboxInAddress, uint16_t mailboxInSize, uint16_t index, uint8_t subindex);
         void                    run();
         
     private:
         
+        /**
+         * The <code>SlaveConfiguration</code> class contains the SYNC manager and FMMU registers
+         * of a slave device, which are written when this slave device is brought up, and the
+         * outcome of the startup of this slave device.
+         */
+        class SlaveConfiguration {
+            
+            public:
+                
+                uint16_t                deviceAddress;
+                SlaveDevice*            slaveDevice;
+                std::vector<uint8_t>    syncManagers;   // images of the SYNC manager registers
+                std::vector<uint8_t>    fmmus;          // images of the FMMU registers
+                uint16_t                mailboxOutAddress;
+                uint16_t                mailboxOutSize;
+                uint16_t                mailboxInAddress;
+                uint16_t                mailboxInSize;
+                bool                    pending;        // this slave device still needs to be brought up
+                std::string             error;          // description of a startup failure, or empty
+                
+                                        SlaveConfiguration(uint16_t deviceAddress);
+                                        ~SlaveConfiguration();
+        };
+        
+        /**
+         * The <code>Mailbox</code> class contains the preallocated mailbox datagrams of a slave
+         * device, and the queue of service data objects that are transferred with this mailbox.
+         */
+        class Mailbox {
+            
+            public:
+                
+                static const uint8_t    STATE_IDLE = 0;         // no transfer in progress
+                static const uint8_t    STATE_REQUEST = 1;      // a request is written into the mailbox
+                static const uint8_t    STATE_RESPONSE = 2;     // the mailbox is polled for a response
+                static const uint8_t    STATE_ABORT = 3;        // an abort request is written into the mailbox
+                
+                uint16_t                deviceAddress;
+                EtherCAT::Datagram*     out;        // datagram to write requests into the mailbox
+                EtherCAT::Datagram*     in;         // datagram to read responses from the mailbox
+                ServiceDataObject*      first;      // queue of service data objects to transfer
+                ServiceDataObject*      last;
+                uint8_t                 state;
+                uint8_t                 counter;    // counter of the mailbox header
+                int32_t                 time;       // start time of the current transfer in [ms]
+                                        
+                                        Mailbox(uint16_t deviceAddress, uint16_t mailboxOutAddress, uint16_t mailboxOutSize, uint16_t mailboxInAddress, uint16_t mailboxInSize);
+                                        ~Mailbox();
+        };
+        
         static const size_t     STACK_SIZE = 64*1024;   // stack size of private thread in [bytes]
         static const int32_t    PRIORITY;               // priority level of private thread
-        static const uint16_t   RETRIES = 10;
+        static const uint16_t   PROCESS_IMAGE_SIZE = 1024;  // maximum size of the logical process image in [bytes]
+        static const uint16_t   STATE_TIMEOUT = 3000;       // timeout for state transitions of slave devices in [ms]
+        static const int32_t    SDO_TIMEOUT = 2000;         // timeout for transfers of service data objects in [ms]
+        static const uint16_t   DRIFT_COMPENSATION_FRAMES = 300;    // number of frames for the static drift compensation
+        static const uint16_t   DRIFT_COMPENSATION_DATAGRAMS = 50;  // number of ARMW datagrams per frame for the static drift compensation
+        static const uint32_t   SYNC_START_DELAY = 100000000;       // delay until SYNC signals are started in [ns]
         
         EtherCAT&                           etherCAT;
+        Mutex                               mutex;
         std::vector<SlaveDevice*>           slaveDevices;
         std::vector<EtherCAT::Datagram*>    datagrams;
+        EtherCAT::Frame                     frame;
+        EtherCAT::Datagram*                 processImage;
+        uint16_t                            processImageLength;
+        std::vector<EtherCAT::ProcessData*> processData;
+        std::vector<SlaveConfiguration*>    slaveConfigurations;
+        bool                                startupDeferred;
+        Mutex                               mailboxMutex;       // mutex for the mailboxes and their queues
+        std::vector<Mailbox*>               mailboxes;
+        std::vector<Mailbox*>               activeMailboxes;    // mailboxes with datagrams in the mailbox frame
+        std::vector<EtherCAT::Datagram*>    mailboxDatagrams;
+        EtherCAT::Frame                     mailboxFrame;       // frame with mailbox datagrams, transmitted with the periodic frame
+        EtherCAT::Datagram*                 systemTime;     // ARMW datagram that distributes the time of the reference clock
+        
+        SlaveConfiguration*     getSlaveConfiguration(uint16_t deviceAddress);
+        Mailbox*                getMailbox(uint16_t deviceAddress);
+        Mailbox*                getMailbox(uint16_t deviceAddress, uint16_t mailboxOutAddress, uint16_t mailboxOutSize, uint16_t mailboxInAddress, uint16_t mailboxInSize);
+        void                    transfer(Mailbox* mailbox, ServiceDataObject& serviceDataObject, bool download);
+        bool                    prepareMailboxes(ServiceDataObject*& completed);
+        void                    processMailboxes(ServiceDataObject*& completed, bool received);
+        void                    writeRequest(Mailbox* mailbox);
+        void                    writeAbortRequest(Mailbox* mailbox, uint32_t abortCode);
+        void                    readResponse(Mailbox* mailbox, ServiceDataObject*& completed);
+        void                    complete(Mailbox* mailbox, uint32_t abortCode, ServiceDataObject*& completed);
+        void                    bringUp(std::vector<SlaveConfiguration*>& slaveConfigurations);
+        void                    initializeDistributedClocks();
+        void                    setState(std::vector<SlaveConfiguration*>& slaveConfigurations, uint16_t state);
+        void                    transmit(std::vector<EtherCAT::Datagram*>& datagrams);
 };
 
 #endif /* COE_H_ */
@@ -26,6 +26,9 @@ class Ethernet;
  * <br/>
  * This master stack may use an Ethernet driver to transmit and receive EtherCAT
  * frames. Using an Ethernet driver is required for hard-realtime communication.
+ * On linux systems, the <code>PacketSocket</code> driver may be used with any
+ * standard network interface, and the <code>EtherCATSimulator</code> driver
+ * simulates a segment with slave devices for tests without hardware.
  * <br/>
  * Optionally, this master stack may use the TCP/IP stack of the operating system
  * to transmit EtherCAT datagrams with multicast UDP packets. In order to receive
@@ -40,16 +43,31 @@ class Ethernet;
  * constructor of this class. The first constructor requires a reference to an
  * <code>Ethernet</code> driver, and the second constructor accepts the IP address
  * of the interface to use for UDP communication.
+ * <br/>
+ * Several frames may be on the fieldbus at the same time. Every transmitted frame
+ * gets an index, which is written into the index field of its first datagram, and
+ * received frames are matched with the frames in flight by this index. Periodic
+ * frames transmitted with <code>sendFrame()</code> are therefore not delayed by
+ * acyclic datagrams of other threads, i.e. by mailbox communication. A frame may
+ * also be transmitted with <code>transmitFrame()</code>, and its response may be
+ * collected later with <code>receiveFrame()</code>.
  */
 class EtherCAT {
     
     public:
         
+        class Frame;
+        
         /**
          * The <code>Datagram</code> class represents a simple EtherCAT datagram.
+         * The data of a datagram is usually stored in a buffer owned by the datagram.
+         * While the datagram is attached to a <code>Frame</code>, the data pointer aliases
+         * the buffer of that frame instead, so that the datagram is processed in place.
          */
         class Datagram {
             
+            friend class Frame;
+            
             public:
                 
                 uint8_t*    data;
@@ -61,10 +79,53 @@ class EtherCAT {
                             Datagram(uint8_t command, uint16_t deviceAddress, uint16_t offsetAddress, uint64_t value, uint16_t length);
                             Datagram(Datagram& datagram);
                             ~Datagram();
+                void        resize(uint16_t length);
                 void        setMoreDatagrams(bool moreDatagrams);
                 bool        hasMoreDatagrams();
                 void        resetWorkingCounter();
                 uint16_t    getWorkingCounter();
+                
+            private:
+                
+                uint8_t*    buffer;     // buffer owned by this datagram
+        };
+        
+        /**
+         * The <code>Frame</code> class is a preallocated buffer for an EtherCAT frame.
+         * Datagrams are laid out in this buffer once, when they are attached to the frame,
+         * and they alias this buffer afterwards. A frame can therefore be transmitted
+         * periodically without allocating memory and without copying datagrams.
+         * <br/>
+         * A frame uses two buffers: a received frame is read into the buffer that is not
+         * transmitted, and the attached datagrams are redirected to that buffer if the
+         * received frame is valid. The datagrams attached to a frame must not be resized
+         * or deleted until they are detached again.
+         */
+        class Frame {
+            
+            friend class EtherCAT;
+            
+            public:
+                
+                static const uint16_t   SIZE = 1500;    /**< Maximum size of an EtherCAT frame, including the EtherCAT header, in [bytes]. */
+                
+                            Frame();
+                virtual     ~Frame();
+                void        attach(const std::vector<Datagram*>& datagrams);
+                void        detach();
+                
+            private:
+                
+                uint8_t*                buffers[2];     // buffers for transmitted and received frames
+                uint8_t                 active;         // index of the buffer the datagrams alias
+                uint16_t                length;         // length of the frame, including the EtherCAT header
+                uint8_t                 index;          // index of this frame while it is in flight
+                bool                    pending;        // this frame was transmitted and waits for its response
+                uint16_t                responses;      // number of responses this frame still waits for
+                std::vector<Datagram*>  datagrams;      // datagrams attached to this frame
+                std::vector<uint16_t>   offsets;        // offsets of the datagrams within a buffer
+                
+                void        swap();
         };
         
         /**
@@ -84,6 +145,31 @@ class EtherCAT {
                 static uint8_t  counter;
         };
         
+        /**
+         * The <code>ProcessData</code> class is a typed view into a section of a logical
+         * process image. Such a process image is mapped with FMMUs into the process data
+         * RAM of several slave devices, and it is exchanged with a single LRW datagram.
+         * Offsets given to the methods of this class are relative to the beginning of the
+         * section, which corresponds to the physical start address the FMMU is mapped to.
+         */
+        class ProcessData {
+            
+            public:
+                
+                Datagram*   datagram;
+                uint16_t    offset;
+                uint16_t    length;
+                
+                            ProcessData(Datagram* datagram, uint16_t offset, uint16_t length);
+                            ~ProcessData();
+                void        write8(uint16_t offset, uint8_t value);
+                uint8_t     read8(uint16_t offset);
+                void        write16(uint16_t offset, uint16_t value);
+                uint16_t    read16(uint16_t offset);
+                void        write32(uint16_t offset, uint32_t value);
+                uint32_t    read32(uint16_t offset);
+        };
+        
         static const uint16_t   ESC_INFORMATION = 0x0000;                           /**< ESC register address. */
         static const uint16_t   ESC_INFORMATION_TYPE = 0x0000;                      /**< ESC register address. */
         static const uint16_t   ESC_INFORMATION_REVISION = 0x0001;                  /**< ESC register address. */
@@ -108,6 +194,15 @@ class EtherCAT {
         static const uint16_t   WATCHDOG_TIME_PROCESS_DATA = 0x0420;                /**< ESC register address. */
         static const uint16_t   WATCHDOG_COUNTER_PROCESS_DATA = 0x0442;             /**< ESC register address. */
         static const uint16_t   INTERRUPTS = 0x0200;                                /**< ESC register address. */
+        static const uint16_t   FMMU = 0x0600;                                      /**< ESC register address. */
+        static const uint16_t   FMMU_LENGTH = 0x0604;                               /**< ESC register address. */
+        static const uint16_t   FMMU_LOGICAL_START_BIT = 0x0606;                    /**< ESC register address. */
+        static const uint16_t   FMMU_LOGICAL_STOP_BIT = 0x0607;                     /**< ESC register address. */
+        static const uint16_t   FMMU_PHYSICAL_START_ADDRESS = 0x0608;               /**< ESC register address. */
+        static const uint16_t   FMMU_PHYSICAL_START_BIT = 0x060A;                   /**< ESC register address. */
+        static const uint16_t   FMMU_TYPE = 0x060B;                                 /**< ESC register address. */
+        static const uint16_t   FMMU_ACTIVATE = 0x060C;                             /**< ESC register address. */
+        static const uint16_t   FMMU_OFFSET = 0x0010;                               /**< ESC register address. */
         static const uint16_t   SYNC_MANAGER = 0x0800;                              /**< ESC register address. */
         static const uint16_t   SYNC_MANAGER_LENGTH = 0x0802;                       /**< ESC register address. */
         static const uint16_t   SYNC_MANAGER_CONTROL = 0x0804;                      /**< ESC register address. */
@@ -115,8 +210,13 @@ class EtherCAT {
         static const uint16_t   SYNC_MANAGER_OFFSET = 0x0008;                       /**< ESC register address. */
         static const uint16_t   DC_RECEIVE_TIME_PORT_0 = 0x0900;                    /**< ESC register address. */
         static const uint16_t   DC_RECEIVE_TIME_PORT_1 = 0x0904;                    /**< ESC register address. */
+        static const uint16_t   DC_RECEIVE_TIME_PORT_2 = 0x0908;                    /**< ESC register address. */
+        static const uint16_t   DC_RECEIVE_TIME_PORT_3 = 0x090C;                    /**< ESC register address. */
         static const uint16_t   DC_SYSTEM_TIME = 0x0910;                            /**< ESC register address. */
+        static const uint16_t   DC_RECEIVE_TIME_ECAT_PROCESSING_UNIT = 0x0918;      /**< ESC register address. */
         static const uint16_t   DC_SYSTEM_TIME_OFFSET = 0x0920;                     /**< ESC register address. */
+        static const uint16_t   DC_SYSTEM_TIME_DELAY = 0x0928;                      /**< ESC register address. */
+        static const uint16_t   DC_SYSTEM_TIME_DIFFERENCE = 0x092C;                 /**< ESC register address. */
         static const uint16_t   DC_CYCLIC_UNIT_CONTROL = 0x0980;                    /**< ESC register address. */
         static const uint16_t   DC_ACTIVATION_REGISTER = 0x0981;                    /**< ESC register address. */
         static const uint16_t   DC_START_TIME_CYCLIC_OPERATION = 0x0990;            /**< ESC register address. */
@@ -139,6 +239,17 @@ class EtherCAT {
         static const uint8_t    COMMAND_FPRD = 4;               /**< EtherCAT datagram command. */
         static const uint8_t    COMMAND_FPWR = 5;               /**< EtherCAT datagram command. */
         static const uint8_t    COMMAND_FPRW = 6;               /**< EtherCAT datagram command. */
+        static const uint8_t    COMMAND_BRD = 7;                /**< EtherCAT datagram command. */
+        static const uint8_t    COMMAND_BWR = 8;                /**< EtherCAT datagram command. */
+        static const uint8_t    COMMAND_BRW = 9;                /**< EtherCAT datagram command. */
+        static const uint8_t    COMMAND_LRD = 10;               /**< EtherCAT datagram command. */
+        static const uint8_t    COMMAND_LWR = 11;               /**< EtherCAT datagram command. */
+        static const uint8_t    COMMAND_LRW = 12;               /**< EtherCAT datagram command. */
+        static const uint8_t    COMMAND_ARMW = 13;              /**< EtherCAT datagram command. */
+        static const uint8_t    COMMAND_FRMW = 14;              /**< EtherCAT datagram command. */
+        
+        static const uint8_t    FMMU_TYPE_READ = 0x01;          /**< FMMU type for inputs, read by the master. */
+        static const uint8_t    FMMU_TYPE_WRITE = 0x02;         /**< FMMU type for outputs, written by the master. */
         
         static const uint8_t    MAILBOX_TYPE_MAILBOX_ERROR = 0x0;   /**< EtherCAT mailbox type. */
         static const uint8_t    MAILBOX_TYPE_EOE = 0x2;             /**< EtherCAT mailbox type. */
@@ -150,7 +261,10 @@ class EtherCAT {
                     EtherCAT(Ethernet* ethernet);
                     EtherCAT(std::string interfaceAddress);
         virtual     ~EtherCAT();
-        void        sendDatagrams(std::vector<Datagram*> datagrams);
+        void        sendDatagrams(const std::vector<Datagram*>& datagrams);
+        void        sendFrame(Frame& frame);
+        void        transmitFrame(Frame& frame);
+        bool        receiveFrame(Frame& frame);
         void        write8(uint16_t deviceAddress, uint16_t offsetAddress, uint8_t value);
         uint8_t     read8(uint16_t deviceAddress, uint16_t offsetAddress);
         void        write16(uint16_t deviceAddress, uint16_t offsetAddress, uint16_t value);
@@ -166,11 +280,22 @@ class EtherCAT {
         static const uint16_t       PORT_NUMBER;
         static const uint16_t       RETRIES = 1000;     // number of tries to read a frame back
         
-        Ethernet*       ethernet;
-        std::string     interfaceAddress;
-        int32_t         networkSocket;
-        Mutex           mutex;
+        Ethernet*               ethernet;
+        std::string             interfaceAddress;
+        int32_t                 networkSocket;
+        Mutex                   mutex;              // mutex for the frame and datagram below
+        Mutex                   pipeline;           // mutex for the frames in flight and for transmitting frames
+        Mutex                   receiver;           // mutex for reading frames from the communication channel
+        Frame*                  frames[256];        // frames in flight, indexed by their frame index
+        uint8_t                 index;              // index of the next transmitted frame
+        Frame                   frame;              // frame for datagrams that are not transmitted periodically
+        Datagram*               registerDatagram;   // datagram to read and write registers of slave devices
+        std::vector<Datagram*>  registerDatagrams;
         
+        uint64_t        transfer(uint8_t command, uint16_t deviceAddress, uint16_t offsetAddress, uint64_t value, uint16_t length);
+        void            transceive(Frame& frame);
+        uint16_t        receive(uint8_t data[], uint16_t length);
+        void            dispatch(uint8_t data[], uint16_t length);
         void            sendMulticastDatagram(uint8_t data[], uint16_t length);
         ssize_t         receiveMulticastDatagram(uint8_t data[], uint16_t length);
 };
@@ -0,0 +1,171 @@
+/*
+ * EtherCATSimulator.h
+ * Copyright (c) 2026, ZHAW
+ * All rights reserved.
+ *
+ *  Created on: 17.10.2026
+ *      Author: Marcel Honegger
+ */
+
+#ifndef ETHER_CAT_SIMULATOR_H_
+#define ETHER_CAT_SIMULATOR_H_
+
+#include <cstdlib>
+#include <cstdint>
+#include <vector>
+#include <map>
+#include <deque>
+#include <stdexcept>
+#include "Mutex.h"
+#include "Ethernet.h"
+
+/**
+ * This class implements a simulated EtherCAT segment as an Ethernet driver. EtherCAT frames
+ * sent with this driver are processed by a chain of emulated EtherCAT slave controllers, and
+ * the processed frames are returned by the <code>receive()</code> method, like frames that
+ * went around a real segment. This allows to test and benchmark the EtherCAT master stack
+ * and device drivers without hardware.
+ * <br/>
+ * The emulated slave controllers implement the register space, SYNC managers with mailboxes,
+ * FMMUs for logical addressing, the application layer state machine, working counters and
+ * distributed clocks with a fixed propagation delay between neighbouring slave devices.
+ * Mailboxes offer a CoE server with an object dictionary that supports expedited, normal,
+ * segmented and complete access transfers of service data objects.
+ * <br/>
+ * Slave devices are added in the order they are connected to the master. Predefined slave
+ * devices mimic Beckhoff terminals, i.e. an EL3104 produces analog input values, an EL5101
+ * counts encoder pulses, and an EL7342 integrates the velocities given to its motors. Other
+ * slave devices may be simulated by extending the <code>SlaveDevice</code> class. An example
+ * of a simulated segment is given below:
+ * <pre><code>
+ * EtherCATSimulator simulator;
+ * simulator.addSlaveDevice(EtherCATSimulator::PRODUCT_CODE_EL3104);
+ * simulator.addSlaveDevice(EtherCATSimulator::PRODUCT_CODE_EL5101);
+ *
+ * EtherCAT etherCAT(&simulator);
+ * CoE coe(etherCAT, 0.001);
+ * BeckhoffEL3104 beckhoffEL3104(etherCAT, coe, 0x0000);
+ * BeckhoffEL5101 beckhoffEL5101(etherCAT, coe, 0xFFFF);
+ * ...
+ * </code></pre>
+ * The number of frames, datagrams and bytes processed by the simulated segment are counted,
+ * which allows to measure the startup time, cycle time and throughput of the master stack.
+ */
+class EtherCATSimulator : public Ethernet {
+    
+    public:
+        
+        static const uint32_t   VENDOR_ID_BECKHOFF = 0x00000002;        /**< Vendor ID of Beckhoff Automation. */
+        static const uint32_t   PRODUCT_CODE_EL3104 = 0x0C203052;       /**< Product code of a Beckhoff EL3104 terminal. */
+        static const uint32_t   PRODUCT_CODE_EL5101 = 0x13ED3052;       /**< Product code of a Beckhoff EL5101 terminal. */
+        static const uint32_t   PRODUCT_CODE_EL7342 = 0x1CAE3052;       /**< Product code of a Beckhoff EL7342 terminal. */
+        
+        /**
+         * The <code>SlaveDevice</code> class emulates an EtherCAT slave controller with
+         * its register space and process data RAM, and a CoE object dictionary. The
+         * <code>update()</code> method may be overridden to simulate the application
+         * of a specific slave device.
+         */
+        class SlaveDevice {
+            
+            friend class EtherCATSimulator;
+            
+            public:
+                
+                static const uint32_t   MEMORY_SIZE = 0x10000;  /**< Size of the register space and the process data RAM, in [bytes]. */
+                                
+                                SlaveDevice(uint32_t vendorID, uint32_t productCode);
+                virtual         ~SlaveDevice();
+                uint32_t        getVendorID();
+                uint32_t        getProductCode();
+                void            write8(uint16_t address, uint8_t value);
+                uint8_t         read8(uint16_t address);
+                void            write16(uint16_t address, uint16_t value);
+                uint16_t        read16(uint16_t address);
+                void            write32(uint16_t address, uint32_t value);
+                uint32_t        read32(uint16_t address);
+                void            writeObject(uint16_t index, uint8_t subindex, uint32_t value, uint16_t length);
+                uint32_t        readObject(uint16_t index, uint8_t subindex);
+            
+            protected:
+                
+                uint8_t*        memory;     // register space and process data RAM
+                
+                uint16_t        getSyncManagerAddress(uint8_t number);
+                uint16_t        getSyncManagerLength(uint8_t number);
+                virtual void    update(uint64_t time);
+            
+            private:
+                
+                static const uint8_t    SYNC_MANAGERS = 8;      // number of SYNC managers
+                static const uint8_t    FMMUS = 8;              // number of FMMUs
+                static const double     PI;                     // ratio of the circumference of a circle to its diameter
+                
+                uint32_t                                    vendorID;       // vendor ID of this slave device
+                uint32_t                                    productCode;    // product code of this slave device
+                Mutex                                       mutex;          // mutex to lock critical sections
+                std::map<uint32_t, std::vector<uint8_t> >   objects;        // object dictionary, the key is index << 8 | subindex
+                std::deque<std::vector<uint8_t> >           responses;      // responses waiting for the in mailbox
+                bool                                        mailboxFull;    // flag indicating that the in mailbox contains a response
+                uint8_t                                     counter;        // counter of the mailbox header
+                std::vector<uint8_t>                        segments;       // data of a segmented transfer
+                uint32_t                                    segmentKey;     // key of the object with a segmented transfer
+                uint32_t                                    segmentOffset;  // offset of the next segment to upload, or the size of a download
+                bool                                        completeAccess; // flag for a segmented transfer with complete access
+                int64_t                                     clockOffset;    // offset of the local clock to the clock of the simulator
+                uint64_t                                    updateTime;     // time of the last update of the simulated application
+                double                                      positions[2];   // positions of the motors of a simulated EL7342
+                
+                uint64_t        getLocalTime(uint64_t time);
+                bool            read(uint16_t address, uint8_t data[], uint16_t length, uint64_t time);
+                bool            write(uint16_t address, uint8_t data[], uint16_t length, uint64_t time, uint64_t receiveTimes[4]);
+                bool            readLogical(uint32_t address, uint8_t data[], uint16_t length);
+                bool            writeLogical(uint32_t address, uint8_t data[], uint16_t length);
+                int16_t         getMailbox(uint16_t address, uint16_t length, bool out);
+                void            processMailbox();
+                void            respond(uint8_t data[], uint16_t length);
+                void            post(std::vector<uint8_t>& message);
+                void            abort(uint16_t index, uint8_t subindex, uint32_t abortCode);
+                void            upload(uint16_t index, uint8_t subindex, bool completeAccess);
+                uint32_t        getObject(uint16_t index, uint8_t subindex, bool completeAccess, std::vector<uint8_t>& value);
+                uint32_t        setObject(uint16_t index, uint8_t subindex, bool completeAccess, std::vector<uint8_t>& value);
+        };
+                        
+                        EtherCATSimulator();
+        virtual         ~EtherCATSimulator();
+        SlaveDevice*    addSlaveDevice(uint32_t productCode);
+        void            addSlaveDevice(SlaveDevice& slaveDevice);
+        uint16_t        getNumberOfSlaveDevices();
+        SlaveDevice*    getSlaveDevice(uint16_t position);
+        uint32_t        getNumberOfFrames();
+        uint32_t        getNumberOfDatagrams();
+        uint64_t        getNumberOfBytes();
+        void            resetCounters();
+        bool            link();
+        void            address(uint8_t macAddress[6]);
+        uint16_t        send(uint8_t destinationMACAddress[6], uint16_t etherType, uint8_t data[], uint16_t length);
+        uint16_t        receive(uint8_t sourceMACAddress[6], uint16_t& etherType, uint8_t data[], uint16_t length);
+    
+    private:
+        
+        static const uint8_t    MAC_ADDRESS[];                  // ethernet address of the simulator
+        static const uint16_t   FRAME_SIZE = 1514;              // size of a buffer for an Ethernet frame, in [bytes]
+        static const uint16_t   FRAMES = 64;                    // number of buffers for processed frames
+        static const uint32_t   PROPAGATION_DELAY = 500;        // delay of a frame between neighbouring slave devices, in [ns]
+        
+        Mutex                       mutex;              // mutex to lock critical sections
+        std::vector<SlaveDevice*>   slaveDevices;       // chain of simulated slave devices
+        std::vector<SlaveDevice*>   ownSlaveDevices;    // slave devices created by this simulator
+        uint8_t                     frames[FRAMES][FRAME_SIZE]; // buffers for processed frames
+        uint16_t                    lengths[FRAMES];    // lengths of the processed frames
+        uint16_t                    first;              // index of the first processed frame
+        uint16_t                    size;               // number of processed frames
+        uint32_t                    numberOfFrames;     // number of frames processed by the segment
+        uint32_t                    numberOfDatagrams;  // number of datagrams processed by the segment
+        uint64_t                    numberOfBytes;      // number of bytes processed by the segment
+        
+        uint64_t        getTime();
+        void            process(uint8_t data[], uint16_t length);
+};
+
+#endif /* ETHER_CAT_SIMULATOR_H_ */
@@ -12,8 +12,10 @@
 
 #include <cstdlib>
 #include <stdint.h>
+#include <vector>
 #include "Module.h"
 #include "RealtimeThread.h"
+#include "CyclicExecutor.h"
 #include "CANopen.h"
 
 /**
@@ -44,13 +46,29 @@
  *     int32_t position = maxonEPOS4.readPositionActualValue(); <span style="color:#008000">// read the actual position</span>
  * }
  * </code></pre>
+ * Instead of using its own handler thread, this device driver may transmit its process data
+ * objects synchronously with other CANopen devices, when the SYNC producer of the CANopen stack
+ * is enabled:
+ * <pre><code>
+ * CANopen canOpen(pcanPCI);
+ * MaxonEPOS4 maxonEPOS4(canOpen, 20);           <span style="color:#008000">// create a synchronous driver for node ID 20</span>
+ * canOpen.setSYNCPeriod(0.002);                 <span style="color:#008000">// transmit a SYNC object every 2 ms</span>
+ * </code></pre>
+ * This device driver may also be executed periodically by a cyclic executor that is shared
+ * with other device drivers, instead of using its own handler thread:
+ * <pre><code>
+ * CyclicExecutor cyclicExecutor("cyclicExecutor", RealtimeThread::RT_MAX_PRIORITY-10, 0.001);
+ * MaxonEPOS4 maxonEPOS4(canOpen, cyclicExecutor, 20, 0.002);
+ * </code></pre>
  * Also see the documentation of the DigitalIn and DigitalOut classes for more information.
  */
-class MaxonEPOS4 : public Module, RealtimeThread, CANopen::Delegate {
+class MaxonEPOS4 : public Module, CANopen::Delegate, CyclicExecutor::Task {
     
     public:
         
                     MaxonEPOS4(CANopen& canOpen, uint32_t nodeID, double period);
+                    MaxonEPOS4(CANopen& canOpen, uint32_t nodeID);
+                    MaxonEPOS4(CANopen& canOpen, CyclicExecutor& cyclicExecutor, uint32_t nodeID, double period);
         virtual     ~MaxonEPOS4();
         bool        readDigitalIn(uint16_t number);
         void        writeDigitalOut(uint16_t number, bool value);
@@ -107,20 +125,47 @@ class MaxonEPOS4 : public Module, RealtimeThread, CANopen::Delegate {
         static const int8_t     PROFILE_VELOCITY_MODE = 3;
         static const int8_t     CYCLIC_SYNCHRONOUS_TORQUE_MODE = 10;
         
-        CANopen&    canOpen;
-        uint32_t    nodeID;
-        bool        enable;
-        bool        newSetpoint;
-        int8_t      modesOfOperation;
-        int8_t      modesOfOperationDisplay;
-        int32_t     targetPosition;
-        int32_t     targetVelocity;
-        int16_t     targetTorque;
-        uint16_t    statusword;
-        int32_t     positionActualValue;
+        /**
+         * The <code>Handler</code> class implements the private thread of a driver that is
+         * neither executed synchronously with the SYNC producer nor by a cyclic executor.
+         */
+        class Handler : public RealtimeThread {
+            
+            public:
+                
+                                Handler(MaxonEPOS4* maxonEPOS4, double period);
+                virtual         ~Handler();
+                void            run();
+            
+            private:
+                
+                MaxonEPOS4*     maxonEPOS4;
+        };
+        
+        CANopen&                    canOpen;
+        uint32_t                    nodeID;
+        Handler*                    handler;
+        CyclicExecutor*             cyclicExecutor;
+        CANopen::ProcessDataObject  rpdo1;
+        CANopen::ProcessDataObject  rpdo2;
+        CANopen::ProcessDataObject  rpdo3;
+        CANopen::ProcessDataObject  tpdo1;
+        bool                        synchronous;
+        bool                        enable;
+        bool                        newSetpoint;
+        int8_t                      modesOfOperation;
+        int8_t                      modesOfOperationDisplay;
+        int32_t                     targetPosition;
+        int32_t                     targetVelocity;
+        int16_t                     targetTorque;
+        uint16_t                    statusword;
+        int32_t                     positionActualValue;
         
+        void        initialize(uint32_t nodeID, double period);
         void        receiveObject(uint32_t functionCode, uint8_t object[]);
-        void        run();
+        void        transmitObjects();
+        void        transmitRPDO();
+        void        execute();
 };
 
 #endif /* MAXON_EPOS4_H_ */
@@ -54,6 +54,7 @@ class Mecca500 : public Module, CoE::SlaveDevice {
         
         EtherCAT&   etherCAT;           // reference to EtherCAT stack
         CoE&        coe;                // reference to CANopen over EtherCAT driver
+        uint16_t    deviceAddress;      // relative device address
         Mutex       mutex;              // mutex to lock critical sections
         
         uint32_t    robotControl;       // output objects
@@ -70,9 +71,10 @@ class Mecca500 : public Module, CoE::SlaveDevice {
         uint32_t    jointSet[6];
         uint32_t    endEffectorPose[6];
         
-        EtherCAT::Datagram*     rxPDO;
-        EtherCAT::Datagram*     txPDO;
+        EtherCAT::ProcessData*  rxPDO;
+        EtherCAT::ProcessData*  txPDO;
         
+        void        configure();
         void        writeDatagram();
         void        readDatagram();
 };
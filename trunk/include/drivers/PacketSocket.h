@@ -0,0 +1,77 @@
+/*
+ * PacketSocket.h
+ * Copyright (c) 2026, ZHAW
+ * All rights reserved.
+ *
+ *  Created on: 17.10.2026
+ *      Author: Marcel Honegger
+ */
+
+#ifndef PACKET_SOCKET_H_
+#define PACKET_SOCKET_H_
+
+#include <cstdlib>
+#include <cstdint>
+#include <string>
+#include <stdexcept>
+#include "Ethernet.h"
+
+/**
+ * This class implements a specific Ethernet device driver for the packet socket interface of
+ * Linux operating systems. It allows to transmit and receive raw Ethernet frames with any
+ * standard network interface, without the need for a dedicated Ethernet controller driver.
+ * <br/>
+ * The driver only receives frames of a given ether type, i.e. <code>ETHERTYPE_ETHER_CAT</code>,
+ * which are filtered by the kernel. Frames are exchanged with the kernel through receive and
+ * transmit rings that are mapped into the memory of the process, so that no system call is
+ * needed to read a frame, and only one system call is needed to transmit a frame.
+ * <br/>
+ * This driver requires root privileges, or the <code>CAP_NET_RAW</code> capability. An example
+ * of how to use this driver with an EtherCAT master stack is given below:
+ * <pre><code>
+ * PacketSocket packetSocket("eth1");
+ * EtherCAT etherCAT(&packetSocket);
+ * CoE coe(etherCAT, 0.001);
+ * ...
+ * </code></pre>
+ * For tests without hardware, the network interface may be one end of a virtual Ethernet pair,
+ * which is created as follows:
+ * <pre><code>
+ * % sudo ip link add veth0 type veth peer name veth1
+ * % sudo ip link set veth0 up
+ * % sudo ip link set veth1 up
+ * </code></pre>
+ */
+class PacketSocket : public Ethernet {
+    
+    public:
+        
+                    PacketSocket(std::string interfaceName);
+                    PacketSocket(std::string interfaceName, uint16_t etherType);
+        virtual     ~PacketSocket();
+        bool        link();
+        void        address(uint8_t macAddress[6]);
+        uint16_t    send(uint8_t destinationMACAddress[6], uint16_t etherType, uint8_t data[], uint16_t length);
+        uint16_t    receive(uint8_t sourceMACAddress[6], uint16_t& etherType, uint8_t data[], uint16_t length);
+    
+    private:
+        
+        static const uint16_t   MTU = 1500;             // largest payload of an ethernet frame, given in [bytes]
+        static const uint32_t   FRAME_SIZE = 2048;      // size of a frame slot in the rings, given in [bytes]
+        static const uint32_t   BLOCK_SIZE = 4096;      // size of a block of frame slots, given in [bytes]
+        static const uint32_t   FRAME_NUMBER = 64;      // number of frame slots in each ring
+        static const int32_t    RECEIVE_TIMEOUT = 1;    // time to wait for a frame in the receive method, given in [ms]
+        
+        std::string interfaceName;      // name of the network interface, i.e. 'eth0'
+        int32_t     interfaceIndex;     // index of the network interface
+        int32_t     packetSocket;       // socket id for the packet socket
+        uint8_t     macAddress[6];      // ethernet address of the network interface
+        uint8_t*    ring;               // memory mapped receive and transmit rings
+        uint32_t    receiveIndex;       // index of the next frame slot to read in the receive ring
+        uint32_t    transmitIndex;      // index of the next frame slot to write in the transmit ring
+        
+        void        open(uint16_t etherType);
+        void        close();
+};
+
+#endif /* PACKET_SOCKET_H_ */
@@ -101,6 +101,7 @@ class RtelligentECR60 : public Module, CoE::SlaveDevice {
 
         EtherCAT&   etherCAT;           // reference to EtherCAT stack
         CoE&        coe;                // reference to CANopen over EtherCAT driver
+        uint16_t    deviceAddress;      // relative device address
         Mutex       mutex;              // mutex to lock critical sections
         bool        enable;
         bool        newSetpoint;
@@ -115,9 +116,10 @@ class RtelligentECR60 : public Module, CoE::SlaveDevice {
         int32_t     positionActualValue;
         uint32_t    digitalInputs;
 
-        EtherCAT::Datagram*     txPDO;
-        EtherCAT::Datagram*     rxPDO;
+        EtherCAT::ProcessData*  txPDO;
+        EtherCAT::ProcessData*  rxPDO;
 
+        void        configure();
         void        writeDatagram();
         void        readDatagram();
 };
@@ -124,8 +124,8 @@ class SMCServoJXCE1 : public Module, Thread, CoE::SlaveDevice {
         uint8_t     alarm3;                 // 0x6030/0x03 Alarm3
         uint8_t     alarm4;                 // 0x6030/0x04 Alarm4
         
-        EtherCAT::Datagram*     rxPDO;
-        EtherCAT::Datagram*     txPDO;
+        EtherCAT::ProcessData*  rxPDO;
+        EtherCAT::ProcessData*  txPDO;
         
         void        initializeEtherCAT(uint16_t deviceAddress);
         void        writeDatagram();
@@ -13,11 +13,11 @@
 #include <cstdlib>
 #include <stdexcept>
 #include <string>
-#include <deque>
+#include <atomic>
 #include <stdint.h>
-#include "Mutex.h"
 #include "CAN.h"
 #include "CANMessage.h"
+#include "CANMessageBuffer.h"
 #include "RealtimeThread.h"
 
 /**
@@ -39,15 +39,31 @@
  * This will configure the baudrate of the CAN bus named 'can0' to 1 MBit/s.
  * <br/><br/>
  * When the CAN interface is configured, this device driver may be used to transmit and receive CAN messages.
+ * <br/><br/>
+ * By default, the handler of this device driver polls the CAN socket periodically. In the event driven mode,
+ * the handler blocks until messages are written into the software transmit buffer or received from the CAN
+ * socket, and it transmits and receives messages in batches. This allows to use the full bandwidth of the
+ * CAN bus, and it adds only a few microseconds of latency. Received messages are time stamped by the kernel.
+ * <br/>
+ * The event driven mode may be tested without hardware with a virtual CAN interface:
+ * <code><pre>
+ * % sudo ip link add dev vcan0 type vcan
+ * % sudo ip link set vcan0 up
+ * </pre></code>
  */
 class SocketCAN : public CAN, public RealtimeThread {
     
     public:
         
                         SocketCAN(std::string socketName);
+                        SocketCAN(std::string socketName, bool eventDriven);
         virtual         ~SocketCAN();
         int32_t         write(CANMessage canMessage);
         int32_t         read(CANMessage& canMessage);
+        int32_t         read(CANMessage& canMessage, uint64_t& timestamp);
+        uint32_t        getTransmitOverflows();
+        uint32_t        getReceiveOverflows();
+        void            stop();
         
     private:
         
@@ -56,14 +72,23 @@ class SocketCAN : public CAN, public RealtimeThread {
         static const double     PERIOD;                 // period of private thread in [s]
         
         static const uint16_t   BUFFER_SIZE = 64;       // size of the software transmit and receive buffers
+        static const uint16_t   BATCH_SIZE = 32;        // maximum number of messages transmitted or received with one system call
+        static const int32_t    RETRY_TIMEOUT = 1;      // time to wait until a full transmit queue is retried, given in [ms]
         
-        std::deque<CANMessage>  messagesToTransmit;     // buffer with CAN messages to transmit
-        std::deque<CANMessage>  receivedMessages;       // buffer with received CAN messages
-        Mutex                   mutex;                  // mutex to lock critical sections
+        CANMessageBuffer        messagesToTransmit;     // buffer with CAN messages to transmit
+        CANMessageBuffer        receivedMessages;       // buffer with received CAN messages and their times of reception
+        CANMessage              pendingMessages[BATCH_SIZE];    // messages taken from the transmit buffer but not yet sent
+        uint16_t                numberOfPendingMessages;        // number of messages not yet sent
         int32_t                 canSocket;              // socket id for CAN communication
+        bool                    eventDriven;            // flag indicating that the handler waits for events instead of polling
+        volatile bool           running;                // flag indicating that the event driven handler should continue
+        std::atomic<bool>       signaled;               // flag indicating that the event driven handler was woken up already
+        int32_t                 eventDescriptor;        // event file descriptor to wake up the event driven handler
+        int32_t                 epollDescriptor;        // epoll instance the event driven handler waits on
         
-        void            transmit(CANMessage canMessage);
-        int32_t         receive(CANMessage& canMessage);
+        void            open(std::string socketName);
+        bool            transmit();
+        void            receive();
         void            run();
 };
 
@@ -12,11 +12,10 @@
 
 #include <cstdlib>
 #include <stdexcept>
-#include <deque>
 #include <stdint.h>
-#include "Mutex.h"
 #include "CAN.h"
 #include "CANMessage.h"
+#include "CANMessageBuffer.h"
 #include "RealtimeThread.h"
 
 class PCI;
@@ -37,6 +36,8 @@ class TPMC901 : public CAN, public RealtimeThread {
         void            frequency(uint32_t hz);
         int32_t         write(CANMessage canMessage);
         int32_t         read(CANMessage& canMessage);
+        uint32_t        getTransmitOverflows();
+        uint32_t        getReceiveOverflows();
 
     private:
 
@@ -83,9 +84,8 @@ class TPMC901 : public CAN, public RealtimeThread {
         PCI&                    pci;                    // reference to the PCI driver
         void*                   deviceHandle;           // pci handle of this board
         uint64_t                baseAddress;            // base address of this board
-        std::deque<CANMessage>  messagesToTransmit;     // buffer with CAN messages to transmit
-        std::deque<CANMessage>  receivedMessages;       // buffer with received CAN messages
-        Mutex                   mutex;                  // mutex to lock critical sections
+        CANMessageBuffer        messagesToTransmit;     // buffer with CAN messages to transmit
+        CANMessageBuffer        receivedMessages;       // buffer with received CAN messages
 
         void            transmit(CANMessage canMessage);
         int32_t         receive(CANMessage& canMessage);
@@ -0,0 +1,145 @@
+/*
+ * CyclicExecutor.cpp
+ * Copyright (c) 2026, ZHAW
+ * All rights reserved.
+ *
+ *  Created on: 17.10.2026
+ *      Author: Marcel Honegger
+ */
+
+#include <cmath>
+#include "Trace.h"
+#include "CyclicExecutor.h"
+
+using namespace std;
+
+CyclicExecutor::Task::~Task() {}
+
+/**
+ * This method is called periodically by the cyclic executor.
+ * It needs to be implemented by a task.
+ */
+void CyclicExecutor::Task::execute() {}
+
+/**
+ * Creates a cyclic executor and starts its realtime thread.
+ * @param name the name of the realtime thread of this executor.
+ * @param priority the priority of the realtime thread of this executor.
+ * @param period the period of this executor, given in [s]. The periods of all tasks must be multiples of this period.
+ */
+CyclicExecutor::CyclicExecutor(string name, int32_t priority, double period) : RealtimeThread(name, STACK_SIZE, priority, period) {
+    
+    // reserve memory, so that tasks can be added without reallocation in most cases
+    
+    entries.reserve(32);
+    
+    // start handler
+    
+    start();
+}
+
+/**
+ * Deletes the cyclic executor and stops its realtime thread.
+ */
+CyclicExecutor::~CyclicExecutor() {
+    
+    // stop handler
+    
+    stop();
+}
+
+/**
+ * Adds a task to this executor. The task is executed for the first time in the next
+ * period of the executor, and then with the given period.
+ * @param task the task to add.
+ * @param period the period of the task, given in [s]. This must be a multiple of the period of this executor.
+ */
+void CyclicExecutor::addTask(Task& task, double period) {
+    
+    addTask(task, period, 0.0);
+}
+
+/**
+ * Adds a task to this executor. The task is executed for the first time after the given
+ * offset, and then with the given period. Offsets allow to distribute tasks with the same
+ * period over different periods of the executor.
+ * @param task the task to add.
+ * @param period the period of the task, given in [s]. This must be a multiple of the period of this executor.
+ * @param offset the offset of the task, given in [s]. This is rounded to a multiple of the period of this executor.
+ */
+void CyclicExecutor::addTask(Task& task, double period, double offset) {
+    
+    double basePeriod = getPeriod();
+    
+    uint32_t divider = static_cast<uint32_t>(period/basePeriod+0.5);
+    if ((divider < 1) || (fabs(static_cast<double>(divider)*basePeriod-period) > 0.01*basePeriod)) throw invalid_argument("CyclicExecutor: the period of a task must be a multiple of the period of the executor.");
+    
+    uint32_t phase = (offset > 0.0) ? static_cast<uint32_t>(offset/basePeriod+0.5)%divider : 0;
+    
+    Entry entry;
+    entry.task = &task;
+    entry.divider = divider;
+    entry.counter = phase+1;
+    
+    mutex.lock();
+    
+    entries.push_back(entry);
+    
+    mutex.unlock();
+}
+
+/**
+ * Removes a task from this executor. When this method returns, the task isn't executed anymore.
+ * @param task the task to remove.
+ */
+void CyclicExecutor::removeTask(Task& task) {
+    
+    mutex.lock();
+    
+    for (vector<Entry>::iterator entry = entries.begin(); entry != entries.end(); ) {
+        
+        if (entry->task == &task) entry = entries.erase(entry);
+        else entry++;
+    }
+    
+    mutex.unlock();
+}
+
+/**
+ * Gets the number of tasks of this executor.
+ * @return the number of tasks.
+ */
+uint32_t CyclicExecutor::getNumberOfTasks() {
+    
+    mutex.lock();
+    
+    uint32_t numberOfTasks = static_cast<uint32_t>(entries.size());
+    
+    mutex.unlock();
+    
+    return numberOfTasks;
+}
+
+/**
+ * This method is the handler of the cyclic executor. It executes all tasks that are due.
+ */
+void CyclicExecutor::run() {
+    
+    while (waitForNextPeriod()) {
+        
+        mutex.lock();
+        
+        for (vector<Entry>::iterator entry = entries.begin(); entry != entries.end(); entry++) {
+            
+            if (--entry->counter == 0) {
+                
+                entry->counter = entry->divider;
+                
+                Trace::Span span("CyclicExecutor::Task::execute");
+                entry->task->execute();
+            }
+        }
+        
+        mutex.unlock();
+    }
+}
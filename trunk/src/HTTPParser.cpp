@@ -0,0 +1,501 @@
+/*
+ * HTTPParser.cpp
+ * Copyright (c) 2026, ZHAW
+ * All rights reserved.
+ *
+ *  Created on: 17.10.2026
+ *      Author: Marcel Honegger
+ */
+
+#include <cctype>
+#include "HTTPParser.h"
+
+using namespace std;
+
+/**
+ * Gets the value of a hexadecimal digit.
+ * @return the value of the digit, or -1 if the character isn't a hexadecimal digit.
+ */
+inline int32_t hexadecimal(char c) {
+    
+    if ((c >= '0') && (c <= '9')) return c-'0';
+    else if ((c >= 'a') && (c <= 'f')) return c-'a'+10;
+    else if ((c >= 'A') && (c <= 'F')) return c-'A'+10;
+    else return -1;
+}
+
+/**
+ * Creates an http parser, which is ready to parse a request.
+ */
+HTTPParser::HTTPParser() {
+    
+    maxSize = 65536;
+    
+    reset();
+}
+
+/**
+ * Deletes the http parser.
+ */
+HTTPParser::~HTTPParser() {}
+
+/**
+ * Sets the maximum size of a request, with its header and content.
+ * @param maxSize the maximum size of a request, given in [bytes].
+ */
+void HTTPParser::setMaxSize(size_t maxSize) {
+    
+    this->maxSize = maxSize;
+}
+
+/**
+ * Resets the parser, so that it is ready to parse the next request.
+ */
+void HTTPParser::reset() {
+    
+    state = METHOD;
+    status = INCOMPLETE;
+    size = 0;
+    
+    method.clear();
+    target.clear();
+    version.clear();
+    
+    fields = 0;
+    chunked = false;
+    keepAlive = false;
+    remaining = 0;
+    emptyLine = true;
+    
+    content.clear();
+}
+
+/**
+ * Parses the given data of a request. The parser stops at the end of the request,
+ * or if the request is found to be invalid. The data that follows the request
+ * belongs to the next request.
+ * @param data a pointer to the received data.
+ * @param size the number of received bytes.
+ * @return the number of bytes that were parsed.
+ */
+size_t HTTPParser::parse(const char* data, size_t size) {
+    
+    size_t i = 0;
+    
+    while ((i < size) && (status == INCOMPLETE)) {
+        
+        // the content and chunks are copied as a whole
+        
+        if ((state == CONTENT) || (state == CHUNK_DATA)) {
+            
+            size_t n = (remaining < size-i) ? static_cast<size_t>(remaining) : size-i;
+            
+            content.append(data+i, n);
+            remaining -= n;
+            this->size += n;
+            i += n;
+            
+            if (remaining == 0) {
+                if (state == CONTENT) {
+                    state = END;
+                    status = COMPLETE;
+                } else {
+                    state = CHUNK_DATA_END;
+                }
+            }
+            
+            continue;
+        }
+        
+        // everything else is parsed byte by byte
+        
+        char c = data[i++];
+        
+        if (++this->size > maxSize) {
+            status = TOO_LARGE;
+            break;
+        }
+        
+        switch (state) {
+            
+            case METHOD:
+                
+                if (c == ' ') {
+                    if (method.empty()) status = BAD_REQUEST;
+                    else state = TARGET;
+                } else if ((c == '\r') || (c == '\n')) {
+                    if (!method.empty()) status = BAD_REQUEST;
+                } else if ((c > ' ') && (c < 0x7F)) {
+                    method += c;
+                } else {
+                    status = BAD_REQUEST;
+                }
+                break;
+                
+            case TARGET:
+                
+                if (c == ' ') {
+                    if (target.empty()) status = BAD_REQUEST;
+                    else state = VERSION;
+                } else if (c == '\n') {
+                    if (target.empty()) status = BAD_REQUEST;
+                    version = "HTTP/1.0";
+                    keepAlive = false;
+                    state = FIELD_NAME;
+                } else if ((c > ' ') && (c < 0x7F)) {
+                    target += c;
+                } else if (c != '\r') {
+                    status = BAD_REQUEST;
+                }
+                break;
+                
+            case VERSION:
+                
+                if (c == '\n') {
+                    if (version.compare(0, 5, "HTTP/") != 0) status = BAD_REQUEST;
+                    keepAlive = (version.compare("HTTP/1.1") == 0);
+                    state = FIELD_NAME;
+                } else if (c != '\r') {
+                    version += c;
+                }
+                break;
+                
+            case FIELD_NAME:
+                
+                if (c == '\n') {
+                    
+                    if (emptyLine) headerComplete();
+                    else status = BAD_REQUEST;
+                    
+                } else if (c == ':') {
+                    
+                    if (emptyLine) status = BAD_REQUEST;
+                    else state = FIELD_VALUE;
+                    
+                } else if (c != '\r') {
+                    
+                    if (emptyLine) {
+                        
+                        // begin a new header field, and reuse the strings of former requests
+                        
+                        if (fields >= MAX_FIELDS) {
+                            status = TOO_LARGE;
+                            break;
+                        } else if ((c == ' ') || (c == '\t')) {
+                            status = BAD_REQUEST;
+                            break;
+                        }
+                        
+                        if (fields >= names.size()) {
+                            names.push_back("");
+                            values.push_back("");
+                        }
+                        
+                        names[fields].clear();
+                        values[fields].clear();
+                        emptyLine = false;
+                    }
+                    
+                    names[fields] += ((c >= 'A') && (c <= 'Z')) ? c-'A'+'a' : c;
+                }
+                break;
+                
+            case FIELD_VALUE:
+                
+                if (c == '\n') {
+                    fieldComplete();
+                    emptyLine = true;
+                    state = FIELD_NAME;
+                } else if ((c == ' ') || (c == '\t')) {
+                    if (!values[fields].empty()) values[fields] += c;
+                } else if (c != '\r') {
+                    values[fields] += c;
+                }
+                break;
+                
+            case CHUNK_SIZE:
+            case CHUNK_EXTENSION:
+                
+                if (c == '\n') {
+                    
+                    if (emptyLine) {
+                        status = BAD_REQUEST;
+                    } else if (remaining == 0) {
+                        emptyLine = true;
+                        state = TRAILER;
+                    } else if (this->size+remaining > maxSize) {
+                        status = TOO_LARGE;
+                    } else {
+                        state = CHUNK_DATA;
+                    }
+                    
+                } else if ((state == CHUNK_SIZE) && (hexadecimal(c) >= 0)) {
+                    
+                    remaining = 16*remaining+hexadecimal(c);
+                    emptyLine = false;
+                    
+                    if (remaining > maxSize) status = TOO_LARGE;
+                    
+                } else if ((c == ';') || (c == ' ') || (c == '\t')) {
+                    
+                    state = CHUNK_EXTENSION;
+                    
+                } else if ((state == CHUNK_SIZE) && (c != '\r')) {
+                    
+                    status = BAD_REQUEST;
+                }
+                break;
+                
+            case CHUNK_DATA_END:
+                
+                if (c == '\n') {
+                    remaining = 0;
+                    emptyLine = true;
+                    state = CHUNK_SIZE;
+                } else if (c != '\r') {
+                    status = BAD_REQUEST;
+                }
+                break;
+                
+            case TRAILER:
+                
+                if (c == '\n') {
+                    if (emptyLine) {
+                        state = END;
+                        status = COMPLETE;
+                    }
+                    emptyLine = true;
+                } else if (c != '\r') {
+                    emptyLine = false;
+                }
+                break;
+                
+            default:
+                
+                break;
+        }
+    }
+    
+    return i;
+}
+
+/**
+ * Gets the status of the request that is parsed.
+ * @return the status of the request.
+ */
+HTTPParser::Status HTTPParser::getStatus() {
+    
+    return status;
+}
+
+/**
+ * Gets the method of the request.
+ * @return the method, i.e. 'GET'.
+ */
+const string& HTTPParser::getMethod() {
+    
+    return method;
+}
+
+/**
+ * Gets the request target, as it was received.
+ * @return the request target, i.e. '/cgi-bin/myScript?x=0.5'.
+ */
+const string& HTTPParser::getTarget() {
+    
+    return target;
+}
+
+/**
+ * Gets the decoded path of the request target, without the query.
+ * @return the path, i.e. '/cgi-bin/myScript'.
+ */
+string HTTPParser::getPath() {
+    
+    string path;
+    
+    size_t query = target.find('?');
+    decode(target.data(), (query != string::npos) ? query : target.size(), false, path);
+    
+    return path;
+}
+
+/**
+ * Gets the decoded arguments of the query of the request target. An argument without
+ * a value, like 'y' in '?x=0.5&y', has an empty string as its value.
+ * @param names a vector the names of the arguments are appended to.
+ * @param values a vector the values of the arguments are appended to.
+ */
+void HTTPParser::getArguments(vector<string>& names, vector<string>& values) {
+    
+    size_t begin = target.find('?');
+    if (begin == string::npos) return;
+    
+    while (begin < target.size()) {
+        
+        size_t end = target.find('&', ++begin);
+        if (end == string::npos) end = target.size();
+        
+        size_t equals = target.find('=', begin);
+        if (equals > end) equals = end;
+        
+        if (end > begin) {
+            
+            names.push_back("");
+            values.push_back("");
+            
+            decode(target.data()+begin, equals-begin, true, names.back());
+            if (equals < end) decode(target.data()+equals+1, end-equals-1, true, values.back());
+        }
+        
+        begin = end;
+    }
+}
+
+/**
+ * Gets the http version of the request.
+ * @return the http version, i.e. 'HTTP/1.1'.
+ */
+const string& HTTPParser::getVersion() {
+    
+    return version;
+}
+
+/**
+ * Gets the value of a header field with a given name.
+ * @param name the name of the header field in lower case, i.e. 'if-none-match'.
+ * @return the value of the header field, or an empty string if the request has no such field.
+ */
+string HTTPParser::getField(string name) {
+    
+    for (uint32_t i = 0; i < fields; i++) {
+        if (names[i].compare(name) == 0) return values[i];
+    }
+    
+    return "";
+}
+
+/**
+ * Tests if the connection is kept alive after this request. This is the default for HTTP/1.1,
+ * unless the request has a 'Connection: close' header field.
+ * @return <code>true</code> if the connection is kept alive, <code>false</code> otherwise.
+ */
+bool HTTPParser::isKeepAlive() {
+    
+    return keepAlive;
+}
+
+/**
+ * Gets the content of the request, which is already decoded from the chunked transfer coding.
+ * @return the content of the request.
+ */
+const string& HTTPParser::getContent() {
+    
+    return content;
+}
+
+/**
+ * Decodes a given URL encoded text in a single pass.
+ * @param data a pointer to the encoded text.
+ * @param size the number of bytes of the encoded text.
+ * @param form a flag indicating form data, where '+' encodes a space.
+ * @param text a string the decoded text is written to.
+ */
+void HTTPParser::decode(const char* data, size_t size, bool form, string& text) {
+    
+    text.clear();
+    text.reserve(size);
+    
+    for (size_t i = 0; i < size; i++) {
+        
+        if ((data[i] == '%') && (i+2 < size) && (hexadecimal(data[i+1]) >= 0) && (hexadecimal(data[i+2]) >= 0)) {
+            text += static_cast<char>(16*hexadecimal(data[i+1])+hexadecimal(data[i+2]));
+            i += 2;
+        } else if ((data[i] == '+') && form) {
+            text += ' ';
+        } else {
+            text += data[i];
+        }
+    }
+}
+
+/**
+ * Decodes a given URL encoded text in a single pass.
+ * @param text the encoded text.
+ * @param form a flag indicating form data, where '+' encodes a space.
+ * @return the decoded text.
+ */
+string HTTPParser::decode(const string& text, bool form) {
+    
+    string decodedText;
+    decode(text.data(), text.size(), form, decodedText);
+    
+    return decodedText;
+}
+
+/**
+ * Interprets a header field when it is complete.
+ */
+void HTTPParser::fieldComplete() {
+    
+    string& name = names[fields];
+    string& value = values[fields];
+    
+    while (!value.empty() && ((value[value.size()-1] == ' ') || (value[value.size()-1] == '\t'))) value.erase(value.size()-1);
+    
+    fields++;
+    
+    if (name.compare("content-length") == 0) {
+        
+        if (value.empty() || chunked) status = BAD_REQUEST;
+        
+        remaining = 0;
+        for (size_t i = 0; (i < value.size()) && (status == INCOMPLETE); i++) {
+            if ((value[i] < '0') || (value[i] > '9')) status = BAD_REQUEST;
+            else if ((remaining = 10*remaining+(value[i]-'0')) > maxSize) status = TOO_LARGE;
+        }
+        
+    } else if (name.compare("transfer-encoding") == 0) {
+        
+        string coding = value;
+        for (size_t i = 0; i < coding.size(); i++) coding[i] = tolower(coding[i]);
+        
+        if ((coding.size() >= 7) && (coding.compare(coding.size()-7, 7, "chunked") == 0) && (coding.find(',') == string::npos)) {
+            chunked = true;
+            remaining = 0;
+        } else if (coding.compare("identity") != 0) {
+            status = NOT_IMPLEMENTED;
+        }
+        
+    } else if (name.compare("connection") == 0) {
+        
+        string options = value;
+        for (size_t i = 0; i < options.size(); i++) options[i] = tolower(options[i]);
+        
+        if (options.find("close") != string::npos) keepAlive = false;
+        else if (options.find("keep-alive") != string::npos) keepAlive = true;
+    }
+}
+
+/**
+ * Prepares the parsing of the content of the request, when its header is complete.
+ */
+void HTTPParser::headerComplete() {
+    
+    if (chunked) {
+        
+        state = CHUNK_SIZE;
+        remaining = 0;
+        emptyLine = true;
+        
+    } else if (remaining > 0) {
+        
+        if (size+remaining > maxSize) status = TOO_LARGE;
+        else state = CONTENT;
+        
+    } else {
+        
+        state = END;
+        status = COMPLETE;
+    }
+}
@@ -7,10 +7,133 @@
  *      Author: Marcel Honegger
  */
 
+#include <cstdio>
+#include <utility>
 #include "HTTPScript.h"
 
 using namespace std;
 
+/**
+ * Creates an empty response, with the content type 'text/xml'.
+ */
+HTTPScript::Response::Response() {
+    
+    contentType = "text/xml";
+    compressible = true;
+}
+
+/**
+ * Deletes the response object.
+ */
+HTTPScript::Response::~Response() {}
+
+/**
+ * Removes the content of this response, and resets its content type. The memory
+ * of the content is kept, so that it can be reused for the next response.
+ */
+void HTTPScript::Response::clear() {
+    
+    contentType = "text/xml";
+    compressible = true;
+    content.clear();
+}
+
+/**
+ * Sets the content type of this response.
+ * @param contentType the content type, i.e. 'application/json' or 'application/octet-stream'.
+ */
+void HTTPScript::Response::setContentType(string contentType) {
+    
+    this->contentType = contentType;
+}
+
+/**
+ * Gets the content type of this response.
+ * @return the content type.
+ */
+string HTTPScript::Response::getContentType() {
+    
+    return contentType;
+}
+
+/**
+ * Defines if the content of this response may be compressed by the http server. This
+ * should be disabled for content that is already compressed, like images.
+ * @param compressible <code>true</code> if the content may be compressed, <code>false</code> otherwise.
+ */
+void HTTPScript::Response::setCompressible(bool compressible) {
+    
+    this->compressible = compressible;
+}
+
+/**
+ * Tests if the content of this response may be compressed.
+ * @return <code>true</code> if the content may be compressed, <code>false</code> otherwise.
+ */
+bool HTTPScript::Response::isCompressible() {
+    
+    return compressible;
+}
+
+/**
+ * Appends binary data to the content of this response, i.e. an array of float values.
+ * @param data a pointer to the data.
+ * @param size the size of the data, given in [bytes].
+ */
+void HTTPScript::Response::write(const void* data, size_t size) {
+    
+    content.append(static_cast<const char*>(data), size);
+}
+
+/**
+ * Appends a text to the content of this response.
+ * @param text the text to append.
+ */
+void HTTPScript::Response::write(const string& text) {
+    
+    content.append(text);
+}
+
+/**
+ * Appends a formatted text to the content of this response, i.e. a JSON object. The
+ * text is formatted like with the <code>printf()</code> function, directly into the
+ * buffer of this response.
+ * @param format the format of the text.
+ */
+void HTTPScript::Response::print(const char* format, ...) {
+    
+    size_t size = content.size();
+    size_t capacity = (content.capacity() > size+64) ? content.capacity()-size : 64;
+    
+    va_list arguments;
+    
+    va_start(arguments, format);
+    content.resize(size+capacity);
+    int32_t n = vsnprintf(&content[size], capacity, format, arguments);
+    va_end(arguments);
+    
+    if ((n >= 0) && (static_cast<size_t>(n) >= capacity)) {
+        
+        // the buffer was too small, so the text is formatted again
+        
+        va_start(arguments, format);
+        content.resize(size+n+1);
+        vsnprintf(&content[size], n+1, format, arguments);
+        va_end(arguments);
+    }
+    
+    content.resize((n >= 0) ? size+n : size);
+}
+
+/**
+ * Gets the content of this response.
+ * @return a reference to the content, which may also be modified directly.
+ */
+string& HTTPScript::Response::getContent() {
+    
+    return content;
+}
+
 HTTPScript::HTTPScript() {}
 
 HTTPScript::~HTTPScript() {}
@@ -29,3 +152,26 @@ string HTTPScript::call(vector<string> names, vector<string> values) {
     
     return "";
 }
+
+/**
+ * This method may be implemented by derived classes, which return other types of
+ * content than xhtml. It gets called by the http server, when the corresponding
+ * script is called by an http client. The default implementation places the string
+ * returned by the <code>call(names, values)</code> method within an xhtml page.
+ * @param names a vector of the names of arguments passed to the server by
+ * the client with a URL.
+ * @param values a vector of the corresponding values of arguments passed
+ * to the server.
+ * @param response an empty response object, which the content is written to.
+ */
+void HTTPScript::call(vector<string>& names, vector<string>& values, Response& response) {
+    
+    response.setContentType("text/xml");
+    response.write("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\r\n");
+    response.write("<!DOCTYPE html>\r\n");
+    response.write("<html xmlns=\"http://www.w3.org/1999/xhtml\" xml:lang=\"en\" lang=\"en\">\r\n");
+    response.write("<body>\r\n");
+    response.write(call(move(names), move(values)));
+    response.write("</body>\r\n");
+    response.write("</html>\r\n");
+}
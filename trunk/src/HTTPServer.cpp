@@ -7,8 +7,28 @@
  *      Author: Marcel Honegger
  */
 
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <netinet/tcp.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+#if defined __QNX__
+
+#include <poll.h>
+
+#else
+
+#include <sys/epoll.h>
+#include <sys/sendfile.h>
+
+#endif
+
 #include "HTTPScript.h"
 #include "HTTPServer.h"
+#include "Telemetry.h"
 
 using namespace std;
 
@@ -20,16 +40,27 @@ template <class T> inline string type2String(const T& t) {
 	return out.str();
 }
 
+const unordered_map<string, string> HTTPServer::contentTypes = {
+	{"html", "text/html"}, {"htm", "text/html"}, {"text", "text/plain"}, {"txt", "text/plain"}, {"conf", "text/plain"}, {"asc", "text/plain"}, {"c", "text/plain"},
+	{"css", "text/css"}, {"xml", "text/xml"}, {"dtd", "text/xml"}, {"js", "text/javascript"}, {"json", "application/json"}, {"manifest", "text/cache-manifest"},
+	{"gif", "image/gif"}, {"jpg", "image/jpeg"}, {"jpeg", "image/jpeg"}, {"png", "image/png"}, {"svg", "image/svg+xml"}, {"ico", "image/x-icon"},
+	{"xbm", "image/x-xbitmap"}, {"xpm", "image/x-xpixmap"}, {"xwd", "image/x-xwindowdump"},
+	{"class", "application/octet-stream"}, {"jar", "application/x-java-applet"}, {"pdf", "application/pdf"}, {"sig", "application/pgp-signature"},
+	{"spl", "application/futuresplash"}, {"ps", "application/postscript"}, {"torrent", "application/x-bittorrent"}, {"dvi", "application/x-dvi"},
+	{"pac", "application/x-ns-proxy-autoconfig"}, {"swf", "application/x-shockwave-flash"},
+	{"tar.gz", "application/x-tgz"}, {"tar.bz2", "application/x-bzip-compressed-tar"}, {"gz", "application/x-gzip"}, {"tgz", "application/x-tgz"},
+	{"tar", "application/x-tar"}, {"bz2", "application/x-bzip"}, {"tbz", "application/x-bzip-compressed-tar"}, {"zip", "application/zip"},
+	{"mp3", "audio/mpeg"}, {"m3u", "audio/x-mpegurl"}, {"wma", "audio/x-ms-wma"}, {"wax", "audio/x-ms-wax"}, {"wav", "audio/x-wav"}, {"ogg", "audio/ogg"},
+	{"mpeg", "video/mpeg"}, {"mpg", "video/mpeg"}, {"mp4", "video/mp4"}, {"mov", "video/quicktime"}, {"qt", "video/quicktime"}, {"ogv", "video/ogg"},
+	{"avi", "video/x-msvideo"}, {"asf", "video/x-ms-asf"}, {"asx", "video/x-ms-asf"}, {"wmv", "video/x-ms-wmv"}, {"webm", "video/webm"}
+};
+
 /**
  * Creates an http server with the default port number.
  */
 HTTPServer::HTTPServer() : Thread("HTTPServer", STACK_SIZE) {
 	
-	portNumber = PORT_NUMBER;
-	path = "";
-	indexPage = "index.html";
-	
-	signal(SIGPIPE, SIG_IGN);
+	init(PORT_NUMBER, "", "index.html");
 }
 
 /**
@@ -38,11 +69,7 @@ HTTPServer::HTTPServer() : Thread("HTTPServer", STACK_SIZE) {
  */
 HTTPServer::HTTPServer(uint16_t portNumber) : Thread("HTTPServer", STACK_SIZE) {
 	
-	this->portNumber = portNumber;
-	this->path = "";
-	this->indexPage = "index.html";
-	
-	signal(SIGPIPE, SIG_IGN);
+	init(portNumber, "", "index.html");
 }
 
 /**
@@ -54,44 +81,62 @@ HTTPServer::HTTPServer(uint16_t portNumber) : Thread("HTTPServer", STACK_SIZE) {
  */
 HTTPServer::HTTPServer(uint16_t portNumber, string path, string indexPage) : Thread("HTTPServer", STACK_SIZE) {
 	
-	this->portNumber = portNumber;
-	this->path = path;
-	this->indexPage = indexPage;
-	
-	signal(SIGPIPE, SIG_IGN);
+	init(portNumber, path, indexPage);
 }
 
-HTTPServer::~HTTPServer() {}
+/**
+ * Stops the http server and its worker threads, and closes all connections.
+ */
+HTTPServer::~HTTPServer() {
+	
+	if (isAlive()) {
+		
+		running = false;
+		
+		char wakeup = 0;
+		if (write(wakeupPipe[1], &wakeup, 1) < 0) {}
+		
+		join();
+	}
+	
+	::close(wakeupPipe[0]);
+	::close(wakeupPipe[1]);
+	
+	pthread_cond_destroy(&jobCondition);
+	pthread_mutex_destroy(&jobMutex);
+	
+	for (unordered_map<string, CachedFile*>::iterator i = cachedFiles.begin(); i != cachedFiles.end(); i++) delete i->second;
+}
 
 /**
- * Decodes a given URL string into a standard text string.
+ * Initializes the attributes of this http server.
  */
-string HTTPServer::urlDecoder(string url) {
+void HTTPServer::init(uint16_t portNumber, string path, string indexPage) {
+	
+	this->portNumber = portNumber;
+	this->path = path;
+	this->indexPage = indexPage;
 	
-	size_t pos = -1;
-	while ((pos = url.find("+")) != string::npos) url = url.substr(0, pos)+" "+url.substr(pos+1);
-	while ((pos = url.find("%08")) != string::npos) url = url.substr(0, pos)+"\b"+url.substr(pos+3);
-	while ((pos = url.find("%09")) != string::npos) url = url.substr(0, pos)+"\t"+url.substr(pos+3);
-	while ((pos = url.find("%0A")) != string::npos) url = url.substr(0, pos)+"\n"+url.substr(pos+3);
-	while ((pos = url.find("%0D")) != string::npos) url = url.substr(0, pos)+"\r"+url.substr(pos+3);
-	while ((pos = url.find("%20")) != string::npos) url = url.substr(0, pos)+" "+url.substr(pos+3);
-	while ((pos = url.find("%22")) != string::npos) url = url.substr(0, pos)+"\""+url.substr(pos+3);
-	while ((pos = url.find("%23")) != string::npos) url = url.substr(0, pos)+"#"+url.substr(pos+3);
-	while ((pos = url.find("%24")) != string::npos) url = url.substr(0, pos)+"$"+url.substr(pos+3);
-	while ((pos = url.find("%25")) != string::npos) url = url.substr(0, pos)+"%"+url.substr(pos+3);
-	while ((pos = url.find("%26")) != string::npos) url = url.substr(0, pos)+"&"+url.substr(pos+3);
-	while ((pos = url.find("%2B")) != string::npos) url = url.substr(0, pos)+"+"+url.substr(pos+3);
-	while ((pos = url.find("%2C")) != string::npos) url = url.substr(0, pos)+","+url.substr(pos+3);
-	while ((pos = url.find("%2F")) != string::npos) url = url.substr(0, pos)+"/"+url.substr(pos+3);
-	while ((pos = url.find("%3A")) != string::npos) url = url.substr(0, pos)+":"+url.substr(pos+3);
-	while ((pos = url.find("%3B")) != string::npos) url = url.substr(0, pos)+";"+url.substr(pos+3);
-	while ((pos = url.find("%3C")) != string::npos) url = url.substr(0, pos)+"<"+url.substr(pos+3);
-	while ((pos = url.find("%3D")) != string::npos) url = url.substr(0, pos)+"="+url.substr(pos+3);
-	while ((pos = url.find("%3E")) != string::npos) url = url.substr(0, pos)+">"+url.substr(pos+3);
-	while ((pos = url.find("%3F")) != string::npos) url = url.substr(0, pos)+"?"+url.substr(pos+3);
-	while ((pos = url.find("%40")) != string::npos) url = url.substr(0, pos)+"@"+url.substr(pos+3);
+	maxConnections = MAX_CONNECTIONS;
+	maxRequestSize = MAX_REQUEST_SIZE;
+	maxRequestsPerConnection = MAX_REQUESTS_PER_CONNECTION;
+	maxPendingRequests = MAX_PENDING_REQUESTS;
+	keepAliveTimeout = KEEP_ALIVE_TIMEOUT;
+	numberOfWorkers = WORKERS;
 	
-	return url;
+	running = false;
+	serverSocket = -1;
+	pollFD = -1;
+	cacheSize = 0;
+	
+	if (pipe(wakeupPipe) < 0) throw runtime_error("HTTPServer: couldn't create pipe.");
+	fcntl(wakeupPipe[0], F_SETFL, fcntl(wakeupPipe[0], F_GETFL) | O_NONBLOCK);
+	fcntl(wakeupPipe[1], F_SETFL, fcntl(wakeupPipe[1], F_GETFL) | O_NONBLOCK);
+	
+	pthread_mutex_init(&jobMutex, NULL);
+	pthread_cond_init(&jobCondition, NULL);
+	
+	signal(SIGPIPE, SIG_IGN);
 }
 
 /**
@@ -105,12 +150,152 @@ void HTTPServer::add(string name, HTTPScript* httpScript) {
 	httpScripts.push_back(httpScript);
 }
 
-void HTTPServer::run() {
+/**
+ * Registers the given telemetry object with the http server.
+ * This allows remote systems to subscribe to the signals of this
+ * telemetry object with requests like '/events/name?signals=x,y'.
+ */
+void HTTPServer::add(string name, Telemetry* telemetry) {
+	
+	telemetryNames.push_back(name);
+	telemetries.push_back(telemetry);
+}
+
+/**
+ * Sets the maximum number of connections this server keeps open at the same time.
+ * Further clients get a response with the status '503 Service Unavailable'.
+ * @param maxConnections the maximum number of open connections.
+ */
+void HTTPServer::setMaxConnections(uint32_t maxConnections) {
+	
+	this->maxConnections = (maxConnections > 0) ? maxConnections : 1;
+}
+
+/**
+ * Gets the maximum number of connections this server keeps open at the same time.
+ * @return the maximum number of open connections.
+ */
+uint32_t HTTPServer::getMaxConnections() {
+	
+	return maxConnections;
+}
+
+/**
+ * Sets the maximum size of a request, with its header and content. Larger requests get
+ * a response with the status '413 Payload Too Large', and the connection is closed.
+ * @param maxRequestSize the maximum size of a request, given in [bytes].
+ */
+void HTTPServer::setMaxRequestSize(uint32_t maxRequestSize) {
+	
+	this->maxRequestSize = (maxRequestSize > 1024) ? maxRequestSize : 1024;
+}
+
+/**
+ * Gets the maximum size of a request.
+ * @return the maximum size of a request, given in [bytes].
+ */
+uint32_t HTTPServer::getMaxRequestSize() {
+	
+	return maxRequestSize;
+}
+
+/**
+ * Sets the maximum number of requests of a connection. The connection
+ * is closed after the response to the last of these requests.
+ * @param maxRequestsPerConnection the maximum number of requests of a connection.
+ */
+void HTTPServer::setMaxRequestsPerConnection(uint32_t maxRequestsPerConnection) {
 	
-	int32_t serverSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	this->maxRequestsPerConnection = (maxRequestsPerConnection > 0) ? maxRequestsPerConnection : 1;
+}
+
+/**
+ * Gets the maximum number of requests of a connection.
+ * @return the maximum number of requests of a connection.
+ */
+uint32_t HTTPServer::getMaxRequestsPerConnection() {
+	
+	return maxRequestsPerConnection;
+}
+
+/**
+ * Sets the maximum number of script calls that wait for a worker thread. Further
+ * script calls get a response with the status '503 Service Unavailable'.
+ * @param maxPendingRequests the maximum number of waiting script calls.
+ */
+void HTTPServer::setMaxPendingRequests(uint32_t maxPendingRequests) {
+	
+	this->maxPendingRequests = (maxPendingRequests > 0) ? maxPendingRequests : 1;
+}
+
+/**
+ * Gets the maximum number of script calls that wait for a worker thread.
+ * @return the maximum number of waiting script calls.
+ */
+uint32_t HTTPServer::getMaxPendingRequests() {
+	
+	return maxPendingRequests;
+}
+
+/**
+ * Sets the time after which idle connections are closed.
+ * @param keepAliveTimeout the timeout of idle connections, given in [ms].
+ */
+void HTTPServer::setKeepAliveTimeout(int32_t keepAliveTimeout) {
+	
+	this->keepAliveTimeout = (keepAliveTimeout > 0) ? keepAliveTimeout : 0;
+}
+
+/**
+ * Gets the time after which idle connections are closed.
+ * @return the timeout of idle connections, given in [ms].
+ */
+int32_t HTTPServer::getKeepAliveTimeout() {
+	
+	return keepAliveTimeout;
+}
+
+/**
+ * Sets the number of worker threads that call scripts. This method must
+ * be called before the server is started.
+ * @param numberOfWorkers the number of worker threads.
+ */
+void HTTPServer::setNumberOfWorkers(uint32_t numberOfWorkers) {
+	
+	this->numberOfWorkers = (numberOfWorkers > 0) ? numberOfWorkers : 1;
+}
+
+/**
+ * Gets the number of worker threads that call scripts.
+ * @return the number of worker threads.
+ */
+uint32_t HTTPServer::getNumberOfWorkers() {
+	
+	return numberOfWorkers;
+}
+
+/**
+ * Gets the number of connections that are currently open.
+ * @return the number of open connections.
+ */
+uint32_t HTTPServer::getNumberOfConnections() {
+	
+	return static_cast<uint32_t>(connections.size());
+}
 
-    int32_t enable = 1;
-    setsockopt(serverSocket, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(int32_t));
+/**
+ * This method implements the event loop of the server. It accepts connections, reads
+ * requests and writes responses without blocking, and collects the responses of
+ * script calls from the worker threads.
+ */
+void HTTPServer::run() {
+	
+	running = true;
+	
+	serverSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	
+	int32_t enable = 1;
+	setsockopt(serverSocket, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(int32_t));
 	
 	sockaddr_in serverAddr;
 	
@@ -119,443 +304,1199 @@ void HTTPServer::run() {
 	serverAddr.sin_addr.s_addr = htonl(INADDR_ANY);
 	serverAddr.sin_port = htons(portNumber);
 	
-	while (true) {
+	while (running && (::bind(serverSocket, (sockaddr*)&serverAddr, sizeof(serverAddr)) != 0)) sleep(BIND_RETRY_DELAY);
+	
+	if (running) {
+		
+		listen(serverSocket, LISTEN_BACKLOG);
+		fcntl(serverSocket, F_SETFL, fcntl(serverSocket, F_GETFL) | O_NONBLOCK);
+		
+		// start the pool of worker threads
+		
+		for (uint32_t i = 0; i < numberOfWorkers; i++) {
+			Worker* worker = new Worker(this);
+			worker->start();
+			workers.push_back(worker);
+		}
+		
+		#if defined __QNX__
+		
+		vector<pollfd> descriptors;
+		
+		#else
 		
-	    if (::bind(serverSocket, (sockaddr*)&serverAddr, sizeof(serverAddr)) == 0) {
+		pollFD = epoll_create(EVENTS);
+		
+		epoll_event event;
+		memset(&event, 0, sizeof(event));
+		event.events = EPOLLIN;
+		event.data.fd = serverSocket;
+		epoll_ctl(pollFD, EPOLL_CTL_ADD, serverSocket, &event);
+		event.data.fd = wakeupPipe[0];
+		epoll_ctl(pollFD, EPOLL_CTL_ADD, wakeupPipe[0], &event);
+		
+		epoll_event events[EVENTS];
+		
+		#endif
+		
+		while (running) {
+			
+			// wait for sockets that are ready to read or write, or until the next event of a stream is due
+			
+			vector<pair<int32_t, bool> > readyDescriptors;
+			
+			int32_t timeout = EVENT_TIMEOUT;
+			int32_t time = currentTimeMillis();
+			
+			for (map<int32_t, Connection*>::iterator i = connections.begin(); i != connections.end(); i++) {
+				Stream* stream = i->second->stream;
+				if (stream != NULL) timeout = max(0, min(timeout, stream->time-time));
+			}
+			
+			#if defined __QNX__
+			
+			descriptors.clear();
+			
+			pollfd descriptor;
+			descriptor.fd = serverSocket;
+			descriptor.events = POLLIN;
+			descriptor.revents = 0;
+			descriptors.push_back(descriptor);
+			descriptor.fd = wakeupPipe[0];
+			descriptors.push_back(descriptor);
+			
+			for (map<int32_t, Connection*>::iterator i = connections.begin(); i != connections.end(); i++) {
+				if (i->second->closed) continue;
+				descriptor.fd = i->first;
+				descriptor.events = (i->second->received ? 0 : POLLIN) | (i->second->writing ? POLLOUT : 0);
+				descriptors.push_back(descriptor);
+			}
+			
+			int32_t n = poll(&descriptors[0], descriptors.size(), timeout);
+			
+			for (uint32_t i = 0; (n > 0) && (i < descriptors.size()); i++) {
+				if ((descriptors[i].revents & (POLLIN | POLLHUP | POLLERR)) != 0) readyDescriptors.push_back(pair<int32_t, bool>(descriptors[i].fd, false));
+				if ((descriptors[i].revents & POLLOUT) != 0) readyDescriptors.push_back(pair<int32_t, bool>(descriptors[i].fd, true));
+			}
+			
+			#else
+			
+			int32_t n = epoll_wait(pollFD, events, EVENTS, timeout);
+			
+			for (int32_t i = 0; i < n; i++) {
+				int32_t descriptor = events[i].data.fd;
+				if ((events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) != 0) readyDescriptors.push_back(pair<int32_t, bool>(descriptor, false));
+				if ((events[i].events & EPOLLOUT) != 0) readyDescriptors.push_back(pair<int32_t, bool>(descriptor, true));
+			}
 			
-			listen(serverSocket, 5);
+			#endif
 			
-			while (true) {
+			for (uint32_t i = 0; i < readyDescriptors.size(); i++) {
 				
-				sockaddr_in clientAddr;
-				socklen_t clientLength = sizeof(clientAddr);
+				int32_t descriptor = readyDescriptors[i].first;
 				
-				int32_t clientSocket = accept(serverSocket, (sockaddr*)&clientAddr, &clientLength);
-				if (clientSocket != -1) {
+				if (descriptor == serverSocket) {
+					
+					accept();
+					
+				} else if (descriptor == wakeupPipe[0]) {
+					
+					char buffer[64];
+					while (read(wakeupPipe[0], buffer, sizeof(buffer)) > 0);
 					
-					// create client thread to handle request
+					complete();
 					
-					HTTPClientThread* httpClientThread = new HTTPClientThread(this, clientSocket);
-					httpClientThread->start();
-					httpClients.push_back(httpClientThread);
+				} else {
 					
-					// clean up dead client threads
+					map<int32_t, Connection*>::iterator connection = connections.find(descriptor);
 					
-					for (list<HTTPClientThread*>::iterator i = httpClients.begin(); i != httpClients.end();) {
-						HTTPClientThread* httpClientThread = *i;
-						if (httpClientThread->isAlive()) {
-							++i;
-						} else {
-							httpClientThread->join();
-							i = httpClients.erase(i);
-							delete httpClientThread;
-						}
+					if (connection != connections.end()) {
+						if (readyDescriptors[i].second) transmit(connection->second);
+						else receive(connection->second);
 					}
 				}
 			}
+			
+			// publish the events of streams that are due, and close idle connections
+			
+			time = currentTimeMillis();
+			
+			for (map<int32_t, Connection*>::iterator i = connections.begin(); i != connections.end();) {
+				
+				Connection* connection = (i++)->second;
+				
+				if (connection->stream != NULL) {
+					
+					// streams are closed when the client doesn't receive events anymore
+					
+					if (!connection->output.empty() && (time-connection->time > keepAliveTimeout)) close(connection);
+					else if (time-connection->stream->time >= 0) publish(connection);
+					
+				} else if (!connection->busy && (time-connection->time > keepAliveTimeout)) {
+					
+					close(connection);
+				}
+			}
+		}
+		
+		// stop the worker threads and close all connections
+		
+		pthread_mutex_lock(&jobMutex);
+		pthread_cond_broadcast(&jobCondition);
+		pthread_mutex_unlock(&jobMutex);
+		
+		for (vector<Worker*>::iterator worker = workers.begin(); worker != workers.end(); worker++) {
+			(*worker)->join();
+			delete *worker;
 		}
+		workers.clear();
 		
-		sleep(BIND_RETRY_DELAY);
+		for (deque<Job*>::iterator job = pendingJobs.begin(); job != pendingJobs.end(); job++) delete *job;
+		for (deque<Job*>::iterator job = completedJobs.begin(); job != completedJobs.end(); job++) delete *job;
+		pendingJobs.clear();
+		completedJobs.clear();
+		
+		for (map<int32_t, Connection*>::iterator i = connections.begin(); i != connections.end(); i++) {
+			if (i->second->file >= 0) ::close(i->second->file);
+			::close(i->first);
+			delete i->second->stream;
+			delete i->second;
+		}
+		connections.clear();
+		
+		#if !defined __QNX__
+		
+		::close(pollFD);
+		
+		#endif
 	}
 	
-	close(serverSocket);
+	::close(serverSocket);
 }
 
 /**
- * Creates an http client thread.
+ * Accepts all pending connections.
  */
-HTTPClientThread::HTTPClientThread(HTTPServer* httpServer, int32_t clientSocket) : Thread("HTTPServer", HTTPServer::STACK_SIZE) {
+void HTTPServer::accept() {
 	
-	this->httpServer = httpServer;
-	this->clientSocket = clientSocket;
+	while (true) {
+		
+		sockaddr_in clientAddr;
+		socklen_t clientLength = sizeof(clientAddr);
+		
+		int32_t clientSocket = ::accept(serverSocket, (sockaddr*)&clientAddr, &clientLength);
+		if (clientSocket < 0) return;
+		
+		fcntl(clientSocket, F_SETFL, fcntl(clientSocket, F_GETFL) | O_NONBLOCK);
+		
+		int32_t enable = 1;
+		setsockopt(clientSocket, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(int32_t));
+		
+		if (connections.size() >= maxConnections) {
+			
+			// reject the connection without waiting for its request
+			
+			string output = errorResponse("503 Service Unavailable", "The server has too many open connections!", false);
+			if (write(clientSocket, output.c_str(), output.size()) < 0) {}
+			
+			::close(clientSocket);
+			
+		} else {
+			
+			Connection* connection = new Connection();
+			connection->socket = clientSocket;
+			connection->parsed = 0;
+			connection->parser.setMaxSize(maxRequestSize);
+			connection->requests = 0;
+			connection->file = -1;
+			connection->fileOffset = 0;
+			connection->fileSize = 0;
+			connection->stream = NULL;
+			connection->time = currentTimeMillis();
+			connection->busy = false;
+			connection->writing = false;
+			connection->closing = false;
+			connection->received = false;
+			connection->closed = false;
+			
+			connections[clientSocket] = connection;
+			
+			#if !defined __QNX__
+			
+			epoll_event event;
+			memset(&event, 0, sizeof(event));
+			event.events = EPOLLIN;
+			event.data.fd = clientSocket;
+			epoll_ctl(pollFD, EPOLL_CTL_ADD, clientSocket, &event);
+			
+			#endif
+		}
+	}
 }
 
-HTTPClientThread::~HTTPClientThread() {}
-
-void HTTPClientThread::run() {
+/**
+ * Reads all available data of a connection, and processes the complete requests. When the
+ * client shut down its side of the connection, the received requests are still processed,
+ * and the connection is closed when their responses are written.
+ * @param connection the connection to read from.
+ */
+void HTTPServer::receive(Connection* connection) {
 	
-	try {
-		
-		timeval tv;
-		tv.tv_sec = 60;
-		tv.tv_usec = 0;
-		setsockopt(clientSocket, SOL_SOCKET, SO_RCVTIMEO, (void*)&tv, sizeof(tv));
+	char buffer[BUFFER_SIZE];
+	
+	while (true) {
 		
-		char buffer[HTTPServer::BUFFER_SIZE];
-		memset(buffer, 0, HTTPServer::BUFFER_SIZE);
+		ssize_t size = read(connection->socket, buffer, BUFFER_SIZE);
 		
-		ssize_t size = read(clientSocket, buffer, HTTPServer::BUFFER_SIZE);
-		while (size > 0) {
+		if (size > 0) {
 			
-			string input(buffer, size);
-			string header;
-			string output;
+			connection->input.append(buffer, size);
+			connection->time = currentTimeMillis();
 			
-			// check if input is complete
+		} else if ((size < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK))) {
 			
-			if (input.find("\r\n\r\n") == string::npos) {
-				sleep(HTTPServer::READ_RETRY_DELAY);
-				if ((size = read(clientSocket, buffer, HTTPServer::BUFFER_SIZE)) > 0) input += string(buffer, size);
-			}
+			break;
 			
-			// parse input
+		} else if ((size < 0) && (errno == EINTR)) {
 			
-			if ((input.find("GET") == 0) || (input.find("HEAD") == 0)) {
-				
-				if (input.find("cgi-bin") != string::npos) {
-					
-					// process script request with arguments
-					
-					string script = input.substr(input.find("cgi-bin/")+8, input.find(" ", input.find("cgi-bin/")+8)-input.find("cgi-bin/")-8);
-					string name;
-					vector<string> names;
-					vector<string> values;
-					
-					if (script.find("?") != string::npos) {
-						
-						name = script.substr(0, script.find("?"));
-						script = script.substr(script.find("?")+1);
-						
-						vector<string> arguments;
-						while (script.find("&") != string::npos) {
-							arguments.push_back(script.substr(0, script.find("&")));
-							script = script.substr(script.find("&")+1);
-						}
-						arguments.push_back(script);
-						
-						for (uint32_t i = 0; i < arguments.size(); i++) {
-							
-							if (arguments[i].find("=") != string::npos) {
-								
-								names.push_back(arguments[i].substr(0, arguments[i].find("=")));
-								values.push_back(httpServer->urlDecoder(arguments[i].substr(arguments[i].find("=")+1)));
-								
-							} else {
-								
-								names.push_back(arguments[i]);
-								values.push_back("");
-							}
-						}
-						
-					} else {
-						
-						name = script;
-					}
-					
-					// look for corresponding script
-					
-                    for (uint32_t i = 0; i < min(httpServer->httpScriptNames.size(), httpServer->httpScripts.size()); i++) {
-						
-						if (httpServer->httpScriptNames[i].compare(name) == 0) {
-
-							output  = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\r\n";
-                            output += "<!DOCTYPE html>\r\n";
-                            output += "<html xmlns=\"http://www.w3.org/1999/xhtml\" xml:lang=\"en\" lang=\"en\">\r\n";
-                            output += "<body>\r\n";
-                            output += httpServer->httpScripts[i]->call(names, values);
-                            output += "</body>\r\n";
-                            output += "</html>\r\n";
-                            
-                            header  = "HTTP/1.1 200 OK\r\n";
-                            header += "Content-Length: "+type2String(output.size())+"\r\n";
-                            header += "Content-Type: text/xml\r\n";
-                            header += "Expires: 0\r\n";
-                            header += "\r\n";
-                            
-                            output = header+output;
-						}
-					}
-					
-					// requested script was not found on this server
-					
-					if (output.size() == 0) {
-						
-						output += "<!DOCTYPE html>\r\n";
-						output += "<html lang=\"en\">\r\n";
-						output += "<head>\r\n";
-						output += "  <title>400 Bad Request</title>\r\n";
-						output += "  <style type=\"text/css\">\r\n";
-						output += "    h2 {font-family:Helvetica,Arial,sans-serif; font-size: 24; color:#FFFFFF;}\r\n";
-						output += "    p {font-family:Helvetica,Arial,sans-serif; font-size: 14; color:#444444;}\r\n";
-						output += "  </style>\r\n";
-						output += "</head>\r\n";
-						output += "<body leftmargin=\"0\" topmargin=\"0\" marginwidth=\"0\" marginheight=\"0\">\r\n";
-						output += "  <table width=\"100%\" height=\"100%\" border=\"0\" frame=\"void\" cellspacing=\"0\" cellpadding=\"20\">\r\n";
-						output += "    <tr>\r\n";
-						output += "      <td width=\"100%\" height=\"30\" bgcolor=\"#585858\"><h2>400 Bad Request</h2></td>\r\n";
-						output += "    </tr>\r\n";
-						output += "    <tr>\r\n";
-						output += "      <td valign=\"top\" style=\"border-top-width:2px; border-left-width:0px; border-bottom-width:0px; border-right-width:0px; border-style:solid; border-color:#444444;\">\r\n";
-						output += "      <p>The requested script could not be found on this server!</p>\r\n";
-						output += "      </td>\r\n";
-						output += "    </tr>\r\n";
-						output += "  </table>\r\n";
-						output += "</body>\r\n";
-						output += "</html>\r\n";
-						
-						header  = "HTTP/1.1 400 Bad Request\r\n";
-						header += "Content-Length: "+type2String(output.size())+"\r\n";
-						header += "Content-Type: text/html\r\n";
-						header += "\r\n";
-						
-						output = header+output;
-					}
-					
-					ssize_t written = write(clientSocket, output.c_str(), output.size());
-					if (written != static_cast<ssize_t>(output.size())) throw runtime_error("HTTPServer: couldn't write content to socket.");
-                    
-				} else {
-					
-					// look for file to load and transmit
-					
-					string filename = input.substr(input.find("/")+1, input.find(" ", input.find("/"))-input.find("/")-1);
-					if (filename.size() == 0) filename = httpServer->indexPage;
-					filename = httpServer->path+filename;
-					
-					ifstream file;
-					file.open(filename.c_str());
-					if (file) {
-						
-						// requested file exists
-						
-						file.seekg(0, ios::end);
-						int32_t n = file.tellg();
-						
-						output  = "HTTP/1.1 200 OK\r\n";
-						output += "Content-Length: "+type2String(n)+"\r\n";
-						
-						if (filename.find(".html") != string::npos) output += "Content-Type: text/html\r\n";
-						else if (filename.find(".htm") != string::npos) output += "Content-Type: text/html\r\n";
-						else if (filename.find(".text") != string::npos) output += "Content-Type: text/plain\r\n";
-						else if (filename.find(".txt") != string::npos) output += "Content-Type: text/plain\r\n";
-						else if (filename.find(".conf") != string::npos) output += "Content-Type: text/plain\r\n";
-						else if (filename.find(".asc") != string::npos) output += "Content-Type: text/plain\r\n";
-						else if (filename.find(".css") != string::npos) output += "Content-Type: text/css\r\n";
-						else if (filename.find(".class") != string::npos) output += "Content-Type: application/octet-stream\r\n";
-						else if (filename.find(".c") != string::npos) output += "Content-Type: text/plain\r\n";
-						else if (filename.find(".xml") != string::npos) output += "Content-Type: text/xml\r\n";
-						else if (filename.find(".dtd") != string::npos) output += "Content-Type: text/xml\r\n";
-						else if (filename.find(".js") != string::npos) output += "Content-Type: text/javascript\r\n";
-						else if (filename.find(".gif") != string::npos) output += "Content-Type: image/gif\r\n";
-						else if (filename.find(".jpg") != string::npos) output += "Content-Type: image/jpeg\r\n";
-						else if (filename.find(".jpeg") != string::npos) output += "Content-Type: image/jpeg\r\n";
-						else if (filename.find(".png") != string::npos) output += "Content-Type: image/png\r\n";
-						else if (filename.find(".xbm") != string::npos) output += "Content-Type: image/x-xbitmap\r\n";
-						else if (filename.find(".xpm") != string::npos) output += "Content-Type: image/x-xpixmap\r\n";
-						else if (filename.find(".xwd") != string::npos) output += "Content-Type: image/x-xwindowdump\r\n";
-						else if (filename.find(".manifest") != string::npos) output += "Content-Type: text/cache-manifest\r\n";
-						else if (filename.find(".jar") != string::npos) output += "Content-Type: application/x-java-applet\r\n";
-						else if (filename.find(".pdf") != string::npos) output += "Content-Type: application/pdf\r\n";
-						else if (filename.find(".sig") != string::npos) output += "Content-Type: application/pgp-signature\r\n";
-						else if (filename.find(".spl") != string::npos) output += "Content-Type: application/futuresplash\r\n";
-						else if (filename.find(".ps") != string::npos) output += "Content-Type: application/postscript\r\n";
-						else if (filename.find(".torrent") != string::npos) output += "Content-Type: application/x-bittorrent\r\n";
-						else if (filename.find(".dvi") != string::npos) output += "Content-Type: application/x-dvi\r\n";
-						else if (filename.find(".pac") != string::npos) output += "Content-Type: application/x-ns-proxy-autoconfig\r\n";
-						else if (filename.find(".swf") != string::npos) output += "Content-Type: application/x-shockwave-flash\r\n";
-						else if (filename.find(".tar.gz") != string::npos) output += "Content-Type: application/x-tgz\r\n";
-						else if (filename.find(".tar.bz2") != string::npos) output += "Content-Type: application/x-bzip-compressed-tar\r\n";
-						else if (filename.find(".gz") != string::npos) output += "Content-Type: application/x-gzip\r\n";
-						else if (filename.find(".tgz") != string::npos) output += "Content-Type: application/x-tgz\r\n";
-						else if (filename.find(".tar") != string::npos) output += "Content-Type: application/x-tar\r\n";
-						else if (filename.find(".bz2") != string::npos) output += "Content-Type: application/x-bzip\r\n";
-						else if (filename.find(".tbz") != string::npos) output += "Content-Type: application/x-bzip-compressed-tar\r\n";
-						else if (filename.find(".zip") != string::npos) output += "Content-Type: application/zip\r\n";
-						else if (filename.find(".mp3") != string::npos) output += "Content-Type: audio/mpeg\r\n";
-						else if (filename.find(".m3u") != string::npos) output += "Content-Type: audio/x-mpegurl\r\n";
-						else if (filename.find(".wma") != string::npos) output += "Content-Type: audio/x-ms-wma\r\n";
-						else if (filename.find(".wax") != string::npos) output += "Content-Type: audio/x-ms-wax\r\n";
-						else if (filename.find(".wav") != string::npos) output += "Content-Type: audio/x-wav\r\n";
-						else if (filename.find(".ogg") != string::npos) output += "Content-Type: audio/x-wav\r\n";
-						else if (filename.find(".mpeg") != string::npos) output += "Content-Type: video/mpeg\r\n";
-						else if (filename.find(".mpg") != string::npos) output += "Content-Type: video/mpeg\r\n";
-						else if (filename.find(".mp4") != string::npos) output += "Content-Type: video/mp4\r\n";
-						else if (filename.find(".mov") != string::npos) output += "Content-Type: video/quicktime\r\n";
-						else if (filename.find(".qt") != string::npos) output += "Content-Type: video/quicktime\r\n";
-						else if (filename.find(".ogv") != string::npos) output += "Content-Type: video/ogg\r\n";
-						else if (filename.find(".avi") != string::npos) output += "Content-Type: video/x-msvideo\r\n";
-						else if (filename.find(".asf") != string::npos) output += "Content-Type: video/x-ms-asf\r\n";
-						else if (filename.find(".asx") != string::npos) output += "Content-Type: video/x-ms-asf\r\n";
-						else if (filename.find(".wmv") != string::npos) output += "Content-Type: video/x-ms-wmv\r\n";
-						else if (filename.find(".webm") != string::npos) output += "Content-Type: video/webm\r\n";
-						
-						output += "\r\n";
-						
-						ssize_t written = write(clientSocket, output.c_str(), output.size());
-						if (written != static_cast<ssize_t>(output.size())) throw runtime_error("HTTPServer: couldn't write content to socket.");
-						
-						if (input.find("GET") == 0) {
-							
-							// transmit file
-							
-							file.seekg(0, ios::beg);
-							if (file) {
-								char fileBuffer[1024];
-								for (int32_t i = 0; i < n/1024; i++) {
-									file.read(fileBuffer, 1024);
-									written = write(clientSocket, fileBuffer, 1024);
-									if (written != 1024) throw runtime_error("couldn't write content to socket.");
-								}
-								file.read(fileBuffer, n%1024);
-								written = write(clientSocket, fileBuffer, n%1024);
-								if (written != n%1024) throw runtime_error("couldn't write content to socket.");
-							}
-						}
-						
-						file.close();
-						
-					} else {
-						
-						// file not found
-						
-						output += "<!DOCTYPE html>\r\n";
-						output += "<html lang=\"en\">\r\n";
-						output += "<head>\r\n";
-						output += "  <title>404 Not Found</title>\r\n";
-						output += "  <style type=\"text/css\">\r\n";
-						output += "    h2 {font-family:Helvetica,Arial,sans-serif; font-size: 24; color:#FFFFFF;}\r\n";
-						output += "    p {font-family:Helvetica,Arial,sans-serif; font-size: 14; color:#444444;}\r\n";
-						output += "  </style>\r\n";
-						output += "</head>\r\n";
-						output += "<body leftmargin=\"0\" topmargin=\"0\" marginwidth=\"0\" marginheight=\"0\">\r\n";
-						output += "  <table width=\"100%\" height=\"100%\" border=\"0\" frame=\"void\" cellspacing=\"0\" cellpadding=\"20\">\r\n";
-						output += "    <tr>\r\n";
-						output += "      <td width=\"100%\" height=\"30\" bgcolor=\"#585858\"><h2>404 Not Found</h2></td>\r\n";
-						output += "    </tr>\r\n";
-						output += "    <tr>\r\n";
-						output += "      <td valign=\"top\" style=\"border-top-width:2px; border-left-width:0px; border-bottom-width:0px; border-right-width:0px; border-style:solid; border-color:#444444;\">\r\n";
-						output += "      <p>The requested file could not be found on this server!</p>\r\n";
-						output += "      </td>\r\n";
-						output += "    </tr>\r\n";
-						output += "  </table>\r\n";
-						output += "</body>\r\n";
-						output += "</html>\r\n";
-						
-						header  = "HTTP/1.1 404 Not Found\r\n";
-						header += "Content-Length: "+type2String(output.size())+"\r\n";
-						header += "Content-Type: text/html\r\n";
-						header += "\r\n";
-						
-						output = header+output;
-						
-						ssize_t written = write(clientSocket, output.c_str(), output.size());
-						if (written != static_cast<ssize_t>(output.size())) throw runtime_error("HTTPServer: couldn't write content to socket.");
-					}
-				}
-				
-			} else if (input.find("POST") == 0) {
-				
-                string filename = input.substr(input.find("/")+1, input.find(" ", input.find("/"))-input.find("/")-1);
-                if (filename.size() > 0) {
-                    
-                    filename = httpServer->path+filename;
-                    
-                    size_t pos = string::npos;
-                    if ((pos = input.find("\r\n\r\n")) != string::npos) {
-                        
-                        if (pos < input.size()-4) {
-                            
-                            input = input.substr(pos+4);
-                            if ((pos = input.find("=")) != string::npos) {
-                                if (pos < input.size()-1) input = input.substr(pos+1);
-                            }
-                            
-                            // posted content is saved to a file
-                            
-                            ofstream posting;
-                            posting.open(filename.c_str());
-                            posting << httpServer->urlDecoder(input);
-                            posting.close();
-                            
-                            output  = "HTTP/1.1 201 Created\r\n";
-                            output += "Content-Length: 0\r\n";
-                            output += "\r\n";
-                            
-                        } else {
-                            
-                            // posted content cannot be saved to a file
-                            
-                            output  = "HTTP/1.1 403 Forbidden\r\n";
-                            output += "Content-Length: 0\r\n";
-                            output += "\r\n";
-                        }
-                        
-                    } else {
-                        
-                        // posted content cannot be saved to a file
-                        
-                        output  = "HTTP/1.1 403 Forbidden\r\n";
-                        output += "Content-Length: 0\r\n";
-                        output += "\r\n";
-                    }
-                    
-                    ssize_t written = write(clientSocket, output.c_str(), output.size());
-                    if (written != static_cast<ssize_t>(output.size())) throw runtime_error("HTTPServer: couldn't write content to socket.");
-                    
-                } else {
-                    
-                    // posted content cannot be saved to a file
-                    
-                    output  = "HTTP/1.1 403 Forbidden\r\n";
-                    output += "Content-Length: 0\r\n";
-                    output += "\r\n";
-                    
-                    ssize_t written = write(clientSocket, output.c_str(), output.size());
-                    if (written != static_cast<ssize_t>(output.size())) throw runtime_error("HTTPServer: couldn't write content to socket.");
-                }
-                
-			} else {
-				
-				// the http method is not known
-				
-				output += "<!DOCTYPE html>\r\n";
-				output += "<html lang=\"en\">\r\n";
-				output += "<head>\r\n";
-				output += "  <title>400 Bad Request</title>\r\n";
-				output += "  <style type=\"text/css\">\r\n";
-				output += "    h2 {font-family:Helvetica,Arial,sans-serif; font-size: 24; color:#FFFFFF;}\r\n";
-				output += "    p {font-family:Helvetica,Arial,sans-serif; font-size: 14; color:#444444;}\r\n";
-				output += "  </style>\r\n";
-				output += "</head>\r\n";
-				output += "<body leftmargin=\"0\" topmargin=\"0\" marginwidth=\"0\" marginheight=\"0\">\r\n";
-				output += "  <table width=\"100%\" height=\"100%\" border=\"0\" frame=\"void\" cellspacing=\"0\" cellpadding=\"20\">\r\n";
-				output += "    <tr>\r\n";
-				output += "      <td width=\"100%\" height=\"30\" bgcolor=\"#585858\"><h2>400 Bad Request</h2></td>\r\n";
-				output += "    </tr>\r\n";
-				output += "    <tr>\r\n";
-				output += "      <td valign=\"top\" style=\"border-top-width:2px; border-left-width:0px; border-bottom-width:0px; border-right-width:0px; border-style:solid; border-color:#444444;\">\r\n";
-				output += "      <p>The requested method is not supported by this server!</p>\r\n";
-				output += "      </td>\r\n";
-				output += "    </tr>\r\n";
-				output += "  </table>\r\n";
-				output += "</body>\r\n";
-				output += "</html>\r\n";
-				
-				header  = "HTTP/1.1 400 Bad Request\r\n";
-				header += "Content-Length: "+type2String(output.size())+"\r\n";
-				header += "Content-Type: text/html\r\n";
-				header += "\r\n";
-				
-				output = header+output;
-				
-				ssize_t written = write(clientSocket, output.c_str(), output.size());
-				if (written != static_cast<ssize_t>(output.size())) throw runtime_error("HTTPServer: couldn't write content to socket.");
-			}
+			continue;
+			
+		} else if ((size == 0) && !connection->received && (connection->stream == NULL)) {
+			
+			// the client won't send further requests, but may still wait for the responses
 			
-			memset(buffer, 0, HTTPServer::BUFFER_SIZE);
-			size = read(clientSocket, buffer, HTTPServer::BUFFER_SIZE);
+			connection->received = true;
+			watch(connection, connection->writing);
+			break;
+			
+		} else {
+			
+			// the client closed the connection, or an error occurred, or the end of file
+			// is reported again, because the client closed both directions of the connection
+			
+			connection->closed = true;
+			break;
 		}
-		
-	} catch (exception& e) {
-		cerr << e.what() << endl;
 	}
 	
-	try {
+	if (connection->closed) {
 		
-		shutdown(clientSocket, SHUT_RDWR);
-		close(clientSocket);
+		if (connection->busy) {
+			
+			// the connection is deleted when the worker thread has completed its job
+			
+			#if !defined __QNX__
+			
+			epoll_ctl(pollFD, EPOLL_CTL_DEL, connection->socket, NULL);
+			
+			#endif
+			
+		} else {
+			
+			close(connection);
+		}
 		
-	} catch (exception& e) {
-		cerr << e.what() << endl;
-	}
+	} else {
+		
+		// input of a connection with a stream is ignored
+		
+		if (connection->stream != NULL) connection->input.clear();
+		
+		process(connection);
+		transmit(connection);
+	}
+}
+
+/**
+ * Writes the pending output of a connection, as far as the socket accepts it.
+ * @param connection the connection to write to.
+ */
+void HTTPServer::transmit(Connection* connection) {
+	
+	size_t written = 0;
+	
+	while (written < connection->output.size()) {
+		
+		ssize_t size = write(connection->socket, connection->output.data()+written, connection->output.size()-written);
+		
+		if (size > 0) {
+			
+			written += size;
+			
+		} else if ((size < 0) && (errno == EINTR)) {
+			
+			continue;
+			
+		} else if ((size < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK))) {
+			
+			break;
+			
+		} else {
+			
+			if (connection->busy) {
+				connection->closed = true;
+				connection->output.clear();
+			} else {
+				close(connection);
+			}
+			
+			return;
+		}
+	}
+	
+	if (written > 0) {
+		connection->output.erase(0, written);
+		connection->time = currentTimeMillis();
+	}
+	
+	// write the content of a file that follows the output
+	
+	while (connection->output.empty() && (connection->file >= 0)) {
+		
+		#if defined __QNX__
+		
+		char buffer[BUFFER_SIZE];
+		ssize_t size = pread(connection->file, buffer, min(static_cast<off_t>(BUFFER_SIZE), connection->fileSize-connection->fileOffset), connection->fileOffset);
+		if (size > 0) size = write(connection->socket, buffer, size);
+		
+		#else
+		
+		ssize_t size = sendfile(connection->socket, connection->file, NULL, connection->fileSize-connection->fileOffset);
+		
+		#endif
+		
+		if (size > 0) {
+			
+			connection->fileOffset += size;
+			connection->time = currentTimeMillis();
+			
+			if (connection->fileOffset >= connection->fileSize) {
+				::close(connection->file);
+				connection->file = -1;
+			}
+			
+		} else if ((size < 0) && (errno == EINTR)) {
+			
+			continue;
+			
+		} else if ((size < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK))) {
+			
+			break;
+			
+		} else {
+			
+			close(connection);
+			
+			return;
+		}
+	}
+	
+	if (connection->output.empty() && (connection->file < 0)) {
+		
+		if (connection->closing && !connection->busy) {
+			close(connection);
+			return;
+		}
+		
+		if (connection->writing) watch(connection, false);
+		
+		// continue with requests that were held back by pending output
+		
+		if ((!connection->input.empty() || connection->received) && !connection->busy && !connection->closing) {
+			process(connection);
+			if (!connection->output.empty() || connection->closing) transmit(connection);
+		}
+		
+	} else {
+		
+		if (!connection->writing) watch(connection, true);
+	}
+}
+
+/**
+ * Processes the complete requests of a connection in the order they were received. Static
+ * files are processed immediately, while script calls are handed over to the worker threads.
+ * Further requests of this connection are processed when the response of a script is complete.
+ * @param connection the connection with received requests.
+ */
+void HTTPServer::process(Connection* connection) {
+	
+	while (!connection->busy && !connection->closing && (connection->file < 0) && (connection->stream == NULL) && (connection->output.size() < OUTPUT_LIMIT)) {
+		
+		// parse the received data, which is examined only once
+		
+		HTTPParser& parser = connection->parser;
+		
+		connection->parsed += parser.parse(connection->input.data()+connection->parsed, connection->input.size()-connection->parsed);
+		
+		if (connection->parsed >= connection->input.size()) {
+			connection->input.clear();
+			connection->parsed = 0;
+		} else if (connection->parsed >= BUFFER_SIZE) {
+			connection->input.erase(0, connection->parsed);
+			connection->parsed = 0;
+		}
+		
+		HTTPParser::Status status = parser.getStatus();
+		
+		if (status == HTTPParser::INCOMPLETE) {
+			
+			// all received requests were processed, if the client won't send further requests
+			
+			if (connection->received) connection->closing = true;
+			
+			return;
+			
+		} else if (status != HTTPParser::COMPLETE) {
+			
+			// the request is invalid, and the connection can't be used for further requests
+			
+			if (status == HTTPParser::TOO_LARGE) connection->output += errorResponse("413 Payload Too Large", "The request is too large for this server!", false);
+			else if (status == HTTPParser::NOT_IMPLEMENTED) connection->output += errorResponse("501 Not Implemented", "The transfer coding of the request is not supported by this server!", false);
+			else connection->output += errorResponse("400 Bad Request", "The request could not be parsed by this server!", false);
+			
+			connection->closing = true;
+			
+			return;
+		}
+		
+		const string& method = parser.getMethod();
+		string path = parser.getPath();
+		bool keepAlive = parser.isKeepAlive();
+		
+		if (++connection->requests >= maxRequestsPerConnection) keepAlive = false;
+		if (!keepAlive) connection->closing = true;
+		
+		// process the request
+		
+		if ((method.compare("GET") == 0) || (method.compare("HEAD") == 0)) {
+			
+			bool head = (method.compare("HEAD") == 0);
+			
+			if (path.find("cgi-bin/") != string::npos) {
+				
+				Job* job = call(connection, path, head, keepAlive);
+				
+				if (job != NULL) {
+					
+					pthread_mutex_lock(&jobMutex);
+					
+					if (pendingJobs.size() < maxPendingRequests) {
+						
+						pendingJobs.push_back(job);
+						connection->busy = true;
+						pthread_cond_signal(&jobCondition);
+						
+					} else {
+						
+						delete job;
+						connection->output += errorResponse("503 Service Unavailable", "The server has too many pending requests!", keepAlive);
+					}
+					
+					pthread_mutex_unlock(&jobMutex);
+					
+				} else {
+					
+					connection->output += errorResponse("400 Bad Request", "The requested script could not be found on this server!", keepAlive);
+				}
+				
+			} else if (path.find("/events/") == 0) {
+				
+				subscribe(connection, path, head, keepAlive);
+				
+			} else {
+				
+				getFile(connection, path, parser.getField("if-none-match"), parser.getField("if-modified-since"), head, keepAlive);
+			}
+			
+		} else if (method.compare("POST") == 0) {
+			
+			connection->output += postFile(path, parser.getContent(), keepAlive);
+			
+		} else {
+			
+			// the http method is not known
+			
+			connection->output += errorResponse("400 Bad Request", "The requested method is not supported by this server!", keepAlive);
+		}
+		
+		parser.reset();
+	}
+}
+
+/**
+ * Collects the responses of script calls that were completed by the worker threads,
+ * and continues to process the requests of their connections.
+ */
+void HTTPServer::complete() {
+	
+	pthread_mutex_lock(&jobMutex);
+	deque<Job*> jobs;
+	jobs.swap(completedJobs);
+	pthread_mutex_unlock(&jobMutex);
+	
+	for (deque<Job*>::iterator job = jobs.begin(); job != jobs.end(); job++) {
+		
+		Connection* connection = (*job)->connection;
+		connection->busy = false;
+		
+		if (connection->closed) {
+			
+			close(connection);
+			
+		} else {
+			
+			connection->output += (*job)->response;
+			connection->time = currentTimeMillis();
+			
+			process(connection);
+			transmit(connection);
+		}
+		
+		delete *job;
+	}
+}
+
+/**
+ * Subscribes a connection to the signals of a telemetry object. The names of the signals and
+ * the rate of the samples are given as arguments of the request target, i.e.
+ * '/events/robot?signals=x,y&rate=100'. The response is a stream of Server-Sent Events,
+ * which ends when the client closes the connection.
+ * @param connection the connection that received the request.
+ * @param path the path of the request target, i.e. '/events/robot'.
+ * @param head a flag indicating a HEAD request, which is answered without a stream.
+ * @param keepAlive a flag indicating that the connection is kept alive.
+ */
+void HTTPServer::subscribe(Connection* connection, string path, bool head, bool keepAlive) {
+	
+	string name = path.substr(8);
+	
+	// look for corresponding telemetry object
+	
+	Telemetry* telemetry = NULL;
+	
+	for (uint32_t i = 0; i < min(telemetryNames.size(), telemetries.size()); i++) {
+		if (telemetryNames[i].compare(name) == 0) telemetry = telemetries[i];
+	}
+	
+	if (telemetry == NULL) {
+		connection->output += errorResponse("404 Not Found", "The requested telemetry could not be found on this server!", keepAlive);
+		return;
+	}
+	
+	// parse the names of the signals and the rate of the samples
+	
+	vector<uint32_t> signals;
+	double rate = 0.0;
+	
+	vector<string> names;
+	vector<string> values;
+	
+	connection->parser.getArguments(names, values);
+	
+	for (uint32_t i = 0; i < names.size(); i++) {
+		
+		if (names[i].compare("signals") == 0) {
+			
+			string value = values[i];
+			
+			while (value.size() > 0) {
+				
+				string signalName = value.substr(0, value.find(","));
+				value = (value.find(",") != string::npos) ? value.substr(value.find(",")+1) : "";
+				
+				int32_t signal = telemetry->getSignal(signalName);
+				
+				if (signal < 0) {
+					connection->output += errorResponse("404 Not Found", "The requested signal '"+signalName+"' could not be found on this server!", keepAlive);
+					return;
+				}
+				
+				signals.push_back(static_cast<uint32_t>(signal));
+			}
+			
+		} else if (names[i].compare("rate") == 0) {
+			
+			rate = atof(values[i].c_str());
+		}
+	}
+	
+	if (signals.empty()) {
+		for (uint32_t i = 0; i < telemetry->getNumberOfSignals(); i++) signals.push_back(i);
+	}
+	
+	string header = "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\n\r\n";
+	
+	if (head) {
+		connection->output += header;
+		return;
+	}
+	
+	// the stream ends when the client closes the connection
+	
+	Stream* stream = new Stream();
+	stream->telemetry = telemetry;
+	stream->signals = signals;
+	stream->sample = telemetry->getNumberOfSamples();
+	stream->samplePeriod = (rate > 0.0) ? static_cast<int64_t>(1.0e9/rate) : 0;
+	stream->sampleTime = 0;
+	stream->period = ((rate > 0.0) && (1000.0/rate > STREAM_PERIOD)) ? static_cast<int32_t>(min(1000.0/rate, static_cast<double>(EVENT_TIMEOUT))) : STREAM_PERIOD;
+	stream->time = currentTimeMillis()+stream->period;
+	
+	connection->stream = stream;
+	connection->closing = false;
+	
+	connection->output += header;
+	connection->output += "event: signals\ndata: ";
+	for (uint32_t i = 0; i < signals.size(); i++) connection->output += ((i > 0) ? "," : "")+telemetry->getName(signals[i]);
+	connection->output += "\n\n";
+}
+
+/**
+ * Transmits an event with the samples of the signals of a stream that were recorded since the
+ * previous event. Samples are skipped to match the rate the client requested. No event is
+ * transmitted while the client doesn't receive the previous events.
+ * @param connection a connection with a stream.
+ */
+void HTTPServer::publish(Connection* connection) {
+	
+	Stream* stream = connection->stream;
+	
+	int32_t time = currentTimeMillis();
+	
+	stream->time += stream->period;
+	if (stream->time-time < 0) stream->time = time+stream->period;
+	
+	if (connection->output.size() >= OUTPUT_LIMIT) return;
+	
+	// the buffers of the stream are reused for every event, so that they keep their capacity
+	
+	vector<int64_t>& times = stream->times;
+	vector<double>& values = stream->values;
+	string& event = stream->event;
+	
+	times.clear();
+	values.clear();
+	event.clear();
+	
+	uint32_t numberOfSignals = stream->telemetry->getNumberOfSignals();
+	uint32_t n = stream->telemetry->read(stream->sample, times, values);
+	
+	char buffer[32];
+	
+	for (uint32_t i = 0; i < n; i++) {
+		
+		if (times[i] < stream->sampleTime) continue;
+		
+		stream->sampleTime += stream->samplePeriod;
+		if (stream->sampleTime <= times[i]) stream->sampleTime = times[i]+stream->samplePeriod;
+		
+		snprintf(buffer, sizeof(buffer), "data: %.6f", static_cast<double>(times[i])/1.0e9);
+		event += buffer;
+		
+		for (uint32_t j = 0; j < stream->signals.size(); j++) {
+			snprintf(buffer, sizeof(buffer), ",%.9g", values[i*numberOfSignals+stream->signals[j]]);
+			event += buffer;
+		}
+		
+		event += "\n";
+	}
+	
+	if (event.size() > 0) {
+		event += "\n";
+		connection->output += event;
+		transmit(connection);
+	}
+}
+
+/**
+ * Closes a connection and deletes its state.
+ * @param connection the connection to close.
+ */
+void HTTPServer::close(Connection* connection) {
+	
+	#if !defined __QNX__
+	
+	epoll_ctl(pollFD, EPOLL_CTL_DEL, connection->socket, NULL);
+	
+	#endif
+	
+	if (connection->file >= 0) ::close(connection->file);
+	delete connection->stream;
+	
+	shutdown(connection->socket, SHUT_RDWR);
+	::close(connection->socket);
+	
+	connections.erase(connection->socket);
+	delete connection;
+}
+
+/**
+ * Sets the events the event loop waits for on the socket of a connection.
+ * @param connection the connection to watch.
+ * @param writing <code>true</code> to wait until the socket accepts more output,
+ * <code>false</code> to wait for input only. No input is waited for when the client
+ * won't send further requests.
+ */
+void HTTPServer::watch(Connection* connection, bool writing) {
+	
+	connection->writing = writing;
+	
+	#if !defined __QNX__
+	
+	epoll_event event;
+	memset(&event, 0, sizeof(event));
+	event.events = (connection->received ? 0 : EPOLLIN) | (writing ? EPOLLOUT : 0);
+	event.data.fd = connection->socket;
+	epoll_ctl(pollFD, EPOLL_CTL_MOD, connection->socket, &event);
+	
+	#endif
+}
+
+/**
+ * Creates a job to call the script of a given request. The arguments of the
+ * script are taken from the query of the request target.
+ * @param connection the connection that received the request.
+ * @param path the path of the request target, i.e. '/cgi-bin/myScript'.
+ * @param head a flag indicating a HEAD request.
+ * @param keepAlive a flag indicating that the connection is kept alive.
+ * @return a job for a worker thread, or <code>NULL</code> if no script with this name is registered.
+ */
+HTTPServer::Job* HTTPServer::call(Connection* connection, string path, bool head, bool keepAlive) {
+	
+	string name = path.substr(path.find("cgi-bin/")+8);
+	
+	// look for corresponding script
+	
+	for (uint32_t i = 0; i < min(httpScriptNames.size(), httpScripts.size()); i++) {
+		
+		if (httpScriptNames[i].compare(name) == 0) {
+			
+			Job* job = new Job();
+			job->connection = connection;
+			job->httpScript = httpScripts[i];
+			job->head = head;
+			job->keepAlive = keepAlive;
+			job->gzip = (connection->parser.getField("accept-encoding").find("gzip") != string::npos);
+			
+			connection->parser.getArguments(job->names, job->values);
+			
+			return job;
+		}
+	}
+	
+	return NULL;
+}
+
+/**
+ * Processes a request for a file. The response headers of files are prepared only once,
+ * and small files are kept in a cache together with their header. Cached files are
+ * revalidated with the modification time of the file for every request. Larger files are
+ * transmitted with <code>sendfile()</code> directly from the file system. A response with
+ * the status '304 Not Modified' is returned if the client already has the current version
+ * of the file.
+ * @param connection the connection that received the request.
+ * @param path the path of the request target, i.e. '/index.html'.
+ * @param ifNoneMatch the value of the 'If-None-Match' header field, or an empty string.
+ * @param ifModifiedSince the value of the 'If-Modified-Since' header field, or an empty string.
+ * @param head a flag indicating a HEAD request, which is answered without content.
+ * @param keepAlive a flag indicating that the connection is kept alive.
+ */
+void HTTPServer::getFile(Connection* connection, string path, string ifNoneMatch, string ifModifiedSince, bool head, bool keepAlive) {
+	
+	// look for file to load and transmit
+	
+	if (!isValidPath(path)) {
+		connection->output += errorResponse("403 Forbidden", "The requested path is not allowed on this server!", keepAlive);
+		return;
+	}
+	
+	string filename = path.substr(path.find("/")+1);
+	if (filename.size() == 0) filename = indexPage;
+	filename = this->path+filename;
+	
+	struct stat status;
+	
+	if ((stat(filename.c_str(), &status) != 0) || !S_ISREG(status.st_mode)) {
+		
+		// file not found
+		
+		connection->output += errorResponse("404 Not Found", "The requested file could not be found on this server!", keepAlive);
+		
+		return;
+	}
+	
+	// look for the cached header of this file, and check if it is still valid
+	
+	CachedFile* cachedFile = NULL;
+	
+	unordered_map<string, CachedFile*>::iterator i = cachedFiles.find(filename);
+	if (i != cachedFiles.end()) {
+		if ((i->second->modificationTime == status.st_mtime) && (i->second->size == status.st_size)) {
+			cachedFile = i->second;
+		} else {
+			cacheSize -= i->second->content.size();
+			delete i->second;
+			cachedFiles.erase(i);
+		}
+	}
+	
+	if (cachedFile == NULL) {
+		
+		cachedFile = new CachedFile();
+		cachedFile->modificationTime = status.st_mtime;
+		cachedFile->size = status.st_size;
+		cachedFile->cached = false;
+		
+		char buffer[64];
+		
+		snprintf(buffer, sizeof(buffer), "\"%llx-%llx\"", static_cast<unsigned long long>(status.st_size), static_cast<unsigned long long>(status.st_mtime));
+		cachedFile->entityTag = buffer;
+		
+		tm time;
+		gmtime_r(&status.st_mtime, &time);
+		strftime(buffer, sizeof(buffer), "%a, %d %b %Y %H:%M:%S GMT", &time);
+		cachedFile->lastModified = buffer;
+		
+		cachedFile->header = "HTTP/1.1 200 OK\r\n";
+		cachedFile->header += "Content-Length: "+type2String(status.st_size)+"\r\n";
+		cachedFile->header += getContentType(filename);
+		cachedFile->header += "ETag: "+cachedFile->entityTag+"\r\n";
+		cachedFile->header += "Last-Modified: "+cachedFile->lastModified+"\r\n";
+		
+		// load the content of small files, as long as the cache isn't full
+		
+		if ((status.st_size <= static_cast<off_t>(CACHED_FILE_SIZE)) && (cacheSize+status.st_size <= CACHE_SIZE)) {
+			
+			ifstream file;
+			file.open(filename.c_str(), ios::in | ios::binary);
+			
+			cachedFile->content.resize(status.st_size);
+			if (status.st_size > 0) file.read(&cachedFile->content[0], status.st_size);
+			
+			if (file) {
+				cachedFile->cached = true;
+				cacheSize += cachedFile->content.size();
+			} else {
+				cachedFile->content.clear();
+			}
+		}
+		
+		cachedFiles[filename] = cachedFile;
+	}
+	
+	string connectionField = keepAlive ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+	
+	// check if the client already has the current version of this file
+	
+	bool notModified = false;
+	
+	if (ifNoneMatch.size() > 0) notModified = (ifNoneMatch.compare("*") == 0) || (ifNoneMatch.find(cachedFile->entityTag) != string::npos);
+	else if (ifModifiedSince.size() > 0) notModified = (ifModifiedSince.compare(cachedFile->lastModified) == 0);
+	
+	if (notModified) {
+		
+		connection->output += "HTTP/1.1 304 Not Modified\r\nETag: "+cachedFile->entityTag+"\r\nLast-Modified: "+cachedFile->lastModified+"\r\n"+connectionField+"\r\n";
+		
+	} else if (head || cachedFile->cached) {
+		
+		connection->output += cachedFile->header+connectionField+"\r\n";
+		if (!head) connection->output += cachedFile->content;
+		
+	} else {
+		
+		// the content of this file is transmitted after the header
+		
+		int32_t file = open(filename.c_str(), O_RDONLY);
+		
+		if (file < 0) {
+			
+			connection->output += errorResponse("404 Not Found", "The requested file could not be found on this server!", keepAlive);
+			
+		} else {
+			
+			connection->output += cachedFile->header+connectionField+"\r\n";
+			
+			if (status.st_size > 0) {
+				connection->file = file;
+				connection->fileOffset = 0;
+				connection->fileSize = status.st_size;
+			} else {
+				::close(file);
+			}
+		}
+	}
+}
+
+/**
+ * Saves the content of a POST request to a file.
+ * @param path the path of the request target, i.e. '/data.txt'.
+ * @param content the content of the request.
+ * @param keepAlive a flag indicating that the connection is kept alive.
+ * @return a response with header and content.
+ */
+string HTTPServer::postFile(string path, string content, bool keepAlive) {
+	
+	string filename = path.substr(path.find("/")+1);
+	string connection = keepAlive ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+	
+	if ((filename.size() > 0) && (content.size() > 0) && isValidPath(path)) {
+		
+		filename = this->path+filename;
+		
+		// the cached copy of this file isn't valid anymore
+		
+		unordered_map<string, CachedFile*>::iterator cachedFile = cachedFiles.find(filename);
+		if (cachedFile != cachedFiles.end()) {
+			cacheSize -= cachedFile->second->content.size();
+			delete cachedFile->second;
+			cachedFiles.erase(cachedFile);
+		}
+		
+		size_t pos = string::npos;
+		if ((pos = content.find("=")) != string::npos) {
+			if (pos < content.size()-1) content = content.substr(pos+1);
+		}
+		
+		// posted content is saved to a file
+		
+		ofstream posting;
+		posting.open(filename.c_str());
+		posting << HTTPParser::decode(content, true);
+		posting.close();
+		
+		return "HTTP/1.1 201 Created\r\nContent-Length: 0\r\n"+connection+"\r\n";
+		
+	} else {
+		
+		// posted content cannot be saved to a file
+		
+		return "HTTP/1.1 403 Forbidden\r\nContent-Length: 0\r\n"+connection+"\r\n";
+	}
+}
+
+/**
+ * Checks if the decoded path of a request target stays within the directory of this server.
+ * Paths with '..' segments, which may result from percent-encoded characters, and paths
+ * with null characters, which would truncate the filename, are rejected.
+ * @param path the decoded path of the request target, i.e. '/index.html'.
+ * @return <code>true</code> if the path is valid, <code>false</code> otherwise.
+ */
+bool HTTPServer::isValidPath(const string& path) {
+	
+	if (path.find('\0') != string::npos) return false;
+	
+	size_t begin = 0;
+	
+	while (begin <= path.size()) {
+		
+		size_t end = path.find('/', begin);
+		if (end == string::npos) end = path.size();
+		
+		if (path.compare(begin, end-begin, "..") == 0) return false;
+		
+		begin = end+1;
+	}
+	
+	return true;
+}
+
+/**
+ * Gets the header field with the content type of a given file. The content type is
+ * looked up with the extension of the filename, i.e. 'html' or 'tar.gz'.
+ * @param filename the name of the file.
+ * @return a header field, or an empty string if the type of the file is not known.
+ */
+string HTTPServer::getContentType(string filename) {
+	
+	size_t slash = filename.rfind("/");
+	size_t dot = filename.rfind(".");
+	
+	if ((dot == string::npos) || ((slash != string::npos) && (dot < slash))) return "";
+	
+	for (size_t i = dot; i < filename.size(); i++) filename[i] = tolower(filename[i]);
+	
+	// look for extensions with two parts first
+	
+	size_t previousDot = (dot > 0) ? filename.rfind(".", dot-1) : string::npos;
+	
+	if ((previousDot != string::npos) && ((slash == string::npos) || (previousDot > slash))) {
+		
+		for (size_t i = previousDot; i < dot; i++) filename[i] = tolower(filename[i]);
+		
+		unordered_map<string, string>::const_iterator contentType = contentTypes.find(filename.substr(previousDot+1));
+		if (contentType != contentTypes.end()) return "Content-Type: "+contentType->second+"\r\n";
+	}
+	
+	unordered_map<string, string>::const_iterator contentType = contentTypes.find(filename.substr(dot+1));
+	if (contentType != contentTypes.end()) return "Content-Type: "+contentType->second+"\r\n";
+	
+	return "";
+}
+
+/**
+ * Creates a response with a given status and content.
+ * @param status the status of the response, i.e. '200 OK'.
+ * @param contentType the type of the content, i.e. 'text/xml'.
+ * @param contentEncoding the encoding of the content, i.e. 'gzip', or an empty string.
+ * @param content the content of the response.
+ * @param head a flag indicating a HEAD request, which is answered without content.
+ * @param keepAlive a flag indicating that the connection is kept alive.
+ * @return a response with header and content.
+ */
+string HTTPServer::response(string status, string contentType, string contentEncoding, const string& content, bool head, bool keepAlive) {
+	
+	string output = "HTTP/1.1 "+status+"\r\n";
+	output += "Content-Length: "+type2String(content.size())+"\r\n";
+	output += "Content-Type: "+contentType+"\r\n";
+	if (contentEncoding.size() > 0) output += "Content-Encoding: "+contentEncoding+"\r\nVary: Accept-Encoding\r\n";
+	output += "Expires: 0\r\n";
+	output += keepAlive ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+	output += "\r\n";
+	
+	if (!head) {
+		output.reserve(output.size()+content.size());
+		output += content;
+	}
+	
+	return output;
+}
+
+/**
+ * Creates a response with an error page.
+ * @param status the status of the response, i.e. '404 Not Found'.
+ * @param message a message describing the error.
+ * @param keepAlive a flag indicating that the connection is kept alive.
+ * @return a response with header and content.
+ */
+string HTTPServer::errorResponse(string status, string message, bool keepAlive) {
+	
+	string output;
+	
+	output += "<!DOCTYPE html>\r\n";
+	output += "<html lang=\"en\">\r\n";
+	output += "<head>\r\n";
+	output += "  <title>"+status+"</title>\r\n";
+	output += "  <style type=\"text/css\">\r\n";
+	output += "    h2 {font-family:Helvetica,Arial,sans-serif; font-size: 24; color:#FFFFFF;}\r\n";
+	output += "    p {font-family:Helvetica,Arial,sans-serif; font-size: 14; color:#444444;}\r\n";
+	output += "  </style>\r\n";
+	output += "</head>\r\n";
+	output += "<body leftmargin=\"0\" topmargin=\"0\" marginwidth=\"0\" marginheight=\"0\">\r\n";
+	output += "  <table width=\"100%\" height=\"100%\" border=\"0\" frame=\"void\" cellspacing=\"0\" cellpadding=\"20\">\r\n";
+	output += "    <tr>\r\n";
+	output += "      <td width=\"100%\" height=\"30\" bgcolor=\"#585858\"><h2>"+status+"</h2></td>\r\n";
+	output += "    </tr>\r\n";
+	output += "    <tr>\r\n";
+	output += "      <td valign=\"top\" style=\"border-top-width:2px; border-left-width:0px; border-bottom-width:0px; border-right-width:0px; border-style:solid; border-color:#444444;\">\r\n";
+	output += "      <p>"+message+"</p>\r\n";
+	output += "      </td>\r\n";
+	output += "    </tr>\r\n";
+	output += "  </table>\r\n";
+	output += "</body>\r\n";
+	output += "</html>\r\n";
+	
+	string header = "HTTP/1.1 "+status+"\r\n";
+	header += "Content-Length: "+type2String(output.size())+"\r\n";
+	header += "Content-Type: text/html\r\n";
+	header += keepAlive ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+	header += "\r\n";
+	
+	return header+output;
+}
+
+/**
+ * Creates a worker thread of a given http server.
+ * @param httpServer the http server this worker thread belongs to.
+ */
+HTTPServer::Worker::Worker(HTTPServer* httpServer) : Thread("HTTPServer", HTTPServer::STACK_SIZE) {
+	
+	this->httpServer = httpServer;
+	
+	compressor = new z_stream();
+	compression = (deflateInit2(compressor, Z_BEST_SPEED, Z_DEFLATED, 15+16, 8, Z_DEFAULT_STRATEGY) == Z_OK);
+}
+
+/**
+ * Deletes the worker thread and its compressor.
+ */
+HTTPServer::Worker::~Worker() {
+	
+	if (compression) deflateEnd(compressor);
+	delete compressor;
+}
+
+/**
+ * Calls the scripts of pending jobs, and hands the responses back to the event loop.
+ */
+void HTTPServer::Worker::run() {
+	
+	while (true) {
+		
+		pthread_mutex_lock(&httpServer->jobMutex);
+		
+		while (httpServer->running && httpServer->pendingJobs.empty()) pthread_cond_wait(&httpServer->jobCondition, &httpServer->jobMutex);
+		
+		if (!httpServer->running) {
+			pthread_mutex_unlock(&httpServer->jobMutex);
+			return;
+		}
+		
+		Job* job = httpServer->pendingJobs.front();
+		httpServer->pendingJobs.pop_front();
+		
+		pthread_mutex_unlock(&httpServer->jobMutex);
+		
+		try {
+			
+			// the script writes its content into the reusable response
+			
+			response.clear();
+			job->httpScript->call(job->names, job->values, response);
+			
+			const string& content = response.getContent();
+			
+			if (job->gzip && response.isCompressible() && (content.size() >= COMPRESSION_SIZE) && compress(content)) {
+				job->response = httpServer->response("200 OK", response.getContentType(), "gzip", compressedContent, job->head, job->keepAlive);
+			} else {
+				job->response = httpServer->response("200 OK", response.getContentType(), "", content, job->head, job->keepAlive);
+			}
+			
+		} catch (exception& e) {
+			
+			cerr << e.what() << endl;
+			
+			job->response = httpServer->errorResponse("500 Internal Server Error", "The requested script failed!", job->keepAlive);
+		}
+		
+		pthread_mutex_lock(&httpServer->jobMutex);
+		httpServer->completedJobs.push_back(job);
+		pthread_mutex_unlock(&httpServer->jobMutex);
+		
+		char wakeup = 0;
+		if (write(httpServer->wakeupPipe[1], &wakeup, 1) < 0) {}
+	}
+}
+
+/**
+ * Compresses the content of a response with gzip into the reusable buffer of this worker thread.
+ * @param content the content to compress.
+ * @return <code>true</code> if the content was compressed, <code>false</code> otherwise.
+ */
+bool HTTPServer::Worker::compress(const string& content) {
+	
+	if (!compression || (deflateReset(compressor) != Z_OK)) return false;
+	
+	compressedContent.resize(deflateBound(compressor, content.size())+32);
+	
+	compressor->next_in = reinterpret_cast<Bytef*>(const_cast<char*>(content.data()));
+	compressor->avail_in = content.size();
+	compressor->next_out = reinterpret_cast<Bytef*>(&compressedContent[0]);
+	compressor->avail_out = compressedContent.size();
+	
+	if (deflate(compressor, Z_FINISH) != Z_STREAM_END) return false;
+	
+	compressedContent.resize(compressor->total_out);
+	
+	return true;
 }
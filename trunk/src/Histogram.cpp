@@ -0,0 +1,216 @@
+/*
+ * Histogram.cpp
+ * Copyright (c) 2026, ZHAW
+ * All rights reserved.
+ *
+ *  Created on: 17.10.2026
+ *      Author: Marcel Honegger
+ */
+
+#include "Histogram.h"
+
+using namespace std;
+
+/**
+ * Creates an empty histogram.
+ */
+Histogram::Histogram() {
+    
+    reset();
+}
+
+/**
+ * Creates a copy of a given histogram.
+ * @param histogram the histogram to copy.
+ */
+Histogram::Histogram(const Histogram& histogram) {
+    
+    copy(histogram);
+}
+
+/**
+ * Deletes the histogram object.
+ */
+Histogram::~Histogram() {}
+
+/**
+ * Copies the counters of a given histogram into this histogram.
+ * @param histogram the histogram to copy.
+ * @return a reference to this histogram.
+ */
+Histogram& Histogram::operator=(const Histogram& histogram) {
+    
+    if (this != &histogram) copy(histogram);
+    
+    return *this;
+}
+
+/**
+ * Removes all recorded values from this histogram.
+ */
+void Histogram::reset() {
+    
+    for (uint16_t i = 0; i < NUMBER_OF_BUCKETS; i++) buckets[i].store(0, memory_order_relaxed);
+    
+    count.store(0, memory_order_relaxed);
+    sum.store(0, memory_order_relaxed);
+    min.store(UINT64_MAX, memory_order_relaxed);
+    max.store(0, memory_order_relaxed);
+}
+
+/**
+ * Records a given value. This method must only be called by one thread at a time.
+ * @param value the value to record, i.e. a latency given in [ns].
+ */
+void Histogram::record(uint64_t value) {
+    
+    // the counters are only written by this thread, so they are updated without read-modify-write operations
+    
+    uint16_t bucket = getBucket(value);
+    
+    buckets[bucket].store(buckets[bucket].load(memory_order_relaxed)+1, memory_order_relaxed);
+    count.store(count.load(memory_order_relaxed)+1, memory_order_relaxed);
+    sum.store(sum.load(memory_order_relaxed)+value, memory_order_relaxed);
+    if (value < min.load(memory_order_relaxed)) min.store(value, memory_order_relaxed);
+    if (value > max.load(memory_order_relaxed)) max.store(value, memory_order_relaxed);
+}
+
+/**
+ * Gets the number of recorded values.
+ * @return the number of recorded values.
+ */
+uint64_t Histogram::getCount() {
+    
+    return count.load(memory_order_relaxed);
+}
+
+/**
+ * Gets the smallest recorded value.
+ * @return the smallest value, or 0 if no values were recorded.
+ */
+uint64_t Histogram::getMin() {
+    
+    return (count.load(memory_order_relaxed) > 0) ? min.load(memory_order_relaxed) : 0;
+}
+
+/**
+ * Gets the largest recorded value.
+ * @return the largest value, or 0 if no values were recorded.
+ */
+uint64_t Histogram::getMax() {
+    
+    return max.load(memory_order_relaxed);
+}
+
+/**
+ * Gets the mean of the recorded values.
+ * @return the mean value, or 0 if no values were recorded.
+ */
+uint64_t Histogram::getMean() {
+    
+    uint64_t count = this->count.load(memory_order_relaxed);
+    
+    return (count > 0) ? sum.load(memory_order_relaxed)/count : 0;
+}
+
+/**
+ * Gets a given percentile of the recorded values, i.e. the median with 50.0, or the value
+ * that 99.9% of the recorded values don't exceed with 99.9. The percentile is given as the
+ * upper bound of the bucket it lies in, but not larger than the largest recorded value.
+ * @param percentile the percentile, given in [%].
+ * @return the value of the percentile, or 0 if no values were recorded.
+ */
+uint64_t Histogram::getPercentile(double percentile) {
+    
+    uint64_t count = this->count.load(memory_order_relaxed);
+    if (count == 0) return 0;
+    
+    if (percentile < 0.0) percentile = 0.0;
+    else if (percentile > 100.0) percentile = 100.0;
+    
+    uint64_t rank = static_cast<uint64_t>(percentile/100.0*static_cast<double>(count)+0.5);
+    if (rank < 1) rank = 1;
+    else if (rank > count) rank = count;
+    
+    uint64_t max = this->max.load(memory_order_relaxed);
+    uint64_t sum = 0;
+    
+    for (uint16_t i = 0; i < NUMBER_OF_BUCKETS; i++) {
+        sum += buckets[i].load(memory_order_relaxed);
+        if (sum >= rank) return (getUpperBound(i) < max) ? getUpperBound(i) : max;
+    }
+    
+    return max;
+}
+
+/**
+ * Gets the number of values recorded in a given bucket.
+ * @param bucket the index of the bucket.
+ * @return the number of values in this bucket.
+ */
+uint64_t Histogram::getBucketCount(uint16_t bucket) {
+    
+    return (bucket < NUMBER_OF_BUCKETS) ? buckets[bucket].load(memory_order_relaxed) : 0;
+}
+
+/**
+ * Gets the index of the bucket that counts a given value.
+ * @param value a value.
+ * @return the index of the bucket.
+ */
+uint16_t Histogram::getBucket(uint64_t value) {
+    
+    if (value < 2*SUB_BUCKETS) return static_cast<uint16_t>(value);
+    
+    uint8_t exponent = 63-static_cast<uint8_t>(__builtin_clzll(value));
+    if (exponent > MAX_EXPONENT) return NUMBER_OF_BUCKETS-1;
+    
+    uint8_t shift = exponent-SUB_BUCKET_BITS;
+    
+    return static_cast<uint16_t>((shift+1)*SUB_BUCKETS+(value >> shift)-SUB_BUCKETS);
+}
+
+/**
+ * Gets the smallest value that is counted by a given bucket.
+ * @param bucket the index of the bucket.
+ * @return the lower bound of the bucket.
+ */
+uint64_t Histogram::getLowerBound(uint16_t bucket) {
+    
+    if (bucket < 2*SUB_BUCKETS) return bucket;
+    
+    uint8_t shift = bucket/SUB_BUCKETS-1;
+    
+    return static_cast<uint64_t>(SUB_BUCKETS+bucket%SUB_BUCKETS) << shift;
+}
+
+/**
+ * Gets the largest value that is counted by a given bucket.
+ * @param bucket the index of the bucket.
+ * @return the upper bound of the bucket.
+ */
+uint64_t Histogram::getUpperBound(uint16_t bucket) {
+    
+    if (bucket < 2*SUB_BUCKETS) return bucket;
+    if (bucket >= NUMBER_OF_BUCKETS-1) return UINT64_MAX;
+    
+    uint8_t shift = bucket/SUB_BUCKETS-1;
+    
+    return getLowerBound(bucket)+(static_cast<uint64_t>(1) << shift)-1;
+}
+
+/**
+ * Copies the counters of a given histogram. The counters may be updated by another
+ * thread while they are copied, so the copy is only consistent if it is protected
+ * by a seqlock or a mutex.
+ * @param histogram the histogram to copy.
+ */
+void Histogram::copy(const Histogram& histogram) {
+    
+    for (uint16_t i = 0; i < NUMBER_OF_BUCKETS; i++) buckets[i].store(histogram.buckets[i].load(memory_order_relaxed), memory_order_relaxed);
+    
+    count.store(histogram.count.load(memory_order_relaxed), memory_order_relaxed);
+    sum.store(histogram.sum.load(memory_order_relaxed), memory_order_relaxed);
+    min.store(histogram.min.load(memory_order_relaxed), memory_order_relaxed);
+    max.store(histogram.max.load(memory_order_relaxed), memory_order_relaxed);
+}
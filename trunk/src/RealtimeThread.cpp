@@ -8,6 +8,27 @@
  */
 
 #include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <alloca.h>
+#include <sched.h>
+#include <sys/mman.h>
+
+#if defined __QNX__
+
+#else
+
+#include <malloc.h>
+#include <sys/syscall.h>
+
+#if !defined SCHED_DEADLINE
+#define SCHED_DEADLINE 6
+#endif
+
+#endif
+
+#include "Trace.h"
 #include "RealtimeThread.h"
 
 using namespace std;
@@ -17,9 +38,12 @@ const int32_t RealtimeThread::RT_MAX_PRIORITY = sched_get_priority_max(SCHED_FIF
 
 const double RealtimeThread::DELAY = 10.0;		// delay for collecting statistical information in [s]
 
+pthread_mutex_t RealtimeThread::mutex = PTHREAD_MUTEX_INITIALIZER;
+bool RealtimeThread::memoryLocked = false;
+uint32_t RealtimeThread::numberOfIsolatedThreads = 0;
+
 #if defined __QNX__
 
-pthread_mutex_t RealtimeThread::mutex = PTHREAD_MUTEX_INITIALIZER;
 bool RealtimeThread::signalsInitialized = false;
 bool* RealtimeThread::signalNumbers = new bool[SIGRTMAX-SIGRTMIN+1];
 
@@ -59,6 +83,24 @@ RealtimeThread::RealtimeThread() {
     
     threadState = 0;
     threadID = 0;
+    affinity = CPU_ANY;
+    cpu = CPU_ANY;
+    stackPrefaulted = false;
+    absoluteTiming = false;
+    overrunPolicy = OVERRUN_SKIP;
+    offset = 0.0;
+    periodTime = 0;
+    releaseTimeNext = 0;
+    missedPeriods = 0;
+    runs = 0;
+    overruns = 0;
+    sequence = 0;
+    freeRuns = 0;
+    releaseTimeLast = 0;
+    runtime = 0.0;
+    deadline = 0.0;
+    deadlineScheduled = false;
+    absoluteRelease = false;
     name = "RealtimeThread";
     period = 1.0;
 }
@@ -98,6 +140,24 @@ RealtimeThread::RealtimeThread(string name, size_t stackSize) {
     
     threadState = 0;
     threadID = 0;
+    affinity = CPU_ANY;
+    cpu = CPU_ANY;
+    stackPrefaulted = false;
+    absoluteTiming = false;
+    overrunPolicy = OVERRUN_SKIP;
+    offset = 0.0;
+    periodTime = 0;
+    releaseTimeNext = 0;
+    missedPeriods = 0;
+    runs = 0;
+    overruns = 0;
+    sequence = 0;
+    freeRuns = 0;
+    releaseTimeLast = 0;
+    runtime = 0.0;
+    deadline = 0.0;
+    deadlineScheduled = false;
+    absoluteRelease = false;
     this->name = name;
     period = 1.0;
 }
@@ -143,13 +203,31 @@ RealtimeThread::RealtimeThread(string name, size_t stackSize, int32_t priority,
     
     threadState = 0;
     threadID = 0;
+    affinity = CPU_ANY;
+    cpu = CPU_ANY;
+    stackPrefaulted = false;
+    absoluteTiming = false;
+    overrunPolicy = OVERRUN_SKIP;
+    offset = 0.0;
+    periodTime = 0;
+    releaseTimeNext = 0;
+    missedPeriods = 0;
+    runs = 0;
+    overruns = 0;
+    sequence = 0;
+    freeRuns = 0;
+    releaseTimeLast = 0;
+    runtime = 0.0;
+    deadline = 0.0;
+    deadlineScheduled = false;
+    absoluteRelease = false;
     this->name = name;
     this->period = period;
 }
 
 RealtimeThread::~RealtimeThread() {
     
-    pthread_cancel(threadID);
+    if (threadID != 0) pthread_cancel(threadID);
     pthread_attr_destroy(&threadAttr);
     
     #if defined __QNX__
@@ -226,6 +304,220 @@ double RealtimeThread::getPeriod() {
     return period;
 }
 
+/**
+ * Sets the affinity of this realtime thread to a given CPU. To set or change the affinity,
+ * this method must be called before the thread is started.
+ * @param affinity the number of the CPU this thread should run on, or <code>CPU_ANY</code>
+ * if it may run on any CPU, or <code>CPU_ISOLATED</code> if it should run on one of the CPUs
+ * that are isolated with the <code>isolcpus</code> kernel parameter. If no CPUs are isolated,
+ * the thread may run on any CPU. An invalid CPU number is rejected, and the thread may then
+ * run on any CPU.
+ */
+void RealtimeThread::setAffinity(int32_t affinity) {
+    
+    #if defined __QNX__
+    
+    const int32_t MAX_CPUS = 32;            // size of the runmask of a thread
+    
+    #else
+    
+    const int32_t MAX_CPUS = CPU_SETSIZE;   // size of a cpu_set_t
+    
+    #endif
+    
+    if ((affinity < CPU_ISOLATED) || (affinity >= MAX_CPUS)) {
+        
+        cerr << "RealtimeThread: invalid cpu " << affinity << " for thread '" << name << "'." << endl;
+        
+        affinity = CPU_ANY;
+    }
+    
+    this->affinity = affinity;
+}
+
+/**
+ * Gets the affinity of this realtime thread.
+ * @return the number of a CPU, or <code>CPU_ANY</code> or <code>CPU_ISOLATED</code>.
+ */
+int32_t RealtimeThread::getAffinity() {
+    
+    return affinity;
+}
+
+/**
+ * Gets the CPU this realtime thread is pinned to. With the affinity <code>CPU_ISOLATED</code>,
+ * this CPU is chosen when the thread is started.
+ * @return the number of the CPU, or <code>CPU_ANY</code> if this thread isn't pinned to a CPU.
+ */
+int32_t RealtimeThread::getCPU() {
+    
+    return cpu;
+}
+
+/**
+ * Sets the timing mode of this realtime thread. With absolute timing, the thread waits for
+ * absolute release times with <code>clock_nanosleep()</code>, which are multiples of its
+ * period on the monotonic clock, plus an offset. Otherwise, the thread uses a periodic timer.
+ * To set or change the timing mode, this method must be called before the thread is started.
+ * @param absoluteTiming <code>true</code> for absolute timing, <code>false</code> for a periodic timer.
+ */
+void RealtimeThread::setAbsoluteTiming(bool absoluteTiming) {
+    
+    this->absoluteTiming = absoluteTiming;
+}
+
+/**
+ * Tests if this realtime thread uses absolute timing.
+ * @return <code>true</code> if this thread uses absolute timing, <code>false</code> otherwise.
+ */
+bool RealtimeThread::isAbsoluteTiming() {
+    
+    return absoluteTiming;
+}
+
+/**
+ * Sets the offset of the release times of this realtime thread relative to multiples of its
+ * period. This offset is only used with absolute timing. To set or change the offset, this
+ * method must be called before the thread is started.
+ * @param offset the offset of the release times, given in [s].
+ */
+void RealtimeThread::setOffset(double offset) {
+    
+    this->offset = offset;
+}
+
+/**
+ * Gets the offset of the release times of this realtime thread.
+ * @return the offset, given in [s].
+ */
+double RealtimeThread::getOffset() {
+    
+    return offset;
+}
+
+/**
+ * Sets the overrun policy of this realtime thread, which defines what happens when this thread
+ * misses release times. This policy is only used with absolute timing. With a periodic timer,
+ * missed release times are always skipped.
+ * @param overrunPolicy the overrun policy, either <code>OVERRUN_SKIP</code>, <code>OVERRUN_CATCH_UP</code>
+ * or <code>OVERRUN_NOTIFY</code>.
+ */
+void RealtimeThread::setOverrunPolicy(uint8_t overrunPolicy) {
+    
+    this->overrunPolicy = overrunPolicy;
+}
+
+/**
+ * Gets the overrun policy of this realtime thread.
+ * @return the overrun policy.
+ */
+uint8_t RealtimeThread::getOverrunPolicy() {
+    
+    return overrunPolicy;
+}
+
+/**
+ * Gets the number of release times this realtime thread missed since it was started.
+ * @return the number of missed release times.
+ */
+uint64_t RealtimeThread::getMissedPeriods() {
+    
+    return missedPeriods.load(memory_order_relaxed);
+}
+
+/**
+ * Gets a consistent snapshot of the statistics of this realtime thread. This method may be
+ * called by a monitoring thread at any time, without disturbing this thread: it copies the
+ * statistics, and retries if this thread updated them in the meantime. The monitoring thread
+ * shouldn't have a higher priority than this thread when they run on the same CPU.
+ * @param statistics a reference to a statistics object to copy the snapshot into.
+ */
+void RealtimeThread::getStatistics(Statistics& statistics) {
+    
+    while (true) {
+        
+        uint32_t sequence = this->sequence.load(memory_order_acquire);
+        
+        if ((sequence & 1) == 0) {
+            
+            statistics.runs = (runs.load(memory_order_relaxed) > freeRuns) ? runs.load(memory_order_relaxed)-freeRuns : 0;
+            statistics.overruns = overruns.load(memory_order_relaxed);
+            statistics.missedPeriods = missedPeriods.load(memory_order_relaxed);
+            statistics.latency = latency;
+            statistics.duration = duration;
+            
+            atomic_thread_fence(memory_order_acquire);
+            
+            if (this->sequence.load(memory_order_relaxed) == sequence) return;
+        }
+        
+        sched_yield();
+    }
+}
+
+/**
+ * Sets the execution time budget of this realtime thread per period. With a budget greater
+ * than 0, this thread is scheduled with <code>SCHED_DEADLINE</code>, using the period of this
+ * thread and the given budget. To set or change the budget, this method must be called before
+ * the thread is started. Note that the kernel doesn't admit threads with a budget that are
+ * pinned to a subset of the CPUs of their scheduling domain, i.e. with <code>setAffinity()</code>.
+ * @param runtime the execution time budget per period, given in [s], or 0 to schedule this
+ * thread with <code>SCHED_FIFO</code>.
+ */
+void RealtimeThread::setRuntime(double runtime) {
+    
+    this->runtime = (runtime > 0.0) ? runtime : 0.0;
+}
+
+/**
+ * Gets the execution time budget of this realtime thread per period.
+ * @return the execution time budget, given in [s], or 0 if this thread is scheduled with <code>SCHED_FIFO</code>.
+ */
+double RealtimeThread::getRuntime() {
+    
+    return runtime;
+}
+
+/**
+ * Sets the relative deadline of this realtime thread, when it is scheduled with
+ * <code>SCHED_DEADLINE</code>. The deadline must be at least the execution time budget,
+ * and at most the period of this thread. To set or change the deadline, this method must
+ * be called before the thread is started.
+ * @param deadline the relative deadline, given in [s], or 0 to use the period as deadline.
+ */
+void RealtimeThread::setDeadline(double deadline) {
+    
+    this->deadline = (deadline > 0.0) ? deadline : 0.0;
+}
+
+/**
+ * Gets the relative deadline of this realtime thread.
+ * @return the relative deadline, given in [s], or 0 if the period is used as deadline.
+ */
+double RealtimeThread::getDeadline() {
+    
+    return deadline;
+}
+
+/**
+ * Tests if this realtime thread is scheduled with <code>SCHED_DEADLINE</code>, i.e. if
+ * the kernel admitted its execution time budget when the thread was started.
+ * @return <code>true</code> if this thread is scheduled with <code>SCHED_DEADLINE</code>,
+ * <code>false</code> otherwise.
+ */
+bool RealtimeThread::isDeadlineScheduled() {
+    
+    return deadlineScheduled;
+}
+
+/**
+ * This method is called by <code>waitForNextPeriod()</code> when this realtime thread missed
+ * release times and the overrun policy is <code>OVERRUN_NOTIFY</code>. It may be overridden
+ * to handle overruns, i.e. to enter a safe state.
+ * @param missedPeriods the number of release times that were missed.
+ */
+void RealtimeThread::overrun(uint64_t missedPeriods) {}
+
 /**
  * Sets the name of this realtime thread object.
  * @param name the name of this thread.
@@ -263,55 +555,94 @@ void RealtimeThread::start() {
         
         threadState = 1;
         
-        #if defined __QNX__
+        // choose the CPU to pin this thread to
         
-        signalEvent.sigev_notify = SIGEV_SIGNAL;
-        signalEvent.sigev_signo = signalNumber;
-        signalEvent.sigev_value.sival_ptr = &signalTimer;
+        cpu = affinity;
         
-        timer_create(CLOCK_REALTIME, &signalEvent, &signalTimer);
+        if (affinity == CPU_ISOLATED) {
+            
+            vector<int32_t> isolatedCPUs = getIsolatedCPUs();
+            
+            pthread_mutex_lock(&RealtimeThread::mutex);
+            
+            cpu = isolatedCPUs.empty() ? CPU_ANY : isolatedCPUs[numberOfIsolatedThreads%isolatedCPUs.size()];
+            if (!isolatedCPUs.empty()) numberOfIsolatedThreads++;
+            
+            pthread_mutex_unlock(&RealtimeThread::mutex);
+        }
         
-        itimerspec timerSpec;
+        stackPrefaulted = false;
+        deadlineScheduled = false;
+        absoluteRelease = absoluteTiming || (runtime > 0.0);
+        periodTime = max(static_cast<int64_t>(llround(1.0e9*period)), static_cast<int64_t>(1));
         
-        uint64_t period = static_cast<uint64_t>(1.0e9*this->period);
-        timerSpec.it_interval.tv_sec = period/1000000000;
-        timerSpec.it_interval.tv_nsec = period%1000000000;
-        timerSpec.it_value = timerSpec.it_interval;
+        // reset the statistics, while a monitoring thread may read them
         
-        timer_settime(signalTimer, 0, &timerSpec, NULL);
+        beginUpdate();
         
-        sigemptyset(&signalsToCatch);
-        sigaddset(&signalsToCatch, signalNumber);
+        runs.store(0, memory_order_relaxed);
+        overruns.store(0, memory_order_relaxed);
+        missedPeriods.store(0, memory_order_relaxed);
+        latency.reset();
+        duration.reset();
         
-        #else
-        
-        timerFD = timerfd_create(CLOCK_MONOTONIC, 0);
-        
-        itimerspec timerSpec;
-        
-        long period = 1.0e9*this->period;
-        timerSpec.it_interval.tv_sec = period/1000000000;
-        timerSpec.it_interval.tv_nsec = period%1000000000;
-        timerSpec.it_value = timerSpec.it_interval;
+        endUpdate();
         
-        timerfd_settime(timerFD, 0, &timerSpec, NULL);
+        freeRuns = max(static_cast<uint64_t>(DELAY/period), static_cast<uint64_t>(1));
+        releaseTimeLast = 0;
         
-        #endif
+        if (absoluteRelease) {
+            
+            // the first release time is the next multiple of the period, plus the offset
+            
+            int64_t time = getTime();
+            
+            releaseTimeNext = (time/periodTime+1)*periodTime+static_cast<int64_t>(llround(1.0e9*offset))%periodTime;
+            if (releaseTimeNext <= time) releaseTimeNext += periodTime;
+            
+        } else {
+            
+            #if defined __QNX__
+            
+            signalEvent.sigev_notify = SIGEV_SIGNAL;
+            signalEvent.sigev_signo = signalNumber;
+            signalEvent.sigev_value.sival_ptr = &signalTimer;
+            
+            timer_create(CLOCK_REALTIME, &signalEvent, &signalTimer);
+            
+            itimerspec timerSpec;
+            
+            uint64_t period = static_cast<uint64_t>(1.0e9*this->period);
+            timerSpec.it_interval.tv_sec = period/1000000000;
+            timerSpec.it_interval.tv_nsec = period%1000000000;
+            timerSpec.it_value = timerSpec.it_interval;
+            
+            timer_settime(signalTimer, 0, &timerSpec, NULL);
+            
+            releaseTimeNext = 0;
+            
+            sigemptyset(&signalsToCatch);
+            sigaddset(&signalsToCatch, signalNumber);
+            
+            #else
+            
+            timerFD = timerfd_create(CLOCK_MONOTONIC, 0);
+            
+            itimerspec timerSpec;
+            
+            long period = 1.0e9*this->period;
+            timerSpec.it_interval.tv_sec = period/1000000000;
+            timerSpec.it_interval.tv_nsec = period%1000000000;
+            timerSpec.it_value = timerSpec.it_interval;
+            
+            releaseTimeNext = getTime()+periodTime;
+            
+            timerfd_settime(timerFD, 0, &timerSpec, NULL);
+            
+            #endif
+            
+        }
         
-        runs = 0;
-        overruns = 0;
-        freeRuns = max(static_cast<uint64_t>(DELAY/period), static_cast<uint64_t>(1));
-        releaseTime = 0.0;
-        periodActual = period;
-        periodMin = 1.0e9;
-        periodMax = 0.0;
-        periodMean = period;
-        periodDeviation = 0.0;
-        durationActual = 0.0;
-        durationMin = 1.0e9;
-        durationMax = 0.0;
-        durationMean = 0.0;
-        durationDeviation = 0.0;
         
         pthread_create(&threadID, &threadAttr, (void*(*)(void*))RealtimeThread::runHandler, this);
     }
@@ -328,15 +659,18 @@ void RealtimeThread::stop() {
         
         pthread_join(threadID, NULL);
         
-        #if defined __QNX__
-        
-        timer_delete(signalTimer);
-        
-        #else
-        
-        close(timerFD);
-        
-        #endif
+        if (!absoluteRelease) {
+            
+            #if defined __QNX__
+            
+            timer_delete(signalTimer);
+            
+            #else
+            
+            close(timerFD);
+            
+            #endif
+        }
     }
 }
 
@@ -349,59 +683,154 @@ bool RealtimeThread::waitForNextPeriod() {
     
     if (threadState == 0) return false;
     
-    #if defined __QNX__
+    if (absoluteRelease) {
+        
+        int64_t time0 = getTime();
+        
+        // handle a release time that has already passed according to the overrun policy
+        
+        bool sleep = true;
+        uint64_t missed = 0;
+        
+        if (time0 >= releaseTimeNext) {
+            
+            if (overrunPolicy == OVERRUN_CATCH_UP) {
+                sleep = false;
+            } else {
+                missed = static_cast<uint64_t>((time0-releaseTimeNext)/periodTime)+1;
+                releaseTimeNext += static_cast<int64_t>(missed)*periodTime;
+                if (overrunPolicy == OVERRUN_NOTIFY) overrun(missed);
+            }
+        }
+        
+        if (sleep) {
+            
+            Trace::Span span("RealtimeThread::waitForNextPeriod");
+            
+            timespec releaseTime;
+            releaseTime.tv_sec = releaseTimeNext/1000000000LL;
+            releaseTime.tv_nsec = releaseTimeNext%1000000000LL;
+            
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &releaseTime, NULL) == EINTR);
+        }
+        
+        int64_t releaseTime = releaseTimeNext;
+        releaseTimeNext += periodTime;
+        
+        updateStatistics(time0, getTime(), releaseTime, missed);
+        
+        return true;
+    }
     
-    uint64_t cycles = ClockCycles();
-    uint64_t cyclesPerSec = SYSPAGE_ENTRY(qtime)->cycles_per_sec;
-    double time0 = static_cast<double>(cycles)/static_cast<double>(cyclesPerSec);
+    int64_t time0 = getTime();
+    
+    Trace::begin("RealtimeThread::waitForNextPeriod");
     
-    //timespec currentTime;
-    //clock_gettime(CLOCK_REALTIME, &currentTime);
-    //double time0 = static_cast<double>(currentTime.tv_sec+currentTime.tv_nsec/1.0e9);
+    #if defined __QNX__
     
     sigevent caughtSignal;
     sigwait(&signalsToCatch, (int32_t*)&caughtSignal);
     
-    cycles = ClockCycles();
-    double time1 = static_cast<double>(cycles)/static_cast<double>(cyclesPerSec);
+    int64_t time1 = getTime();
+    
+    // the timer runs on another clock, so the first release defines the grid of release times
+    
+    if (releaseTimeNext == 0) releaseTimeNext = time1;
     
-    //clock_gettime(CLOCK_REALTIME, &currentTime);
-    //double time1 = static_cast<double>(currentTime.tv_sec+currentTime.tv_nsec/1.0e9);
+    uint64_t missed = (time1 >= releaseTimeNext+periodTime) ? static_cast<uint64_t>((time1-releaseTimeNext)/periodTime) : 0;
     
     #else
     
-    timespec currentTime;
-    clock_gettime(CLOCK_MONOTONIC, &currentTime);
-    double time0 = static_cast<double>(currentTime.tv_sec+currentTime.tv_nsec/1.0e9);
+    uint64_t expirations = 0;
+    if (read(timerFD, &expirations, sizeof(expirations)) != sizeof(expirations)) expirations = 1;
+    
+    int64_t time1 = getTime();
+    
+    uint64_t missed = (expirations > 1) ? expirations-1 : 0;
     
-    uint64_t missed;
-    read(timerFD, &missed, sizeof(missed));
+    #endif
+    
+    Trace::end("RealtimeThread::waitForNextPeriod");
+    
+    int64_t releaseTime = releaseTimeNext+static_cast<int64_t>(missed)*periodTime;
+    releaseTimeNext = releaseTime+periodTime;
     
+    updateStatistics(time0, time1, releaseTime, missed);
+    
+    return true;
+}
+
+/**
+ * Gets the current time of the monotonic clock.
+ * @return the current time, given in [ns].
+ */
+int64_t RealtimeThread::getTime() {
+    
+    #if defined __QNX__
+    
+    uint64_t cycles = ClockCycles();
+    uint64_t cyclesPerSec = SYSPAGE_ENTRY(qtime)->cycles_per_sec;
+    
+    return static_cast<int64_t>(cycles/cyclesPerSec*1000000000ULL+cycles%cyclesPerSec*1000000000ULL/cyclesPerSec);
+    
+    #else
+    
+    timespec currentTime;
     clock_gettime(CLOCK_MONOTONIC, &currentTime);
-    double time1 = static_cast<double>(currentTime.tv_sec+currentTime.tv_nsec/1.0e9);
+    
+    return static_cast<int64_t>(currentTime.tv_sec)*1000000000LL+static_cast<int64_t>(currentTime.tv_nsec);
     
     #endif
+}
+
+/**
+ * Updates the statistics of this thread with integer operations only. The statistics are
+ * written inside of a seqlock, so that a monitoring thread may read a consistent snapshot.
+ * @param time0 the time when the thread started to wait for the next period, given in [ns].
+ * @param time1 the time when the thread was released, given in [ns].
+ * @param releaseTime the time when the thread should have been released, given in [ns].
+ * @param missed the number of release times that were skipped.
+ */
+void RealtimeThread::updateStatistics(int64_t time0, int64_t time1, int64_t releaseTime, uint64_t missed) {
+    
+    int64_t period = time1-releaseTimeLast;
+    int64_t duration = time0-releaseTimeLast;
+    int64_t latency = time1-releaseTime;
+    
+    bool first = (releaseTimeLast == 0);
+    releaseTimeLast = time1;
     
-    double period = time1-releaseTime;
-    double duration = time0-releaseTime;
-    releaseTime = time1;
-    
-    runs++;
-    if (runs > freeRuns) {
-        overruns += (period > 2.0*this->period) ? 1 : 0;
-        periodActual = period;
-        periodMin = (period < periodMin) ? period : periodMin;
-        periodMax = (period > periodMax) ? period : periodMax;
-        periodMean = (((double)runs-(double)freeRuns-1.0)*periodMean+period)/(double)(runs-freeRuns);
-        periodDeviation = sqrt((periodDeviation*periodDeviation*((double)runs-(double)freeRuns-1.0)+(period-periodMean)*(period-periodMean))/(double)(runs-freeRuns));
-        durationActual = duration;
-        durationMin = (duration < durationMin) ? duration : durationMin;
-        durationMax = (duration > durationMax) ? duration : durationMax;
-        durationMean = ((runs-freeRuns-1)*durationMean+duration)/(runs-freeRuns);
-        durationDeviation = sqrt((durationDeviation*durationDeviation*((double)runs-(double)(freeRuns+1))+(duration-durationMean)*(duration-durationMean))/((double)runs-(double)freeRuns));
+    beginUpdate();
+    
+    uint64_t runs = this->runs.load(memory_order_relaxed)+1;
+    this->runs.store(runs, memory_order_relaxed);
+    
+    if (missed > 0) missedPeriods.store(missedPeriods.load(memory_order_relaxed)+missed, memory_order_relaxed);
+    
+    if ((runs > freeRuns) && !first) {
+        if ((period > 2*periodTime) || (deadlineScheduled && (duration > static_cast<int64_t>(1.0e9*runtime)))) overruns.store(overruns.load(memory_order_relaxed)+1, memory_order_relaxed);
+        this->latency.record((latency > 0) ? static_cast<uint64_t>(latency) : 0);
+        this->duration.record((duration > 0) ? static_cast<uint64_t>(duration) : 0);
     }
     
-    return true;
+    endUpdate();
+}
+
+/**
+ * Starts to write the statistics of this thread, by making the sequence number odd.
+ */
+void RealtimeThread::beginUpdate() {
+    
+    sequence.store(sequence.load(memory_order_relaxed)+1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+/**
+ * Finishes to write the statistics of this thread, by making the sequence number even.
+ */
+void RealtimeThread::endUpdate() {
+    
+    sequence.store(sequence.load(memory_order_relaxed)+1, memory_order_release);
 }
 
 /**
@@ -443,20 +872,31 @@ string RealtimeThread::toString() {
     
     out << name << ":" << endl;
     out << "  priority: " << getPriority() << endl;
-    
-    if (isAlive() && (runs > freeRuns)) {
-        out << "  period: " << static_cast<int32_t>(periodActual*1.0e6) << " (" << static_cast<int32_t>(period*1.0e6) << ") us" << endl;
-        out << "    min/max: " << static_cast<int32_t>(periodMin*1.0e6) << "/" << static_cast<int32_t>(periodMax*1.0e6) << " us" << endl;
-        out << "    mean: " << static_cast<int32_t>(periodMean*1.0e6) << " us" << endl;
-        out << "    deviation: " << static_cast<int32_t>(periodDeviation*1.0e6) << " us" << endl;
-        out << "    overruns: " << overruns;
-        if (overruns > 0) out << " (1:" << static_cast<int32_t>((double)(runs-100)/(double)overruns) << ")" << endl; else out << endl;
-        out << "  duration: " << static_cast<int32_t>(durationActual*1.0e6) << " us" << endl;
-        out << "    min/max: " << static_cast<int32_t>(durationMin*1.0e6) << "/" << static_cast<int32_t>(durationMax*1.0e6) << " us" << endl;
-        out << "    mean: " << static_cast<int32_t>(durationMean*1.0e6) << " us" << endl;
-        out << "    deviation: " << static_cast<int32_t>(durationDeviation*1.0e6) << " us" << endl;
+    if (runtime > 0.0) out << "  scheduling: " << (deadlineScheduled ? "deadline" : isAlive() ? "fifo (deadline not admitted)" : "deadline") << " (runtime " << static_cast<int32_t>(runtime*1.0e6) << " us, deadline " << static_cast<int32_t>(((deadline > 0.0) ? deadline : period)*1.0e6) << " us)" << endl;
+    out << "  affinity: " << ((affinity == CPU_ANY) ? "any" : (affinity == CPU_ISOLATED) ? "isolated" : "fixed");
+    if (isAlive() && (cpu != CPU_ANY)) out << " (cpu " << cpu << ")" << endl; else out << endl;
+    out << "  stack: " << getStackSize()/1024 << " kB" << (stackPrefaulted ? ", prefaulted" : "") << endl;
+    out << "  memory: " << (memoryLocked ? "locked" : "not locked") << endl;
+    out << "  timing: " << ((absoluteTiming || (runtime > 0.0)) ? "absolute" : "timer");
+    if (absoluteTiming || (runtime > 0.0)) out << " (offset " << static_cast<int32_t>(offset*1.0e6) << " us, " << ((overrunPolicy == OVERRUN_CATCH_UP) ? "catch up" : (overrunPolicy == OVERRUN_NOTIFY) ? "notify" : "skip") << ")" << endl; else out << endl;
+    out << "  missed periods: " << getMissedPeriods() << endl;
+    
+    Statistics statistics;
+    getStatistics(statistics);
+    
+    out << "  period: " << static_cast<int32_t>(period*1.0e6) << " us" << endl;
+    
+    if (isAlive() && (statistics.runs > 0)) {
+        out << "    overruns: " << statistics.overruns;
+        if (statistics.overruns > 0) out << " (1:" << statistics.runs/statistics.overruns << ")" << endl; else out << endl;
+        out << "  latency: " << statistics.latency.getMean()/1000 << " us" << endl;
+        out << "    p50/p99/p99.9: " << statistics.latency.getPercentile(50.0)/1000 << "/" << statistics.latency.getPercentile(99.0)/1000 << "/" << statistics.latency.getPercentile(99.9)/1000 << " us" << endl;
+        out << "    max: " << statistics.latency.getMax()/1000 << " us" << endl;
+        out << "  duration: " << statistics.duration.getMean()/1000 << " us" << endl;
+        out << "    p50/p99/p99.9: " << statistics.duration.getPercentile(50.0)/1000 << "/" << statistics.duration.getPercentile(99.0)/1000 << "/" << statistics.duration.getPercentile(99.9)/1000 << " us" << endl;
+        out << "    max: " << statistics.duration.getMax()/1000 << " us" << endl;
     } else {
-        out << "  period: " << static_cast<int32_t>(period*1.0e6) << " us" << endl;
+        out << "  latency: -" << endl;
         out << "  duration: -" << endl;
     }
     
@@ -485,7 +925,181 @@ uint32_t RealtimeThread::getSignalNumber() {
     #endif
 }
 
+/**
+ * Locks all current and future memory pages of this process into physical memory, so that
+ * realtime threads don't suffer from page faults. This also stops the heap from returning
+ * memory to the operating system. This method should be called once, at the beginning of
+ * the <code>main()</code> function of an application, and it requires root privileges or
+ * the <code>CAP_IPC_LOCK</code> capability.
+ * @return <code>true</code> if the memory was locked, <code>false</code> otherwise.
+ */
+bool RealtimeThread::lockMemory() {
+    
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) return false;
+    
+    #if defined __QNX__
+    
+    #else
+    
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+    
+    #endif
+    
+    memoryLocked = true;
+    
+    return true;
+}
+
+/**
+ * Gets the CPUs that are isolated from the scheduler of the operating system,
+ * i.e. with the <code>isolcpus</code> kernel parameter.
+ * @return a list with the numbers of the isolated CPUs, which may be empty.
+ */
+vector<int32_t> RealtimeThread::getIsolatedCPUs() {
+    
+    vector<int32_t> isolatedCPUs;
+    
+    #if defined __QNX__
+    
+    #else
+    
+    // parse a list like '2-3,6'
+    
+    ifstream file("/sys/devices/system/cpu/isolated");
+    string list;
+    getline(file, list);
+    
+    stringstream ranges(list);
+    string range;
+    
+    while (getline(ranges, range, ',')) {
+        
+        int32_t first = 0;
+        int32_t last = 0;
+        
+        int32_t values = sscanf(range.c_str(), "%d-%d", &first, &last);
+        if (values == 1) last = first;
+        
+        for (int32_t i = first; (values > 0) && (i <= last); i++) isolatedCPUs.push_back(i);
+    }
+    
+    #endif
+    
+    return isolatedCPUs;
+}
+
+/**
+ * Gets the number of bytes on the stack of the calling thread below its current
+ * stack pointer, i.e. the part of the stack that isn't used yet.
+ * @param stackSize the stack size this thread was created with, given in [bytes].
+ * This size is only used if the stack of the thread can't be queried.
+ * @return the number of bytes that are still available, given in [bytes].
+ */
+size_t RealtimeThread::getFreeStackSize(size_t stackSize) {
+    
+    #if defined __QNX__
+    
+    return (stackSize > STACK_RESERVE) ? stackSize-STACK_RESERVE : 0;
+    
+    #else
+    
+    volatile uint8_t top = 0;
+    uintptr_t stackPointer = reinterpret_cast<uintptr_t>(&top);
+    size_t freeStackSize = 0;
+    
+    pthread_attr_t attr;
+    if (pthread_getattr_np(pthread_self(), &attr) == 0) {
+        
+        void* stackAddress = NULL;
+        size_t size = 0;
+        
+        if (pthread_attr_getstack(&attr, &stackAddress, &size) == 0) {
+            
+            // the stack grows downwards from stackAddress+size to stackAddress
+            
+            uintptr_t bottom = reinterpret_cast<uintptr_t>(stackAddress);
+            if ((stackPointer > bottom) && (stackPointer <= bottom+size)) freeStackSize = stackPointer-bottom;
+        }
+        
+        pthread_attr_destroy(&attr);
+    }
+    
+    return freeStackSize;
+    
+    #endif
+}
+
+/**
+ * Touches a given number of bytes on the stack of the calling thread, so that
+ * these memory pages are mapped before the thread enters its periodic loop.
+ * @param size the number of bytes to prefault, given in [bytes].
+ */
+void RealtimeThread::prefaultStack(size_t size) {
+    
+    volatile uint8_t* stack = static_cast<volatile uint8_t*>(alloca(size));
+    
+    for (size_t i = 0; i < size; i += 1024) stack[i] = 0;
+}
+
 void RealtimeThread::runHandler(RealtimeThread* realtimeThread) {
     
+    // pin the thread to its CPU
+    
+    if (realtimeThread->cpu >= 0) {
+        
+        #if defined __QNX__
+        
+        ThreadCtl(_NTO_TCTL_RUNMASK, reinterpret_cast<void*>(1 << realtimeThread->cpu));
+        
+        #else
+        
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        CPU_SET(realtimeThread->cpu, &cpuSet);
+        
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) != 0) cerr << "RealtimeThread: couldn't pin thread '" << realtimeThread->name << "' to cpu " << realtimeThread->cpu << "." << endl;
+        
+        #endif
+    }
+    
+    // schedule the thread with SCHED_DEADLINE, if it has an execution time budget
+    
+    if (realtimeThread->runtime > 0.0) {
+        
+        #if defined __QNX__ || !defined SYS_sched_setattr
+        
+        cerr << "RealtimeThread: SCHED_DEADLINE isn't supported for thread '" << realtimeThread->name << "'." << endl;
+        
+        #else
+        
+        SchedAttr schedAttr;
+        memset(&schedAttr, 0, sizeof(schedAttr));
+        schedAttr.size = sizeof(schedAttr);
+        schedAttr.schedPolicy = SCHED_DEADLINE;
+        schedAttr.schedRuntime = static_cast<uint64_t>(llround(1.0e9*realtimeThread->runtime));
+        schedAttr.schedDeadline = static_cast<uint64_t>(llround(1.0e9*((realtimeThread->deadline > 0.0) ? realtimeThread->deadline : realtimeThread->period)));
+        schedAttr.schedPeriod = static_cast<uint64_t>(llround(1.0e9*realtimeThread->period));
+        
+        if (syscall(SYS_sched_setattr, 0, &schedAttr, 0) == 0) realtimeThread->deadlineScheduled = true;
+        else cerr << "RealtimeThread: SCHED_DEADLINE wasn't admitted for thread '" << realtimeThread->name << "' (errno=" << errno << ")." << endl;
+        
+        #endif
+    }
+    
+    // register the thread with its name for tracing, its ring buffer is allocated when tracing is enabled
+    
+    Trace::setThreadName(realtimeThread->name);
+    
+    // prefault the free part of the stack below the current stack pointer, without a reserve above the guard page
+    
+    size_t freeStackSize = getFreeStackSize(realtimeThread->getStackSize());
+    
+    if (freeStackSize > 2*STACK_RESERVE) {
+        
+        prefaultStack(freeStackSize-STACK_RESERVE);
+        realtimeThread->stackPrefaulted = true;
+    }
+    
     realtimeThread->run();
 }
@@ -0,0 +1,250 @@
+/*
+ * Telemetry.cpp
+ * Copyright (c) 2026, ZHAW
+ * All rights reserved.
+ *
+ *  Created on: 17.10.2026
+ *      Author: Marcel Honegger
+ */
+
+#include <ctime>
+#include "AnalogIn.h"
+#include "AnalogOut.h"
+#include "DigitalIn.h"
+#include "DigitalOut.h"
+#include "EncoderCounter.h"
+#include "Telemetry.h"
+
+using namespace std;
+
+/**
+ * Creates a telemetry object without signals.
+ */
+Telemetry::Telemetry() {
+    
+    times = new atomic<int64_t>[SAMPLES];
+    values = NULL;
+    
+    for (uint32_t i = 0; i < SAMPLES; i++) times[i].store(0, memory_order_relaxed);
+    
+    next.store(0, memory_order_relaxed);
+    head.store(0, memory_order_relaxed);
+}
+
+/**
+ * Deletes the telemetry object and its ring buffer.
+ */
+Telemetry::~Telemetry() {
+    
+    delete[] times;
+    delete[] values;
+}
+
+/**
+ * Adds an analog input as a signal.
+ * @param analogIn a reference to the analog input, which must have a name.
+ */
+void Telemetry::add(AnalogIn& analogIn) {
+    
+    add(analogIn.getName(), ANALOG_IN, &analogIn, NULL);
+}
+
+/**
+ * Adds an analog output as a signal.
+ * @param analogOut a reference to the analog output, which must have a name.
+ */
+void Telemetry::add(AnalogOut& analogOut) {
+    
+    add(analogOut.getName(), ANALOG_OUT, &analogOut, NULL);
+}
+
+/**
+ * Adds a digital input as a signal, with the values 0 and 1.
+ * @param digitalIn a reference to the digital input, which must have a name.
+ */
+void Telemetry::add(DigitalIn& digitalIn) {
+    
+    add(digitalIn.getName(), DIGITAL_IN, &digitalIn, NULL);
+}
+
+/**
+ * Adds a digital output as a signal, with the values 0 and 1.
+ * @param digitalOut a reference to the digital output, which must have a name.
+ */
+void Telemetry::add(DigitalOut& digitalOut) {
+    
+    add(digitalOut.getName(), DIGITAL_OUT, &digitalOut, NULL);
+}
+
+/**
+ * Adds an encoder counter as a signal.
+ * @param encoderCounter a reference to the encoder counter, which must have a name.
+ */
+void Telemetry::add(EncoderCounter& encoderCounter) {
+    
+    add(encoderCounter.getName(), ENCODER_COUNTER, &encoderCounter, NULL);
+}
+
+/**
+ * Adds a variable as a signal, i.e. a setpoint or a state of a controller. The variable
+ * must only be written by the thread that calls the <code>sample()</code> method.
+ * @param name the name of the signal.
+ * @param value a reference to the variable.
+ */
+void Telemetry::add(string name, double& value) {
+    
+    add(name, VALUE, NULL, &value);
+}
+
+/**
+ * Gets the number of signals of this telemetry object.
+ * @return the number of signals.
+ */
+uint32_t Telemetry::getNumberOfSignals() {
+    
+    return static_cast<uint32_t>(signals.size());
+}
+
+/**
+ * Gets the name of a given signal.
+ * @param signal the index of the signal.
+ * @return the name of the signal, or an empty string if the index is not valid.
+ */
+string Telemetry::getName(uint32_t signal) {
+    
+    return (signal < signals.size()) ? signals[signal].name : "";
+}
+
+/**
+ * Gets the index of the signal with a given name.
+ * @param name the name of the signal.
+ * @return the index of the signal, or -1 if there is no signal with this name.
+ */
+int32_t Telemetry::getSignal(string name) {
+    
+    for (uint32_t i = 0; i < signals.size(); i++) {
+        if (signals[i].name.compare(name) == 0) return static_cast<int32_t>(i);
+    }
+    
+    return -1;
+}
+
+/**
+ * Samples the values of all signals, and writes them into the ring buffer with the current time.
+ * This method is called periodically by a realtime thread, and must only be called by one
+ * thread at a time.
+ */
+void Telemetry::sample() {
+    
+    timespec currentTime;
+    clock_gettime(CLOCK_MONOTONIC, &currentTime);
+    
+    // announce the sample before the slot is overwritten, so that a reader can discard the old sample
+    
+    uint64_t head = this->head.load(memory_order_relaxed);
+    next.store(head+1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    
+    uint32_t slot = static_cast<uint32_t>(head%SAMPLES);
+    uint32_t numberOfSignals = static_cast<uint32_t>(signals.size());
+    
+    times[slot].store(static_cast<int64_t>(currentTime.tv_sec)*1000000000LL+static_cast<int64_t>(currentTime.tv_nsec), memory_order_relaxed);
+    
+    for (uint32_t i = 0; i < numberOfSignals; i++) {
+        
+        Signal& signal = signals[i];
+        double value = 0.0;
+        
+        switch (signal.type) {
+            case ANALOG_IN: value = static_cast<AnalogIn*>(signal.channel)->read(); break;
+            case ANALOG_OUT: value = static_cast<AnalogOut*>(signal.channel)->read(); break;
+            case DIGITAL_IN: value = static_cast<DigitalIn*>(signal.channel)->read() ? 1.0 : 0.0; break;
+            case DIGITAL_OUT: value = static_cast<DigitalOut*>(signal.channel)->read() ? 1.0 : 0.0; break;
+            case ENCODER_COUNTER: value = static_cast<EncoderCounter*>(signal.channel)->read(); break;
+            case VALUE: value = *signal.value; break;
+        }
+        
+        values[slot*numberOfSignals+i].store(value, memory_order_relaxed);
+    }
+    
+    this->head.store(head+1, memory_order_release);
+}
+
+/**
+ * Gets the number of samples that were written since this telemetry object was created.
+ * @return the number of samples.
+ */
+uint64_t Telemetry::getNumberOfSamples() {
+    
+    return head.load(memory_order_acquire);
+}
+
+/**
+ * Copies the samples from a given sample number on. This method may be called by any thread
+ * while samples are written. Samples that were already overwritten are skipped.
+ * @param sample the number of the first sample to copy. This parameter is set to the number of
+ * the next sample, which isn't written yet.
+ * @param times a vector the times of the copied samples are appended to, given in [ns].
+ * @param values a vector the values of the copied samples are appended to, with the values of all
+ * signals for each sample.
+ * @return the number of copied samples.
+ */
+uint32_t Telemetry::read(uint64_t& sample, vector<int64_t>& times, vector<double>& values) {
+    
+    uint64_t head = this->head.load(memory_order_acquire);
+    uint32_t numberOfSignals = static_cast<uint32_t>(signals.size());
+    
+    if (head > sample+SAMPLES) sample = head-SAMPLES;
+    if (sample >= head) return 0;
+    
+    size_t numberOfTimes = times.size();
+    size_t numberOfValues = values.size();
+    
+    for (uint64_t i = sample; i < head; i++) {
+        uint32_t slot = static_cast<uint32_t>(i%SAMPLES);
+        times.push_back(this->times[slot].load(memory_order_relaxed));
+        for (uint32_t j = 0; j < numberOfSignals; j++) values.push_back(this->values[slot*numberOfSignals+j].load(memory_order_relaxed));
+    }
+    
+    atomic_thread_fence(memory_order_acquire);
+    
+    // discard the samples that were overwritten while they were copied
+    
+    uint64_t written = next.load(memory_order_relaxed);
+    uint64_t valid = (written > sample+SAMPLES) ? written-SAMPLES : sample;
+    
+    if (valid > head) valid = head;
+    
+    times.erase(times.begin()+numberOfTimes, times.begin()+numberOfTimes+(valid-sample));
+    values.erase(values.begin()+numberOfValues, values.begin()+numberOfValues+(valid-sample)*numberOfSignals);
+    
+    uint32_t n = static_cast<uint32_t>(head-valid);
+    sample = head;
+    
+    return n;
+}
+
+/**
+ * Adds a signal, and reallocates the ring buffer of values. This isn't synchronized with
+ * the <code>sample()</code> and <code>read()</code> methods, so signals can only be added
+ * before the first sample is written.
+ */
+void Telemetry::add(string name, Type type, Channel* channel, double* value) {
+    
+    if (head.load(memory_order_relaxed) > 0) throw runtime_error("Telemetry: signals can't be added after sampling started.");
+    if (name.size() == 0) throw runtime_error("Telemetry: a signal needs a name.");
+    if (getSignal(name) >= 0) throw runtime_error("Telemetry: a signal with the name '"+name+"' was already added.");
+    
+    Signal signal;
+    signal.name = name;
+    signal.type = type;
+    signal.channel = channel;
+    signal.value = value;
+    
+    signals.push_back(signal);
+    
+    delete[] values;
+    values = new atomic<double>[SAMPLES*signals.size()];
+    
+    for (uint32_t i = 0; i < SAMPLES*signals.size(); i++) values[i].store(0.0, memory_order_relaxed);
+}
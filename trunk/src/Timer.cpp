@@ -14,16 +14,36 @@ using namespace std;
 /**
  * Creates a timer object.
  */
-Timer::Timer() : RealtimeThread("Timer", STACK_SIZE, RealtimeThread::RT_MIN_PRIORITY, 0.001) {
+Timer::Timer() {
     
     // initialize local values
     
+    cyclicExecutor = NULL;
     time = 0;
     running = false;
     
     // start timer thread
     
-    RealtimeThread::start();
+    handler = new Handler(this);
+    handler->start();
+}
+
+/**
+ * Creates a timer object that is executed by a given cyclic executor.
+ * @param cyclicExecutor a reference to a cyclic executor, with a period that is 1 ms or a fraction thereof.
+ */
+Timer::Timer(CyclicExecutor& cyclicExecutor) {
+    
+    // initialize local values
+    
+    handler = NULL;
+    this->cyclicExecutor = &cyclicExecutor;
+    time = 0;
+    running = false;
+    
+    // register timer with the cyclic executor
+    
+    this->cyclicExecutor->addTask(*this, 0.001);
 }
 
 /**
@@ -31,7 +51,12 @@ Timer::Timer() : RealtimeThread("Timer", STACK_SIZE, RealtimeThread::RT_MIN_PRIO
  */
 Timer::~Timer() {
     
-    RealtimeThread::stop();
+    if (cyclicExecutor != NULL) cyclicExecutor->removeTask(*this);
+    
+    if (handler != NULL) {
+        handler->stop();
+        delete handler;
+    }
 }
 
 /**
@@ -74,13 +99,28 @@ Timer::operator uint32_t() {
 	return read();
 }
 
+/**
+ * Increments the time of the timer by 1 ms, if it is running.
+ */
+void Timer::execute() {
+    
+    if (running && (time < UINT32_MAX)) time++;
+}
+
+Timer::Handler::Handler(Timer* timer) : RealtimeThread("Timer", STACK_SIZE, RealtimeThread::RT_MIN_PRIORITY, 0.001) {
+    
+    this->timer = timer;
+}
+
+Timer::Handler::~Handler() {}
+
 /**
  * Implements the run logic of the timer.
  */
-void Timer::run() {
+void Timer::Handler::run() {
     
     while (waitForNextPeriod()) {
         
-        if (running && (time < UINT32_MAX)) time++;
+        timer->execute();
     }
 }
@@ -0,0 +1,381 @@
+/*
+ * Trace.cpp
+ * Copyright (c) 2026, ZHAW
+ * All rights reserved.
+ *
+ *  Created on: 17.10.2026
+ *      Author: Marcel Honegger
+ */
+
+#include <ctime>
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+#include <fstream>
+#include <unistd.h>
+#include "Trace.h"
+
+using namespace std;
+
+atomic<bool> Trace::enabled(false);
+pthread_mutex_t Trace::mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_once_t Trace::once = PTHREAD_ONCE_INIT;
+pthread_key_t Trace::key;
+vector<Trace::Thread*> Trace::threads;
+vector<Trace::Buffer*> Trace::buffers;
+thread_local Trace::Thread* Trace::thread = NULL;
+
+/**
+ * Begins a span with a given name.
+ * @param name the name of the span, which must be a string literal.
+ */
+Trace::Span::Span(const char* name) : name(name) {
+    
+    record(name, 'B');
+}
+
+/**
+ * Ends the span.
+ */
+Trace::Span::~Span() {
+    
+    record(name, 'E');
+}
+
+/**
+ * Enables the recording of events. This method allocates the ring buffers
+ * of all registered threads that don't have one yet.
+ */
+void Trace::enable() {
+    
+    pthread_mutex_lock(&mutex);
+    
+    for (vector<Thread*>::iterator thread = threads.begin(); thread != threads.end(); thread++) {
+        if ((*thread)->buffer.load(memory_order_relaxed) == NULL) (*thread)->buffer.store(allocateBuffer(*thread), memory_order_release);
+    }
+    
+    pthread_mutex_unlock(&mutex);
+    
+    enabled.store(true, memory_order_relaxed);
+}
+
+/**
+ * Disables the recording of events. Events that were already recorded are kept.
+ */
+void Trace::disable() {
+    
+    enabled.store(false, memory_order_relaxed);
+}
+
+/**
+ * Tests if the recording of events is enabled.
+ * @return <code>true</code> if events are recorded, <code>false</code> otherwise.
+ */
+bool Trace::isEnabled() {
+    
+    return enabled.load(memory_order_relaxed);
+}
+
+/**
+ * Registers the calling thread with a given name. The name is shown on the timeline
+ * of the trace. This method only allocates the ring buffer of the calling thread if
+ * tracing is enabled.
+ * @param threadName the name of the calling thread.
+ */
+void Trace::setThreadName(string threadName) {
+    
+    Thread* thread = getThread();
+    
+    pthread_mutex_lock(&mutex);
+    
+    thread->threadName = threadName;
+    
+    Buffer* buffer = thread->buffer.load(memory_order_relaxed);
+    if (buffer != NULL) buffer->threadName = threadName;
+    else if (enabled.load(memory_order_relaxed)) thread->buffer.store(allocateBuffer(thread), memory_order_release);
+    
+    pthread_mutex_unlock(&mutex);
+}
+
+/**
+ * Records the beginning of a span with a given name.
+ * @param name the name of the span, which must be a string literal.
+ */
+void Trace::begin(const char* name) {
+    
+    record(name, 'B');
+}
+
+/**
+ * Records the end of a span with a given name. Spans of a thread must be nested,
+ * so this ends the span that was begun last.
+ * @param name the name of the span, which must be a string literal.
+ */
+void Trace::end(const char* name) {
+    
+    record(name, 'E');
+}
+
+/**
+ * Records an instant event with a given name, i.e. the reception of a message.
+ * @param name the name of the event, which must be a string literal.
+ */
+void Trace::instant(const char* name) {
+    
+    record(name, 'i');
+}
+
+/**
+ * Discards all events that were recorded so far. The ring buffers of threads
+ * that exited may then be reused by other threads.
+ */
+void Trace::clear() {
+    
+    pthread_mutex_lock(&mutex);
+    
+    for (vector<Buffer*>::iterator buffer = buffers.begin(); buffer != buffers.end(); buffer++) {
+        (*buffer)->tail.store((*buffer)->head.load(memory_order_acquire), memory_order_relaxed);
+    }
+    
+    pthread_mutex_unlock(&mutex);
+}
+
+/**
+ * Gets the recorded events in the JSON trace event format. Events may be recorded by other
+ * threads while this method reads them; events that were overwritten in the meantime are
+ * discarded, as well as the ends of spans whose beginnings were already overwritten.
+ * @return a string with a JSON object.
+ */
+string Trace::toJSON() {
+    
+    stringstream out;
+    out.precision(3);
+    out << fixed;
+    
+    int32_t pid = static_cast<int32_t>(getpid());
+    bool first = true;
+    
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    
+    pthread_mutex_lock(&mutex);
+    
+    for (vector<Buffer*>::iterator buffer = buffers.begin(); buffer != buffers.end(); buffer++) {
+        
+        // copy the events of this buffer, and check which of them weren't overwritten in the meantime
+        
+        uint64_t head = (*buffer)->head.load(memory_order_acquire);
+        uint64_t tail = (*buffer)->tail.load(memory_order_relaxed);
+        if ((*buffer)->released && (head == tail)) continue;
+        if (head > tail+EVENTS) tail = head-EVENTS;
+        
+        vector<int64_t> times;
+        vector<const char*> names;
+        vector<char> phases;
+        
+        for (uint64_t i = tail; i < head; i++) {
+            Event& event = (*buffer)->events[i%EVENTS];
+            times.push_back(event.time.load(memory_order_relaxed));
+            names.push_back(event.name.load(memory_order_relaxed));
+            phases.push_back(event.phase.load(memory_order_relaxed));
+        }
+        
+        atomic_thread_fence(memory_order_acquire);
+        
+        uint64_t written = (*buffer)->next.load(memory_order_relaxed);
+        uint64_t valid = (written > tail+EVENTS) ? written-EVENTS : tail;
+        
+        // write the name of the thread, and its events
+        
+        string threadName;
+        for (string::iterator c = (*buffer)->threadName.begin(); c != (*buffer)->threadName.end(); c++) {
+            if ((*c == '"') || (*c == '\\')) threadName += '\\';
+            if (static_cast<unsigned char>(*c) >= 0x20) threadName += *c;
+        }
+        
+        out << (first ? "" : ",") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << (*buffer)->threadID << ",\"args\":{\"name\":\"" << threadName << "\"}}";
+        first = false;
+        
+        uint32_t depth = 0;
+        
+        for (uint64_t i = max(tail, valid); i < head; i++) {
+            
+            uint64_t j = i-tail;
+            
+            if (phases[j] == 'B') depth++;
+            else if (phases[j] == 'E') {
+                if (depth == 0) continue;
+                depth--;
+            }
+            
+            out << ",{\"name\":\"" << names[j] << "\",\"ph\":\"" << phases[j] << "\",";
+            if (phases[j] == 'i') out << "\"s\":\"t\",";
+            out << "\"ts\":" << static_cast<double>(times[j])/1000.0 << ",\"pid\":" << pid << ",\"tid\":" << (*buffer)->threadID << "}";
+        }
+    }
+    
+    pthread_mutex_unlock(&mutex);
+    
+    out << "]}";
+    
+    return out.str();
+}
+
+/**
+ * Writes the recorded events into a file with the JSON trace event format.
+ * @param filename the name of the file, i.e. '/tmp/trace.json'.
+ */
+void Trace::write(string filename) {
+    
+    ofstream file(filename.c_str());
+    if (!file) throw runtime_error("Trace: couldn't open file '"+filename+"'.");
+    
+    file << toJSON();
+    file.close();
+    
+    if (!file) throw runtime_error("Trace: couldn't write file '"+filename+"'.");
+}
+
+/**
+ * Creates the key with the destructor that releases a thread when it exits.
+ */
+void Trace::createKey() {
+    
+    pthread_key_create(&key, releaseThread);
+}
+
+/**
+ * Releases a thread that exits. Its ring buffer is kept until its events are
+ * cleared, and may then be reused by another thread.
+ * @param thread a pointer to the thread.
+ */
+void Trace::releaseThread(void* thread) {
+    
+    Thread* exitingThread = static_cast<Thread*>(thread);
+    
+    pthread_mutex_lock(&mutex);
+    
+    threads.erase(find(threads.begin(), threads.end(), exitingThread));
+    
+    Buffer* buffer = exitingThread->buffer.load(memory_order_relaxed);
+    if (buffer != NULL) buffer->released = true;
+    
+    pthread_mutex_unlock(&mutex);
+    
+    Trace::thread = NULL;
+    
+    delete exitingThread;
+}
+
+/**
+ * Gets the calling thread, and registers it if needed.
+ * @return a pointer to the thread.
+ */
+Trace::Thread* Trace::getThread() {
+    
+    if (thread == NULL) {
+        
+        pthread_once(&once, createKey);
+        
+        Thread* thread = new Thread();
+        thread->buffer.store(NULL, memory_order_relaxed);
+        
+        pthread_mutex_lock(&mutex);
+        threads.push_back(thread);
+        pthread_mutex_unlock(&mutex);
+        
+        pthread_setspecific(key, thread);
+        
+        Trace::thread = thread;
+    }
+    
+    return thread;
+}
+
+/**
+ * Gets the ring buffer of the calling thread, and allocates it if needed.
+ * @return a pointer to the ring buffer.
+ */
+Trace::Buffer* Trace::getBuffer() {
+    
+    Thread* thread = getThread();
+    
+    Buffer* buffer = thread->buffer.load(memory_order_acquire);
+    
+    if (buffer == NULL) {
+        
+        pthread_mutex_lock(&mutex);
+        
+        buffer = thread->buffer.load(memory_order_relaxed);
+        if (buffer == NULL) {
+            buffer = allocateBuffer(thread);
+            thread->buffer.store(buffer, memory_order_release);
+        }
+        
+        pthread_mutex_unlock(&mutex);
+    }
+    
+    return buffer;
+}
+
+/**
+ * Allocates a ring buffer for a given thread. This method reuses the buffer of
+ * a thread that exited, if its events were cleared, or creates a new buffer.
+ * The mutex must be locked by the caller.
+ * @param thread the thread the buffer is allocated for.
+ * @return a pointer to the ring buffer.
+ */
+Trace::Buffer* Trace::allocateBuffer(Thread* thread) {
+    
+    Buffer* buffer = NULL;
+    
+    for (vector<Buffer*>::iterator released = buffers.begin(); (buffer == NULL) && (released != buffers.end()); released++) {
+        if ((*released)->released && ((*released)->head.load(memory_order_relaxed) == (*released)->tail.load(memory_order_relaxed))) buffer = *released;
+    }
+    
+    if (buffer == NULL) {
+        
+        buffer = new Buffer();
+        
+        buffer->next.store(0, memory_order_relaxed);
+        buffer->head.store(0, memory_order_relaxed);
+        buffer->tail.store(0, memory_order_relaxed);
+        buffer->threadID = static_cast<uint32_t>(buffers.size()+1);
+        
+        buffers.push_back(buffer);
+    }
+    
+    buffer->released = false;
+    buffer->threadName = thread->threadName.empty() ? "Thread "+to_string(buffer->threadID) : thread->threadName;
+    
+    return buffer;
+}
+
+/**
+ * Records an event of the calling thread with the current time, if recording is enabled.
+ * @param name the name of the event.
+ * @param phase the phase of the event.
+ */
+void Trace::record(const char* name, char phase) {
+    
+    if (!enabled.load(memory_order_relaxed)) return;
+    
+    Buffer* buffer = (thread != NULL) ? thread->buffer.load(memory_order_acquire) : NULL;
+    if (buffer == NULL) buffer = getBuffer();
+    
+    timespec currentTime;
+    clock_gettime(CLOCK_MONOTONIC, &currentTime);
+    
+    // announce the event before the slot is overwritten, so that a reader can discard the old event
+    
+    uint64_t head = buffer->head.load(memory_order_relaxed);
+    buffer->next.store(head+1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    
+    Event& event = buffer->events[head%EVENTS];
+    
+    event.time.store(static_cast<int64_t>(currentTime.tv_sec)*1000000000LL+static_cast<int64_t>(currentTime.tv_nsec), memory_order_relaxed);
+    event.name.store(name, memory_order_relaxed);
+    event.phase.store(phase, memory_order_relaxed);
+    
+    buffer->head.store(head+1, memory_order_release);
+}
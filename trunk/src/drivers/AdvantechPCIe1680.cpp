@@ -24,7 +24,7 @@ const uint16_t AdvantechPCIe1680::CHIP_OFFSET[] = {0x0000, 0x0400};
  * bus. '0' is the first board of this type, '1' the second, and so on.
  * @param port the port number to use, either 0 or 1.
  */
-AdvantechPCIe1680::AdvantechPCIe1680(PCI& pci, uint16_t number, uint16_t port) : RealtimeThread("AdvantechPCIe1680", STACK_SIZE, PRIORITY, PERIOD), pci(pci) {
+AdvantechPCIe1680::AdvantechPCIe1680(PCI& pci, uint16_t number, uint16_t port) : RealtimeThread("AdvantechPCIe1680", STACK_SIZE, PRIORITY, PERIOD), pci(pci), messagesToTransmit(BUFFER_SIZE), receivedMessages(BUFFER_SIZE) {
     
     // get base address
     
@@ -151,20 +151,7 @@ void AdvantechPCIe1680::frequency(uint32_t hz) {
  */
 int32_t AdvantechPCIe1680::write(CANMessage canMessage) {
     
-    if (messagesToTransmit.size() < BUFFER_SIZE) {
-        
-        mutex.lock();
-        
-        messagesToTransmit.push_back(canMessage);
-        
-        mutex.unlock();
-        
-        return 1;
-        
-    } else {
-        
-        return 0;
-    }
+    return messagesToTransmit.write(canMessage) ? 1 : 0;
 }
 
 /**
@@ -175,25 +162,27 @@ int32_t AdvantechPCIe1680::write(CANMessage canMessage) {
 
 int32_t AdvantechPCIe1680::read(CANMessage& canMessage) {
     
-    if (receivedMessages.size() > 0) {
-        
-        mutex.lock();
-        
-        CANMessage canMessageOnStack = receivedMessages.front();
-        canMessage.id = canMessageOnStack.id;
-        for (uint8_t i = 0; i < 8; i++) canMessage.data[i] = canMessageOnStack.data[i];
-        canMessage.len = canMessageOnStack.len;
-        canMessage.type = canMessageOnStack.type;
-        receivedMessages.pop_front();
-        
-        mutex.unlock();
-        
-        return 1;
-        
-    } else {
-        
-        return 0;
-    }
+    return receivedMessages.read(canMessage) ? 1 : 0;
+}
+
+/**
+ * Gets the number of messages that couldn't be written for transmission because
+ * the software transmit buffer of this CAN driver was full.
+ * @return the number of rejected messages to transmit.
+ */
+uint32_t AdvantechPCIe1680::getTransmitOverflows() {
+    
+    return messagesToTransmit.getOverflows();
+}
+
+/**
+ * Gets the number of received messages that were discarded because
+ * the software receive buffer of this CAN driver was full.
+ * @return the number of discarded received messages.
+ */
+uint32_t AdvantechPCIe1680::getReceiveOverflows() {
+    
+    return receivedMessages.getOverflows();
 }
 
 /**
@@ -260,19 +249,11 @@ void AdvantechPCIe1680::run() {
         
         // tries to write a message from the software transmit buffer to the CAN bus
         
-        if (messagesToTransmit.size() > 0) {
+        if ((pci.in8(baseAddress+SR) & 0x04) != 0) {
             
-            if ((pci.in8(baseAddress+SR) & 0x04) != 0) {
-                
-                mutex.lock();
-                
-                CANMessage canMessage(messagesToTransmit.front());
-				messagesToTransmit.pop_front();
-                
-                mutex.unlock();
-                
-                transmit(canMessage);
-            }
+            CANMessage canMessage;
+            
+            if (messagesToTransmit.read(canMessage)) transmit(canMessage);
         }
         
         // tries to read a messages from the hardware receive buffer
@@ -282,18 +263,7 @@ void AdvantechPCIe1680::run() {
         
         while (received) {
             
-            if (receivedMessages.size() < BUFFER_SIZE) {
-            
-                mutex.lock();
-                
-                receivedMessages.push_back(canMessage);
-                
-                mutex.unlock();
-                
-            } else {
-                
-                // software receive buffer is full, discard message
-            }
+            receivedMessages.write(canMessage);   // the message is discarded if the software receive buffer is full
             
             received = receive(canMessage);
         }
@@ -24,134 +24,17 @@ BeckhoffEL1000::BeckhoffEL1000(EtherCAT& etherCAT, CoE& coe, uint16_t deviceAddr
     
     inputBuffer = 0x0000;
     
-    // set EtherCAT state machine to state INIT
+    // configure SYNC managers
     
-    uint16_t loop = 0;
-    uint16_t state = 0;
-    while ((state != EtherCAT::STATE_INIT) && (loop++ < 100)) try {
-        state = etherCAT.read16(deviceAddress, EtherCAT::APPLICATION_LAYER_STATUS);
-        Thread::sleep(10);
-        if ((state & EtherCAT::STATE_ERROR_MASK) == EtherCAT::STATE_ERROR) {
-            etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, state & EtherCAT::STATE_MASK);
-            Thread::sleep(10);
-            etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, state);
-        } else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_BOOTSTRAP) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_INIT);
-        else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_PRE_OPERATIONAL) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_INIT);
-        else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_SAFE_OPERATIONAL) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_PRE_OPERATIONAL);
-        else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_OPERATIONAL) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_SAFE_OPERATIONAL);
-        Thread::sleep(10);
-    } catch (exception& e) {
-        cerr << e.what() << endl;
-    }
-    if (state != EtherCAT::STATE_INIT) {
-        try {
-            uint16_t statusCode = etherCAT.read16(deviceAddress, EtherCAT::APPLICATION_LAYER_STATUS_CODE);
-            cerr << "BeckhoffEL1000: APPLICATION_LAYER_STATUS_CODE=0x" << hex << statusCode << endl;
-        } catch (exception& e) {}
-        throw runtime_error("BeckhoffEL1000: couldn't enter state INIT.");
-    }
-    
-    Thread::sleep(10);
-    
-    // initialize SYNC managers
-    
-    etherCAT.write8(deviceAddress, EtherCAT::SYNC_MANAGER_ACTIVATE+0*EtherCAT::SYNC_MANAGER_OFFSET, 0);
-    Thread::sleep(10);
-    etherCAT.write16(deviceAddress, EtherCAT::SYNC_MANAGER+0*EtherCAT::SYNC_MANAGER_OFFSET, BUFFERED_IN_ADDRESS);
-    Thread::sleep(10);
-    etherCAT.write16(deviceAddress, EtherCAT::SYNC_MANAGER_LENGTH+0*EtherCAT::SYNC_MANAGER_OFFSET, BUFFERED_IN_SIZE);
-    Thread::sleep(10);
-    etherCAT.write8(deviceAddress, EtherCAT::SYNC_MANAGER_CONTROL+0*EtherCAT::SYNC_MANAGER_OFFSET, 0x00);    // read, no interrupt in PDI
-    Thread::sleep(10);
-    etherCAT.write8(deviceAddress, EtherCAT::SYNC_MANAGER_ACTIVATE+0*EtherCAT::SYNC_MANAGER_OFFSET, 1);
-    Thread::sleep(10);
-    
-    // set EtherCAT state machine to state PRE OPERATIONAL
-    
-    loop = 0;
-    state = 0;
-    while ((state != EtherCAT::STATE_PRE_OPERATIONAL) && (loop++ < 100)) try {
-        state = etherCAT.read16(deviceAddress, EtherCAT::APPLICATION_LAYER_STATUS);
-        Thread::sleep(10);
-        if ((state & EtherCAT::STATE_ERROR_MASK) == EtherCAT::STATE_ERROR) {
-            etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, state & EtherCAT::STATE_MASK);
-            Thread::sleep(10);
-            etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, state);
-        } else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_INIT) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_PRE_OPERATIONAL);
-        else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_BOOTSTRAP) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_INIT);
-        else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_SAFE_OPERATIONAL) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_PRE_OPERATIONAL);
-        else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_OPERATIONAL) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_SAFE_OPERATIONAL);
-        Thread::sleep(10);
-    } catch (exception& e) {
-        cerr << e.what() << endl;
-    }
-    if (state != EtherCAT::STATE_PRE_OPERATIONAL) {
-        try {
-            uint16_t statusCode = etherCAT.read16(deviceAddress, EtherCAT::APPLICATION_LAYER_STATUS_CODE);
-            cerr << "BeckhoffEL1000: APPLICATION_LAYER_STATUS_CODE=0x" << hex << statusCode << endl;
-        } catch (exception& e) {}
-        throw runtime_error("BeckhoffEL1000: couldn't enter state PRE OPERATIONAL.");
-    }
-    
-    // register process datagram
-    
-    coe.registerDatagram(txPDO = new EtherCAT::Datagram(EtherCAT::COMMAND_APRD, deviceAddress, BUFFERED_IN_ADDRESS, BUFFERED_IN_SIZE));
-    
-    coe.addSlaveDevice(this);
+    coe.configureSyncManager(deviceAddress, 0, BUFFERED_IN_ADDRESS, BUFFERED_IN_SIZE, 0x00, true);   // read, no interrupt in PDI
     
-    // set EtherCAT state machine to state SAFE OPERATIONAL
+    // register process data
     
-    loop = 0;
-    state = 0;
-    while ((state != EtherCAT::STATE_SAFE_OPERATIONAL) && (loop++ < 100)) try {
-        state = etherCAT.read16(deviceAddress, EtherCAT::APPLICATION_LAYER_STATUS);
-        Thread::sleep(10);
-        if ((state & EtherCAT::STATE_ERROR_MASK) == EtherCAT::STATE_ERROR) {
-            etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, state & EtherCAT::STATE_MASK);
-            Thread::sleep(10);
-            etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, state);
-        } else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_INIT) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_PRE_OPERATIONAL);
-        else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_BOOTSTRAP) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_INIT);
-        else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_PRE_OPERATIONAL) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_SAFE_OPERATIONAL);
-        else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_OPERATIONAL) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_SAFE_OPERATIONAL);
-        Thread::sleep(10);
-    } catch (exception& e) {
-        cerr << e.what() << endl;
-    }
-    if (state != EtherCAT::STATE_SAFE_OPERATIONAL) {
-        try {
-            uint16_t statusCode = etherCAT.read16(deviceAddress, EtherCAT::APPLICATION_LAYER_STATUS_CODE);
-            cerr << "BeckhoffEL1000: APPLICATION_LAYER_STATUS_CODE=0x" << hex << statusCode << endl;
-        } catch (exception& e) {}
-        throw runtime_error("BeckhoffEL1000: couldn't enter state SAFE OPERATIONAL.");
-    }
+    txPDO = coe.registerProcessData(deviceAddress, BUFFERED_IN_ADDRESS, BUFFERED_IN_SIZE, EtherCAT::FMMU_TYPE_READ);
     
-    // set EtherCAT state machine to state OPERATIONAL
+    // register this slave device and bring it up
     
-    loop = 0;
-    state = 0;
-    while ((state != EtherCAT::STATE_OPERATIONAL) && (loop++ < 100)) try {
-        state = etherCAT.read16(deviceAddress, EtherCAT::APPLICATION_LAYER_STATUS);
-        Thread::sleep(10);
-        if ((state & EtherCAT::STATE_ERROR_MASK) == EtherCAT::STATE_ERROR) {
-            etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, state & EtherCAT::STATE_MASK);
-            Thread::sleep(10);
-            etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, state);
-        } else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_INIT) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_PRE_OPERATIONAL);
-        else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_BOOTSTRAP) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_INIT);
-        else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_PRE_OPERATIONAL) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_SAFE_OPERATIONAL);
-        else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_SAFE_OPERATIONAL) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_OPERATIONAL);
-        Thread::sleep(10);
-    } catch (exception& e) {
-        cerr << e.what() << endl;
-    }
-    if (state != EtherCAT::STATE_OPERATIONAL) {
-        try {
-            uint16_t statusCode = etherCAT.read16(deviceAddress, EtherCAT::APPLICATION_LAYER_STATUS_CODE);
-            cerr << "BeckhoffEL1000: APPLICATION_LAYER_STATUS_CODE=0x" << hex << statusCode << endl;
-        } catch (exception& e) {}
-        throw runtime_error("BeckhoffEL1000: couldn't enter state OPERATIONAL.");
-    }
+    coe.addSlaveDevice(this, deviceAddress);
 }
 
 /**
@@ -197,7 +80,7 @@ void BeckhoffEL1000::readDatagram() {
     
     mutex.lock();
     
-    inputBuffer = txPDO->data[10];
+    inputBuffer = txPDO->read8(0);
     
     mutex.unlock();
 }
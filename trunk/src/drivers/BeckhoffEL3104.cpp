@@ -26,167 +26,20 @@ BeckhoffEL3104::BeckhoffEL3104(EtherCAT& etherCAT, CoE& coe, uint16_t deviceAddr
         inputBuffer[i] = 0;
     }
 
-    // set EtherCAT state machine to state INIT
-
-    uint16_t loop = 0;
-    uint16_t state = 0;
-    while ((state != EtherCAT::STATE_INIT) && (loop++ < 100)) try {
-        state = etherCAT.read16(deviceAddress, EtherCAT::APPLICATION_LAYER_STATUS);
-        Thread::sleep(10);
-        if ((state & EtherCAT::STATE_ERROR_MASK) == EtherCAT::STATE_ERROR) {
-            etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, state & EtherCAT::STATE_MASK);
-            Thread::sleep(10);
-            etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, state);
-        } else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_BOOTSTRAP) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_INIT);
-        else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_PRE_OPERATIONAL) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_INIT);
-        else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_SAFE_OPERATIONAL) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_PRE_OPERATIONAL);
-        else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_OPERATIONAL) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_SAFE_OPERATIONAL);
-        Thread::sleep(10);
-    } catch (exception& e) {
-        cerr << e.what() << endl;
-    }
-    if (state != EtherCAT::STATE_INIT) {
-        try {
-            uint16_t statusCode = etherCAT.read16(deviceAddress, EtherCAT::APPLICATION_LAYER_STATUS_CODE);
-            cerr << "BeckhoffEL3104: APPLICATION_LAYER_STATUS_CODE=0x" << hex << statusCode << endl;
-        } catch (exception& e) {}
-        throw runtime_error("BeckhoffEL3104: couldn't enter state INIT.");
-    }
+    // configure SYNC managers
 
-    Thread::sleep(10);
-
-    // initialize SYNC managers
-
-    etherCAT.write8(deviceAddress, EtherCAT::SYNC_MANAGER_ACTIVATE+0*EtherCAT::SYNC_MANAGER_OFFSET, 0);
-    Thread::sleep(10);
-    etherCAT.write16(deviceAddress, EtherCAT::SYNC_MANAGER+0*EtherCAT::SYNC_MANAGER_OFFSET, MAILBOX_OUT_ADDRESS);
-    Thread::sleep(10);
-    etherCAT.write16(deviceAddress, EtherCAT::SYNC_MANAGER_LENGTH+0*EtherCAT::SYNC_MANAGER_OFFSET, MAILBOX_OUT_SIZE);
-    Thread::sleep(10);
-    etherCAT.write8(deviceAddress, EtherCAT::SYNC_MANAGER_CONTROL+0*EtherCAT::SYNC_MANAGER_OFFSET, 0x26);   // mailbox, write, interrupt in PDI
-    Thread::sleep(10);
-    etherCAT.write8(deviceAddress, EtherCAT::SYNC_MANAGER_ACTIVATE+0*EtherCAT::SYNC_MANAGER_OFFSET, 1);
-    Thread::sleep(10);
-
-    etherCAT.write8(deviceAddress, EtherCAT::SYNC_MANAGER_ACTIVATE+1*EtherCAT::SYNC_MANAGER_OFFSET, 0);
-    Thread::sleep(10);
-    etherCAT.write16(deviceAddress, EtherCAT::SYNC_MANAGER+1*EtherCAT::SYNC_MANAGER_OFFSET, MAILBOX_IN_ADDRESS);
-    Thread::sleep(10);
-    etherCAT.write16(deviceAddress, EtherCAT::SYNC_MANAGER_LENGTH+1*EtherCAT::SYNC_MANAGER_OFFSET, MAILBOX_IN_SIZE);
-    Thread::sleep(10);
-    etherCAT.write8(deviceAddress, EtherCAT::SYNC_MANAGER_CONTROL+1*EtherCAT::SYNC_MANAGER_OFFSET, 0x22);   // mailbox, read, interrupt in PDI
-    Thread::sleep(10);
-    etherCAT.write8(deviceAddress, EtherCAT::SYNC_MANAGER_ACTIVATE+1*EtherCAT::SYNC_MANAGER_OFFSET, 1);
-    Thread::sleep(10);
-
-    etherCAT.write8(deviceAddress, EtherCAT::SYNC_MANAGER_ACTIVATE+2*EtherCAT::SYNC_MANAGER_OFFSET, 0);
-    Thread::sleep(10);
-    etherCAT.write16(deviceAddress, EtherCAT::SYNC_MANAGER+2*EtherCAT::SYNC_MANAGER_OFFSET, BUFFERED_OUT_ADDRESS);
-    Thread::sleep(10);
-    etherCAT.write16(deviceAddress, EtherCAT::SYNC_MANAGER_LENGTH+2*EtherCAT::SYNC_MANAGER_OFFSET, BUFFERED_OUT_SIZE);
-    Thread::sleep(10);
-    etherCAT.write8(deviceAddress, EtherCAT::SYNC_MANAGER_CONTROL+2*EtherCAT::SYNC_MANAGER_OFFSET, 0x04);   // buffered, write
-    Thread::sleep(10);
-    etherCAT.write8(deviceAddress, EtherCAT::SYNC_MANAGER_ACTIVATE+2*EtherCAT::SYNC_MANAGER_OFFSET, 0);     // do not enable
-    Thread::sleep(10);
-
-    etherCAT.write8(deviceAddress, EtherCAT::SYNC_MANAGER_ACTIVATE+3*EtherCAT::SYNC_MANAGER_OFFSET, 0);
-    Thread::sleep(10);
-    etherCAT.write16(deviceAddress, EtherCAT::SYNC_MANAGER+3*EtherCAT::SYNC_MANAGER_OFFSET, BUFFERED_IN_ADDRESS);
-    Thread::sleep(10);
-    etherCAT.write16(deviceAddress, EtherCAT::SYNC_MANAGER_LENGTH+3*EtherCAT::SYNC_MANAGER_OFFSET, BUFFERED_IN_SIZE);
-    Thread::sleep(10);
-    etherCAT.write8(deviceAddress, EtherCAT::SYNC_MANAGER_CONTROL+3*EtherCAT::SYNC_MANAGER_OFFSET, 0x20);   // buffered, read, interrupt in PDI
-    Thread::sleep(10);
-    etherCAT.write8(deviceAddress, EtherCAT::SYNC_MANAGER_ACTIVATE+3*EtherCAT::SYNC_MANAGER_OFFSET, 1);
-    Thread::sleep(10);
-
-    // set EtherCAT state machine to state PRE OPERATIONAL
-
-    loop = 0;
-    state = 0;
-    while ((state != EtherCAT::STATE_PRE_OPERATIONAL) && (loop++ < 100)) try {
-        state = etherCAT.read16(deviceAddress, EtherCAT::APPLICATION_LAYER_STATUS);
-        Thread::sleep(10);
-        if ((state & EtherCAT::STATE_ERROR_MASK) == EtherCAT::STATE_ERROR) {
-            etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, state & EtherCAT::STATE_MASK);
-            Thread::sleep(10);
-            etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, state);
-        } else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_INIT) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_PRE_OPERATIONAL);
-        else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_BOOTSTRAP) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_INIT);
-        else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_SAFE_OPERATIONAL) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_PRE_OPERATIONAL);
-        else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_OPERATIONAL) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_SAFE_OPERATIONAL);
-        Thread::sleep(10);
-    } catch (exception& e) {
-        cerr << e.what() << endl;
-    }
-    if (state != EtherCAT::STATE_PRE_OPERATIONAL) {
-        try {
-            uint16_t statusCode = etherCAT.read16(deviceAddress, EtherCAT::APPLICATION_LAYER_STATUS_CODE);
-            cerr << "BeckhoffEL3104: APPLICATION_LAYER_STATUS_CODE=0x" << hex << statusCode << endl;
-        } catch (exception& e) {}
-        throw runtime_error("BeckhoffEL3104: couldn't enter state PRE OPERATIONAL.");
-    }
+    coe.configureSyncManager(deviceAddress, 0, MAILBOX_OUT_ADDRESS, MAILBOX_OUT_SIZE, 0x26, true);   // mailbox, write, interrupt in PDI
+    coe.configureSyncManager(deviceAddress, 1, MAILBOX_IN_ADDRESS, MAILBOX_IN_SIZE, 0x22, true);   // mailbox, read, interrupt in PDI
+    coe.configureSyncManager(deviceAddress, 2, BUFFERED_OUT_ADDRESS, BUFFERED_OUT_SIZE, 0x04, false);   // buffered, write
+    coe.configureSyncManager(deviceAddress, 3, BUFFERED_IN_ADDRESS, BUFFERED_IN_SIZE, 0x20, true);   // buffered, read, interrupt in PDI
 
-    // register process datagram
-
-    coe.registerDatagram(txPDO = new EtherCAT::Datagram(EtherCAT::COMMAND_APRD, deviceAddress, BUFFERED_IN_ADDRESS, BUFFERED_IN_SIZE));
-
-    coe.addSlaveDevice(this);
-
-    // set EtherCAT state machine to state SAFE OPERATIONAL
-
-    loop = 0;
-    state = 0;
-    while ((state != EtherCAT::STATE_SAFE_OPERATIONAL) && (loop++ < 100)) try {
-        state = etherCAT.read16(deviceAddress, EtherCAT::APPLICATION_LAYER_STATUS);
-        Thread::sleep(10);
-        if ((state & EtherCAT::STATE_ERROR_MASK) == EtherCAT::STATE_ERROR) {
-            etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, state & EtherCAT::STATE_MASK);
-            Thread::sleep(10);
-            etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, state);
-        } else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_INIT) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_PRE_OPERATIONAL);
-        else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_BOOTSTRAP) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_INIT);
-        else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_PRE_OPERATIONAL) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_SAFE_OPERATIONAL);
-        else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_OPERATIONAL) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_SAFE_OPERATIONAL);
-        Thread::sleep(10);
-    } catch (exception& e) {
-        cerr << e.what() << endl;
-    }
-    if (state != EtherCAT::STATE_SAFE_OPERATIONAL) {
-        try {
-            uint16_t statusCode = etherCAT.read16(deviceAddress, EtherCAT::APPLICATION_LAYER_STATUS_CODE);
-            cerr << "BeckhoffEL3104: APPLICATION_LAYER_STATUS_CODE=0x" << hex << statusCode << endl;
-        } catch (exception& e) {}
-        throw runtime_error("BeckhoffEL3104: couldn't enter state SAFE OPERATIONAL.");
-    }
+    // register process data
 
-    // set EtherCAT state machine to state OPERATIONAL
-
-    loop = 0;
-    state = 0;
-    while ((state != EtherCAT::STATE_OPERATIONAL) && (loop++ < 100)) try {
-        state = etherCAT.read16(deviceAddress, EtherCAT::APPLICATION_LAYER_STATUS);
-        Thread::sleep(10);
-        if ((state & EtherCAT::STATE_ERROR_MASK) == EtherCAT::STATE_ERROR) {
-            etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, state & EtherCAT::STATE_MASK);
-            Thread::sleep(10);
-            etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, state);
-        } else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_INIT) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_PRE_OPERATIONAL);
-        else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_BOOTSTRAP) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_INIT);
-        else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_PRE_OPERATIONAL) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_SAFE_OPERATIONAL);
-        else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_SAFE_OPERATIONAL) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_OPERATIONAL);
-        Thread::sleep(10);
-    } catch (exception& e) {
-        cerr << e.what() << endl;
-    }
-    if (state != EtherCAT::STATE_OPERATIONAL) {
-        try {
-            uint16_t statusCode = etherCAT.read16(deviceAddress, EtherCAT::APPLICATION_LAYER_STATUS_CODE);
-            cerr << "BeckhoffEL3104: APPLICATION_LAYER_STATUS_CODE=0x" << hex << statusCode << endl;
-        } catch (exception& e) {}
-        throw runtime_error("BeckhoffEL3104: couldn't enter state OPERATIONAL.");
-    }
+    txPDO = coe.registerProcessData(deviceAddress, BUFFERED_IN_ADDRESS, BUFFERED_IN_SIZE, EtherCAT::FMMU_TYPE_READ);
+
+    // register this slave device and bring it up
+
+    coe.addSlaveDevice(this, deviceAddress);
 }
 
 /**
@@ -233,7 +86,7 @@ void BeckhoffEL3104::readDatagram() {
 
     for (uint16_t i = 0; i < NUMBER_OF_ANALOG_INPUTS; i++) {
 
-        inputBuffer[i] = (static_cast<int16_t>(txPDO->data[12+4*i]) & 0xFF) | ((static_cast<int16_t>(txPDO->data[13+4*i]) & 0xFF) << 8);
+        inputBuffer[i] = static_cast<int16_t>(txPDO->read16(2+4*i));
     }
 
     mutex.unlock();
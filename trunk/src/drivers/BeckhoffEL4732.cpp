@@ -19,7 +19,7 @@ using namespace std;
  * @param deviceAddress the relative device address, i.e. 0x0000, 0xFFFF, 0xFFFE, etc.
  * @param period the period of the DC clock, given in [s].
  */
-BeckhoffEL4732::BeckhoffEL4732(EtherCAT& etherCAT, CoE& coe, uint16_t deviceAddress, double period) : etherCAT(etherCAT), coe(coe) {
+BeckhoffEL4732::BeckhoffEL4732(EtherCAT& etherCAT, CoE& coe, uint16_t deviceAddress, double period) : etherCAT(etherCAT), coe(coe), deviceAddress(deviceAddress), period(period) {
     
     // initialize process data values
     
@@ -27,151 +27,19 @@ BeckhoffEL4732::BeckhoffEL4732(EtherCAT& etherCAT, CoE& coe, uint16_t deviceAddr
         outputBuffer[i] = 0;
     }
     
-    // set EtherCAT state machine to state INIT
+    // configure SYNC managers
     
-    uint16_t loop = 0;
-    uint16_t state = 0;
-    while ((state != EtherCAT::STATE_INIT) && (loop++ < 100)) try {
-        state = etherCAT.read16(deviceAddress, EtherCAT::APPLICATION_LAYER_STATUS);
-        Thread::sleep(10);
-        if ((state & EtherCAT::STATE_ERROR_MASK) == EtherCAT::STATE_ERROR) {
-            etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, state & EtherCAT::STATE_MASK);
-            Thread::sleep(10);
-            etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, state);
-        } else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_BOOTSTRAP) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_INIT);
-        else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_PRE_OPERATIONAL) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_INIT);
-        else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_SAFE_OPERATIONAL) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_PRE_OPERATIONAL);
-        else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_OPERATIONAL) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_SAFE_OPERATIONAL);
-        Thread::sleep(10);
-    } catch (exception& e) {
-        cerr << e.what() << endl;
-    }
-    if (state != EtherCAT::STATE_INIT) {
-        try {
-            uint16_t statusCode = etherCAT.read16(deviceAddress, EtherCAT::APPLICATION_LAYER_STATUS_CODE);
-            cerr << "BeckhoffEL4732: APPLICATION_LAYER_STATUS_CODE=0x" << hex << statusCode << endl;
-        } catch (exception& e) {}
-        throw runtime_error("BeckhoffEL4732: couldn't enter state INIT.");
-    }
-
-    Thread::sleep(10);
+    coe.configureSyncManager(deviceAddress, 0, BUFFERED_OUT_ADDRESS_1, BUFFERED_OUT_SIZE_1, 0x64, true);   // buffered, write, interrupt in PDI, watchdog enabled
+    coe.configureSyncManager(deviceAddress, 1, BUFFERED_OUT_ADDRESS_2, BUFFERED_OUT_SIZE_2, 0x64, true);   // buffered, write, interrupt in PDI, watchdog enabled
     
-    // initialize SYNC managers
-
-    etherCAT.write8(deviceAddress, EtherCAT::SYNC_MANAGER_ACTIVATE+0*EtherCAT::SYNC_MANAGER_OFFSET, 0);
-    Thread::sleep(10);
-    etherCAT.write16(deviceAddress, EtherCAT::SYNC_MANAGER+0*EtherCAT::SYNC_MANAGER_OFFSET, BUFFERED_OUT_ADDRESS_1);
-    Thread::sleep(10);
-    etherCAT.write16(deviceAddress, EtherCAT::SYNC_MANAGER_LENGTH+0*EtherCAT::SYNC_MANAGER_OFFSET, BUFFERED_OUT_SIZE_1);
-    Thread::sleep(10);
-    etherCAT.write8(deviceAddress, EtherCAT::SYNC_MANAGER_CONTROL+0*EtherCAT::SYNC_MANAGER_OFFSET, 0x64);   // buffered, write, interrupt in PDI, watchdog enabled
-    Thread::sleep(10);
-    etherCAT.write8(deviceAddress, EtherCAT::SYNC_MANAGER_ACTIVATE+0*EtherCAT::SYNC_MANAGER_OFFSET, 1);
-    Thread::sleep(10);
-
-    etherCAT.write8(deviceAddress, EtherCAT::SYNC_MANAGER_ACTIVATE+1*EtherCAT::SYNC_MANAGER_OFFSET, 0);
-    Thread::sleep(10);
-    etherCAT.write16(deviceAddress, EtherCAT::SYNC_MANAGER+1*EtherCAT::SYNC_MANAGER_OFFSET, BUFFERED_OUT_ADDRESS_2);
-    Thread::sleep(10);
-    etherCAT.write16(deviceAddress, EtherCAT::SYNC_MANAGER_LENGTH+1*EtherCAT::SYNC_MANAGER_OFFSET, BUFFERED_OUT_SIZE_2);
-    Thread::sleep(10);
-    etherCAT.write8(deviceAddress, EtherCAT::SYNC_MANAGER_CONTROL+1*EtherCAT::SYNC_MANAGER_OFFSET, 0x64);   // buffered, write, interrupt in PDI, watchdog enabled
-    Thread::sleep(10);
-    etherCAT.write8(deviceAddress, EtherCAT::SYNC_MANAGER_ACTIVATE+1*EtherCAT::SYNC_MANAGER_OFFSET, 1);
-    Thread::sleep(10);
-
-    // set EtherCAT state machine to state PRE OPERATIONAL
+    // register process data
     
-    loop = 0;
-    state = 0;
-    while ((state != EtherCAT::STATE_PRE_OPERATIONAL) && (loop++ < 100)) try {
-        state = etherCAT.read16(deviceAddress, EtherCAT::APPLICATION_LAYER_STATUS);
-        Thread::sleep(10);
-        if ((state & EtherCAT::STATE_ERROR_MASK) == EtherCAT::STATE_ERROR) {
-            etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, state & EtherCAT::STATE_MASK);
-            Thread::sleep(10);
-            etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, state);
-        } else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_INIT) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_PRE_OPERATIONAL);
-        else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_BOOTSTRAP) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_INIT);
-        else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_SAFE_OPERATIONAL) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_PRE_OPERATIONAL);
-        else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_OPERATIONAL) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_SAFE_OPERATIONAL);
-        Thread::sleep(10);
-    } catch (exception& e) {
-        cerr << e.what() << endl;
-    }
-    if (state != EtherCAT::STATE_PRE_OPERATIONAL) {
-        try {
-            uint16_t statusCode = etherCAT.read16(deviceAddress, EtherCAT::APPLICATION_LAYER_STATUS_CODE);
-            cerr << "BeckhoffEL4732: APPLICATION_LAYER_STATUS_CODE=0x" << hex << statusCode << endl;
-        } catch (exception& e) {}
-        throw runtime_error("BeckhoffEL4732: couldn't enter state PRE OPERATIONAL.");
-    }
-    
-    // register process datagram
-    
-    coe.registerDatagram(rxPDO1 = new EtherCAT::Datagram(EtherCAT::COMMAND_APWR, deviceAddress, BUFFERED_OUT_ADDRESS_1, BUFFERED_OUT_SIZE_1));
-    coe.registerDatagram(rxPDO2 = new EtherCAT::Datagram(EtherCAT::COMMAND_APWR, deviceAddress, BUFFERED_OUT_ADDRESS_2, BUFFERED_OUT_SIZE_2));
-
-    coe.addSlaveDevice(this);
+    rxPDO1 = coe.registerProcessData(deviceAddress, BUFFERED_OUT_ADDRESS_1, BUFFERED_OUT_SIZE_1, EtherCAT::FMMU_TYPE_WRITE);
+    rxPDO2 = coe.registerProcessData(deviceAddress, BUFFERED_OUT_ADDRESS_2, BUFFERED_OUT_SIZE_2, EtherCAT::FMMU_TYPE_WRITE);
     
-    // set EtherCAT state machine to state SAFE OPERATIONAL
+    // register this slave device and bring it up
     
-    loop = 0;
-    state = 0;
-    while ((state != EtherCAT::STATE_SAFE_OPERATIONAL) && (loop++ < 100)) try {
-        state = etherCAT.read16(deviceAddress, EtherCAT::APPLICATION_LAYER_STATUS);
-        Thread::sleep(10);
-        if ((state & EtherCAT::STATE_ERROR_MASK) == EtherCAT::STATE_ERROR) {
-            etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, state & EtherCAT::STATE_MASK);
-            Thread::sleep(10);
-            etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, state);
-        } else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_INIT) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_PRE_OPERATIONAL);
-        else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_BOOTSTRAP) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_INIT);
-        else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_PRE_OPERATIONAL) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_SAFE_OPERATIONAL);
-        else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_OPERATIONAL) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_SAFE_OPERATIONAL);
-        Thread::sleep(10);
-    } catch (exception& e) {
-        cerr << e.what() << endl;
-    }
-    if (state != EtherCAT::STATE_SAFE_OPERATIONAL) {
-        try {
-            uint16_t statusCode = etherCAT.read16(deviceAddress, EtherCAT::APPLICATION_LAYER_STATUS_CODE);
-            cerr << "BeckhoffEL4732: APPLICATION_LAYER_STATUS_CODE=0x" << hex << statusCode << endl;
-        } catch (exception& e) {}
-        throw runtime_error("BeckhoffEL4732: couldn't enter state SAFE OPERATIONAL.");
-    }
-    
-    // set EtherCAT state machine to state OPERATIONAL
-    
-    loop = 0;
-    state = 0;
-    while ((state != EtherCAT::STATE_OPERATIONAL) && (loop++ < 100)) try {
-        state = etherCAT.read16(deviceAddress, EtherCAT::APPLICATION_LAYER_STATUS);
-        Thread::sleep(10);
-        if ((state & EtherCAT::STATE_ERROR_MASK) == EtherCAT::STATE_ERROR) {
-            etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, state & EtherCAT::STATE_MASK);
-            Thread::sleep(10);
-            etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, state);
-        } else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_INIT) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_PRE_OPERATIONAL);
-        else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_BOOTSTRAP) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_INIT);
-        else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_PRE_OPERATIONAL) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_SAFE_OPERATIONAL);
-        else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_SAFE_OPERATIONAL) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_OPERATIONAL);
-        Thread::sleep(10);
-    } catch (exception& e) {
-        cerr << e.what() << endl;
-    }
-    if (state != EtherCAT::STATE_OPERATIONAL) {
-        try {
-            uint16_t statusCode = etherCAT.read16(deviceAddress, EtherCAT::APPLICATION_LAYER_STATUS_CODE);
-            cerr << "BeckhoffEL4732: APPLICATION_LAYER_STATUS_CODE=0x" << hex << statusCode << endl;
-        } catch (exception& e) {}
-        throw runtime_error("BeckhoffEL4732: couldn't enter state OPERATIONAL.");
-    }
-
-    // configure and activate DC
-
-    etherCAT.write32(deviceAddress, EtherCAT::DC_SYNC0_CYCLE_TIME, static_cast<uint32_t>(1.0e9*period));
-    etherCAT.write8(deviceAddress, EtherCAT::DC_ACTIVATION_REGISTER, 0x27);
+    coe.addSlaveDevice(this, deviceAddress);
 }
 
 /**
@@ -199,6 +67,17 @@ void BeckhoffEL4732::writeAnalogOut(uint16_t number, float value) {
     }
 }
 
+/**
+ * This method is called by the communication handler when the device is in the
+ * state PRE OPERATIONAL. It configures and activates the distributed clock of this device.
+ */
+void BeckhoffEL4732::configure() {
+    
+    // configure and activate DC, aligned with the distributed system time
+    
+    coe.activateDistributedClock(deviceAddress, 0x27, static_cast<uint32_t>(1.0e9*period), 0);
+}
+
 /**
  * This method is called by the communication handler just before a new
  * EtherCAT frame is transmitted on the fieldbus. It allows this device
@@ -208,15 +87,13 @@ void BeckhoffEL4732::writeDatagram() {
     
     mutex.lock();
 
-    rxPDO1->data[10] = 0x01;
-    rxPDO1->data[11] = 0x00;
-    rxPDO1->data[12] = static_cast<uint8_t>(outputBuffer[0] & 0xFF);
-    rxPDO1->data[13] = static_cast<uint8_t>((outputBuffer[0] >> 8) & 0xFF);
+    rxPDO1->write8(0, 0x01);
+    rxPDO1->write8(1, 0x00);
+    rxPDO1->write16(2, outputBuffer[0]);
 
-    rxPDO2->data[10] = 0x01;
-    rxPDO2->data[11] = 0x00;
-    rxPDO2->data[12] = static_cast<uint8_t>(outputBuffer[1] & 0xFF);
-    rxPDO2->data[13] = static_cast<uint8_t>((outputBuffer[1] >> 8) & 0xFF);
+    rxPDO2->write8(0, 0x01);
+    rxPDO2->write8(1, 0x00);
+    rxPDO2->write16(2, outputBuffer[1]);
 
     mutex.unlock();
 }
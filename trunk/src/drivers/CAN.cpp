@@ -49,3 +49,41 @@ int32_t CAN::read(CANMessage& canMessage) {
     
     return 0;
 }
+
+/**
+ * Reads a CAN message received from the CAN bus, together with its time of reception.
+ * This method may be implemented by a specific CAN driver that time stamps received
+ * messages. The default implementation reads a message without a timestamp.
+ * @param canMessage a reference to a CAN message object to overwrite.
+ * @param timestamp a reference to the time the message was received, given in [ns] since
+ * the epoch, i.e. measured with <code>CLOCK_REALTIME</code>, or 0 if the time is unknown.
+ * @return 0 if no message was received, 1 if a message could be read successfully.
+ */
+int32_t CAN::read(CANMessage& canMessage, uint64_t& timestamp) {
+    
+    timestamp = 0;
+    
+    return read(canMessage);
+}
+
+/**
+ * Gets the number of messages that couldn't be written for transmission because
+ * the software transmit buffer of this CAN driver was full.
+ * This method may be implemented by a specific CAN driver.
+ * @return the number of rejected messages to transmit.
+ */
+uint32_t CAN::getTransmitOverflows() {
+    
+    return 0;
+}
+
+/**
+ * Gets the number of received messages that were discarded because
+ * the software receive buffer of this CAN driver was full.
+ * This method may be implemented by a specific CAN driver.
+ * @return the number of discarded received messages.
+ */
+uint32_t CAN::getReceiveOverflows() {
+    
+    return 0;
+}
@@ -0,0 +1,188 @@
+/*
+ * CANMessageBuffer.cpp
+ * Copyright (c) 2026, ZHAW
+ * All rights reserved.
+ *
+ *  Created on: 17.10.2026
+ *      Author: Marcel Honegger
+ */
+
+#include "CANMessageBuffer.h"
+
+using namespace std;
+
+/**
+ * Creates a CAN message buffer with a given capacity.
+ * @param size the number of messages this buffer can store. This value is
+ * rounded up to the next power of two.
+ */
+CANMessageBuffer::CANMessageBuffer(uint16_t size) {
+    
+    uint32_t capacity = 1;
+    while (capacity < size) capacity <<= 1;
+    
+    slots = new Slot[capacity];
+    mask = capacity-1;
+    
+    for (uint32_t i = 0; i < capacity; i++) slots[i].sequence.store(i, memory_order_relaxed);
+    
+    writePosition.store(0, memory_order_relaxed);
+    readPosition.store(0, memory_order_relaxed);
+    overflows.store(0, memory_order_relaxed);
+    
+    atomic_thread_fence(memory_order_release);
+}
+
+/**
+ * Deletes the CAN message buffer.
+ */
+CANMessageBuffer::~CANMessageBuffer() {
+    
+    delete[] slots;
+}
+
+/**
+ * Gets the number of messages this buffer can store.
+ * @return the capacity of this buffer.
+ */
+uint32_t CANMessageBuffer::getCapacity() {
+    
+    return mask+1;
+}
+
+/**
+ * Writes a copy of a given CAN message into this buffer.
+ * @param canMessage the CAN message to store.
+ * @return <code>true</code> if the message was stored, or <code>false</code>
+ * if the buffer is full. In this case, the overflow counter is incremented.
+ */
+bool CANMessageBuffer::write(const CANMessage& canMessage) {
+    
+    return write(canMessage, 0);
+}
+
+/**
+ * Writes a copy of a given CAN message together with a timestamp into this buffer.
+ * @param canMessage the CAN message to store.
+ * @param timestamp the time of reception of the message, i.e. given in [ns].
+ * @return <code>true</code> if the message was stored, or <code>false</code>
+ * if the buffer is full. In this case, the overflow counter is incremented.
+ */
+bool CANMessageBuffer::write(const CANMessage& canMessage, uint64_t timestamp) {
+    
+    uint32_t position = writePosition.load(memory_order_relaxed);
+    
+    while (true) {
+        
+        Slot& slot = slots[position & mask];
+        int32_t difference = static_cast<int32_t>(slot.sequence.load(memory_order_acquire)-position);
+        
+        if (difference == 0) {
+            
+            // the slot is free, try to claim it
+            
+            if (writePosition.compare_exchange_weak(position, position+1, memory_order_relaxed)) {
+                
+                slot.canMessage.id = canMessage.id;
+                for (uint8_t i = 0; i < 8; i++) slot.canMessage.data[i] = canMessage.data[i];
+                slot.canMessage.len = canMessage.len;
+                slot.canMessage.type = canMessage.type;
+                slot.timestamp = timestamp;
+                
+                slot.sequence.store(position+1, memory_order_release);
+                
+                return true;
+            }
+            
+        } else if (difference < 0) {
+            
+            // the slot still contains a message that wasn't read yet
+            
+            overflows.fetch_add(1, memory_order_relaxed);
+            
+            return false;
+            
+        } else {
+            
+            // another thread wrote this slot in the meantime
+            
+            position = writePosition.load(memory_order_relaxed);
+        }
+    }
+}
+
+/**
+ * Reads the oldest CAN message from this buffer and removes it.
+ * @param canMessage a reference to a CAN message object to overwrite.
+ * @return <code>true</code> if a message was read, or <code>false</code> if the buffer is empty.
+ */
+bool CANMessageBuffer::read(CANMessage& canMessage) {
+    
+    uint64_t timestamp = 0;
+    
+    return read(canMessage, timestamp);
+}
+
+/**
+ * Reads the oldest CAN message together with its timestamp from this buffer and removes it.
+ * @param canMessage a reference to a CAN message object to overwrite.
+ * @param timestamp a reference to the timestamp the message was stored with, or 0.
+ * @return <code>true</code> if a message was read, or <code>false</code> if the buffer is empty.
+ */
+bool CANMessageBuffer::read(CANMessage& canMessage, uint64_t& timestamp) {
+    
+    uint32_t position = readPosition.load(memory_order_relaxed);
+    
+    while (true) {
+        
+        Slot& slot = slots[position & mask];
+        int32_t difference = static_cast<int32_t>(slot.sequence.load(memory_order_acquire)-(position+1));
+        
+        if (difference == 0) {
+            
+            // the slot contains a message, try to claim it
+            
+            if (readPosition.compare_exchange_weak(position, position+1, memory_order_relaxed)) {
+                
+                canMessage.id = slot.canMessage.id;
+                for (uint8_t i = 0; i < 8; i++) canMessage.data[i] = slot.canMessage.data[i];
+                canMessage.len = slot.canMessage.len;
+                canMessage.type = slot.canMessage.type;
+                timestamp = slot.timestamp;
+                
+                slot.sequence.store(position+mask+1, memory_order_release);
+                
+                return true;
+            }
+            
+        } else if (difference < 0) {
+            
+            // the slot wasn't written yet, the buffer is empty
+            
+            return false;
+            
+        } else {
+            
+            // another thread read this slot in the meantime
+            
+            position = readPosition.load(memory_order_relaxed);
+        }
+    }
+}
+
+/**
+ * Gets the number of messages that couldn't be written into this buffer because it was full.
+ * @return the number of overflows since this buffer was created or the counter was reset.
+ */
+uint32_t CANMessageBuffer::getOverflows() {
+    
+    return overflows.load(memory_order_relaxed);
+}
+
+/**
+ * Resets the overflow counter of this buffer.
+ */
+void CANMessageBuffer::resetOverflows() {
+    
+    overflows.store(0, memory_order_relaxed);
+}
@@ -7,7 +7,11 @@
  *      Author: Marcel Honegger
  */
 
+#include <ctime>
+#include <cstring>
+#include <algorithm>
 #include "Thread.h"
+#include "Trace.h"
 #include "CAN.h"
 #include "CANopen.h"
 
@@ -26,6 +30,323 @@ const double CANopen::PERIOD = 0.0001;                                  // perio
 
 void CANopen::Delegate::receiveObject(uint32_t functionCode, uint8_t object[]) {}
 
+void CANopen::Delegate::transmitObjects() {}
+
+/**
+ * Creates a service data object with a buffer of a given size.
+ * @param index the index of the CANopen service data object (16 bit).
+ * @param subindex the subindex of the CANopen service data object (8 bit).
+ * @param size the size of the buffer for the value of this object, given in [bytes].
+ */
+CANopen::ServiceDataObject::ServiceDataObject(uint16_t index, uint8_t subindex, uint16_t size) : ServiceDataObject(index, subindex, size, false) {}
+
+/**
+ * Creates a service data object with a buffer of a given size, which is optionally
+ * transferred with a block transfer. Block transfers need less handshakes than segmented
+ * transfers, and they are faster for large objects, but they must be supported by the
+ * SDO server of the node.
+ * @param index the index of the CANopen service data object (16 bit).
+ * @param subindex the subindex of the CANopen service data object (8 bit).
+ * @param size the size of the buffer for the value of this object, given in [bytes].
+ * @param block a flag indicating if this object should be transferred with a block transfer.
+ */
+CANopen::ServiceDataObject::ServiceDataObject(uint16_t index, uint8_t subindex, uint16_t size, bool block) {
+    
+    data = new uint8_t[(size > 0) ? size : 1];
+    memset((void*)data, 0, (size > 0) ? size : 1);
+    length = 0;
+    
+    this->index = index;
+    this->subindex = subindex;
+    this->size = size;
+    this->block = block;
+    this->state.store(STATE_IDLE, memory_order_relaxed);
+    this->result = STATE_IDLE;
+    this->abortCode = 0;
+    this->download = false;
+    this->phase = PHASE_IDLE;
+    this->offset = 0;
+    this->toggle = 0;
+    this->blockOffset = 0;
+    this->blockSize = 0;
+    this->sequence = 0;
+    this->last = false;
+    this->retries = 0;
+    this->time = 0;
+    this->next = NULL;
+}
+
+/**
+ * Deletes the service data object and releases its buffer.
+ * A service data object must not be deleted while it is pending.
+ */
+CANopen::ServiceDataObject::~ServiceDataObject() {
+    
+    delete[] data;
+}
+
+/**
+ * Gets the index of this service data object.
+ * @return the index of this service data object.
+ */
+uint16_t CANopen::ServiceDataObject::getIndex() {
+    
+    return index;
+}
+
+/**
+ * Gets the subindex of this service data object.
+ * @return the subindex of this service data object.
+ */
+uint8_t CANopen::ServiceDataObject::getSubindex() {
+    
+    return subindex;
+}
+
+/**
+ * Sets a simple value of this service data object, to be transferred with a download.
+ * @param value the value to set (8 - 32 bit).
+ * @param length the number of bytes the value consists of, usually 1, 2 or 4.
+ */
+void CANopen::ServiceDataObject::setValue(uint32_t value, uint16_t length) {
+    
+    if (length > 4) length = 4;
+    if (length > size) length = size;
+    
+    for (uint16_t i = 0; i < length; i++) data[i] = static_cast<uint8_t>((value >> (8*i)) & 0xFF);
+    
+    this->length = length;
+}
+
+/**
+ * Gets a simple value of this service data object, i.e. after an upload.
+ * @return the value of this object, consisting of up to 4 bytes.
+ */
+uint32_t CANopen::ServiceDataObject::getValue() {
+    
+    uint32_t value = 0;
+    for (uint16_t i = 0; (i < length) && (i < 4); i++) value |= (static_cast<uint32_t>(data[i]) & 0xFF) << (8*i);
+    
+    return value;
+}
+
+/**
+ * Gets the state of the transfer of this service data object.
+ * @return the state, i.e. <code>STATE_PENDING</code>, <code>STATE_COMPLETED</code> or <code>STATE_ABORTED</code>.
+ */
+uint8_t CANopen::ServiceDataObject::getState() {
+    
+    return state.load(memory_order_acquire);
+}
+
+/**
+ * Gets the abort code of a failed transfer of this service data object. This is either
+ * the abort code sent by the node, or 0x05040000 if the transfer timed out.
+ * @return the CANopen abort code, or 0 if the transfer didn't fail.
+ */
+uint32_t CANopen::ServiceDataObject::getAbortCode() {
+    
+    return abortCode;
+}
+
+/**
+ * Waits until the transfer of this service data object is completed, either successfully
+ * or not. This method must not be called by the handler of the CANopen device driver itself,
+ * i.e. from the <code>receiveObject()</code> method of a delegate.
+ * @return <code>true</code> if the transfer was successful, <code>false</code> otherwise.
+ */
+bool CANopen::ServiceDataObject::waitForCompletion() {
+    
+    uint8_t state;
+    while ((state = this->state.load(memory_order_acquire)) == STATE_PENDING) Thread::sleep(1);
+    
+    return state == STATE_COMPLETED;
+}
+
+/**
+ * This method is called by the handler of the CANopen device driver when the transfer of
+ * this service data object is completed, either successfully or not. It may be overridden
+ * to handle the result of a transfer without waiting for it. The state of this object
+ * changes from <code>STATE_PENDING</code> just after this method returned.
+ */
+void CANopen::ServiceDataObject::completed() {}
+
+/**
+ * Creates a description of a process data object with a given function code.
+ * Receive process data objects are transmitted event driven, and transmit
+ * process data objects are transmitted after every SYNC object.
+ * @param functionCode the function code of this object, i.e. <code>RPDO1</code> or <code>TPDO2</code>.
+ */
+CANopen::ProcessDataObject::ProcessDataObject(uint32_t functionCode) {
+    
+    if ((functionCode != RPDO1) && (functionCode != RPDO2) && (functionCode != RPDO3) && (functionCode != RPDO4)
+            && (functionCode != TPDO1) && (functionCode != TPDO2) && (functionCode != TPDO3) && (functionCode != TPDO4)) throw invalid_argument("CANopen: wrong function code of a process data object!");
+    
+    this->functionCode = functionCode;
+    this->transmissionType = ((functionCode & 0x80) == 0x00) ? 0xFF : 0x01;
+    this->inhibitTime = 0;
+    this->eventTimer = 0;
+    this->parameters = 0;
+    this->length = 0;
+}
+
+/**
+ * Creates a description of a process data object with a given function code and transmission type.
+ * @param functionCode the function code of this object, i.e. <code>RPDO1</code> or <code>TPDO2</code>.
+ * @param transmissionType the transmission type of this object, i.e. 1 for a synchronous transmission
+ * after every SYNC object, 253 for a transmission on remote request only, or 255 for an event driven transmission.
+ */
+CANopen::ProcessDataObject::ProcessDataObject(uint32_t functionCode, uint8_t transmissionType) {
+    
+    if ((functionCode != RPDO1) && (functionCode != RPDO2) && (functionCode != RPDO3) && (functionCode != RPDO4)
+            && (functionCode != TPDO1) && (functionCode != TPDO2) && (functionCode != TPDO3) && (functionCode != TPDO4)) throw invalid_argument("CANopen: wrong function code of a process data object!");
+    
+    this->functionCode = functionCode;
+    this->transmissionType = transmissionType;
+    this->inhibitTime = 0;
+    this->eventTimer = 0;
+    this->parameters = 0;
+    this->length = 0;
+}
+
+/**
+ * Deletes the description of a process data object.
+ */
+CANopen::ProcessDataObject::~ProcessDataObject() {}
+
+/**
+ * Gets the function code of this process data object.
+ * @return the function code, i.e. <code>RPDO1</code> or <code>TPDO2</code>.
+ */
+uint32_t CANopen::ProcessDataObject::getFunctionCode() {
+    
+    return functionCode;
+}
+
+/**
+ * Sets the transmission type of this process data object.
+ * @param transmissionType the transmission type of this object, i.e. 1 for a synchronous transmission
+ * after every SYNC object, 253 for a transmission on remote request only, or 255 for an event driven transmission.
+ */
+void CANopen::ProcessDataObject::setTransmissionType(uint8_t transmissionType) {
+    
+    this->transmissionType = transmissionType;
+}
+
+/**
+ * Sets the inhibit time of this process data object. If the inhibit time isn't set,
+ * the value of the node is not changed.
+ * @param inhibitTime the minimum time between two transmissions of this object, given in [100 &micro;s].
+ */
+void CANopen::ProcessDataObject::setInhibitTime(uint16_t inhibitTime) {
+    
+    this->inhibitTime = inhibitTime;
+    this->parameters |= INHIBIT_TIME;
+}
+
+/**
+ * Sets the event timer of this process data object. If the event timer isn't set,
+ * the value of the node is not changed.
+ * @param eventTimer the time between event driven transmissions of this object, given in [ms].
+ */
+void CANopen::ProcessDataObject::setEventTimer(uint16_t eventTimer) {
+    
+    this->eventTimer = eventTimer;
+    this->parameters |= EVENT_TIMER;
+}
+
+/**
+ * Maps an entry of the object dictionary into this process data object. The entry is
+ * appended to the entries that were already mapped.
+ * @param index the index of the entry (16 bit).
+ * @param subindex the subindex of the entry (8 bit).
+ * @param length the length of the entry, given in [bits].
+ */
+void CANopen::ProcessDataObject::addEntry(uint16_t index, uint8_t subindex, uint8_t length) {
+    
+    if ((length < 1) || (length > 32)) throw invalid_argument("CANopen: wrong length of a mapped entry!");
+    if (this->length+length > 64) throw runtime_error("CANopen: the mapped entries exceed the length of a process data object.");
+    
+    entries.push_back((static_cast<uint32_t>(index) << 16) | (static_cast<uint32_t>(subindex) << 8) | static_cast<uint32_t>(length));
+    offsets.push_back(this->length);
+    
+    this->length += length;
+}
+
+/**
+ * Gets the number of entries mapped into this process data object.
+ * @return the number of mapped entries.
+ */
+uint8_t CANopen::ProcessDataObject::getNumberOfEntries() {
+    
+    return static_cast<uint8_t>(entries.size());
+}
+
+/**
+ * Gets the length of this process data object.
+ * @return the length of this object, given in [bytes].
+ */
+uint8_t CANopen::ProcessDataObject::getLength() {
+    
+    return (length+7)/8;
+}
+
+/**
+ * Writes the value of a mapped entry into a buffer for this process data object.
+ * @param object a buffer of 8 bytes for this object.
+ * @param entry the number of the entry, in the order the entries were added.
+ * @param value the value of the entry. Only the bits of the mapped length are used.
+ */
+void CANopen::ProcessDataObject::pack(uint8_t object[], uint8_t entry, uint32_t value) {
+    
+    uint8_t length = entries[entry] & 0xFF;
+    uint8_t offset = offsets[entry];
+    
+    if (((offset & 0x07) == 0) && ((length & 0x07) == 0)) {
+        
+        for (uint8_t i = 0; i < length/8; i++) object[offset/8+i] = static_cast<uint8_t>((value >> (8*i)) & 0xFF);
+        
+    } else {
+        
+        for (uint8_t i = 0; i < length; i++) {
+            
+            uint8_t bit = offset+i;
+            
+            if (((value >> i) & 0x01) > 0) object[bit/8] |= static_cast<uint8_t>(1 << (bit & 0x07));
+            else object[bit/8] &= ~static_cast<uint8_t>(1 << (bit & 0x07));
+        }
+    }
+}
+
+/**
+ * Reads the value of a mapped entry from a received process data object.
+ * @param object a buffer with this object.
+ * @param entry the number of the entry, in the order the entries were added.
+ * @return the value of the entry. Signed values need to be cast to a signed type of the mapped length, i.e. <code>int16_t</code>.
+ */
+uint32_t CANopen::ProcessDataObject::unpack(uint8_t object[], uint8_t entry) {
+    
+    uint8_t length = entries[entry] & 0xFF;
+    uint8_t offset = offsets[entry];
+    uint32_t value = 0;
+    
+    if (((offset & 0x07) == 0) && ((length & 0x07) == 0)) {
+        
+        for (uint8_t i = 0; i < length/8; i++) value |= (static_cast<uint32_t>(object[offset/8+i]) & 0xFF) << (8*i);
+        
+    } else {
+        
+        for (uint8_t i = 0; i < length; i++) {
+            
+            uint8_t bit = offset+i;
+            
+            if (((object[bit/8] >> (bit & 0x07)) & 0x01) > 0) value |= 1U << i;
+        }
+    }
+    
+    return value;
+}
+
 /**
  * Creates a CANopen device driver object and initializes local values.
  */
@@ -57,6 +378,54 @@ CANopen::CANopen(CAN& can) : RealtimeThread("CANopen", STACK_SIZE, PRIORITY, PER
         }
     }
     
+    // initialize table to dispatch received objects
+    
+    for (uint32_t i = 0; i < COB_IDS; i++) {
+        
+        uint32_t functionCode = i & FUNCTION_CODE_BITMASK;
+        uint32_t nodeID = i & NODE_ID_BITMASK;
+        
+        receivers[i].functionCode = functionCode;
+        receivers[i].nodeID = nodeID;
+        receivers[i].object = NULL;
+        receivers[i].received = NULL;
+        receivers[i].pending = false;
+        
+        if (functionCode == EMERGENCY) {
+            receivers[i].object = emergencyObject[nodeID];
+            receivers[i].received = &emergencyObjectReceived[nodeID];
+        } else if (functionCode == TPDO1) {
+            receivers[i].object = tpdo1[nodeID];
+            receivers[i].received = &tpdo1Received[nodeID];
+        } else if (functionCode == TPDO2) {
+            receivers[i].object = tpdo2[nodeID];
+            receivers[i].received = &tpdo2Received[nodeID];
+        } else if (functionCode == TPDO3) {
+            receivers[i].object = tpdo3[nodeID];
+            receivers[i].received = &tpdo3Received[nodeID];
+        } else if (functionCode == TPDO4) {
+            receivers[i].object = tpdo4[nodeID];
+            receivers[i].received = &tpdo4Received[nodeID];
+        } else if (functionCode == TSDO) {
+            receivers[i].object = tsdo[nodeID];
+            receivers[i].received = &tsdoReceived[nodeID];
+        } else if (functionCode == NODEGUARD) {
+            receivers[i].object = nodeguardObject[nodeID];
+            receivers[i].received = &nodeguardObjectReceived[nodeID];
+        }
+    }
+    
+    for (uint32_t i = 0; i < 128; i++) {
+        
+        firstServiceDataObject[i] = NULL;
+        lastServiceDataObject[i] = NULL;
+    }
+    
+    resetStatistics();
+    
+    syncPeriods.store(0, memory_order_relaxed);
+    syncCounter = 0;
+    
     // start handler
     
     start();
@@ -118,6 +487,17 @@ void CANopen::transmitNMTObject(uint8_t command, uint32_t nodeID) {
     canMessage.len = 2;
     
     can.write(canMessage);
+    
+    // discard the snapshots of the object dictionaries of nodes that are reset
+    
+    if ((command == RESET_NODE) || (command == RESET_COMMUNICATION)) {
+        
+        sdoMutex.lock();
+        
+        for (uint32_t i = 0; i < 128; i++) if ((nodeID == 0) || (nodeID == i)) objectDictionary[i].clear();
+        
+        sdoMutex.unlock();
+    }
 }
 
 /**
@@ -132,6 +512,27 @@ void CANopen::transmitSYNCObject() {
     can.write(canMessage);
 }
 
+/**
+ * Sets the period of the SYNC producer. In every SYNC period, the <code>transmitObjects()</code>
+ * method of all registered delegates is called, and then a SYNC object is transmitted.
+ * The period may be changed while the handler is running.
+ * @param period the period of the SYNC producer, given in [s]. This period is rounded to
+ * a multiple of the period of the handler of this driver. A period of 0 disables the SYNC producer.
+ */
+void CANopen::setSYNCPeriod(double period) {
+    
+    syncPeriods.store((period > 0.0) ? max(static_cast<uint32_t>(period/PERIOD+0.5), static_cast<uint32_t>(1)) : 0, memory_order_relaxed);
+}
+
+/**
+ * Gets the period of the SYNC producer.
+ * @return the period of the SYNC producer, given in [s], or 0 if the SYNC producer is disabled.
+ */
+double CANopen::getSYNCPeriod() {
+    
+    return static_cast<double>(syncPeriods.load(memory_order_relaxed))*PERIOD;
+}
+
 /**
  * Transmits a request for a nodeguard object.
  * @param nodeID the identifier of the node. This ID must be in the range 0..127.
@@ -161,25 +562,16 @@ bool CANopen::receiveObject(uint32_t functionCode, uint32_t nodeID, uint8_t obje
     
     if (nodeID > 127) throw invalid_argument("CANopen: wrong node identifier!");
     
-    if ((functionCode == EMERGENCY) && !emergencyObjectReceived[nodeID]) return false;
-    else if ((functionCode == TPDO1) && !tpdo1Received[nodeID]) return false;
-    else if ((functionCode == TPDO2) && !tpdo2Received[nodeID]) return false;
-    else if ((functionCode == TPDO3) && !tpdo3Received[nodeID]) return false;
-    else if ((functionCode == TPDO4) && !tpdo4Received[nodeID]) return false;
-    else if ((functionCode == TSDO) && !tsdoReceived[nodeID]) return false;
-    else if ((functionCode == NODEGUARD) && !nodeguardObjectReceived[nodeID]) return false;
+    Receiver& receiver = getReceiver(functionCode, nodeID);
+    
+    if ((receiver.received != NULL) && !*receiver.received) return false;
     
 	for (uint8_t i = 0; i < 8; i++) object[i] = 0;
     
     mutex.lock();
     
-    if (functionCode == EMERGENCY) for (uint8_t i = 0; i < 8; i++) object[i] = emergencyObject[nodeID][i];
-    else if (functionCode == TPDO1) for (uint8_t i = 0; i < 8; i++) object[i] = tpdo1[nodeID][i];
-    else if (functionCode == TPDO2) for (uint8_t i = 0; i < 8; i++) object[i] = tpdo2[nodeID][i];
-    else if (functionCode == TPDO3) for (uint8_t i = 0; i < 8; i++) object[i] = tpdo3[nodeID][i];
-    else if (functionCode == TPDO4) for (uint8_t i = 0; i < 8; i++) object[i] = tpdo4[nodeID][i];
-    else if (functionCode == TSDO) for (uint8_t i = 0; i < 8; i++) object[i] = tsdo[nodeID][i];
-    else if (functionCode == NODEGUARD) for (uint8_t i = 0; i < 8; i++) object[i] = nodeguardObject[nodeID][i];
+    if (receiver.object != NULL) for (uint8_t i = 0; i < 8; i++) object[i] = receiver.object[i];
+    receiver.pending = false;
     
     mutex.unlock();
     
@@ -196,17 +588,15 @@ void CANopen::resetObject(uint32_t functionCode, uint32_t nodeID) {
     
     if (nodeID > 127) throw invalid_argument("CANopen: wrong node identifier!");
     
-    if (functionCode == EMERGENCY) emergencyObjectReceived[nodeID] = false;
-    else if (functionCode == TPDO1) tpdo1Received[nodeID] = false;
-    else if (functionCode == TPDO2) tpdo2Received[nodeID] = false;
-    else if (functionCode == TPDO3) tpdo3Received[nodeID] = false;
-    else if (functionCode == TPDO4) tpdo4Received[nodeID] = false;
-    else if (functionCode == TSDO) tsdoReceived[nodeID] = false;
-    else if (functionCode == NODEGUARD) nodeguardObjectReceived[nodeID] = false;
+    Receiver& receiver = getReceiver(functionCode, nodeID);
+    
+    if (receiver.received != NULL) *receiver.received = false;
+    receiver.pending = false;
 }
 
 /**
  * Writes an expedited service data object (SDO) to a CANopen node.
+ * This method waits until the transfer is completed.
  * @param nodeID the identifier of the node. This ID must be in the range 1..127.
  * @param index the index of the service data object (16 bit).
  * @param subindex the subindex of the service data object entry (8 bit).
@@ -215,44 +605,23 @@ void CANopen::resetObject(uint32_t functionCode, uint32_t nodeID) {
  */
 void CANopen::writeSDO(uint32_t nodeID, uint16_t index, uint8_t subindex, uint32_t value, uint8_t length) {
     
-    if ((nodeID < 1) || (nodeID > 127)) throw invalid_argument("CANopen: wrong node identifier!");
+    ServiceDataObject serviceDataObject(index, subindex, 4);
+    serviceDataObject.setValue(value, length);
     
-    tsdoReceived[nodeID] = false;
-    for (uint8_t i = 0; i < 8; i++) tsdo[nodeID][i] = 0;    // reset current tsdo
+    download(nodeID, serviceDataObject);
     
-    uint32_t retries = 0;
-    while (!tsdoReceived[nodeID] && (retries < RETRIES)) {
+    if (!serviceDataObject.waitForCompletion()) {
         
-        CANMessage canMessage;
-        canMessage.id = RSDO | nodeID;
-        canMessage.data[0] = 0x23+((4-length) << 2);
-        canMessage.data[1] = index & 0xFF;
-        canMessage.data[2] = (index >> 8) & 0xFF;
-        canMessage.data[3] = subindex;
-        canMessage.data[4] = value & 0xFF;
-        canMessage.data[5] = (value >> 8) & 0xFF;
-        canMessage.data[6] = (value >> 16) & 0xFF;
-        canMessage.data[7] = (value >> 24) & 0xFF;
-        canMessage.len = 8;
-        canMessage.type = CANData;
-        
-        can.write(canMessage);
+        uint32_t abortCode = serviceDataObject.getAbortCode();
         
-        uint32_t counter = 0;
-        while (!tsdoReceived[nodeID] && (counter < TIMEOUT/RETRIES)) {
-            Thread::sleep(1);
-            counter++;
-        }
-        
-        retries++;
+        if (abortCode == 0x05040000) throw runtime_error("CANopen: no response from node "+type2String(nodeID)+"!");
+        else throw runtime_error("CANopen: error message from node "+type2String(nodeID)+": class="+type2String((abortCode >> 24) & 0xFF)+", code="+type2String((abortCode >> 16) & 0xFF)+".");
     }
-    
-    if (!tsdoReceived[nodeID]) throw runtime_error("CANopen: no response from node "+type2String(nodeID)+"!");
-    if ((tsdo[nodeID][0] & 0x80) > 0) throw runtime_error("CANopen: error message from node "+type2String(nodeID)+": class="+type2String(tsdo[nodeID][7])+", code="+type2String(tsdo[nodeID][6])+".");
 }
 
 /**
  * Reads an expedited service data object (SDO) from a CANopen node.
+ * This method waits until the transfer is completed.
  * @param nodeID the identifier of the node. This ID must be in the range 1..127.
  * @param index the index of the service data object (16 bit).
  * @param subindex the subindex of the service data object entry (8 bit).
@@ -260,102 +629,836 @@ void CANopen::writeSDO(uint32_t nodeID, uint16_t index, uint8_t subindex, uint32
  */
 uint32_t CANopen::readSDO(uint32_t nodeID, uint16_t index, uint8_t subindex) {
     
+    ServiceDataObject serviceDataObject(index, subindex, 4);
+    
+    upload(nodeID, serviceDataObject);
+    
+    if (!serviceDataObject.waitForCompletion()) {
+        
+        uint32_t abortCode = serviceDataObject.getAbortCode();
+        
+        if (abortCode == 0x05040000) throw runtime_error("CANopen: no response from node "+type2String(nodeID)+"!");
+        else throw runtime_error("CANopen: error message from node "+type2String(nodeID)+": class="+type2String((abortCode >> 24) & 0xFF)+", code="+type2String((abortCode >> 16) & 0xFF)+".");
+    }
+    
+    return serviceDataObject.getValue();
+}
+
+/**
+ * Starts an upload of a service data object from a CANopen node. The service data object
+ * is appended to the queue of the node, and its value is read asynchronously by the
+ * handler of this driver. The object must not be deleted while it is pending.
+ * @param nodeID the identifier of the node. This ID must be in the range 1..127.
+ * @param serviceDataObject the service data object to read.
+ */
+void CANopen::upload(uint32_t nodeID, ServiceDataObject& serviceDataObject) {
+    
+    transfer(nodeID, serviceDataObject, false);
+}
+
+/**
+ * Starts a download of a service data object to a CANopen node. The service data object
+ * is appended to the queue of the node, and its value is written asynchronously by the
+ * handler of this driver. The object must not be deleted while it is pending.
+ * @param nodeID the identifier of the node. This ID must be in the range 1..127.
+ * @param serviceDataObject the service data object to write.
+ */
+void CANopen::download(uint32_t nodeID, ServiceDataObject& serviceDataObject) {
+    
+    transfer(nodeID, serviceDataObject, true);
+}
+
+/**
+ * Configures the mapping and the communication parameters of process data objects of a node.
+ * The service data objects needed for this configuration are transferred in bulk, and this
+ * method waits until all transfers are completed. Values that are already set, according
+ * to the snapshot of the object dictionary of the node, are not written again. A process
+ * data object is disabled while its mapping or communication parameters are changed.
+ * @param nodeID the identifier of the node. This ID must be in the range 1..127.
+ * @param processDataObjects a list of descriptions of the process data objects to configure.
+ */
+void CANopen::configureProcessDataObjects(uint32_t nodeID, vector<ProcessDataObject*>& processDataObjects) {
+    
     if ((nodeID < 1) || (nodeID > 127)) throw invalid_argument("CANopen: wrong node identifier!");
     
-    tsdoReceived[nodeID] = false;
-    for (uint8_t i = 0; i < 8; i++) tsdo[nodeID][i] = 0;    // reset current tsdo
+    sdoMutex.lock();
+    map<uint32_t, uint32_t> snapshot = objectDictionary[nodeID];
+    sdoMutex.unlock();
+    
+    vector<ServiceDataObject*> serviceDataObjects;
     
-    uint32_t retries = 0;
-    while (!tsdoReceived[nodeID] && (retries < RETRIES)) {
+    for (uint16_t i = 0; i < processDataObjects.size(); i++) {
         
-        CANMessage canMessage;
-        canMessage.id = RSDO | nodeID;
-        canMessage.data[0] = 0x40;
-        canMessage.data[1] = index & 0xFF;
-        canMessage.data[2] = (index >> 8) & 0xFF;
-        canMessage.data[3] = subindex;
-        canMessage.data[4] = 0;
-        canMessage.data[5] = 0;
-        canMessage.data[6] = 0;
-        canMessage.data[7] = 0;
-        canMessage.len = 8;
-        canMessage.type = CANData;
+        ProcessDataObject* processDataObject = processDataObjects[i];
         
-        can.write(canMessage);
+        bool receive = (processDataObject->functionCode & 0x80) == 0x00;
+        uint16_t number = static_cast<uint16_t>(((processDataObject->functionCode-(receive ? RPDO1 : TPDO1)) >> 8) & 0x03);
+        uint16_t communicationIndex = (receive ? 0x1400 : 0x1800)+number;
+        uint16_t mappingIndex = (receive ? 0x1600 : 0x1A00)+number;
+        uint32_t cobID = processDataObject->functionCode+nodeID;
+        uint8_t numberOfEntries = processDataObject->getNumberOfEntries();
+        
+        // compare the description with the snapshot of the object dictionary
+        
+        bool mapping = isSet(snapshot, mappingIndex, 0x00, numberOfEntries);
+        for (uint8_t j = 0; j < numberOfEntries; j++) mapping = mapping && isSet(snapshot, mappingIndex, j+1, processDataObject->entries[j]);
+        
+        bool transmissionType = isSet(snapshot, communicationIndex, 0x02, processDataObject->transmissionType);
+        bool inhibitTime = ((processDataObject->parameters & ProcessDataObject::INHIBIT_TIME) == 0) || isSet(snapshot, communicationIndex, 0x03, processDataObject->inhibitTime);
+        bool eventTimer = ((processDataObject->parameters & ProcessDataObject::EVENT_TIMER) == 0) || isSet(snapshot, communicationIndex, 0x05, processDataObject->eventTimer);
+        
+        if (mapping && transmissionType && inhibitTime && eventTimer && isSet(snapshot, communicationIndex, 0x01, cobID)) continue;
+        
+        // disable the process data object, change the parameters that differ, and enable it again
         
-        uint32_t counter = 0;
-        while (!tsdoReceived[nodeID] && (counter < TIMEOUT/RETRIES)) {
-            Thread::sleep(1);
-            counter++;
+        serviceDataObjects.push_back(write(nodeID, communicationIndex, 0x01, cobID | 0x80000000, 4));
+        
+        if (!mapping) {
+            
+            serviceDataObjects.push_back(write(nodeID, mappingIndex, 0x00, 0x00, 1));
+            for (uint8_t j = 0; j < numberOfEntries; j++) if (!isSet(snapshot, mappingIndex, j+1, processDataObject->entries[j])) serviceDataObjects.push_back(write(nodeID, mappingIndex, j+1, processDataObject->entries[j], 4));
+            serviceDataObjects.push_back(write(nodeID, mappingIndex, 0x00, numberOfEntries, 1));
         }
         
-        retries++;
+        if (!transmissionType) serviceDataObjects.push_back(write(nodeID, communicationIndex, 0x02, processDataObject->transmissionType, 1));
+        if (!inhibitTime) serviceDataObjects.push_back(write(nodeID, communicationIndex, 0x03, processDataObject->inhibitTime, 2));
+        if (!eventTimer) serviceDataObjects.push_back(write(nodeID, communicationIndex, 0x05, processDataObject->eventTimer, 2));
+        
+        serviceDataObjects.push_back(write(nodeID, communicationIndex, 0x01, cobID, 4));
     }
     
-    if (!tsdoReceived[nodeID]) throw runtime_error("CANopen: no response from node "+type2String(nodeID)+"!");
-    if ((tsdo[nodeID][0] & 0x80) > 0) throw runtime_error("CANopen: error message from node "+type2String(nodeID)+": class="+type2String(tsdo[nodeID][7])+", code="+type2String(tsdo[nodeID][6])+".");
+    // wait until all transfers are completed
+    
+    uint32_t abortCode = 0;
     
-    uint8_t length = 4-((tsdo[nodeID][0] >> 2) & 0x03);     // number of used bytes
+    for (uint16_t i = 0; i < serviceDataObjects.size(); i++) {
+        
+        if (!serviceDataObjects[i]->waitForCompletion() && (abortCode == 0)) abortCode = serviceDataObjects[i]->getAbortCode();
+        
+        delete serviceDataObjects[i];
+    }
     
-    if (length == 1) return static_cast<uint32_t>(tsdo[nodeID][4] & 0xFF);
-    else if (length == 2) return static_cast<uint32_t>(tsdo[nodeID][4] & 0xFF) | (static_cast<uint32_t>(tsdo[nodeID][5] & 0xFF) << 8);
-    return static_cast<uint32_t>(tsdo[nodeID][4] & 0xFF) | (static_cast<uint32_t>(tsdo[nodeID][5] & 0xFF) << 8) | (static_cast<uint32_t>(tsdo[nodeID][6] & 0xFF) << 16) | (static_cast<uint32_t>(tsdo[nodeID][7] & 0xFF) << 24);
+    if (abortCode == 0x05040000) throw runtime_error("CANopen: no response from node "+type2String(nodeID)+"!");
+    else if (abortCode != 0) throw runtime_error("CANopen: error message from node "+type2String(nodeID)+": class="+type2String((abortCode >> 24) & 0xFF)+", code="+type2String((abortCode >> 16) & 0xFF)+".");
 }
 
 /**
- * This method is the handler of this CANopen device driver.
+ * Gets the number of objects received from a given node.
+ * @param nodeID the identifier of the node. This ID must be in the range 0..127.
+ * @return the number of received objects since the statistics were reset.
  */
-void CANopen::run() {
+uint32_t CANopen::getNumberOfReceivedObjects(uint32_t nodeID) {
     
-    CANMessage canMessage;
+    if (nodeID > 127) throw invalid_argument("CANopen: wrong node identifier!");
     
-    while (waitForNextPeriod()) {
+    return numberOfReceivedObjects[nodeID];
+}
+
+/**
+ * Gets the number of objects from a given node that were lost. An object is lost when
+ * it's overwritten by a new object with the same COB-ID before it was read with the
+ * <code>receiveObject()</code> method. Objects of nodes with a registered device driver
+ * are never lost, because they are delivered to the driver immediately.
+ * @param nodeID the identifier of the node. This ID must be in the range 0..127.
+ * @return the number of lost objects since the statistics were reset.
+ */
+uint32_t CANopen::getNumberOfLostObjects(uint32_t nodeID) {
+    
+    if (nodeID > 127) throw invalid_argument("CANopen: wrong node identifier!");
+    
+    return numberOfLostObjects[nodeID];
+}
+
+/**
+ * Gets the mean latency between the reception of objects from a given node by the CAN
+ * device driver, and their dispatch by this CANopen device driver.
+ * @param nodeID the identifier of the node. This ID must be in the range 0..127.
+ * @return the mean latency, given in [s], or 0 if the CAN device driver doesn't provide timestamps.
+ */
+double CANopen::getLatencyMean(uint32_t nodeID) {
+    
+    if (nodeID > 127) throw invalid_argument("CANopen: wrong node identifier!");
+    
+    return (numberOfMeasuredLatencies[nodeID] > 0) ? latencySum[nodeID]/static_cast<double>(numberOfMeasuredLatencies[nodeID]) : 0.0;
+}
+
+/**
+ * Gets the maximum latency between the reception of objects from a given node by the CAN
+ * device driver, and their dispatch by this CANopen device driver.
+ * @param nodeID the identifier of the node. This ID must be in the range 0..127.
+ * @return the maximum latency, given in [s], or 0 if the CAN device driver doesn't provide timestamps.
+ */
+double CANopen::getLatencyMax(uint32_t nodeID) {
+    
+    if (nodeID > 127) throw invalid_argument("CANopen: wrong node identifier!");
+    
+    return latencyMax[nodeID];
+}
+
+/**
+ * Resets the statistics of all nodes.
+ */
+void CANopen::resetStatistics() {
+    
+    for (uint32_t i = 0; i < 128; i++) {
         
-        if (can.read(canMessage) != 0) {
-            
-            if (canMessage.type == CANData) {
-                
-                uint32_t id = canMessage.id;
-                uint32_t functionCode = id & FUNCTION_CODE_BITMASK;
-                uint32_t nodeID = id & NODE_ID_BITMASK;
-                
-                if (delegate[nodeID] != NULL) delegate[nodeID]->receiveObject(functionCode, canMessage.data);
-                
-                mutex.lock();
-                
-                if (functionCode == EMERGENCY) {
-                    for (uint8_t i = 0; i < 8; i++) emergencyObject[nodeID][i] = canMessage.data[i];
-                    emergencyObjectReceived[nodeID] = true;
-                } else if (functionCode == TPDO1) {
-                    for (uint8_t i = 0; i < 8; i++) tpdo1[nodeID][i] = canMessage.data[i];
-                    tpdo1Received[nodeID] = true;
-                } else if (functionCode == TPDO2) {
-                    for (uint8_t i = 0; i < 8; i++) tpdo2[nodeID][i] = canMessage.data[i];
-                    tpdo2Received[nodeID] = true;
-                } else if (functionCode == TPDO3) {
-                    for (uint8_t i = 0; i < 8; i++) tpdo3[nodeID][i] = canMessage.data[i];
-                    tpdo3Received[nodeID] = true;
-                } else if (functionCode == TPDO4) {
-                    for (uint8_t i = 0; i < 8; i++) tpdo4[nodeID][i] = canMessage.data[i];
-                    tpdo4Received[nodeID] = true;
-                } else if (functionCode == TSDO) {
-                    for (uint8_t i = 0; i < 8; i++) tsdo[nodeID][i] = canMessage.data[i];
-                    tsdoReceived[nodeID] = true;
-                } else if (functionCode == NODEGUARD) {
-                    for (uint8_t i = 0; i < 8; i++) nodeguardObject[nodeID][i] = canMessage.data[i];
-                    nodeguardObjectReceived[nodeID] = true;
-                }
-                
-                mutex.unlock();
-                
-            } else {
-                
-                // remote message received, ignore message
-            }
+        numberOfReceivedObjects[i] = 0;
+        numberOfLostObjects[i] = 0;
+        numberOfMeasuredLatencies[i] = 0;
+        latencySum[i] = 0.0;
+        latencyMax[i] = 0.0;
+    }
+}
+
+/**
+ * Gets the receiver of objects with a given function code and node ID.
+ * @param functionCode the function code of the objects, i.e. <code>TPDO1</code>.
+ * @param nodeID the identifier of the node.
+ * @return a reference to the entry of the dispatch table for these objects.
+ */
+CANopen::Receiver& CANopen::getReceiver(uint32_t functionCode, uint32_t nodeID) {
+    
+    return receivers[(functionCode | nodeID) & COB_ID_BITMASK];
+}
+
+/**
+ * Checks if an entry of the object dictionary of a node is set to a given value.
+ * @param snapshot a snapshot of the object dictionary of the node.
+ * @param index the index of the entry.
+ * @param subindex the subindex of the entry.
+ * @param value the value to compare.
+ * @return <code>true</code> if the entry is known to be set to this value, <code>false</code> otherwise.
+ */
+bool CANopen::isSet(map<uint32_t, uint32_t>& snapshot, uint16_t index, uint8_t subindex, uint32_t value) {
+    
+    map<uint32_t, uint32_t>::iterator entry = snapshot.find((static_cast<uint32_t>(index) << 8) | static_cast<uint32_t>(subindex));
+    
+    return (entry != snapshot.end()) && (entry->second == value);
+}
+
+/**
+ * Starts the download of an expedited service data object to a node.
+ * @param nodeID the identifier of the node.
+ * @param index the index of the service data object.
+ * @param subindex the subindex of the service data object.
+ * @param value the value to write.
+ * @param length the number of bytes to write, usually 1, 2 or 4.
+ * @return a pointer to the service data object that was created, which needs to be deleted when the transfer is completed.
+ */
+CANopen::ServiceDataObject* CANopen::write(uint32_t nodeID, uint16_t index, uint8_t subindex, uint32_t value, uint8_t length) {
+    
+    ServiceDataObject* serviceDataObject = new ServiceDataObject(index, subindex, 4);
+    serviceDataObject->setValue(value, length);
+    
+    download(nodeID, *serviceDataObject);
+    
+    return serviceDataObject;
+}
+
+/**
+ * Appends a service data object to the queue of a node.
+ * @param nodeID the identifier of the node.
+ * @param serviceDataObject the service data object to transfer.
+ * @param download a flag for a download, or an upload otherwise.
+ */
+void CANopen::transfer(uint32_t nodeID, ServiceDataObject& serviceDataObject, bool download) {
+    
+    if ((nodeID < 1) || (nodeID > 127)) throw invalid_argument("CANopen: wrong node identifier!");
+    
+    if (serviceDataObject.state.load(memory_order_acquire) == ServiceDataObject::STATE_PENDING) {
+        
+        stringstream index;
+        index << hex << serviceDataObject.index;
+        
+        throw runtime_error("CANopen: service data object 0x"+index.str()+" is already pending.");
+    }
+    
+    serviceDataObject.download = download;
+    serviceDataObject.phase = ServiceDataObject::PHASE_IDLE;
+    serviceDataObject.offset = 0;
+    serviceDataObject.toggle = 0;
+    serviceDataObject.retries = 0;
+    serviceDataObject.abortCode = 0;
+    serviceDataObject.next = NULL;
+    serviceDataObject.state.store(ServiceDataObject::STATE_PENDING, memory_order_relaxed);
+    
+    if (!download) serviceDataObject.length = 0;
+    
+    sdoMutex.lock();
+    
+    if (lastServiceDataObject[nodeID] != NULL) lastServiceDataObject[nodeID]->next = &serviceDataObject;
+    else firstServiceDataObject[nodeID] = &serviceDataObject;
+    lastServiceDataObject[nodeID] = &serviceDataObject;
+    
+    sdoMutex.unlock();
+}
+
+/**
+ * Transmits the request that initiates the transfer of a service data object.
+ * @param nodeID the identifier of the node.
+ * @param serviceDataObject the service data object to transfer.
+ */
+void CANopen::transmitRequest(uint32_t nodeID, ServiceDataObject* serviceDataObject) {
+    
+    CANMessage canMessage;
+    canMessage.id = RSDO | nodeID;
+    canMessage.data[1] = serviceDataObject->index & 0xFF;
+    canMessage.data[2] = (serviceDataObject->index >> 8) & 0xFF;
+    canMessage.data[3] = serviceDataObject->subindex;
+    
+    uint16_t length = serviceDataObject->length;
+    
+    if (serviceDataObject->block) {
+        
+        if (serviceDataObject->download) {
+            
+            canMessage.data[0] = 0xC2;  // block download with indicated size, without CRC
+            canMessage.data[4] = length & 0xFF;
+            canMessage.data[5] = (length >> 8) & 0xFF;
             
         } else {
             
-            // no message received
+            canMessage.data[0] = 0xA0;  // block upload without CRC
+            canMessage.data[4] = BLOCK_SIZE;
+            canMessage.data[5] = 0;     // protocol switch threshold
+        }
+        
+        serviceDataObject->phase = ServiceDataObject::PHASE_BLOCK_INITIATE;
+        
+    } else {
+        
+        if (serviceDataObject->download && (length > 0) && (length <= 4)) {
+            
+            canMessage.data[0] = 0x23+((4-length) << 2);    // expedited download
+            for (uint16_t i = 0; i < length; i++) canMessage.data[4+i] = serviceDataObject->data[i];
+            
+        } else if (serviceDataObject->download) {
+            
+            canMessage.data[0] = 0x21;  // segmented download with indicated size
+            canMessage.data[4] = length & 0xFF;
+            canMessage.data[5] = (length >> 8) & 0xFF;
+            
+        } else {
+            
+            canMessage.data[0] = 0x40;  // upload
+        }
+        
+        serviceDataObject->phase = ServiceDataObject::PHASE_INITIATE;
+    }
+    
+    serviceDataObject->time = Thread::currentTimeMillis();
+    
+    can.write(canMessage);
+}
+
+/**
+ * Transmits the segments of the current block of a block download, until the block is
+ * complete or the transmit buffer of the CAN device driver is full.
+ * @param nodeID the identifier of the node.
+ * @param serviceDataObject the service data object to transfer.
+ */
+void CANopen::transmitSegments(uint32_t nodeID, ServiceDataObject* serviceDataObject) {
+    
+    while (!serviceDataObject->last && (serviceDataObject->sequence < serviceDataObject->blockSize)) {
+        
+        uint16_t length = min(static_cast<uint16_t>(serviceDataObject->length-serviceDataObject->offset), static_cast<uint16_t>(7));
+        bool last = (serviceDataObject->offset+length >= serviceDataObject->length);
+        
+        CANMessage canMessage;
+        canMessage.id = RSDO | nodeID;
+        canMessage.data[0] = (last ? 0x80 : 0x00) | (serviceDataObject->sequence+1);
+        for (uint16_t i = 0; i < length; i++) canMessage.data[1+i] = serviceDataObject->data[serviceDataObject->offset+i];
+        
+        if (can.write(canMessage) == 0) break;
+        
+        serviceDataObject->sequence++;
+        serviceDataObject->offset += length;
+        serviceDataObject->last = last;
+        serviceDataObject->time = Thread::currentTimeMillis();
+    }
+}
+
+/**
+ * Transmits a request to abort the transfer of a service data object.
+ * @param nodeID the identifier of the node.
+ * @param serviceDataObject the service data object to abort.
+ * @param abortCode the CANopen abort code.
+ */
+void CANopen::transmitAbortRequest(uint32_t nodeID, ServiceDataObject* serviceDataObject, uint32_t abortCode) {
+    
+    CANMessage canMessage;
+    canMessage.id = RSDO | nodeID;
+    canMessage.data[0] = 0x80;
+    canMessage.data[1] = serviceDataObject->index & 0xFF;
+    canMessage.data[2] = (serviceDataObject->index >> 8) & 0xFF;
+    canMessage.data[3] = serviceDataObject->subindex;
+    canMessage.data[4] = abortCode & 0xFF;
+    canMessage.data[5] = (abortCode >> 8) & 0xFF;
+    canMessage.data[6] = (abortCode >> 16) & 0xFF;
+    canMessage.data[7] = (abortCode >> 24) & 0xFF;
+    
+    can.write(canMessage);
+}
+
+/**
+ * Processes a response of the SDO server of a node, and transmits the next request of
+ * the current transfer, if needed. This method is called by the handler of this driver.
+ * @param nodeID the identifier of the node.
+ * @param response the received object with the response.
+ * @param completed a reference to a list of service data objects with completed transfers.
+ */
+void CANopen::processResponse(uint32_t nodeID, uint8_t response[], ServiceDataObject*& completed) {
+    
+    ServiceDataObject* serviceDataObject = firstServiceDataObject[nodeID];
+    
+    if ((serviceDataObject == NULL) || (serviceDataObject->phase == ServiceDataObject::PHASE_IDLE)) return;
+    
+    uint8_t command = response[0];
+    uint16_t index = static_cast<uint16_t>(response[1]) | (static_cast<uint16_t>(response[2]) << 8);
+    uint8_t subindex = response[3];
+    bool initiate = (serviceDataObject->phase == ServiceDataObject::PHASE_INITIATE) || (serviceDataObject->phase == ServiceDataObject::PHASE_BLOCK_INITIATE);
+    
+    // ignore responses to initiate requests of other objects, i.e. late responses to repeated requests
+    
+    if (initiate && ((index != serviceDataObject->index) || (subindex != serviceDataObject->subindex))) return;
+    
+    serviceDataObject->time = Thread::currentTimeMillis();
+    
+    if (command == 0x80) {
+        
+        // the transfer was aborted by the SDO server
+        
+        uint32_t abortCode = static_cast<uint32_t>(response[4]) | (static_cast<uint32_t>(response[5]) << 8) | (static_cast<uint32_t>(response[6]) << 16) | (static_cast<uint32_t>(response[7]) << 24);
+        
+        complete(nodeID, (abortCode != 0) ? abortCode : 0x08000000, completed);
+        
+        return;
+    }
+    
+    CANMessage canMessage;
+    canMessage.id = RSDO | nodeID;
+    
+    uint32_t abortCode = 0x05040001;    // command specifier not valid
+    
+    if (serviceDataObject->download) {
+        
+        if ((serviceDataObject->phase == ServiceDataObject::PHASE_INITIATE) && (command == 0x60)) {
+            
+            if ((serviceDataObject->length > 0) && (serviceDataObject->length <= 4)) {
+                complete(nodeID, 0, completed);
+                return;
+            }
+            
+            serviceDataObject->phase = ServiceDataObject::PHASE_SEGMENT;
+            serviceDataObject->offset = 0;
+            serviceDataObject->toggle = 0;
+            abortCode = 0;
+            
+        } else if ((serviceDataObject->phase == ServiceDataObject::PHASE_SEGMENT) && ((command & 0xEF) == 0x20)) {
+            
+            if (((command >> 4) & 0x01) != serviceDataObject->toggle) {
+                abortCode = 0x05030000;     // toggle bit not alternated
+            } else if (serviceDataObject->offset >= serviceDataObject->length) {
+                complete(nodeID, 0, completed);
+                return;
+            } else {
+                serviceDataObject->toggle ^= 0x01;
+                abortCode = 0;
+            }
+            
+        } else if ((serviceDataObject->phase == ServiceDataObject::PHASE_BLOCK_INITIATE) && ((command & 0xE3) == 0xA0)) {
+            
+            serviceDataObject->phase = ServiceDataObject::PHASE_BLOCK;
+            serviceDataObject->offset = 0;
+            serviceDataObject->blockOffset = 0;
+            serviceDataObject->blockSize = response[4];
+            serviceDataObject->sequence = 0;
+            serviceDataObject->last = false;
+            
+            if ((serviceDataObject->blockSize < 1) || (serviceDataObject->blockSize > 127)) {
+                abortCode = 0x05040002;     // invalid block size
+            } else {
+                transmitSegments(nodeID, serviceDataObject);
+                return;
+            }
+            
+        } else if ((serviceDataObject->phase == ServiceDataObject::PHASE_BLOCK) && ((command & 0xE3) == 0xA2)) {
+            
+            uint8_t sequence = response[1];
+            uint8_t blockSize = response[2];
+            
+            if (sequence < serviceDataObject->sequence) {
+                
+                // repeat the segments that weren't received by the SDO server
+                
+                serviceDataObject->offset = serviceDataObject->blockOffset+7*sequence;
+                serviceDataObject->last = false;
+            }
+            
+            if (serviceDataObject->last) {
+                
+                uint16_t length = serviceDataObject->length;
+                uint8_t unused = (length == 0) ? 7 : (7-length%7)%7;
+                
+                canMessage.data[0] = 0xC1 | (unused << 2);  // end of block download, without CRC
+                serviceDataObject->phase = ServiceDataObject::PHASE_BLOCK_END;
+                abortCode = 0;
+                
+            } else if ((blockSize < 1) || (blockSize > 127)) {
+                
+                abortCode = 0x05040002;     // invalid block size
+                
+            } else {
+                
+                serviceDataObject->blockOffset = serviceDataObject->offset;
+                serviceDataObject->blockSize = blockSize;
+                serviceDataObject->sequence = 0;
+                
+                transmitSegments(nodeID, serviceDataObject);
+                
+                return;
+            }
+            
+        } else if ((serviceDataObject->phase == ServiceDataObject::PHASE_BLOCK_END) && ((command & 0xE3) == 0xA1)) {
+            
+            complete(nodeID, 0, completed);
+            
+            return;
+        }
+        
+        if (serviceDataObject->phase == ServiceDataObject::PHASE_SEGMENT) {
+            
+            // transmit the next segment of a segmented download
+            
+            uint16_t length = min(static_cast<uint16_t>(serviceDataObject->length-serviceDataObject->offset), static_cast<uint16_t>(7));
+            bool last = (serviceDataObject->offset+length >= serviceDataObject->length);
+            
+            canMessage.data[0] = (serviceDataObject->toggle << 4) | ((7-length) << 1) | (last ? 0x01 : 0x00);
+            for (uint16_t i = 0; i < length; i++) canMessage.data[1+i] = serviceDataObject->data[serviceDataObject->offset+i];
+            
+            serviceDataObject->offset += length;
+        }
+        
+    } else {
+        
+        if ((serviceDataObject->phase == ServiceDataObject::PHASE_INITIATE) && ((command & 0xE0) == 0x40)) {
+            
+            if ((command & 0x02) > 0) {
+                
+                // expedited upload
+                
+                uint16_t length = ((command & 0x01) > 0) ? 4-((command >> 2) & 0x03) : 4;
+                
+                if (length > serviceDataObject->size) {
+                    abortCode = 0x05040005;     // out of memory
+                } else {
+                    for (uint16_t i = 0; i < length; i++) serviceDataObject->data[i] = response[4+i];
+                    serviceDataObject->length = length;
+                    complete(nodeID, 0, completed);
+                    return;
+                }
+                
+            } else if (((command & 0x01) > 0) && ((static_cast<uint32_t>(response[4]) | (static_cast<uint32_t>(response[5]) << 8) | (static_cast<uint32_t>(response[6]) << 16) | (static_cast<uint32_t>(response[7]) << 24)) > serviceDataObject->size)) {
+                
+                abortCode = 0x05040005;     // out of memory
+                
+            } else {
+                
+                serviceDataObject->phase = ServiceDataObject::PHASE_SEGMENT;
+                serviceDataObject->offset = 0;
+                serviceDataObject->toggle = 0;
+                abortCode = 0;
+            }
+            
+        } else if ((serviceDataObject->phase == ServiceDataObject::PHASE_SEGMENT) && ((command & 0xE0) == 0x00)) {
+            
+            uint16_t length = 7-((command >> 1) & 0x07);
+            
+            if (((command >> 4) & 0x01) != serviceDataObject->toggle) {
+                abortCode = 0x05030000;     // toggle bit not alternated
+            } else if (serviceDataObject->offset+length > serviceDataObject->size) {
+                abortCode = 0x05040005;     // out of memory
+            } else {
+                for (uint16_t i = 0; i < length; i++) serviceDataObject->data[serviceDataObject->offset+i] = response[1+i];
+                serviceDataObject->offset += length;
+                serviceDataObject->length = serviceDataObject->offset;
+                if ((command & 0x01) > 0) {
+                    complete(nodeID, 0, completed);
+                    return;
+                }
+                serviceDataObject->toggle ^= 0x01;
+                abortCode = 0;
+            }
+            
+        } else if ((serviceDataObject->phase == ServiceDataObject::PHASE_BLOCK_INITIATE) && ((command & 0xE1) == 0xC0)) {
+            
+            if (((command & 0x02) > 0) && ((static_cast<uint32_t>(response[4]) | (static_cast<uint32_t>(response[5]) << 8) | (static_cast<uint32_t>(response[6]) << 16) | (static_cast<uint32_t>(response[7]) << 24)) > serviceDataObject->size)) {
+                
+                abortCode = 0x05040005;     // out of memory
+                
+            } else {
+                
+                canMessage.data[0] = 0xA3;  // start upload
+                
+                serviceDataObject->phase = ServiceDataObject::PHASE_BLOCK;
+                serviceDataObject->offset = 0;
+                serviceDataObject->sequence = 0;
+                serviceDataObject->last = false;
+                abortCode = 0;
+            }
+            
+        } else if (serviceDataObject->phase == ServiceDataObject::PHASE_BLOCK) {
+            
+            // segment of a block upload, which doesn't have a command specifier
+            
+            uint8_t sequence = command & 0x7F;
+            
+            if (sequence == serviceDataObject->sequence+1) {
+                
+                for (uint16_t i = 0; (i < 7) && (serviceDataObject->offset+i < serviceDataObject->size); i++) serviceDataObject->data[serviceDataObject->offset+i] = response[1+i];
+                
+                serviceDataObject->offset += 7;
+                serviceDataObject->sequence = sequence;
+                serviceDataObject->last = ((command & 0x80) > 0);
+            }
+            
+            if ((sequence < BLOCK_SIZE) && ((command & 0x80) == 0)) return;
+            
+            // acknowledge the block with the sequence number of the last segment received in order
+            
+            canMessage.data[0] = 0xA2;
+            canMessage.data[1] = serviceDataObject->sequence;
+            canMessage.data[2] = BLOCK_SIZE;
+            
+            if (serviceDataObject->last) serviceDataObject->phase = ServiceDataObject::PHASE_BLOCK_END;
+            serviceDataObject->sequence = 0;
+            abortCode = 0;
+            
+        } else if ((serviceDataObject->phase == ServiceDataObject::PHASE_BLOCK_END) && ((command & 0xE3) == 0xC1)) {
+            
+            uint8_t unused = (command >> 2) & 0x07;
+            
+            if ((unused > serviceDataObject->offset) || (serviceDataObject->offset-unused > serviceDataObject->size)) {
+                abortCode = 0x05040005;     // out of memory
+            } else {
+                canMessage.data[0] = 0xA1;  // end of block upload
+                serviceDataObject->length = serviceDataObject->offset-unused;
+                can.write(canMessage);
+                complete(nodeID, 0, completed);
+                return;
+            }
+        }
+        
+        if (serviceDataObject->phase == ServiceDataObject::PHASE_SEGMENT) {
+            
+            // request the next segment of a segmented upload
+            
+            canMessage.data[0] = 0x60 | (serviceDataObject->toggle << 4);
+        }
+    }
+    
+    if (abortCode != 0) {
+        
+        transmitAbortRequest(nodeID, serviceDataObject, abortCode);
+        complete(nodeID, abortCode, completed);
+        
+    } else {
+        
+        can.write(canMessage);
+    }
+}
+
+/**
+ * Starts the transfers of service data objects that are waiting in the queues of the nodes,
+ * continues block downloads, and aborts transfers that timed out. Initiate requests that
+ * aren't answered are repeated a few times before a transfer is aborted. This method is
+ * called by the handler of this driver in every period.
+ * @param completed a reference to a list of service data objects with completed transfers.
+ */
+void CANopen::processTransfers(ServiceDataObject*& completed) {
+    
+    int32_t time = Thread::currentTimeMillis();
+    
+    for (uint32_t nodeID = 1; nodeID < 128; nodeID++) {
+        
+        ServiceDataObject* serviceDataObject = firstServiceDataObject[nodeID];
+        
+        if (serviceDataObject == NULL) continue;
+        
+        bool initiate = (serviceDataObject->phase == ServiceDataObject::PHASE_INITIATE) || (serviceDataObject->phase == ServiceDataObject::PHASE_BLOCK_INITIATE);
+        
+        if (serviceDataObject->phase == ServiceDataObject::PHASE_IDLE) {
+            
+            transmitRequest(nodeID, serviceDataObject);
+            
+        } else if (initiate && (time-serviceDataObject->time > static_cast<int32_t>(TIMEOUT/RETRIES)) && (++serviceDataObject->retries < RETRIES)) {
+            
+            transmitRequest(nodeID, serviceDataObject);
+            
+        } else if ((initiate && (time-serviceDataObject->time > static_cast<int32_t>(TIMEOUT/RETRIES))) || (time-serviceDataObject->time > static_cast<int32_t>(TIMEOUT))) {
+            
+            transmitAbortRequest(nodeID, serviceDataObject, 0x05040000);
+            complete(nodeID, 0x05040000, completed);
+            
+        } else if ((serviceDataObject->phase == ServiceDataObject::PHASE_BLOCK) && serviceDataObject->download) {
+            
+            transmitSegments(nodeID, serviceDataObject);
+        }
+    }
+}
+
+/**
+ * Removes the current service data object from the queue of a node, and appends it
+ * to the list of service data objects with completed transfers.
+ * @param nodeID the identifier of the node.
+ * @param abortCode the CANopen abort code of a failed transfer, or 0 if the transfer was successful.
+ * @param completed a reference to a list of service data objects with completed transfers.
+ */
+void CANopen::complete(uint32_t nodeID, uint32_t abortCode, ServiceDataObject*& completed) {
+    
+    ServiceDataObject* serviceDataObject = firstServiceDataObject[nodeID];
+    
+    firstServiceDataObject[nodeID] = serviceDataObject->next;
+    if (firstServiceDataObject[nodeID] == NULL) lastServiceDataObject[nodeID] = NULL;
+    
+    // update the snapshot of the object dictionary of the node
+    
+    uint32_t key = (static_cast<uint32_t>(serviceDataObject->index) << 8) | static_cast<uint32_t>(serviceDataObject->subindex);
+    
+    if ((abortCode == 0) && (serviceDataObject->length > 0) && (serviceDataObject->length <= 4)) objectDictionary[nodeID][key] = serviceDataObject->getValue();
+    else objectDictionary[nodeID].erase(key);
+    
+    serviceDataObject->phase = ServiceDataObject::PHASE_IDLE;
+    serviceDataObject->abortCode = abortCode;
+    serviceDataObject->result = (abortCode == 0) ? ServiceDataObject::STATE_COMPLETED : ServiceDataObject::STATE_ABORTED;
+    serviceDataObject->next = completed;
+    
+    completed = serviceDataObject;
+}
+
+/**
+ * This method is the handler of this CANopen device driver.
+ */
+void CANopen::run() {
+    
+    CANMessage canMessage;
+    uint64_t timestamp = 0;
+    
+    while (waitForNextPeriod()) {
+        
+        ServiceDataObject* completed = NULL;
+        
+        // dispatch all messages received since the last period
+        
+        Trace::begin("CANopen::receive");
+        
+        while (can.read(canMessage, timestamp) != 0) {
+            
+            if ((canMessage.type == CANData) && (canMessage.id < COB_IDS)) {
+                
+                Receiver& receiver = receivers[canMessage.id];
+                uint32_t nodeID = receiver.nodeID;
+                
+                numberOfReceivedObjects[nodeID]++;
+                
+                if (timestamp > 0) {
+                    
+                    timespec currentTime;
+                    clock_gettime(CLOCK_REALTIME, &currentTime);
+                    
+                    double latency = 1.0e-9*static_cast<double>(static_cast<int64_t>(static_cast<uint64_t>(currentTime.tv_sec)*1000000000ULL+static_cast<uint64_t>(currentTime.tv_nsec)-timestamp));
+                    
+                    numberOfMeasuredLatencies[nodeID]++;
+                    latencySum[nodeID] += latency;
+                    if (latency > latencyMax[nodeID]) latencyMax[nodeID] = latency;
+                }
+                
+                if ((receiver.functionCode == NODEGUARD) && (canMessage.len == 1) && (canMessage.data[0] == 0x00)) {
+                    
+                    // boot-up message of a node, discard the snapshot of its object dictionary
+                    
+                    sdoMutex.lock();
+                    objectDictionary[nodeID].clear();
+                    sdoMutex.unlock();
+                }
+                
+                if (receiver.functionCode == TSDO) {
+                    
+                    // the queue of service data objects is only examined with the mutex locked
+                    
+                    sdoMutex.lock();
+                    processResponse(nodeID, canMessage.data, completed);
+                    sdoMutex.unlock();
+                }
+                
+                if (delegate[nodeID] != NULL) {
+                    Trace::Span span("CANopen::Delegate::receiveObject");
+                    delegate[nodeID]->receiveObject(receiver.functionCode, canMessage.data);
+                }
+                
+                if (receiver.object != NULL) {
+                    
+                    mutex.lock();
+                    
+                    if (*receiver.received && receiver.pending && (delegate[nodeID] == NULL)) numberOfLostObjects[nodeID]++;
+                    
+                    for (uint8_t i = 0; i < 8; i++) receiver.object[i] = canMessage.data[i];
+                    *receiver.received = true;
+                    receiver.pending = true;
+                    
+                    mutex.unlock();
+                }
+                
+            } else {
+                
+                // remote message or message with extended identifier received, ignore message
+            }
+        }
+        
+        Trace::end("CANopen::receive");
+        
+        // start and continue transfers of service data objects, and invoke the callback methods of completed objects
+        
+        Trace::begin("CANopen::processTransfers");
+        
+        sdoMutex.lock();
+        processTransfers(completed);
+        sdoMutex.unlock();
+        
+        while (completed != NULL) {
+            
+            ServiceDataObject* serviceDataObject = completed;
+            completed = completed->next;
+            
+            serviceDataObject->completed();
+            serviceDataObject->state.store(serviceDataObject->result, memory_order_release);
+        }
+        
+        Trace::end("CANopen::processTransfers");
+        
+        // let the device drivers transmit their objects back-to-back, followed by the SYNC object
+        
+        uint32_t syncPeriods = this->syncPeriods.load(memory_order_relaxed);
+        
+        if (syncPeriods == 0) {
+            
+            syncCounter = 0;
+            
+        } else if (++syncCounter >= syncPeriods) {
+            
+            syncCounter = 0;
+            
+            for (uint32_t i = 0; i < 128; i++) {
+                
+                if (delegate[i] != NULL) {
+                    Trace::Span span("CANopen::Delegate::transmitObjects");
+                    delegate[i]->transmitObjects();
+                }
+            }
+            
+            Trace::instant("CANopen::transmitSYNCObject");
+            
+            transmitSYNCObject();
         }
     }
 }
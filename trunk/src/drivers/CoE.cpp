@@ -8,7 +8,9 @@
  */
 
 #include <sstream>
+#include <cstring>
 #include "Thread.h"
+#include "Trace.h"
 #include "CoE.h"
 
 using namespace std;
@@ -21,6 +23,18 @@ template <class T> inline string type2String(const T& t) {
 	return out.str();
 }
 
+static string state2String(uint16_t state) {
+    
+    switch (state & EtherCAT::STATE_MASK) {
+        case EtherCAT::STATE_INIT: return "INIT";
+        case EtherCAT::STATE_BOOTSTRAP: return "BOOTSTRAP";
+        case EtherCAT::STATE_PRE_OPERATIONAL: return "PRE OPERATIONAL";
+        case EtherCAT::STATE_SAFE_OPERATIONAL: return "SAFE OPERATIONAL";
+        case EtherCAT::STATE_OPERATIONAL: return "OPERATIONAL";
+        default: return "UNKNOWN";
+    }
+}
+
 const int32_t CoE::PRIORITY = RealtimeThread::RT_MAX_PRIORITY-11;   // priority level of private thread
 
 /**
@@ -65,10 +79,149 @@ uint16_t CoE::CANopenMailboxDatagram::getMessageType() {
     return static_cast<uint16_t>((data[17] >> 4) & 0x0F);
 }
 
+/**
+ * Creates a service data object with a buffer of a given size.
+ * @param index the index of the CANopen service data object (16 bit).
+ * @param subindex the subindex of the CANopen service data object (8 bit).
+ * @param size the size of the buffer for the value of this object, given in [bytes].
+ */
+CoE::ServiceDataObject::ServiceDataObject(uint16_t index, uint8_t subindex, uint16_t size) : ServiceDataObject(index, subindex, size, false) {}
+
+/**
+ * Creates a service data object with a buffer of a given size, which is optionally
+ * transferred with complete access. With complete access, all entries of an object
+ * are transferred at once, starting with the given subindex, which must be 0 or 1.
+ * @param index the index of the CANopen service data object (16 bit).
+ * @param subindex the subindex of the first entry to transfer, either 0 or 1.
+ * @param size the size of the buffer for the value of this object, given in [bytes].
+ * @param completeAccess a flag indicating if this object should be transferred with complete access.
+ */
+CoE::ServiceDataObject::ServiceDataObject(uint16_t index, uint8_t subindex, uint16_t size, bool completeAccess) {
+    
+    data = new uint8_t[(size > 0) ? size : 1];
+    memset((void*)data, 0, (size > 0) ? size : 1);
+    length = 0;
+    
+    this->index = index;
+    this->subindex = subindex;
+    this->size = size;
+    this->completeAccess = completeAccess;
+    this->state.store(STATE_IDLE, memory_order_relaxed);
+    this->result = STATE_IDLE;
+    this->abortCode = 0;
+    this->download = false;
+    this->initiated = false;
+    this->offset = 0;
+    this->toggle = 0;
+    this->next = NULL;
+}
+
+/**
+ * Deletes the service data object and releases its buffer.
+ * A service data object must not be deleted while it is pending.
+ */
+CoE::ServiceDataObject::~ServiceDataObject() {
+    
+    delete[] data;
+}
+
+/**
+ * Gets the index of this service data object.
+ * @return the index of this service data object.
+ */
+uint16_t CoE::ServiceDataObject::getIndex() {
+    
+    return index;
+}
+
+/**
+ * Gets the subindex of this service data object.
+ * @return the subindex of this service data object.
+ */
+uint8_t CoE::ServiceDataObject::getSubindex() {
+    
+    return subindex;
+}
+
+/**
+ * Sets a simple value of this service data object, to be transferred with a download.
+ * @param value the value to set (8 - 32 bit).
+ * @param length the number of bytes the value consists of, usually 1, 2 or 4.
+ */
+void CoE::ServiceDataObject::setValue(uint32_t value, uint16_t length) {
+    
+    if (length > 4) length = 4;
+    if (length > size) length = size;
+    
+    for (uint16_t i = 0; i < length; i++) data[i] = static_cast<uint8_t>((value >> (8*i)) & 0xFF);
+    
+    this->length = length;
+}
+
+/**
+ * Gets a simple value of this service data object, i.e. after an upload.
+ * @return the value of this object, consisting of up to 4 bytes.
+ */
+uint32_t CoE::ServiceDataObject::getValue() {
+    
+    uint32_t value = 0;
+    for (uint16_t i = 0; (i < length) && (i < 4); i++) value |= (static_cast<uint32_t>(data[i]) & 0xFF) << (8*i);
+    
+    return value;
+}
+
+/**
+ * Gets the state of the transfer of this service data object.
+ * @return the state, i.e. <code>STATE_PENDING</code>, <code>STATE_COMPLETED</code> or <code>STATE_ABORTED</code>.
+ */
+uint8_t CoE::ServiceDataObject::getState() {
+    
+    return state.load(memory_order_acquire);
+}
+
+/**
+ * Gets the abort code of a failed transfer of this service data object. This is either
+ * the abort code sent by the slave device, or 0x05040000 if the transfer timed out.
+ * @return the CANopen abort code, or 0 if the transfer didn't fail.
+ */
+uint32_t CoE::ServiceDataObject::getAbortCode() {
+    
+    return abortCode;
+}
+
+/**
+ * Waits until the transfer of this service data object is completed, either successfully
+ * or not. This method must not be called by the communication handler itself, i.e. from
+ * the callback methods of a slave device driver.
+ * @return <code>true</code> if the transfer was successful, <code>false</code> otherwise.
+ */
+bool CoE::ServiceDataObject::waitForCompletion() {
+    
+    uint8_t state;
+    while ((state = this->state.load(memory_order_acquire)) == STATE_PENDING) Thread::sleep(1);
+    
+    return state == STATE_COMPLETED;
+}
+
+/**
+ * This method is called by the communication handler when the transfer of this service
+ * data object is completed, either successfully or not. It may be overridden to handle
+ * the result of a transfer without waiting for it. The state of this object changes from
+ * <code>STATE_PENDING</code> just after this method returned.
+ */
+void CoE::ServiceDataObject::completed() {}
+
 CoE::SlaveDevice::SlaveDevice() {}
 
 CoE::SlaveDevice::~SlaveDevice() {}
 
+/**
+ * This method is called by the communication handler when the slave device is in
+ * the state PRE OPERATIONAL, just before it is set to the state SAFE OPERATIONAL.
+ * It allows a slave device driver to configure its device, i.e. with service data objects.
+ */
+void CoE::SlaveDevice::configure() {}
+
 /**
  * This method is called by the communication handler just before a new
  * EtherCAT frame is transmitted on the fieldbus. It allows a slave device
@@ -83,8 +236,65 @@ void CoE::SlaveDevice::writeDatagram() {}
  */
 void CoE::SlaveDevice::readDatagram() {}
 
+/**
+ * Creates an empty configuration of a slave device.
+ * @param deviceAddress the relative device address, i.e. 0x0000, 0xFFFF, 0xFFFE, etc.
+ */
+CoE::SlaveConfiguration::SlaveConfiguration(uint16_t deviceAddress) {
+    
+    this->deviceAddress = deviceAddress;
+    this->slaveDevice = NULL;
+    this->mailboxOutAddress = 0;
+    this->mailboxOutSize = 0;
+    this->mailboxInAddress = 0;
+    this->mailboxInSize = 0;
+    this->pending = true;
+}
+
+/**
+ * Deletes the slave configuration object.
+ */
+CoE::SlaveConfiguration::~SlaveConfiguration() {}
+
+/**
+ * Creates a mailbox of a slave device with preallocated datagrams.
+ * @param deviceAddress the relative device address, i.e. 0x0000, 0xFFFF, 0xFFFE, etc.
+ * @param mailboxOutAddress the mailbox address for outgoing data within the EtherCAT slave controller.
+ * @param mailboxOutSize the size of the mailbox, given in [bytes].
+ * @param mailboxInAddress the mailbox address for incoming data within the EtherCAT slave controller.
+ * @param mailboxInSize the size of the mailbox, given in [bytes].
+ */
+CoE::Mailbox::Mailbox(uint16_t deviceAddress, uint16_t mailboxOutAddress, uint16_t mailboxOutSize, uint16_t mailboxInAddress, uint16_t mailboxInSize) {
+    
+    this->deviceAddress = deviceAddress;
+    this->out = new EtherCAT::Datagram(EtherCAT::COMMAND_APWR, deviceAddress, mailboxOutAddress, mailboxOutSize);
+    this->in = new EtherCAT::Datagram(EtherCAT::COMMAND_APRD, deviceAddress, mailboxInAddress, mailboxInSize);
+    this->first = NULL;
+    this->last = NULL;
+    this->state = STATE_IDLE;
+    this->counter = 0;
+    this->time = 0;
+}
+
+/**
+ * Deletes the mailbox object and releases its datagrams.
+ */
+CoE::Mailbox::~Mailbox() {
+    
+    delete out;
+    delete in;
+}
+
 CoE::CoE(EtherCAT& etherCAT, double period) : RealtimeThread("CoE", STACK_SIZE, PRIORITY, period), etherCAT(etherCAT) {
     
+    // create logical process image, this datagram is resized when process data is registered
+    
+    processImage = new EtherCAT::Datagram(EtherCAT::COMMAND_LRW, 0x0000, 0x0000, PROCESS_IMAGE_SIZE);
+    processImageLength = 0;
+    
+    startupDeferred = false;
+    systemTime = NULL;
+    
     // start handler
     
     start();
@@ -98,6 +308,34 @@ CoE::~CoE() {
     // stop handler
     
     stop();
+    
+    // delete process image
+    
+    frame.detach();
+    
+    while (processData.size()) {
+        delete processData.back();
+        processData.pop_back();
+    }
+    
+    delete processImage;
+    delete systemTime;
+    
+    // delete mailboxes
+    
+    mailboxFrame.detach();
+    
+    while (mailboxes.size()) {
+        delete mailboxes.back();
+        mailboxes.pop_back();
+    }
+    
+    // delete slave configurations
+    
+    while (slaveConfigurations.size()) {
+        delete slaveConfigurations.back();
+        slaveConfigurations.pop_back();
+    }
 }
 
 /**
@@ -107,7 +345,230 @@ CoE::~CoE() {
  */
 void CoE::addSlaveDevice(SlaveDevice* slaveDevice) {
     
+    mutex.lock();
+    
     slaveDevices.push_back(slaveDevice);
+    
+    mutex.unlock();
+}
+
+/**
+ * This method must be called by slave device drivers that declare their SYNC managers with
+ * <code>configureSyncManager()</code> and their process data with <code>registerProcessData()</code>.
+ * It registers the given slave device driver, so that its callback methods are invoked by the
+ * communication handler, and it brings the slave device up to the state OPERATIONAL, unless the
+ * startup was deferred with the <code>deferStartup()</code> method.
+ * <br/>
+ * This method must be called at the end of the constructor of a slave device driver, because the
+ * <code>SlaveDevice::configure()</code> method of the driver is called while the device is brought up.
+ * @param slaveDevice a pointer to the slave device driver to register.
+ * @param deviceAddress the relative device address, i.e. 0x0000, 0xFFFF, 0xFFFE, etc.
+ */
+void CoE::addSlaveDevice(SlaveDevice* slaveDevice, uint16_t deviceAddress) {
+    
+    SlaveConfiguration* slaveConfiguration = getSlaveConfiguration(deviceAddress);
+    slaveConfiguration->slaveDevice = slaveDevice;
+    
+    if (!startupDeferred) {
+        
+        vector<SlaveConfiguration*> slaveConfigurations(1, slaveConfiguration);
+        
+        bringUp(slaveConfigurations);
+        
+        if (slaveConfiguration->error.size() > 0) {
+            throw runtime_error("CoE: slave device 0x"+type2String(deviceAddress)+" "+slaveConfiguration->error+".");
+        }
+    }
+}
+
+/**
+ * Declares a SYNC manager of a slave device. The SYNC manager registers of all declared
+ * SYNC managers of a slave device are written with a single datagram when this slave device
+ * is brought up, see <code>addSlaveDevice(slaveDevice, deviceAddress)</code>.
+ * @param deviceAddress the relative device address, i.e. 0x0000, 0xFFFF, 0xFFFE, etc.
+ * @param syncManager the number of the SYNC manager to configure, i.e. 0, 1, 2, etc.
+ * @param physicalAddress the physical start address of this SYNC manager in the process data RAM.
+ * @param length the length of the buffer of this SYNC manager, given in [bytes].
+ * @param control the value of the control register of this SYNC manager, i.e. 0x26 for a mailbox
+ * written by the master, or 0x64 for a buffer with output process data.
+ * @param enable a flag indicating if this SYNC manager should be activated or not.
+ */
+void CoE::configureSyncManager(uint16_t deviceAddress, uint8_t syncManager, uint16_t physicalAddress, uint16_t length, uint8_t control, bool enable) {
+    
+    SlaveConfiguration* slaveConfiguration = getSlaveConfiguration(deviceAddress);
+    
+    size_t offset = syncManager*EtherCAT::SYNC_MANAGER_OFFSET;
+    if (slaveConfiguration->syncManagers.size() < offset+EtherCAT::SYNC_MANAGER_OFFSET) slaveConfiguration->syncManagers.resize(offset+EtherCAT::SYNC_MANAGER_OFFSET, 0);
+    
+    slaveConfiguration->syncManagers[offset+0] = static_cast<uint8_t>(physicalAddress & 0xFF);  // physical start address
+    slaveConfiguration->syncManagers[offset+1] = static_cast<uint8_t>((physicalAddress >> 8) & 0xFF);
+    slaveConfiguration->syncManagers[offset+2] = static_cast<uint8_t>(length & 0xFF);           // length
+    slaveConfiguration->syncManagers[offset+3] = static_cast<uint8_t>((length >> 8) & 0xFF);
+    slaveConfiguration->syncManagers[offset+4] = control;                                       // control register
+    slaveConfiguration->syncManagers[offset+5] = 0;                                             // status register
+    slaveConfiguration->syncManagers[offset+6] = enable ? 1 : 0;                                // activate
+    slaveConfiguration->syncManagers[offset+7] = 0;                                             // PDI control
+    
+    // remember the addresses and sizes of mailboxes
+    
+    if ((control & 0x03) == 0x02) {
+        if ((control & 0x0C) == 0x04) {
+            slaveConfiguration->mailboxOutAddress = physicalAddress;    // mailbox written by the master
+            slaveConfiguration->mailboxOutSize = length;
+        } else {
+            slaveConfiguration->mailboxInAddress = physicalAddress;     // mailbox read by the master
+            slaveConfiguration->mailboxInSize = length;
+        }
+    }
+}
+
+/**
+ * Defers the startup of slave devices that are added with <code>addSlaveDevice(slaveDevice, deviceAddress)</code>
+ * until the <code>startup()</code> method is called. This allows to bring up all slave devices of
+ * a segment in parallel.
+ */
+void CoE::deferStartup() {
+    
+    startupDeferred = true;
+}
+
+/**
+ * Brings all pending slave devices up to the state OPERATIONAL. The SYNC managers and FMMUs of
+ * all slave devices are written with a few frames, and the state transitions are requested with
+ * a broadcast datagram, if all slave devices on the segment are pending.
+ * <br/>
+ * Slave devices that fail to start up do not prevent other slave devices from reaching the state
+ * OPERATIONAL. The failures of all slave devices are reported at the end, with an exception.
+ */
+void CoE::startup() {
+    
+    startupDeferred = false;
+    
+    vector<SlaveConfiguration*> slaveConfigurations;
+    for (uint16_t i = 0; i < this->slaveConfigurations.size(); i++) {
+        if (this->slaveConfigurations[i]->pending && (this->slaveConfigurations[i]->slaveDevice != NULL)) slaveConfigurations.push_back(this->slaveConfigurations[i]);
+    }
+    
+    bringUp(slaveConfigurations);
+    
+    // report failures of slave devices
+    
+    uint16_t failures = 0;
+    for (uint16_t i = 0; i < slaveConfigurations.size(); i++) {
+        if (slaveConfigurations[i]->error.size() > 0) {
+            cerr << "CoE: slave device 0x" << hex << slaveConfigurations[i]->deviceAddress << " " << slaveConfigurations[i]->error << "." << dec << endl;
+            failures++;
+        }
+    }
+    
+    if (failures > 0) {
+        stringstream message;
+        message << "CoE: " << failures << " of " << slaveConfigurations.size() << " slave devices failed to start up.";
+        throw runtime_error(message.str());
+    }
+}
+
+/**
+ * Configures and activates the distributed clock of a slave device. This method is usually called
+ * by slave device drivers in their <code>SlaveDevice::configure()</code> method, while the slave
+ * device is in the state PRE OPERATIONAL.
+ * <br/>
+ * The first call of this method initializes the distributed clocks of the segment, see
+ * <code>initializeDistributedClocks()</code>. The start time of the cyclic operation is then
+ * set to a multiple of the given cycle time, plus the given shift time, so that the SYNC signals
+ * of all slave devices with the same cycle time are aligned with each other.
+ * @param deviceAddress the relative device address, i.e. 0x0000, 0xFFFF, 0xFFFE, etc.
+ * @param activation the value of the activation register, i.e. 0x03 to activate the SYNC0 signal,
+ * or 0x07 to activate the SYNC0 and SYNC1 signals.
+ * @param cycleTime the cycle time of the SYNC0 signal, given in [ns].
+ * @param shiftTime the shift time of the SYNC0 signal relative to the distributed system time, given in [ns].
+ */
+void CoE::activateDistributedClock(uint16_t deviceAddress, uint8_t activation, uint32_t cycleTime, int32_t shiftTime) {
+    
+    if (cycleTime == 0) throw runtime_error("CoE: cycle time of a distributed clock must not be 0.");
+    
+    if (systemTime == NULL) initializeDistributedClocks();
+    
+    // deactivate cyclic operation and set cycle time
+    
+    etherCAT.write8(deviceAddress, EtherCAT::DC_ACTIVATION_REGISTER, 0x00);
+    etherCAT.write32(deviceAddress, EtherCAT::DC_SYNC0_CYCLE_TIME, cycleTime);
+    
+    // set start time of cyclic operation on a multiple of the cycle time, and activate cyclic operation
+    
+    uint64_t startTime = etherCAT.read64(deviceAddress, EtherCAT::DC_SYSTEM_TIME)+SYNC_START_DELAY;
+    startTime = (startTime/cycleTime+1)*cycleTime+static_cast<int64_t>(shiftTime);
+    
+    etherCAT.write64(deviceAddress, EtherCAT::DC_START_TIME_CYCLIC_OPERATION, startTime);
+    etherCAT.write8(deviceAddress, EtherCAT::DC_ACTIVATION_REGISTER, activation);
+}
+
+/**
+ * Gets the time of the reference clock, as it was distributed on the segment with the last
+ * communication cycle.
+ * @return the distributed system time, given in [ns], or 0 if distributed clocks are not used.
+ */
+uint64_t CoE::getSystemTime() {
+    
+    uint64_t value = 0;
+    
+    mutex.lock();
+    
+    if (systemTime != NULL) {
+        for (uint16_t i = 0; i < systemTime->length-12; i++) value |= (static_cast<uint64_t>(systemTime->data[10+i]) & 0xFF) << (8*i);
+    }
+    
+    mutex.unlock();
+    
+    return value;
+}
+
+/**
+ * Gets the difference between the local copy of the system time of a slave device and the
+ * system time distributed by the reference clock. This value allows to monitor the quality
+ * of the drift compensation of the distributed clocks.
+ * @param deviceAddress the relative device address, i.e. 0x0000, 0xFFFF, 0xFFFE, etc.
+ * @return the system time difference, given in [ns].
+ */
+int32_t CoE::getSystemTimeDifference(uint16_t deviceAddress) {
+    
+    uint32_t value = etherCAT.read32(deviceAddress, EtherCAT::DC_SYSTEM_TIME_DIFFERENCE);
+    
+    // this register uses a sign and magnitude representation
+    
+    return ((value & 0x80000000) > 0) ? -static_cast<int32_t>(value & 0x7FFFFFFF) : static_cast<int32_t>(value & 0x7FFFFFFF);
+}
+
+/**
+ * Starts the upload of a service data object from a slave device. This method doesn't wait for
+ * the transfer, which is processed by the communication handler with the mailbox of the slave
+ * device. The mailbox must have been declared with the <code>configureSyncManager()</code> method.
+ * <br/>
+ * Service data objects of a slave device are transferred one after the other, in the order
+ * the transfers were started. Transfers with different slave devices are processed in parallel.
+ * @param deviceAddress the relative device address, i.e. 0x0000, 0xFFFF, 0xFFFE, etc.
+ * @param serviceDataObject a reference to the service data object to upload. This object must
+ * not be accessed or deleted until the transfer is completed.
+ */
+void CoE::upload(uint16_t deviceAddress, ServiceDataObject& serviceDataObject) {
+    
+    transfer(getMailbox(deviceAddress), serviceDataObject, false);
+}
+
+/**
+ * Starts the download of a service data object to a slave device. This method doesn't wait for
+ * the transfer, which is processed by the communication handler with the mailbox of the slave
+ * device. The mailbox must have been declared with the <code>configureSyncManager()</code> method.
+ * <br/>
+ * Service data objects of a slave device are transferred one after the other, in the order
+ * the transfers were started. Transfers with different slave devices are processed in parallel.
+ * @param deviceAddress the relative device address, i.e. 0x0000, 0xFFFF, 0xFFFE, etc.
+ * @param serviceDataObject a reference to the service data object to download. This object must
+ * not be accessed or deleted until the transfer is completed.
+ */
+void CoE::download(uint16_t deviceAddress, ServiceDataObject& serviceDataObject) {
+    
+    transfer(getMailbox(deviceAddress), serviceDataObject, true);
 }
 
 /**
@@ -117,15 +578,104 @@ void CoE::addSlaveDevice(SlaveDevice* slaveDevice) {
  * Typically, a slave device driver registers a datagram with output process data and another one
  * with input process data. And these datagrams then need to be updated and processed in the callback
  * methods <code>SlaveDevice::writeDatagram()</code> and <code>SlaveDevice::readDatagram()</code>.
+ * <br/>
+ * Registered datagrams are processed in place within a preallocated frame, and their data pointers
+ * change with every received frame. Slave device drivers must therefore always access the data of
+ * a datagram through its <code>data</code> pointer, and must not keep copies of that pointer.
  * @param datagram a pointer to a datagram to register.
  */
 void CoE::registerDatagram(EtherCAT::Datagram* datagram) {
     
+    mutex.lock();
+    
+    frame.detach();
+    
     datagrams.push_back(datagram);
+    
+    try {
+        frame.attach(datagrams);
+    } catch (exception& e) {
+        mutex.unlock();
+        throw;
+    }
+    
+    mutex.unlock();
+}
+
+/**
+ * This method allows to register a section of the process data RAM of an EtherCAT slave device
+ * with the logical process image of this communication handler. It declares the next free FMMU
+ * of the given slave device to map the section into the logical process image, so that it is
+ * transmitted on the fieldbus with the single LRW datagram that contains the process data of all
+ * slave devices.
+ * <br/>
+ * The FMMU registers are written when the slave device is brought up, see
+ * <code>addSlaveDevice(slaveDevice, deviceAddress)</code>. Typically, a slave device driver registers a section with output
+ * process data and another one with input process data. The returned objects then need to be updated
+ * and processed in the callback methods <code>SlaveDevice::writeDatagram()</code> and
+ * <code>SlaveDevice::readDatagram()</code>.
+ * @param deviceAddress the relative device address, i.e. 0x0000, 0xFFFF, 0xFFFE, etc.
+ * @param physicalAddress the physical start address within the EtherCAT slave controller, usually
+ * the address of a buffered SYNC manager in the process data RAM.
+ * @param length the length of the section, given in [bytes].
+ * @param type the type of the section, either <code>EtherCAT::FMMU_TYPE_READ</code> for input
+ * process data or <code>EtherCAT::FMMU_TYPE_WRITE</code> for output process data.
+ * @return a pointer to a process data object that gives access to this section of the process image.
+ */
+EtherCAT::ProcessData* CoE::registerProcessData(uint16_t deviceAddress, uint16_t physicalAddress, uint16_t length, uint8_t type) {
+    
+    if (processImageLength+length > PROCESS_IMAGE_SIZE) throw runtime_error("CoE: process image is too large.");
+    
+    // declare the next free FMMU of this slave device
+    
+    SlaveConfiguration* slaveConfiguration = getSlaveConfiguration(deviceAddress);
+    
+    size_t offset = slaveConfiguration->fmmus.size();
+    slaveConfiguration->fmmus.resize(offset+EtherCAT::FMMU_OFFSET, 0);
+    
+    slaveConfiguration->fmmus[offset+0] = static_cast<uint8_t>(processImageLength & 0xFF);         // logical start address
+    slaveConfiguration->fmmus[offset+1] = static_cast<uint8_t>((processImageLength >> 8) & 0xFF);
+    slaveConfiguration->fmmus[offset+4] = static_cast<uint8_t>(length & 0xFF);                     // length
+    slaveConfiguration->fmmus[offset+5] = static_cast<uint8_t>((length >> 8) & 0xFF);
+    slaveConfiguration->fmmus[offset+7] = 7;                                                        // logical stop bit
+    slaveConfiguration->fmmus[offset+8] = static_cast<uint8_t>(physicalAddress & 0xFF);            // physical start address
+    slaveConfiguration->fmmus[offset+9] = static_cast<uint8_t>((physicalAddress >> 8) & 0xFF);
+    slaveConfiguration->fmmus[offset+11] = type;                                                    // type, read or write
+    slaveConfiguration->fmmus[offset+12] = 1;                                                       // activate
+    
+    // extend the logical process image by this section
+    
+    mutex.lock();
+    
+    frame.detach();
+    
+    EtherCAT::ProcessData* processData = new EtherCAT::ProcessData(processImage, processImageLength, length);
+    this->processData.push_back(processData);
+    
+    memset((void*)&(processImage->data[10+processImageLength]), 0, length);
+    
+    if (processImageLength == 0) datagrams.insert(datagrams.begin(), processImage);
+    
+    processImageLength += length;
+    processImage->resize(processImageLength);
+    
+    try {
+        frame.attach(datagrams);
+    } catch (exception& e) {
+        mutex.unlock();
+        throw;
+    }
+    
+    mutex.unlock();
+    
+    return processData;
 }
 
 /**
- * Writes an expedited CANopen service data object (SDO) to an EtherCAT slave device.
+ * Writes a CANopen service data object (SDO) to an EtherCAT slave device, and waits until
+ * the transfer is completed. The transfer is processed by the communication handler, see
+ * <code>download()</code>, this method must therefore not be called from the callback
+ * methods of a slave device driver.
  * @param deviceAddress the relative device address, i.e. 0x0000, 0xFFFF, 0xFFFE, etc.
  * @param mailboxOutAddress the mailbox address for outgoing data within the EtherCAT slave controller.
  * @param mailboxOutSize the size of the mailbox, given in [bytes].
@@ -138,248 +688,989 @@ void CoE::registerDatagram(EtherCAT::Datagram* datagram) {
  */
 void CoE::writeSDO(uint16_t deviceAddress, uint16_t mailboxOutAddress, uint16_t mailboxOutSize, uint16_t mailboxInAddress, uint16_t mailboxInSize, uint16_t index, uint8_t subindex, uint32_t value, uint16_t length) {
     
-    vector<EtherCAT::Datagram*> datagrams;
+    ServiceDataObject serviceDataObject(index, subindex, 4);
+    serviceDataObject.setValue(value, length);
+    
+    transfer(getMailbox(deviceAddress, mailboxOutAddress, mailboxOutSize, mailboxInAddress, mailboxInSize), serviceDataObject, true);
+    
+    if (!serviceDataObject.waitForCompletion()) {
+        stringstream message;
+        message << "CoE: couldn't write SDO 0x" << hex << index << ":" << static_cast<uint16_t>(subindex) << ", abort code 0x" << serviceDataObject.getAbortCode() << ".";
+        throw runtime_error(message.str());
+    }
+}
+
+/**
+ * Reads a CANopen service data object (SDO) from an EtherCAT slave device, and waits until
+ * the transfer is completed. The transfer is processed by the communication handler, see
+ * <code>upload()</code>, this method must therefore not be called from the callback
+ * methods of a slave device driver.
+ * @param deviceAddress the relative device address, i.e. 0x0000, 0xFFFF, 0xFFFE, etc.
+ * @param mailboxOutAddress the mailbox address for outgoing data within the EtherCAT slave controller.
+ * @param mailboxOutSize the size of the mailbox, given in [bytes].
+ * @param mailboxInAddress the mailbox address for incoming data within the EtherCAT slave controller.
+ * @param mailboxInSize the size of the mailbox, given in [bytes].
+ * @param index the index of the CANopen service data object (16 bit).
+ * @param subindex the subindex of the CANopen service data object (8 bit).
+ * @return the value of this service data object.
+ */
+uint32_t CoE::readSDO(uint16_t deviceAddress, uint16_t mailboxOutAddress, uint16_t mailboxOutSize, uint16_t mailboxInAddress, uint16_t mailboxInSize, uint16_t index, uint8_t subindex) {
+    
+    ServiceDataObject serviceDataObject(index, subindex, 4);
+    
+    transfer(getMailbox(deviceAddress, mailboxOutAddress, mailboxOutSize, mailboxInAddress, mailboxInSize), serviceDataObject, false);
+    
+    if (!serviceDataObject.waitForCompletion()) {
+        stringstream message;
+        message << "CoE: couldn't read SDO 0x" << hex << index << ":" << static_cast<uint16_t>(subindex) << ", abort code 0x" << serviceDataObject.getAbortCode() << ".";
+        throw runtime_error(message.str());
+    }
     
-    for (uint16_t i = 0; i < RETRIES; i++) {
+    return serviceDataObject.getValue();
+}
+
+/**
+ * This run method implements the periodic communication loop for the fieldbus.
+ */
+void CoE::run() {
+    
+    while (waitForNextPeriod()) {
         
-        // read inbox
+        mutex.lock();
+        
+        for (uint16_t i = 0; i < datagrams.size(); i++) datagrams[i]->resetWorkingCounter();
+        for (uint16_t i = 0; i < slaveDevices.size(); i++) {
+            Trace::Span span("CoE::SlaveDevice::writeDatagram");
+            slaveDevices[i]->writeDatagram();
+        }
+        
+        // transmit the frame with process data, and the frame with mailbox datagrams, if needed
+        
+        ServiceDataObject* completed = NULL;
+        bool mailboxes = prepareMailboxes(completed);
+        bool transmitted = false;
+        bool mailboxesTransmitted = false;
         
-        datagrams.push_back(new CANopenMailboxDatagram(EtherCAT::COMMAND_APRD, deviceAddress, mailboxInAddress, mailboxInSize, MESSAGE_TYPE_SDO_REQUEST, index, subindex, 0, 0));
         try {
-            etherCAT.sendDatagrams(datagrams);
+            etherCAT.transmitFrame(frame);
+            transmitted = true;
+            if (mailboxes) etherCAT.transmitFrame(mailboxFrame);
+            mailboxesTransmitted = mailboxes;
         } catch (exception& e) {
             cerr << e.what() << endl;
         }
-        while (datagrams.size()) {
-            delete datagrams.back();
-            datagrams.pop_back();
+        
+        // the slave devices only read the process data of a valid response
+        
+        if (transmitted && etherCAT.receiveFrame(frame)) {
+            for (uint16_t i = 0; i < slaveDevices.size(); i++) {
+                Trace::Span span("CoE::SlaveDevice::readDatagram");
+                slaveDevices[i]->readDatagram();
+            }
         }
         
-        // transmit SDO request
+        mutex.unlock();
         
-        datagrams.push_back(new CANopenMailboxDatagram(EtherCAT::COMMAND_APWR, deviceAddress, mailboxOutAddress, mailboxOutSize, MESSAGE_TYPE_SDO_REQUEST, index, subindex, value, length));
-        try {
-            etherCAT.sendDatagrams(datagrams);
-        } catch (exception& e) {
-            cerr << e.what() << endl;
+        if (mailboxes) {
+            bool received = mailboxesTransmitted && etherCAT.receiveFrame(mailboxFrame);
+            Trace::Span span("CoE::processMailboxes");
+            processMailboxes(completed, received);
+        }
+        
+        // invoke the callback methods of completed service data objects
+        
+        while (completed != NULL) {
+            
+            ServiceDataObject* serviceDataObject = completed;
+            completed = completed->next;
+            
+            serviceDataObject->completed();
+            serviceDataObject->state.store(serviceDataObject->result, memory_order_release);
+        }
+    }
+}
+
+/**
+ * Gets the configuration of a given slave device, or creates a new configuration
+ * if this slave device isn't known yet.
+ * @param deviceAddress the relative device address, i.e. 0x0000, 0xFFFF, 0xFFFE, etc.
+ * @return a pointer to the configuration of the slave device.
+ */
+CoE::SlaveConfiguration* CoE::getSlaveConfiguration(uint16_t deviceAddress) {
+    
+    for (uint16_t i = 0; i < slaveConfigurations.size(); i++) {
+        if (slaveConfigurations[i]->deviceAddress == deviceAddress) return slaveConfigurations[i];
+    }
+    
+    SlaveConfiguration* slaveConfiguration = new SlaveConfiguration(deviceAddress);
+    slaveConfigurations.push_back(slaveConfiguration);
+    
+    return slaveConfiguration;
+}
+
+/**
+ * Gets the mailbox of a given slave device, or creates a mailbox from the SYNC managers
+ * that were declared for this slave device.
+ * @param deviceAddress the relative device address, i.e. 0x0000, 0xFFFF, 0xFFFE, etc.
+ * @return a pointer to the mailbox of the slave device.
+ */
+CoE::Mailbox* CoE::getMailbox(uint16_t deviceAddress) {
+    
+    for (uint16_t i = 0; i < slaveConfigurations.size(); i++) {
+        
+        SlaveConfiguration* slaveConfiguration = slaveConfigurations[i];
+        
+        if ((slaveConfiguration->deviceAddress == deviceAddress) && (slaveConfiguration->mailboxOutSize > 0) && (slaveConfiguration->mailboxInSize > 0)) {
+            return getMailbox(deviceAddress, slaveConfiguration->mailboxOutAddress, slaveConfiguration->mailboxOutSize, slaveConfiguration->mailboxInAddress, slaveConfiguration->mailboxInSize);
+        }
+    }
+    
+    throw runtime_error("CoE: slave device 0x"+type2String(deviceAddress)+" has no mailbox.");
+}
+
+/**
+ * Gets the mailbox of a given slave device, or creates a new mailbox with the given
+ * addresses and sizes if this slave device doesn't have a mailbox yet.
+ * @param deviceAddress the relative device address, i.e. 0x0000, 0xFFFF, 0xFFFE, etc.
+ * @param mailboxOutAddress the mailbox address for outgoing data within the EtherCAT slave controller.
+ * @param mailboxOutSize the size of the mailbox, given in [bytes].
+ * @param mailboxInAddress the mailbox address for incoming data within the EtherCAT slave controller.
+ * @param mailboxInSize the size of the mailbox, given in [bytes].
+ * @return a pointer to the mailbox of the slave device.
+ */
+CoE::Mailbox* CoE::getMailbox(uint16_t deviceAddress, uint16_t mailboxOutAddress, uint16_t mailboxOutSize, uint16_t mailboxInAddress, uint16_t mailboxInSize) {
+    
+    if ((mailboxOutSize < 16) || (mailboxInSize < 16)) throw runtime_error("CoE: mailbox of slave device 0x"+type2String(deviceAddress)+" is too small.");
+    
+    mailboxMutex.lock();
+    
+    for (uint16_t i = 0; i < mailboxes.size(); i++) {
+        if (mailboxes[i]->deviceAddress == deviceAddress) {
+            mailboxMutex.unlock();
+            return mailboxes[i];
+        }
+    }
+    
+    Mailbox* mailbox = new Mailbox(deviceAddress, mailboxOutAddress, mailboxOutSize, mailboxInAddress, mailboxInSize);
+    mailboxes.push_back(mailbox);
+    
+    // reserve memory, so that the communication handler doesn't need to allocate memory
+    
+    activeMailboxes.reserve(mailboxes.size());
+    mailboxDatagrams.reserve(mailboxes.size());
+    
+    mailboxMutex.unlock();
+    
+    return mailbox;
+}
+
+/**
+ * Appends a service data object to the queue of a mailbox.
+ * @param mailbox the mailbox of the slave device.
+ * @param serviceDataObject the service data object to transfer.
+ * @param download a flag for a download, or an upload otherwise.
+ */
+void CoE::transfer(Mailbox* mailbox, ServiceDataObject& serviceDataObject, bool download) {
+    
+    if (serviceDataObject.state.load(memory_order_acquire) == ServiceDataObject::STATE_PENDING) throw runtime_error("CoE: service data object 0x"+type2String(serviceDataObject.index)+" is already pending.");
+    
+    serviceDataObject.download = download;
+    serviceDataObject.initiated = false;
+    serviceDataObject.offset = 0;
+    serviceDataObject.toggle = 0;
+    serviceDataObject.abortCode = 0;
+    serviceDataObject.next = NULL;
+    serviceDataObject.state.store(ServiceDataObject::STATE_PENDING, memory_order_relaxed);
+    
+    if (!download) serviceDataObject.length = 0;
+    
+    mailboxMutex.lock();
+    
+    if (mailbox->last != NULL) mailbox->last->next = &serviceDataObject;
+    else mailbox->first = &serviceDataObject;
+    mailbox->last = &serviceDataObject;
+    
+    mailboxMutex.unlock();
+}
+
+/**
+ * Starts pending transfers of service data objects, and attaches the mailbox datagrams of
+ * all mailboxes with transfers in progress to the mailbox frame. This method is called by
+ * the communication handler in every cycle.
+ * @param completed a reference to a list of service data objects with completed transfers.
+ * @return <code>true</code> if the mailbox frame needs to be transmitted, <code>false</code> otherwise.
+ */
+bool CoE::prepareMailboxes(ServiceDataObject*& completed) {
+    
+    mailboxMutex.lock();
+    
+    int32_t time = Thread::currentTimeMillis();
+    uint16_t length = 2;
+    
+    activeMailboxes.clear();
+    mailboxDatagrams.clear();
+    
+    for (uint16_t i = 0; i < mailboxes.size(); i++) {
+        
+        Mailbox* mailbox = mailboxes[i];
+        
+        if ((mailbox->state == Mailbox::STATE_IDLE) && (mailbox->first != NULL)) {
+            
+            // start the transfer of the next service data object
+            
+            mailbox->time = time;
+            mailbox->state = Mailbox::STATE_REQUEST;
+            
+            writeRequest(mailbox);
+            
+        } else if ((mailbox->state != Mailbox::STATE_IDLE) && (mailbox->state != Mailbox::STATE_ABORT) && (time-mailbox->time > SDO_TIMEOUT)) {
+            
+            // abort a transfer that timed out
+            
+            writeAbortRequest(mailbox, 0x05040000);
+            complete(mailbox, 0x05040000, completed);
+        }
+        
+        EtherCAT::Datagram* datagram = (mailbox->state == Mailbox::STATE_RESPONSE) ? mailbox->in : (mailbox->state != Mailbox::STATE_IDLE) ? mailbox->out : NULL;
+        
+        if ((datagram != NULL) && (length+datagram->length <= EtherCAT::Frame::SIZE)) {
+            
+            datagram->resetWorkingCounter();
+            
+            activeMailboxes.push_back(mailbox);
+            mailboxDatagrams.push_back(datagram);
+            length += datagram->length;
+        }
+    }
+    
+    try {
+        mailboxFrame.attach(mailboxDatagrams);
+    } catch (exception& e) {
+        cerr << e.what() << endl;
+    }
+    
+    mailboxMutex.unlock();
+    
+    return mailboxDatagrams.size() > 0;
+}
+
+/**
+ * Processes the mailbox datagrams of a received mailbox frame, and advances the transfers
+ * of service data objects. This method is called by the communication handler in every cycle
+ * a mailbox frame was transmitted. If no valid response was received, the transfers keep
+ * their states, so that the same mailbox datagrams are transmitted again with the next cycle.
+ * @param completed a reference to a list of service data objects with completed transfers.
+ * @param received a flag indicating that a valid response of the mailbox frame was received.
+ */
+void CoE::processMailboxes(ServiceDataObject*& completed, bool received) {
+    
+    mailboxMutex.lock();
+    
+    mailboxFrame.detach();
+    
+    if (!received) activeMailboxes.clear();
+    
+    for (uint16_t i = 0; i < activeMailboxes.size(); i++) {
+        
+        Mailbox* mailbox = activeMailboxes[i];
+        
+        if (mailbox->state == Mailbox::STATE_REQUEST) {
+            
+            // the request was written if the mailbox wasn't full, otherwise it's written again
+            
+            if (mailbox->out->getWorkingCounter() > 0) mailbox->state = Mailbox::STATE_RESPONSE;
+            
+        } else if (mailbox->state == Mailbox::STATE_ABORT) {
+            
+            mailbox->state = Mailbox::STATE_IDLE;
+            
+        } else if (mailbox->state == Mailbox::STATE_RESPONSE) {
+            
+            // the mailbox contains a message if it could be read
+            
+            if (mailbox->in->getWorkingCounter() > 0) readResponse(mailbox, completed);
+        }
+    }
+    
+    mailboxMutex.unlock();
+}
+
+/**
+ * Writes the next request of the current transfer into the mailbox datagram of a slave device.
+ * This is either a request to initiate a transfer, or a request for the next segment.
+ * @param mailbox the mailbox of the slave device.
+ */
+void CoE::writeRequest(Mailbox* mailbox) {
+    
+    ServiceDataObject* serviceDataObject = mailbox->first;
+    uint8_t* data = mailbox->out->data;
+    uint16_t size = mailbox->out->length-12;
+    uint16_t length = 10;
+    
+    memset((void*)&data[10], 0, size);
+    
+    // CANopen header with SDO request, and SDO command with index and subindex
+    
+    data[16] = 0x00;
+    data[17] = static_cast<uint8_t>(MESSAGE_TYPE_SDO_REQUEST << 4);
+    data[19] = static_cast<uint8_t>(serviceDataObject->index & 0xFF);
+    data[20] = static_cast<uint8_t>((serviceDataObject->index >> 8) & 0xFF);
+    data[21] = serviceDataObject->subindex;
+    
+    uint8_t completeAccess = serviceDataObject->completeAccess ? 0x10 : 0x00;
+    
+    if (serviceDataObject->download && !serviceDataObject->initiated) {
+        
+        if (!serviceDataObject->completeAccess && (serviceDataObject->length > 0) && (serviceDataObject->length <= 4)) {
+            
+            // initiate expedited download
+            
+            data[18] = static_cast<uint8_t>(0x23 | ((4-serviceDataObject->length) << 2));
+            memcpy((void*)&data[22], (void*)serviceDataObject->data, serviceDataObject->length);
+            
+            serviceDataObject->offset = serviceDataObject->length;
+            
+        } else {
+            
+            // initiate normal download, with the complete size and as much data as fits into the mailbox
+            
+            uint16_t n = serviceDataObject->length;
+            if (n > size-16) n = size-16;
+            
+            data[18] = 0x21 | completeAccess;
+            data[22] = static_cast<uint8_t>(serviceDataObject->length & 0xFF);
+            data[23] = static_cast<uint8_t>((serviceDataObject->length >> 8) & 0xFF);
+            memcpy((void*)&data[26], (void*)serviceDataObject->data, n);
+            
+            serviceDataObject->offset = n;
+            length = 10+n;
+        }
+        
+    } else if (serviceDataObject->download) {
+        
+        // download segment
+        
+        uint16_t n = serviceDataObject->length-serviceDataObject->offset;
+        if (n > size-9) n = size-9;
+        
+        bool last = (serviceDataObject->offset+n >= serviceDataObject->length);
+        
+        data[18] = static_cast<uint8_t>((serviceDataObject->toggle << 4) | ((n < 7) ? ((7-n) << 1) : 0) | (last ? 0x01 : 0x00));
+        memcpy((void*)&data[19], (void*)&serviceDataObject->data[serviceDataObject->offset], n);
+        
+        serviceDataObject->offset += n;
+        length = (n < 7) ? 10 : 3+n;
+        
+    } else if (!serviceDataObject->initiated) {
+        
+        // initiate upload
+        
+        data[18] = 0x40 | completeAccess;
+        
+    } else {
+        
+        // upload segment
+        
+        data[18] = static_cast<uint8_t>(0x60 | (serviceDataObject->toggle << 4));
+    }
+    
+    // mailbox header
+    
+    mailbox->counter = (mailbox->counter % 7)+1;
+    
+    data[10] = static_cast<uint8_t>(length & 0xFF);
+    data[11] = static_cast<uint8_t>((length >> 8) & 0xFF);
+    data[15] = static_cast<uint8_t>((mailbox->counter << 4) | EtherCAT::MAILBOX_TYPE_COE);
+    
+    mailbox->state = Mailbox::STATE_REQUEST;
+}
+
+/**
+ * Writes a request to abort the current transfer into the mailbox datagram of a slave device.
+ * @param mailbox the mailbox of the slave device.
+ * @param abortCode the CANopen abort code.
+ */
+void CoE::writeAbortRequest(Mailbox* mailbox, uint32_t abortCode) {
+    
+    ServiceDataObject* serviceDataObject = mailbox->first;
+    uint8_t* data = mailbox->out->data;
+    
+    memset((void*)&data[10], 0, mailbox->out->length-12);
+    
+    mailbox->counter = (mailbox->counter % 7)+1;
+    
+    data[10] = 10;
+    data[15] = static_cast<uint8_t>((mailbox->counter << 4) | EtherCAT::MAILBOX_TYPE_COE);
+    data[17] = static_cast<uint8_t>(MESSAGE_TYPE_SDO_REQUEST << 4);
+    data[18] = 0x80;
+    data[19] = static_cast<uint8_t>(serviceDataObject->index & 0xFF);
+    data[20] = static_cast<uint8_t>((serviceDataObject->index >> 8) & 0xFF);
+    data[21] = serviceDataObject->subindex;
+    for (uint16_t i = 0; i < 4; i++) data[22+i] = static_cast<uint8_t>((abortCode >> (8*i)) & 0xFF);
+    
+    mailbox->state = Mailbox::STATE_ABORT;
+}
+
+/**
+ * Reads a message from the mailbox datagram of a slave device, and advances the current transfer
+ * if this message is the expected SDO response. Other messages, i.e. emergency messages, are ignored.
+ * @param mailbox the mailbox of the slave device.
+ * @param completed a reference to a list of service data objects with completed transfers.
+ */
+void CoE::readResponse(Mailbox* mailbox, ServiceDataObject*& completed) {
+    
+    ServiceDataObject* serviceDataObject = mailbox->first;
+    uint8_t* data = mailbox->in->data;
+    uint16_t size = mailbox->in->length-12;
+    
+    uint16_t length = (static_cast<uint16_t>(data[10]) & 0xFF) | ((static_cast<uint16_t>(data[11]) & 0xFF) << 8);
+    uint8_t type = data[15] & 0x0F;
+    uint8_t messageType = (data[17] >> 4) & 0x0F;
+    uint8_t command = data[18];
+    
+    if ((type != EtherCAT::MAILBOX_TYPE_COE) || (length < 10) || (length > size-6)) return;
+    if ((messageType != MESSAGE_TYPE_SDO_RESPONSE) && (messageType != MESSAGE_TYPE_SDO_REQUEST)) return;
+    
+    uint16_t index = (static_cast<uint16_t>(data[19]) & 0xFF) | ((static_cast<uint16_t>(data[20]) & 0xFF) << 8);
+    uint32_t value = (static_cast<uint32_t>(data[22]) & 0xFF) | ((static_cast<uint32_t>(data[23]) & 0xFF) << 8) | ((static_cast<uint32_t>(data[24]) & 0xFF) << 16) | ((static_cast<uint32_t>(data[25]) & 0xFF) << 24);
+    
+    if (command == 0x80) {
+        
+        // abort transfer request from the slave device
+        
+        if ((index == serviceDataObject->index) && (data[21] == serviceDataObject->subindex)) {
+            mailbox->state = Mailbox::STATE_IDLE;
+            complete(mailbox, value, completed);
         }
-        if (datagrams[0]->getWorkingCounter() > 0) {
+        
+    } else if (!serviceDataObject->initiated) {
+        
+        // response to an initiate request
+        
+        if ((index != serviceDataObject->index) || (data[21] != serviceDataObject->subindex)) return;
+        
+        if (serviceDataObject->download && ((command & 0xE0) == 0x60)) {
             
-            while (datagrams.size()) {
-                delete datagrams.back();
-                datagrams.pop_back();
+            serviceDataObject->initiated = true;
+            
+            if (serviceDataObject->offset < serviceDataObject->length) {
+                writeRequest(mailbox);
+            } else {
+                mailbox->state = Mailbox::STATE_IDLE;
+                complete(mailbox, 0, completed);
             }
             
-            for (uint16_t j = 0; j < RETRIES; j++) {
+        } else if (!serviceDataObject->download && ((command & 0xE0) == 0x40)) {
+            
+            if ((command & 0x02) > 0) {
+                
+                // expedited upload, with the data in the initiate response
                 
-                // receive SDO response
+                uint16_t n = ((command & 0x01) > 0) ? 4-((command >> 2) & 0x03) : 4;
                 
-                datagrams.push_back(new CANopenMailboxDatagram(EtherCAT::COMMAND_APRD, deviceAddress, mailboxInAddress, mailboxInSize, MESSAGE_TYPE_SDO_REQUEST, index, subindex, 0, 0));
-                try {
-                    etherCAT.sendDatagrams(datagrams);
-                } catch (exception& e) {
-                    cerr << e.what() << endl;
+                if (n > serviceDataObject->size) {
+                    mailbox->state = Mailbox::STATE_IDLE;
+                    complete(mailbox, 0x05040005, completed);
+                } else {
+                    memcpy((void*)serviceDataObject->data, (void*)&data[22], n);
+                    serviceDataObject->length = n;
+                    mailbox->state = Mailbox::STATE_IDLE;
+                    complete(mailbox, 0, completed);
                 }
-                if (datagrams[0]->getWorkingCounter() > 0) {
-                    
-                    //cout << "CoE::writeSDO: index=0x" << hex << index << " subindex=0x" << subindex << " value=" << dec << value << endl;
-                    //cout << "     response:";
-                    //for (int k = 0; k < 18; k++) cout << hex << " 0x" << ((unsigned int)(datagrams[0]->data[k]) & 0xFF);
-                    //cout << endl;
-                    //cout << "                     ";
-                    //for (int k = 18; k < 26; k++) cout << hex << " 0x" << ((unsigned int)(datagrams[0]->data[k]) & 0xFF);
-                    //cout << endl;
-                    
-                    if ((static_cast<CANopenMailboxDatagram*>(datagrams[0])->getMessageType() == MESSAGE_TYPE_SDO_REQUEST) || (static_cast<CANopenMailboxDatagram*>(datagrams[0])->getMessageType() == MESSAGE_TYPE_SDO_RESPONSE)) {
-                        
-                        while (datagrams.size()) {
-                            delete datagrams.back();
-                            datagrams.pop_back();
-                        }
-                        
-                        //cout << "CoE::writeSDO: i=" << dec << i << " j=" << j << endl;
-                        
-                        return;
-                        
-                    } else {
-                        
-                        while (datagrams.size()) {
-                            delete datagrams.back();
-                            datagrams.pop_back();
-                        }
-                        
-                        Thread::sleep(1);
-                        //throw runtime_error("CoE: wrong response from device!");
-                    }
-                    
+                
+            } else {
+                
+                // normal upload, with the complete size and the first part of the data
+                
+                uint16_t n = length-10;
+                if (n > value) n = static_cast<uint16_t>(value);
+                
+                if (value > serviceDataObject->size) {
+                    writeAbortRequest(mailbox, 0x05040005);
+                    complete(mailbox, 0x05040005, completed);
                 } else {
+                    memcpy((void*)serviceDataObject->data, (void*)&data[26], n);
+                    serviceDataObject->length = static_cast<uint16_t>(value);
+                    serviceDataObject->offset = n;
+                    serviceDataObject->initiated = true;
                     
-                    while (datagrams.size()) {
-                        delete datagrams.back();
-                        datagrams.pop_back();
+                    if (serviceDataObject->offset < serviceDataObject->length) {
+                        writeRequest(mailbox);
+                    } else {
+                        mailbox->state = Mailbox::STATE_IDLE;
+                        complete(mailbox, 0, completed);
                     }
-                    
-                    Thread::sleep(1);
                 }
             }
+        }
+        
+    } else if (((command >> 4) & 0x01) == serviceDataObject->toggle) {
+        
+        // response to a segment request
+        
+        serviceDataObject->toggle ^= 1;
+        
+        if (serviceDataObject->download && ((command & 0xE0) == 0x20)) {
             
-        } else {
+            if (serviceDataObject->offset < serviceDataObject->length) {
+                writeRequest(mailbox);
+            } else {
+                mailbox->state = Mailbox::STATE_IDLE;
+                complete(mailbox, 0, completed);
+            }
+            
+        } else if (!serviceDataObject->download && ((command & 0xE0) == 0x00)) {
+            
+            uint16_t n = (length > 10) ? length-3 : 7-((command >> 1) & 0x07);
+            if (n > serviceDataObject->length-serviceDataObject->offset) n = serviceDataObject->length-serviceDataObject->offset;
+            
+            memcpy((void*)&serviceDataObject->data[serviceDataObject->offset], (void*)&data[19], n);
+            serviceDataObject->offset += n;
             
-            while (datagrams.size()) {
-                delete datagrams.back();
-                datagrams.pop_back();
+            if (((command & 0x01) == 0) && (serviceDataObject->offset < serviceDataObject->length)) {
+                writeRequest(mailbox);
+            } else {
+                serviceDataObject->length = serviceDataObject->offset;
+                mailbox->state = Mailbox::STATE_IDLE;
+                complete(mailbox, 0, completed);
             }
             
-            Thread::sleep(1);
+        } else {
+            
+            serviceDataObject->toggle ^= 1;
         }
     }
+}
+
+/**
+ * Removes the current service data object from the queue of a mailbox, and appends it
+ * to the list of service data objects with completed transfers.
+ * @param mailbox the mailbox of the slave device.
+ * @param abortCode the CANopen abort code of a failed transfer, or 0 if the transfer was successful.
+ * @param completed a reference to a list of service data objects with completed transfers.
+ */
+void CoE::complete(Mailbox* mailbox, uint32_t abortCode, ServiceDataObject*& completed) {
     
-    throw runtime_error("CoE: mailbox datagram was not processed by device!");
+    ServiceDataObject* serviceDataObject = mailbox->first;
+    
+    mailbox->first = serviceDataObject->next;
+    if (mailbox->first == NULL) mailbox->last = NULL;
+    
+    serviceDataObject->abortCode = abortCode;
+    serviceDataObject->result = (abortCode == 0) ? ServiceDataObject::STATE_COMPLETED : ServiceDataObject::STATE_ABORTED;
+    serviceDataObject->next = completed;
+    
+    completed = serviceDataObject;
 }
 
 /**
- * Reads an expedited CANopen service data object (SDO) from an EtherCAT slave device.
- * @param deviceAddress the relative device address, i.e. 0x0000, 0xFFFF, 0xFFFE, etc.
- * @param mailboxOutAddress the mailbox address for outgoing data within the EtherCAT slave controller.
- * @param mailboxOutSize the size of the mailbox, given in [bytes].
- * @param mailboxInAddress the mailbox address for incoming data within the EtherCAT slave controller.
- * @param mailboxInSize the size of the mailbox, given in [bytes].
- * @param index the index of the CANopen service data object (16 bit).
- * @param subindex the subindex of the CANopen service data object (8 bit).
- * @return the value of this service data object.
+ * Brings the given slave devices up to the state OPERATIONAL. Slave devices that fail
+ * to start up are marked with an error description, they are skipped by the subsequent
+ * steps of the startup, and they are removed from the list of registered slave devices.
+ * @param slaveConfigurations a list of configurations of slave devices to bring up.
  */
-uint32_t CoE::readSDO(uint16_t deviceAddress, uint16_t mailboxOutAddress, uint16_t mailboxOutSize, uint16_t mailboxInAddress, uint16_t mailboxInSize, uint16_t index, uint8_t subindex) {
+void CoE::bringUp(vector<SlaveConfiguration*>& slaveConfigurations) {
+    
+    // set EtherCAT state machine to state INIT
+    
+    setState(slaveConfigurations, EtherCAT::STATE_INIT);
+    
+    // write SYNC manager and FMMU registers of all slave devices
     
     vector<EtherCAT::Datagram*> datagrams;
+    vector<SlaveConfiguration*> owners;
+    
+    for (uint16_t i = 0; i < slaveConfigurations.size(); i++) {
+        
+        SlaveConfiguration* slaveConfiguration = slaveConfigurations[i];
+        
+        if (slaveConfiguration->error.size() > 0) continue;
+        
+        if (slaveConfiguration->syncManagers.size() > 0) {
+            datagrams.push_back(new EtherCAT::Datagram(EtherCAT::COMMAND_APWR, slaveConfiguration->deviceAddress, EtherCAT::SYNC_MANAGER, &slaveConfiguration->syncManagers[0], slaveConfiguration->syncManagers.size()));
+            owners.push_back(slaveConfiguration);
+        }
+        if (slaveConfiguration->fmmus.size() > 0) {
+            datagrams.push_back(new EtherCAT::Datagram(EtherCAT::COMMAND_APWR, slaveConfiguration->deviceAddress, EtherCAT::FMMU, &slaveConfiguration->fmmus[0], slaveConfiguration->fmmus.size()));
+            owners.push_back(slaveConfiguration);
+        }
+    }
+    
+    transmit(datagrams);
+    
+    for (uint16_t i = 0; i < datagrams.size(); i++) {
+        if ((datagrams[i]->getWorkingCounter() == 0) && (owners[i]->error.size() == 0)) owners[i]->error = "couldn't write SYNC manager and FMMU registers";
+        delete datagrams[i];
+    }
+    
+    // set EtherCAT state machine to state PRE OPERATIONAL
+    
+    setState(slaveConfigurations, EtherCAT::STATE_PRE_OPERATIONAL);
     
-    for (uint16_t i = 0; i < RETRIES; i++) {
+    // configure slave devices and register their callback methods
+    
+    for (uint16_t i = 0; i < slaveConfigurations.size(); i++) {
+        
+        SlaveConfiguration* slaveConfiguration = slaveConfigurations[i];
         
-        // read inbox
+        if (slaveConfiguration->error.size() > 0) continue;
         
-        datagrams.push_back(new CANopenMailboxDatagram(EtherCAT::COMMAND_APRD, deviceAddress, mailboxInAddress, mailboxInSize, MESSAGE_TYPE_SDO_REQUEST, index, subindex, 0, 0));
         try {
-            etherCAT.sendDatagrams(datagrams);
+            slaveConfiguration->slaveDevice->configure();
         } catch (exception& e) {
-            cerr << e.what() << endl;
+            slaveConfiguration->error = string("couldn't be configured: ")+e.what();
+            continue;
+        }
+        
+        mutex.lock();
+        
+        slaveDevices.push_back(slaveConfiguration->slaveDevice);
+        
+        mutex.unlock();
+    }
+    
+    // set EtherCAT state machine to states SAFE OPERATIONAL and OPERATIONAL
+    
+    setState(slaveConfigurations, EtherCAT::STATE_SAFE_OPERATIONAL);
+    setState(slaveConfigurations, EtherCAT::STATE_OPERATIONAL);
+    
+    // deregister slave devices that failed to start up, so that the communication handler doesn't address them
+    
+    mutex.lock();
+    
+    for (uint16_t i = 0; i < slaveConfigurations.size(); i++) {
+        
+        SlaveConfiguration* slaveConfiguration = slaveConfigurations[i];
+        
+        if (slaveConfiguration->error.size() > 0) {
+            for (vector<SlaveDevice*>::iterator j = slaveDevices.begin(); j != slaveDevices.end(); j++) {
+                if (*j == slaveConfiguration->slaveDevice) {
+                    slaveDevices.erase(j);
+                    break;
+                }
+            }
         }
-        while (datagrams.size()) {
-            delete datagrams.back();
-            datagrams.pop_back();
+        
+        slaveConfiguration->pending = false;
+    }
+    
+    mutex.unlock();
+}
+
+/**
+ * Initializes the distributed clocks of all slave devices on the segment. This method measures
+ * the propagation delays of the frames, compensates the offsets of the local clocks of all slave
+ * devices with distributed clocks to the first of these devices, the reference clock, and
+ * compensates their initial drift with a series of ARMW datagrams. It finally adds an ARMW
+ * datagram to the periodic frame, which compensates the drift of the clocks continuously.
+ * <br/>
+ * The propagation delays are calculated under the assumption that the slave devices are
+ * connected in a line, as it is the case with a chain of EtherCAT terminals.
+ */
+void CoE::initializeDistributedClocks() {
+    
+    vector<EtherCAT::Datagram*> datagrams;
+    
+    // count the slave devices on the segment
+    
+    datagrams.push_back(new EtherCAT::Datagram(EtherCAT::COMMAND_BRD, 0x0000, EtherCAT::APPLICATION_LAYER_STATUS, 2));
+    transmit(datagrams);
+    uint16_t numberOfSlaveDevices = datagrams[0]->getWorkingCounter();
+    delete datagrams.back();
+    datagrams.pop_back();
+    
+    // read supported features and port states of all slave devices
+    
+    for (uint16_t i = 0; i < numberOfSlaveDevices; i++) {
+        datagrams.push_back(new EtherCAT::Datagram(EtherCAT::COMMAND_APRD, static_cast<uint16_t>(0x0000-i), EtherCAT::ESC_INFORMATION_FEATURES_SUPPORTED, 2));
+        datagrams.push_back(new EtherCAT::Datagram(EtherCAT::COMMAND_APRD, static_cast<uint16_t>(0x0000-i), EtherCAT::DATA_LINK_LAYER_STATUS, 2));
+    }
+    transmit(datagrams);
+    
+    vector<uint16_t> deviceAddresses;
+    vector<uint16_t> features;
+    vector<uint16_t> status;
+    
+    for (uint16_t i = 0; i < numberOfSlaveDevices; i++) {
+        
+        uint16_t feature = (static_cast<uint16_t>(datagrams[2*i]->data[10]) & 0xFF) | ((static_cast<uint16_t>(datagrams[2*i]->data[11]) & 0xFF) << 8);
+        
+        if ((datagrams[2*i]->getWorkingCounter() > 0) && ((feature & 0x0004) > 0)) {
+            deviceAddresses.push_back(static_cast<uint16_t>(0x0000-i));
+            features.push_back(feature);
+            status.push_back((static_cast<uint16_t>(datagrams[2*i+1]->data[10]) & 0xFF) | ((static_cast<uint16_t>(datagrams[2*i+1]->data[11]) & 0xFF) << 8));
+        }
+    }
+    
+    while (datagrams.size()) {
+        delete datagrams.back();
+        datagrams.pop_back();
+    }
+    
+    if (deviceAddresses.size() == 0) throw runtime_error("CoE: there are no slave devices with distributed clocks on the segment.");
+    
+    // latch the receive times of all ports of all slave devices, and read them back
+    
+    datagrams.push_back(new EtherCAT::Datagram(EtherCAT::COMMAND_BWR, 0x0000, EtherCAT::DC_RECEIVE_TIME_PORT_0, static_cast<uint32_t>(0), 4));
+    transmit(datagrams);
+    delete datagrams.back();
+    datagrams.pop_back();
+    
+    for (uint16_t i = 0; i < deviceAddresses.size(); i++) {
+        datagrams.push_back(new EtherCAT::Datagram(EtherCAT::COMMAND_APRD, deviceAddresses[i], EtherCAT::DC_RECEIVE_TIME_PORT_0, 32));
+    }
+    transmit(datagrams);
+    
+    vector<int64_t> roundTripTimes;
+    vector<uint64_t> localTimes;
+    
+    for (uint16_t i = 0; i < deviceAddresses.size(); i++) {
+        
+        uint32_t receiveTimes[4];
+        for (uint16_t j = 0; j < 4; j++) {
+            receiveTimes[j] = 0;
+            for (uint16_t k = 0; k < 4; k++) receiveTimes[j] |= (static_cast<uint32_t>(datagrams[i]->data[10+4*j+k]) & 0xFF) << (8*k);
+        }
+        
+        uint64_t localTime = 0;
+        for (uint16_t k = 0; k < 8; k++) localTime |= (static_cast<uint64_t>(datagrams[i]->data[10+24+k]) & 0xFF) << (8*k);
+        
+        // the frame is forwarded in the order port 0, 3, 1, 2, so the last open port receives it back from downstream
+        
+        static const uint16_t ports[] = {3, 1, 2};
+        
+        int64_t roundTripTime = 0;
+        for (uint16_t j = 0; j < 3; j++) {
+            if ((status[i] & (0x0200 << (2*ports[j]))) > 0) roundTripTime = static_cast<int32_t>(receiveTimes[ports[j]]-receiveTimes[0]);
         }
         
-        // transmit SDO request
-		
-        datagrams.push_back(new CANopenMailboxDatagram(EtherCAT::COMMAND_APWR, deviceAddress, mailboxOutAddress, mailboxOutSize, MESSAGE_TYPE_SDO_REQUEST, index, subindex, 0, 0));
+        roundTripTimes.push_back(roundTripTime);
+        localTimes.push_back(localTime);
+    }
+    
+    while (datagrams.size()) {
+        delete datagrams.back();
+        datagrams.pop_back();
+    }
+    
+    // write system time offsets and delays of all slave devices
+    
+    int64_t delay = 0;
+    
+    for (uint16_t i = 0; i < deviceAddresses.size(); i++) {
+        
+        if (i > 0) delay += (roundTripTimes[i-1]-roundTripTimes[i])/2;
+        if (delay < 0) delay = 0;
+        
+        uint64_t offset = localTimes[0]-localTimes[i]+static_cast<uint64_t>(delay);
+        
+        uint8_t data[12];
+        for (uint16_t k = 0; k < 8; k++) data[k] = static_cast<uint8_t>((offset >> (8*k)) & 0xFF);
+        for (uint16_t k = 0; k < 4; k++) data[8+k] = static_cast<uint8_t>((static_cast<uint64_t>(delay) >> (8*k)) & 0xFF);
+        
+        datagrams.push_back(new EtherCAT::Datagram(EtherCAT::COMMAND_APWR, deviceAddresses[i], EtherCAT::DC_SYSTEM_TIME_OFFSET, data, 12));
+    }
+    transmit(datagrams);
+    
+    for (uint16_t i = 0; i < datagrams.size(); i++) {
+        if (datagrams[i]->getWorkingCounter() == 0) cerr << "CoE: couldn't write system time offset of slave device 0x" << hex << deviceAddresses[i] << "." << dec << endl;
+    }
+    
+    while (datagrams.size()) {
+        delete datagrams.back();
+        datagrams.pop_back();
+    }
+    
+    // compensate the initial drift of the clocks with a series of ARMW datagrams
+    
+    uint16_t length = ((features[0] & 0x0008) > 0) ? 8 : 4;    // reference clock with 64 or 32 bit system time
+    
+    for (uint16_t i = 0; i < DRIFT_COMPENSATION_DATAGRAMS; i++) {
+        datagrams.push_back(new EtherCAT::Datagram(EtherCAT::COMMAND_ARMW, deviceAddresses[0], EtherCAT::DC_SYSTEM_TIME, length));
+    }
+    for (uint16_t i = 0; i < DRIFT_COMPENSATION_FRAMES; i++) {
         try {
             etherCAT.sendDatagrams(datagrams);
         } catch (exception& e) {
             cerr << e.what() << endl;
         }
-        if (datagrams[0]->getWorkingCounter() > 0) {
+    }
+    
+    while (datagrams.size()) {
+        delete datagrams.back();
+        datagrams.pop_back();
+    }
+    
+    // compensate the drift of the clocks with every communication cycle
+    
+    systemTime = new EtherCAT::Datagram(EtherCAT::COMMAND_ARMW, deviceAddresses[0], EtherCAT::DC_SYSTEM_TIME, length);
+    
+    registerDatagram(systemTime);
+}
+
+/**
+ * Sets the EtherCAT state machine of the given slave devices to a requested state, and waits until
+ * all slave devices reached that state. The state transition is requested with a broadcast datagram
+ * if the given slave devices are all slave devices on the segment, and if all of them respond without
+ * an error indication, and with one datagram per slave device otherwise. The application layer status
+ * of all slave devices is polled with a single frame.
+ * <br/>
+ * Slave devices with an error description are skipped, and slave devices that fail to enter the
+ * requested state are marked with an error description.
+ * @param slaveConfigurations a list of configurations of slave devices.
+ * @param state the requested state, i.e. <code>EtherCAT::STATE_INIT</code>, etc.
+ */
+void CoE::setState(vector<SlaveConfiguration*>& slaveConfigurations, uint16_t state) {
+    
+    vector<SlaveConfiguration*> pendingSlaveConfigurations;
+    for (uint16_t i = 0; i < slaveConfigurations.size(); i++) {
+        if (slaveConfigurations[i]->error.size() == 0) pendingSlaveConfigurations.push_back(slaveConfigurations[i]);
+    }
+    
+    if (pendingSlaveConfigurations.size() == 0) return;
+    
+    vector<EtherCAT::Datagram*> datagrams;
+    
+    // count the slave devices on the segment, and read the application layer status and status code of the given slave devices
+    
+    datagrams.push_back(new EtherCAT::Datagram(EtherCAT::COMMAND_BRD, 0x0000, EtherCAT::APPLICATION_LAYER_STATUS, 2));
+    for (uint16_t i = 0; i < pendingSlaveConfigurations.size(); i++) {
+        datagrams.push_back(new EtherCAT::Datagram(EtherCAT::COMMAND_APRD, pendingSlaveConfigurations[i]->deviceAddress, EtherCAT::APPLICATION_LAYER_STATUS, 6));
+    }
+    transmit(datagrams);
+    
+    uint16_t numberOfSlaveDevices = datagrams[0]->getWorkingCounter();
+    delete datagrams[0];
+    datagrams.erase(datagrams.begin());
+    
+    // a broadcast is only used if exactly the given slave devices respond, and none of them indicates an error
+    
+    bool broadcast = (pendingSlaveConfigurations.size() == numberOfSlaveDevices);
+    
+    for (uint16_t i = 0; i < datagrams.size(); i++) {
+        uint16_t status = (static_cast<uint16_t>(datagrams[i]->data[10]) & 0xFF) | ((static_cast<uint16_t>(datagrams[i]->data[11]) & 0xFF) << 8);
+        if ((datagrams[i]->getWorkingCounter() == 0) || ((status & EtherCAT::STATE_ERROR_MASK) == EtherCAT::STATE_ERROR)) broadcast = false;
+    }
+    
+    // request the state transition
+    
+    vector<EtherCAT::Datagram*> requests;
+    
+    if (broadcast) {
+        requests.push_back(new EtherCAT::Datagram(EtherCAT::COMMAND_BWR, 0x0000, EtherCAT::APPLICATION_LAYER_CONTROL, static_cast<uint32_t>(state), 2));
+    } else {
+        for (uint16_t i = 0; i < pendingSlaveConfigurations.size(); i++) {
+            if (datagrams[i]->getWorkingCounter() > 0) requests.push_back(new EtherCAT::Datagram(EtherCAT::COMMAND_APWR, pendingSlaveConfigurations[i]->deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, static_cast<uint32_t>(state), 2));
+        }
+    }
+    transmit(requests);
+    while (requests.size()) {
+        delete requests.back();
+        requests.pop_back();
+    }
+    
+    // poll the application layer status and status code of all slave devices
+    
+    vector<uint16_t> statusCodes(pendingSlaveConfigurations.size(), 0);
+    vector<bool> acknowledged(pendingSlaveConfigurations.size(), false);
+    
+    for (uint16_t i = 0; i < pendingSlaveConfigurations.size(); i++) {
+        if (datagrams[i]->getWorkingCounter() == 0) acknowledged[i] = true;  // request the state once this slave device responds
+    }
+    
+    uint16_t time = 0;
+    while (pendingSlaveConfigurations.size() > 0) {
+        
+        for (uint16_t i = 0; i < datagrams.size(); i++) datagrams[i]->resetWorkingCounter();
+        transmit(datagrams);
+        
+        for (uint16_t i = 0; i < pendingSlaveConfigurations.size(); ) {
             
-            while (datagrams.size()) {
-                delete datagrams.back();
-                datagrams.pop_back();
-            }
+            uint16_t status = (static_cast<uint16_t>(datagrams[i]->data[10]) & 0xFF) | ((static_cast<uint16_t>(datagrams[i]->data[11]) & 0xFF) << 8);
             
-            for (uint16_t j = 0; j < RETRIES; j++) {
+            if (datagrams[i]->getWorkingCounter() == 0) {
                 
-                // receive SDO response
+                i++;
                 
-                datagrams.push_back(new CANopenMailboxDatagram(EtherCAT::COMMAND_APRD, deviceAddress, mailboxInAddress, mailboxInSize, MESSAGE_TYPE_SDO_REQUEST, index, subindex, 0, 0));
-                try {
-                    etherCAT.sendDatagrams(datagrams);
-                } catch (exception& e) {
-                    cerr << e.what() << endl;
-                }
-                if (datagrams[0]->getWorkingCounter() > 0) {
-                    
-                    //cout << "CoE::readSDO: index=0x" << hex << index << " subindex=0x" << subindex << endl;
-                    //cout << "     response:";
-                    //for (int k = 0; k < 18; k++) cout << hex << " 0x" << ((unsigned int)(datagrams[0]->data[k]) & 0xFF);
-                    //cout << endl;
-                    //cout << "                    ";
-                    //for (int k = 18; k < 26; k++) cout << hex << " 0x" << ((unsigned int)(datagrams[0]->data[k]) & 0xFF);
-                    //cout << endl;
-                    
-                    if ((static_cast<CANopenMailboxDatagram*>(datagrams[0])->getMessageType() == MESSAGE_TYPE_SDO_REQUEST) || (static_cast<CANopenMailboxDatagram*>(datagrams[0])->getMessageType() == MESSAGE_TYPE_SDO_RESPONSE)) {
-                        
-                        if ((datagrams[0]->data[18] & 0x80) > 0) {
-                            
-                            while (datagrams.size()) {
-                                delete datagrams.back();
-                                datagrams.pop_back();
-                            }
-                            
-                            throw runtime_error("CoE: error message from device, class=0x"+type2String(static_cast<uint16_t>(datagrams[0]->data[25]) & 0xFF)+", code=0x"+type2String(static_cast<uint16_t>(datagrams[0]->data[24]) & 0xFF)+".");
-                        }
-                        
-                        uint8_t n = 4-((datagrams[0]->data[18] >> 2) & 0x03);
-                        uint32_t value = 0;
-                        
-                        if (n == 1) value = static_cast<uint32_t>(datagrams[0]->data[22]) & 0xFF;
-                        else if (n == 2) value = (static_cast<uint32_t>(datagrams[0]->data[22]) & 0xFF) | ((static_cast<uint32_t>(datagrams[0]->data[23]) & 0xFF) << 8);
-                        else value = (static_cast<uint32_t>(datagrams[0]->data[22]) & 0xFF) | ((static_cast<uint32_t>(datagrams[0]->data[23]) & 0xFF) << 8) | ((static_cast<uint32_t>(datagrams[0]->data[24]) & 0xFF) << 16) | ((static_cast<uint32_t>(datagrams[0]->data[25]) & 0xFF) << 24);
-                        
-                        while (datagrams.size()) {
-                            delete datagrams.back();
-                            datagrams.pop_back();
-                        }
-                        
-                        //cout << "CoE::readSDO: i=" << dec << i << " j=" << j << endl;
-                        
-                        return value;
-                        
-                    } else {
-                        
-                        while (datagrams.size()) {
-                            delete datagrams.back();
-                            datagrams.pop_back();
-                        }
-                        
-                        Thread::sleep(1);
-                        //throw runtime_error("CoE: wrong response from device!");
-                    }
-                    
-                } else {
-                    
-                    while (datagrams.size()) {
-                        delete datagrams.back();
-                        datagrams.pop_back();
-                    }
-                    
-                    Thread::sleep(1);
+            } else if ((status & EtherCAT::STATE_ERROR_MASK) == EtherCAT::STATE_ERROR) {
+                
+                // acknowledge the error, and request the state again with the next poll
+                
+                statusCodes[i] = (static_cast<uint16_t>(datagrams[i]->data[14]) & 0xFF) | ((static_cast<uint16_t>(datagrams[i]->data[15]) & 0xFF) << 8);
+                requests.push_back(new EtherCAT::Datagram(EtherCAT::COMMAND_APWR, pendingSlaveConfigurations[i]->deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, static_cast<uint32_t>(status & (EtherCAT::STATE_MASK | EtherCAT::STATE_ERROR_MASK)), 2));
+                acknowledged[i] = true;
+                i++;
+                
+            } else if ((status & EtherCAT::STATE_MASK) == state) {
+                
+                // this slave device reached the requested state
+                
+                delete datagrams[i];
+                datagrams.erase(datagrams.begin()+i);
+                pendingSlaveConfigurations.erase(pendingSlaveConfigurations.begin()+i);
+                statusCodes.erase(statusCodes.begin()+i);
+                acknowledged.erase(acknowledged.begin()+i);
+                
+            } else {
+                
+                if (acknowledged[i]) {
+                    requests.push_back(new EtherCAT::Datagram(EtherCAT::COMMAND_APWR, pendingSlaveConfigurations[i]->deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, static_cast<uint32_t>(state), 2));
+                    acknowledged[i] = false;
                 }
+                i++;
             }
-            
-        } else {
-            
-            while (datagrams.size()) {
-                delete datagrams.back();
-                datagrams.pop_back();
-            }
-            
-            Thread::sleep(1);
+        }
+        
+        transmit(requests);
+        while (requests.size()) {
+            delete requests.back();
+            requests.pop_back();
+        }
+        
+        if (pendingSlaveConfigurations.size() > 0) {
+            if (time++ < STATE_TIMEOUT) Thread::sleep(1);
+            else break;
         }
     }
     
-    throw runtime_error("CoE: mailbox datagram was not processed by device!");
+    // mark slave devices that didn't reach the requested state
+    
+    for (uint16_t i = 0; i < pendingSlaveConfigurations.size(); i++) {
+        if (datagrams[i]->getWorkingCounter() == 0) pendingSlaveConfigurations[i]->error = "doesn't respond, couldn't enter state "+state2String(state);
+        else pendingSlaveConfigurations[i]->error = "couldn't enter state "+state2String(state)+", APPLICATION_LAYER_STATUS_CODE=0x"+type2String(statusCodes[i]);
+        delete datagrams[i];
+    }
 }
 
 /**
- * This run method implements the periodic communication loop for the fieldbus.
+ * Transmits a list of datagrams on the fieldbus. The datagrams are distributed to
+ * as few EtherCAT frames as possible.
+ * @param datagrams a list of datagrams to transmit.
  */
-void CoE::run() {
-
-    while (waitForNextPeriod()) {
+void CoE::transmit(vector<EtherCAT::Datagram*>& datagrams) {
+    
+    vector<EtherCAT::Datagram*> frame;
+    uint16_t length = 0;
+    
+    for (uint16_t i = 0; i < datagrams.size(); i++) {
         
-        for (uint16_t i = 0; i < datagrams.size(); i++) datagrams[i]->resetWorkingCounter();
-        for (uint16_t i = 0; i < slaveDevices.size(); i++) slaveDevices[i]->writeDatagram();
-        try {
-            etherCAT.sendDatagrams(datagrams);
-        } catch (exception& e) {
-            cerr << e.what() << endl;
+        if ((frame.size() > 0) && (length+datagrams[i]->length > EtherCAT::Frame::SIZE-2)) {
+            try {
+                etherCAT.sendDatagrams(frame);
+            } catch (exception& e) {
+                cerr << e.what() << endl;
+            }
+            frame.clear();
+            length = 0;
         }
-        for (uint16_t i = 0; i < slaveDevices.size(); i++) slaveDevices[i]->readDatagram();
+        
+        frame.push_back(datagrams[i]);
+        length += datagrams[i]->length;
+    }
+    
+    if (frame.size() > 0) try {
+        etherCAT.sendDatagrams(frame);
+    } catch (exception& e) {
+        cerr << e.what() << endl;
     }
 }
@@ -19,6 +19,7 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include "Thread.h"
+#include "Trace.h"
 #include "Ethernet.h"
 #include "EtherCAT.h"
 
@@ -36,7 +37,8 @@ const uint16_t EtherCAT::PORT_NUMBER = 0x88A4;                  // EtherCAT port
  */
 EtherCAT::Datagram::Datagram(uint8_t command, uint16_t deviceAddress, uint16_t offsetAddress, uint16_t length) {
     
-    this->data = new uint8_t[10+length+2];
+    buffer = new uint8_t[10+length+2];
+    this->data = buffer;
     
     // fill in datagram header
     
@@ -71,7 +73,8 @@ EtherCAT::Datagram::Datagram(uint8_t command, uint16_t deviceAddress, uint16_t o
  */
 EtherCAT::Datagram::Datagram(uint8_t command, uint16_t deviceAddress, uint16_t offsetAddress, uint8_t data[], uint16_t length) {
     
-    this->data = new uint8_t[10+length+2];
+    buffer = new uint8_t[10+length+2];
+    this->data = buffer;
     
     // fill in datagram header
     
@@ -108,7 +111,8 @@ EtherCAT::Datagram::Datagram(uint8_t command, uint16_t deviceAddress, uint16_t o
     
     if (length < 4) length = 4;
     
-    data = new uint8_t[10+length+2];
+    buffer = new uint8_t[10+length+2];
+    data = buffer;
     
     // fill in datagram header
     
@@ -148,7 +152,8 @@ EtherCAT::Datagram::Datagram(uint8_t command, uint16_t deviceAddress, uint16_t o
     
     if (length < 8) length = 8;
     
-    data = new uint8_t[10+length+2];
+    buffer = new uint8_t[10+length+2];
+    data = buffer;
     
     // fill in datagram header
     
@@ -186,18 +191,37 @@ EtherCAT::Datagram::Datagram(uint8_t command, uint16_t deviceAddress, uint16_t o
  */
 EtherCAT::Datagram::Datagram(Datagram& datagram) {
     
-    this->data = new uint8_t[datagram.length];
+    buffer = new uint8_t[datagram.length];
+    this->data = buffer;
 	this->length = datagram.length;
 	
     memcpy((void*)(this->data), (void*)(datagram.data), this->length);
 }
 
 /**
- * Deletes the datagram object.
+ * Deletes the datagram object. A datagram must be detached from a frame before it is deleted.
  */
 EtherCAT::Datagram::~Datagram() {
     
-    delete[] data;
+    delete[] buffer;
+}
+
+/**
+ * Changes the length of the payload of this datagram. The new length must not exceed
+ * the payload length this datagram was created with, because the data buffer is not
+ * reallocated. The working counter is moved to the end of the new payload and reset.
+ * A datagram must not be resized while it is attached to a frame.
+ * @param length the new length of the payload of this datagram.
+ */
+void EtherCAT::Datagram::resize(uint16_t length) {
+    
+    data[6] = static_cast<uint8_t>(length & 0xFF);
+    data[7] = static_cast<uint8_t>((data[7] & 0x80) | ((length >> 8) & 0x07));
+    
+    data[10+length+0] = 0;
+    data[10+length+1] = 0;
+    
+    this->length = 10+length+2;
 }
 
 /**
@@ -245,6 +269,115 @@ uint16_t EtherCAT::Datagram::getWorkingCounter() {
     return ((static_cast<uint16_t>(data[length-2]) & 0xFF) | ((static_cast<uint16_t>(data[length-1]) & 0xFF) << 8));
 }
 
+/**
+ * Creates an empty EtherCAT frame and allocates its buffers.
+ */
+EtherCAT::Frame::Frame() {
+    
+    buffers[0] = new uint8_t[SIZE];
+    buffers[1] = new uint8_t[SIZE];
+    
+    memset((void*)buffers[0], 0, SIZE);
+    memset((void*)buffers[1], 0, SIZE);
+    
+    active = 0;
+    length = 0;
+    index = 0;
+    pending = false;
+    responses = 0;
+}
+
+/**
+ * Deletes the frame object and releases its buffers.
+ */
+EtherCAT::Frame::~Frame() {
+    
+    detach();
+    
+    delete[] buffers[0];
+    delete[] buffers[1];
+}
+
+/**
+ * Attaches a list of datagrams to this frame. The datagrams are copied into the buffer of
+ * this frame and their data pointers alias this buffer afterwards. Datagrams that were
+ * attached to this frame before are detached first.
+ * <br/>
+ * This method is typically called once, when the datagrams that are transmitted periodically
+ * are registered, and not within a realtime loop.
+ * @param datagrams a list of datagrams to attach to this frame.
+ */
+void EtherCAT::Frame::attach(const vector<Datagram*>& datagrams) {
+    
+    detach();
+    
+    uint16_t length = 2;
+    for (uint16_t i = 0; i < datagrams.size(); i++) length += datagrams[i]->length;
+    
+    if (length > SIZE) throw runtime_error("EtherCAT: datagrams don't fit into a frame.");
+    if (datagrams.size() == 0) return;
+    
+    // fill in EtherCAT header
+    
+    uint16_t header = (length-2) | (1 << 12);
+    
+    buffers[active][0] = static_cast<uint8_t>(header & 0xFF);
+    buffers[active][1] = static_cast<uint8_t>((header >> 8) & 0xFF);
+    
+    // lay out datagrams and let them alias the buffer
+    
+    uint16_t offset = 2;
+    for (uint16_t i = 0; i < datagrams.size(); i++) {
+        
+        datagrams[i]->setMoreDatagrams(i < datagrams.size()-1);
+        
+        memcpy((void*)&(buffers[active][offset]), (void*)(datagrams[i]->data), datagrams[i]->length);
+        datagrams[i]->data = &(buffers[active][offset]);
+        
+        this->datagrams.push_back(datagrams[i]);
+        this->offsets.push_back(offset);
+        
+        offset += datagrams[i]->length;
+    }
+    
+    this->length = length;
+}
+
+/**
+ * Detaches all datagrams from this frame. The datagrams are copied back into their
+ * own buffers, so that they may be resized or deleted again.
+ */
+void EtherCAT::Frame::detach() {
+    
+    for (uint16_t i = 0; i < datagrams.size(); i++) {
+        
+        memcpy((void*)(datagrams[i]->buffer), (void*)(datagrams[i]->data), datagrams[i]->length);
+        datagrams[i]->data = datagrams[i]->buffer;
+    }
+    
+    datagrams.clear();
+    offsets.clear();
+    length = 0;
+}
+
+/**
+ * Redirects the attached datagrams to the buffer a valid frame was received into.
+ * The datagram headers are restored from the transmitted frame, because slave devices
+ * modify the address fields of auto increment and broadcast datagrams.
+ */
+void EtherCAT::Frame::swap() {
+    
+    uint8_t* received = buffers[active ^ 1];
+    
+    for (uint16_t i = 0; i < datagrams.size(); i++) {
+        
+        memcpy((void*)&(received[offsets[i]]), (void*)(datagrams[i]->data), 10);
+        datagrams[i]->data = &(received[offsets[i]]);
+    }
+    
+    active ^= 1;
+}
+
 uint8_t EtherCAT::MailboxDatagram::counter = 0;
 
 /**
@@ -321,12 +454,112 @@ EtherCAT::MailboxDatagram::MailboxDatagram(uint8_t command, uint16_t deviceAddre
  */
 EtherCAT::MailboxDatagram::~MailboxDatagram() {}
 
+/**
+ * Creates a process data object that gives access to a section of a logical process image.
+ * @param datagram the datagram that contains the logical process image.
+ * @param offset the offset of this section within the payload of the datagram, given in [bytes].
+ * @param length the length of this section, given in [bytes].
+ */
+EtherCAT::ProcessData::ProcessData(Datagram* datagram, uint16_t offset, uint16_t length) {
+    
+    this->datagram = datagram;
+    this->offset = offset;
+    this->length = length;
+}
+
+/**
+ * Deletes the process data object. The process image itself is not released.
+ */
+EtherCAT::ProcessData::~ProcessData() {}
+
+/**
+ * Writes an 8 bit value into this section of the process image.
+ * @param offset the offset of the value within this section, given in [bytes].
+ * @param value the value to write.
+ */
+void EtherCAT::ProcessData::write8(uint16_t offset, uint8_t value) {
+    
+    datagram->data[10+this->offset+offset] = value;
+}
+
+/**
+ * Reads an 8 bit value from this section of the process image.
+ * @param offset the offset of the value within this section, given in [bytes].
+ * @return the value at the given offset.
+ */
+uint8_t EtherCAT::ProcessData::read8(uint16_t offset) {
+    
+    return datagram->data[10+this->offset+offset];
+}
+
+/**
+ * Writes a 16 bit value in little endian byte order into this section of the process image.
+ * @param offset the offset of the value within this section, given in [bytes].
+ * @param value the value to write.
+ */
+void EtherCAT::ProcessData::write16(uint16_t offset, uint16_t value) {
+    
+    uint8_t* data = &(datagram->data[10+this->offset]);
+    
+    data[offset+0] = static_cast<uint8_t>(value & 0xFF);
+    data[offset+1] = static_cast<uint8_t>((value >> 8) & 0xFF);
+}
+
+/**
+ * Reads a 16 bit value in little endian byte order from this section of the process image.
+ * @param offset the offset of the value within this section, given in [bytes].
+ * @return the value at the given offset.
+ */
+uint16_t EtherCAT::ProcessData::read16(uint16_t offset) {
+    
+    uint8_t* data = &(datagram->data[10+this->offset]);
+    
+    return (static_cast<uint16_t>(data[offset+0]) & 0xFF) | ((static_cast<uint16_t>(data[offset+1]) & 0xFF) << 8);
+}
+
+/**
+ * Writes a 32 bit value in little endian byte order into this section of the process image.
+ * @param offset the offset of the value within this section, given in [bytes].
+ * @param value the value to write.
+ */
+void EtherCAT::ProcessData::write32(uint16_t offset, uint32_t value) {
+    
+    uint8_t* data = &(datagram->data[10+this->offset]);
+    
+    data[offset+0] = static_cast<uint8_t>(value & 0xFF);
+    data[offset+1] = static_cast<uint8_t>((value >> 8) & 0xFF);
+    data[offset+2] = static_cast<uint8_t>((value >> 16) & 0xFF);
+    data[offset+3] = static_cast<uint8_t>((value >> 24) & 0xFF);
+}
+
+/**
+ * Reads a 32 bit value in little endian byte order from this section of the process image.
+ * @param offset the offset of the value within this section, given in [bytes].
+ * @return the value at the given offset.
+ */
+uint32_t EtherCAT::ProcessData::read32(uint16_t offset) {
+    
+    uint8_t* data = &(datagram->data[10+this->offset]);
+    
+    return (static_cast<uint32_t>(data[offset+0]) & 0xFF) | ((static_cast<uint32_t>(data[offset+1]) & 0xFF) << 8) | ((static_cast<uint32_t>(data[offset+2]) & 0xFF) << 16) | ((static_cast<uint32_t>(data[offset+3]) & 0xFF) << 24);
+}
+
 /**
  * Creates an <code>EtherCAT</code> object that communicates with an Ethernet driver.
  * @param ethernet a reference to an Ethernet driver.
  */
 EtherCAT::EtherCAT(Ethernet* ethernet) {
 
+    // create datagram to access registers of slave devices
+    
+    registerDatagram = new Datagram(COMMAND_APRD, 0x0000, 0x0000, static_cast<uint16_t>(8));
+    registerDatagrams.push_back(registerDatagram);
+    
+    // initialize table of frames in flight
+    
+    for (uint16_t i = 0; i < 256; i++) frames[i] = NULL;
+    index = 0;
+    
     // initialize reference to Ethernet driver
     
     this->ethernet = ethernet;
@@ -342,6 +575,16 @@ EtherCAT::EtherCAT(Ethernet* ethernet) {
  */
 EtherCAT::EtherCAT(string interfaceAddress) : interfaceAddress(interfaceAddress) {
     
+    // create datagram to access registers of slave devices
+    
+    registerDatagram = new Datagram(COMMAND_APRD, 0x0000, 0x0000, static_cast<uint16_t>(8));
+    registerDatagrams.push_back(registerDatagram);
+    
+    // initialize table of frames in flight
+    
+    for (uint16_t i = 0; i < 256; i++) frames[i] = NULL;
+    index = 0;
+    
     // initialize reference to Ethernet driver
     
     ethernet = NULL;
@@ -390,138 +633,186 @@ EtherCAT::EtherCAT(string interfaceAddress) : interfaceAddress(interfaceAddress)
 /**
  * Deletes the <code>EtherCAT</code> object.
  */
-EtherCAT::~EtherCAT() {}
+EtherCAT::~EtherCAT() {
+    
+    delete registerDatagram;
+}
 
 /**
  * Assembles an EtherCAT frame from the list of given datagrams and transmits that
  * EtherCAT frame on the fielbus. Calling this method also reads back the received
  * (processed) datagrams, meaning that the given datagrams will be modified by the
  * EtherCAT slave devices after calling this method.
+ * <br/>
+ * The datagrams are copied into a preallocated frame and back. Datagrams that are
+ * transmitted periodically should rather be attached to a <code>Frame</code> once,
+ * and transmitted with the <code>sendFrame()</code> method.
  * @param datagrams a list of datagrams to transmit on the EtherCAT fieldbus.
  */
-void EtherCAT::sendDatagrams(vector<Datagram*> datagrams) {
+void EtherCAT::sendDatagrams(const vector<Datagram*>& datagrams) {
+    
+    Trace::Span span("EtherCAT::sendDatagrams");
     
     if (datagrams.size() > 0) {
         
         mutex.lock();
         
-        // create byte array with EtherCAT header and datagrams
+        try {
+            frame.attach(datagrams);
+        } catch (exception& e) {
+            mutex.unlock();
+            throw;
+        }
         
-        uint16_t length = 0;    // length of all datagrams, without EtherCAT header, in [bytes]
-        for (uint16_t i = 0; i < datagrams.size(); i++) length += datagrams[i]->length;
+        transceive(frame);
         
-        for (uint16_t i = 0; i < datagrams.size()-1; i++) datagrams[i]->setMoreDatagrams(true);
-        datagrams[datagrams.size()-1]->setMoreDatagrams(false);
+        frame.detach();
         
-        uint8_t data[2+length]; // byte array constists of header (first 2 bytes) and  all datagrams
-        uint16_t header = length | (1 << 12);
+        mutex.unlock();
+    }
+}
+
+/**
+ * Transmits an EtherCAT frame with attached datagrams on the fieldbus, and reads back
+ * the received (processed) frame. The datagrams are processed in place, this method
+ * does neither allocate memory nor copy datagrams.
+ * <br/>
+ * Other frames may be in flight at the same time, i.e. frames with mailbox datagrams
+ * transmitted by other threads. This method therefore only waits for its own frame.
+ * @param frame a reference to a frame with attached datagrams.
+ */
+void EtherCAT::sendFrame(Frame& frame) {
+    
+    transmitFrame(frame);
+    receiveFrame(frame);
+}
+
+/**
+ * Transmits an EtherCAT frame with attached datagrams on the fieldbus, without waiting for
+ * its response. The frame gets the next free frame index, and it stays in flight until its
+ * response is collected with the <code>receiveFrame()</code> method, which must be called
+ * for every transmitted frame. The attached datagrams must not be accessed in the meantime.
+ * <br/>
+ * If the frame couldn't be sent, this method throws an exception, and the frame isn't in flight.
+ * @param frame a reference to a frame with attached datagrams.
+ */
+void EtherCAT::transmitFrame(Frame& frame) {
+    
+    if (frame.length == 0) return;
+    
+    Trace::Span span("EtherCAT::transmitFrame");
+    
+    pipeline.lock();
+    
+    // get the next free frame index
+    
+    for (uint16_t i = 0; (frames[index] != NULL) && (i < 256); i++) index++;
+    
+    if (frames[index] != NULL) {
+        pipeline.unlock();
+        throw runtime_error("EtherCAT: too many frames in flight.");
+    }
+    
+    uint8_t* transmitted = frame.buffers[frame.active];
+    transmitted[3] = index;     // index field of the first datagram
+    
+    // send EtherCAT frame
+    
+    if (ethernet != NULL) {
         
-        data[0] = static_cast<uint8_t>(header & 0xFF);
-        data[1] = static_cast<uint8_t>((header >> 8) & 0xFF);
+        // use the Ethernet driver
         
-        uint16_t index = 2;
-        for (uint16_t i = 0; i < datagrams.size(); i++) {
-            memcpy((void*)&(data[index]), (void*)(datagrams[i]->data), datagrams[i]->length);
-            index += datagrams[i]->length;
+        uint8_t destinationMACAddress[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+        uint16_t bytesSent = ethernet->send(destinationMACAddress, Ethernet::ETHERTYPE_ETHER_CAT, transmitted, frame.length);
+        
+        if (bytesSent == 0) {
+            pipeline.unlock();
+            throw runtime_error("EtherCAT: couldn't send datagrams.");
         }
         
-        // send EtherCAT frame
+    } else {
         
-        if (ethernet != NULL) {
-            
-            // use the Ethernet driver
-            
-            uint8_t destinationMACAddress[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
-            uint16_t bytesSent = ethernet->send(destinationMACAddress, Ethernet::ETHERTYPE_ETHER_CAT, data, 2+length);
+        // use a UDP datagram
+        
+        try {
             
-            if (bytesSent == 0) cerr << "EtherCAT: couldn't send datagrams." << endl;
-
-        } else {
+            sendMulticastDatagram(transmitted, frame.length);
             
-            // use a UDP datagram
+        } catch (exception& e) {
             
-            try {
-                
-                sendMulticastDatagram(data, 2+length);
-                
-            } catch (exception& e) {
-                
-                cerr << e.what() << endl;
-            }
+            pipeline.unlock();
+            throw;
         }
+    }
+    
+    // register the frame in flight only after it was sent, its response can't be dispatched before the pipeline mutex is unlocked
+    
+    frame.index = index;
+    frame.pending = true;
+    frame.responses = (ethernet != NULL) ? 1 : 2;   // UDP datagrams are looped back as well
+    
+    frames[index++] = &frame;
+    
+    pipeline.unlock();
+}
+
+/**
+ * Waits for the response of a frame that was transmitted with the <code>transmitFrame()</code>
+ * method. Received frames of other threads are handed over to their frames while waiting, and
+ * received frames that are not in flight anymore, i.e. late responses, are discarded. The
+ * pipeline mutex isn't locked while waiting, so that other threads can transmit their frames.
+ * <br/>
+ * If a valid response was received, the attached datagrams are redirected to the received frame.
+ * Otherwise, the frame is removed from the frames in flight, and its datagrams keep their data.
+ * @param frame a reference to a frame that was transmitted before.
+ * @return <code>true</code> if a valid response was received, <code>false</code> otherwise.
+ */
+bool EtherCAT::receiveFrame(Frame& frame) {
+    
+    Trace::Span span("EtherCAT::receiveFrame");
+    
+    for (uint16_t counter = 0; ; counter++) {
+        
+        // only the thread that reads from the communication channel dispatches received frames,
+        // so the state of this frame can't change while the receiver mutex is locked
         
-        // receive returning EtherCAT frame
+        receiver.lock();
         
-        if (ethernet != NULL) {
+        if (!frame.pending) {
             
-            // use the Ethernet driver
+            // the response was received, either by this thread or by another thread
             
-            uint8_t sourceMACAddress[6];
-            uint16_t etherType = 0;
-            uint16_t receivedBytes = 0;
-            uint16_t counter = 0;
+            receiver.unlock();
             
-            memset((void*)data, 0, 2+length);
+            return true;
             
-            while ((receivedBytes == 0) && (counter++ < RETRIES)) receivedBytes = ethernet->receive(sourceMACAddress, etherType, data, 2+length);
+        } else if (counter >= RETRIES) {
             
-            if (receivedBytes == 0) {
-                
-                cerr << "EtherCAT: no response from device." << endl;
-                
-            } else {
-                
-                while (receivedBytes > 0) {
-                    
-                    if ((receivedBytes >= 2+length) && (etherType == Ethernet::ETHERTYPE_ETHER_CAT)) {
-                        
-                        // copy response back into datagrams
-                        
-                        index = 2;
-                        for (uint16_t i = 0; i < datagrams.size(); i++) {
-                            memcpy((void*)&(datagrams[i]->data[10]), (void*)&(data[index+10]), datagrams[i]->length-10);
-                            index += datagrams[i]->length;
-                        }
-                    }
-                    
-                    receivedBytes = ethernet->receive(sourceMACAddress, etherType, data, 2+length);
-                }
-            }
+            pipeline.lock();
             
-        } else {
+            frames[frame.index] = NULL;
+            frame.pending = false;
             
-            // use UDP datagrams
+            pipeline.unlock();
+            receiver.unlock();
             
-            try {
-                
-                // read loopback response
-                
-                ssize_t received = receiveMulticastDatagram(data, 2+length);
-                
-                // read response from EtherCAT slave
-                
-                memset((void*)data, 0, 2+length);
-                
-                received = receiveMulticastDatagram(data, 2+length);
-                
-                if (received >= 2+length) {
-                    
-                    // copy response back into datagrams
-                    
-                    index = 2;
-                    for (uint16_t i = 0; i < datagrams.size(); i++) {
-                        memcpy((void*)&(datagrams[i]->data[10]), (void*)&(data[index+10]), datagrams[i]->length-10);
-                        index += datagrams[i]->length;
-                    }
-                }
-                
-            } catch (exception& e) {
-                
-                cerr << e.what() << endl;
-            }
+            cerr << "EtherCAT: no response from device." << endl;
+            
+            return false;
         }
         
-        mutex.unlock();
+        // read without the pipeline mutex, so that other threads can transmit frames in the meantime
+        
+        uint8_t* received = frame.buffers[frame.active^1];
+        uint16_t receivedBytes = receive(received, Frame::SIZE);
+        
+        if (receivedBytes > 0) {
+            pipeline.lock();
+            dispatch(received, receivedBytes);
+            pipeline.unlock();
+        }
+        
+        receiver.unlock();
     }
 }
 
@@ -533,16 +824,7 @@ void EtherCAT::sendDatagrams(vector<Datagram*> datagrams) {
  */
 void EtherCAT::write8(uint16_t deviceAddress, uint16_t offsetAddress, uint8_t value) {
     
-    vector<Datagram*> datagrams;
-    datagrams.push_back(new Datagram(COMMAND_APWR, deviceAddress, offsetAddress, static_cast<uint32_t>(value), 1));
-    try {
-        sendDatagrams(datagrams);
-    } catch (exception& e) {
-        cerr << e.what() << endl;
-    }
-    if (datagrams[0]->getWorkingCounter() == 0) throw runtime_error("EtherCAT: datagram was not processed.");
-    delete datagrams.back();
-    datagrams.pop_back();
+    transfer(COMMAND_APWR, deviceAddress, offsetAddress, value, 4);
 }
 
 /**
@@ -553,19 +835,7 @@ void EtherCAT::write8(uint16_t deviceAddress, uint16_t offsetAddress, uint8_t va
  */
 uint8_t EtherCAT::read8(uint16_t deviceAddress, uint16_t offsetAddress) {
     
-    vector<Datagram*> datagrams;
-    datagrams.push_back(new Datagram(COMMAND_APRD, deviceAddress, offsetAddress, static_cast<uint32_t>(0), 1));
-    try {
-        sendDatagrams(datagrams);
-    } catch (exception& e) {
-        cerr << e.what() << endl;
-    }
-    if (datagrams[0]->getWorkingCounter() == 0) throw runtime_error("EtherCAT: datagram was not processed.");
-    uint8_t value = datagrams[0]->data[10];
-    delete datagrams.back();
-    datagrams.pop_back();
-    
-    return value;
+    return static_cast<uint8_t>(transfer(COMMAND_APRD, deviceAddress, offsetAddress, 0, 4));
 }
 
 /**
@@ -576,16 +846,7 @@ uint8_t EtherCAT::read8(uint16_t deviceAddress, uint16_t offsetAddress) {
  */
 void EtherCAT::write16(uint16_t deviceAddress, uint16_t offsetAddress, uint16_t value) {
     
-    vector<Datagram*> datagrams;
-    datagrams.push_back(new Datagram(COMMAND_APWR, deviceAddress, offsetAddress, static_cast<uint32_t>(value), 2));
-    try {
-        sendDatagrams(datagrams);
-    } catch (exception& e) {
-        cerr << e.what() << endl;
-    }
-    if (datagrams[0]->getWorkingCounter() == 0) throw runtime_error("EtherCAT: datagram was not processed.");
-    delete datagrams.back();
-    datagrams.pop_back();
+    transfer(COMMAND_APWR, deviceAddress, offsetAddress, value, 4);
 }
 
 /**
@@ -596,19 +857,7 @@ void EtherCAT::write16(uint16_t deviceAddress, uint16_t offsetAddress, uint16_t
  */
 uint16_t EtherCAT::read16(uint16_t deviceAddress, uint16_t offsetAddress) {
     
-    vector<Datagram*> datagrams;
-    datagrams.push_back(new Datagram(COMMAND_APRD, deviceAddress, offsetAddress, static_cast<uint32_t>(0), 2));
-    try {
-        sendDatagrams(datagrams);
-    } catch (exception& e) {
-        cerr << e.what() << endl;
-    }
-    if (datagrams[0]->getWorkingCounter() == 0) throw runtime_error("EtherCAT: datagram was not processed.");
-    uint16_t value = (static_cast<uint16_t>(datagrams[0]->data[10]) & 0xFF) | ((static_cast<uint16_t>(datagrams[0]->data[11]) & 0xFF) << 8);
-    delete datagrams.back();
-    datagrams.pop_back();
-    
-    return value;
+    return static_cast<uint16_t>(transfer(COMMAND_APRD, deviceAddress, offsetAddress, 0, 4));
 }
 
 /**
@@ -619,16 +868,7 @@ uint16_t EtherCAT::read16(uint16_t deviceAddress, uint16_t offsetAddress) {
  */
 void EtherCAT::write32(uint16_t deviceAddress, uint16_t offsetAddress, uint32_t value) {
     
-    vector<Datagram*> datagrams;
-    datagrams.push_back(new Datagram(COMMAND_APWR, deviceAddress, offsetAddress, value, 4));
-    try {
-        sendDatagrams(datagrams);
-    } catch (exception& e) {
-        cerr << e.what() << endl;
-    }
-    if (datagrams[0]->getWorkingCounter() == 0) throw runtime_error("EtherCAT: datagram was not processed.");
-    delete datagrams.back();
-    datagrams.pop_back();
+    transfer(COMMAND_APWR, deviceAddress, offsetAddress, value, 4);
 }
 
 /**
@@ -639,19 +879,7 @@ void EtherCAT::write32(uint16_t deviceAddress, uint16_t offsetAddress, uint32_t
  */
 uint32_t EtherCAT::read32(uint16_t deviceAddress, uint16_t offsetAddress) {
     
-    vector<Datagram*> datagrams;
-    datagrams.push_back(new Datagram(COMMAND_APRD, deviceAddress, offsetAddress, static_cast<uint32_t>(0), 4));
-    try {
-        sendDatagrams(datagrams);
-    } catch (exception& e) {
-        cerr << e.what() << endl;
-    }
-    if (datagrams[0]->getWorkingCounter() == 0) throw runtime_error("EtherCAT: datagram was not processed.");
-    uint32_t value = (static_cast<uint32_t>(datagrams[0]->data[10]) & 0xFF) | ((static_cast<uint32_t>(datagrams[0]->data[11]) & 0xFF) << 8) | ((static_cast<uint32_t>(datagrams[0]->data[12]) & 0xFF) << 16) | ((static_cast<uint32_t>(datagrams[0]->data[13]) & 0xFF) << 24);
-    delete datagrams.back();
-    datagrams.pop_back();
-    
-    return value;
+    return static_cast<uint32_t>(transfer(COMMAND_APRD, deviceAddress, offsetAddress, 0, 4));
 }
 
 /**
@@ -662,16 +890,7 @@ uint32_t EtherCAT::read32(uint16_t deviceAddress, uint16_t offsetAddress) {
  */
 void EtherCAT::write64(uint16_t deviceAddress, uint16_t offsetAddress, uint64_t value) {
     
-    vector<Datagram*> datagrams;
-    datagrams.push_back(new Datagram(COMMAND_APWR, deviceAddress, offsetAddress, value, 8));
-    try {
-        sendDatagrams(datagrams);
-    } catch (exception& e) {
-        cerr << e.what() << endl;
-    }
-    if (datagrams[0]->getWorkingCounter() == 0) throw runtime_error("EtherCAT: datagram was not processed.");
-    delete datagrams.back();
-    datagrams.pop_back();
+    transfer(COMMAND_APWR, deviceAddress, offsetAddress, value, 8);
 }
 
 /**
@@ -682,19 +901,138 @@ void EtherCAT::write64(uint16_t deviceAddress, uint16_t offsetAddress, uint64_t
  */
 uint64_t EtherCAT::read64(uint16_t deviceAddress, uint16_t offsetAddress) {
     
-    vector<Datagram*> datagrams;
-    datagrams.push_back(new Datagram(COMMAND_APRD, deviceAddress, offsetAddress, static_cast<uint64_t>(0), 8));
+    return static_cast<uint64_t>(transfer(COMMAND_APRD, deviceAddress, offsetAddress, 0, 8));
+}
+
+/**
+ * Reads or writes a value of a given EtherCAT slave device with a preallocated datagram.
+ * @param command the command of the datagram, i.e. COMMAND_APRD or COMMAND_APWR.
+ * @param deviceAddress the relative device address, i.e. 0x0000, 0xFFFF, 0xFFFE, etc.
+ * @param offsetAddress the address within the EtherCAT slave controller, i.e. the address of a slave controller register.
+ * @param value the value to write.
+ * @param length the length of the payload of the datagram, given in [bytes].
+ * @return the value read back from the slave device.
+ */
+uint64_t EtherCAT::transfer(uint8_t command, uint16_t deviceAddress, uint16_t offsetAddress, uint64_t value, uint16_t length) {
+    
+    mutex.lock();
+    
+    // fill in datagram header and data
+    
+    uint8_t* data = registerDatagram->data;
+    
+    data[0] = command;
+    data[1] = 0;
+    data[2] = static_cast<uint8_t>(deviceAddress & 0xFF);
+    data[3] = static_cast<uint8_t>((deviceAddress >> 8) & 0xFF);
+    data[4] = static_cast<uint8_t>(offsetAddress & 0xFF);
+    data[5] = static_cast<uint8_t>((offsetAddress >> 8) & 0xFF);
+    
+    registerDatagram->resize(length);
+    
+    for (uint16_t i = 0; i < length; i++) data[10+i] = static_cast<uint8_t>((value >> (8*i)) & 0xFF);
+    
+    // transmit datagram
+    
+    frame.attach(registerDatagrams);
+    transceive(frame);
+    frame.detach();
+    
+    uint16_t workingCounter = registerDatagram->getWorkingCounter();
+    
+    value = 0;
+    for (uint16_t i = 0; i < length; i++) value |= (static_cast<uint64_t>(registerDatagram->data[10+i]) & 0xFF) << (8*i);
+    
+    mutex.unlock();
+    
+    if (workingCounter == 0) throw runtime_error("EtherCAT: datagram was not processed.");
+    
+    return value;
+}
+
+/**
+ * Transmits a frame on the fieldbus and receives the processed frame into the second
+ * buffer of that frame. If a valid frame was received, the attached datagrams are
+ * redirected to the received frame. If the frame couldn't be sent, the datagrams keep
+ * their data, like with a frame that wasn't received back.
+ * @param frame a reference to a frame with attached datagrams.
+ */
+void EtherCAT::transceive(Frame& frame) {
+    
     try {
-        sendDatagrams(datagrams);
+        transmitFrame(frame);
     } catch (exception& e) {
         cerr << e.what() << endl;
+        return;
     }
-    if (datagrams[0]->getWorkingCounter() == 0) throw runtime_error("EtherCAT: datagram was not processed.");
-    uint64_t value = (static_cast<uint64_t>(datagrams[0]->data[10]) & 0xFF) | ((static_cast<uint64_t>(datagrams[0]->data[11]) & 0xFF) << 8) | ((static_cast<uint64_t>(datagrams[0]->data[12]) & 0xFF) << 16) | ((static_cast<uint64_t>(datagrams[0]->data[13]) & 0xFF) << 24) | ((static_cast<uint64_t>(datagrams[0]->data[14]) & 0xFF) << 32) | ((static_cast<uint64_t>(datagrams[0]->data[15]) & 0xFF) << 40) | ((static_cast<uint64_t>(datagrams[0]->data[16]) & 0xFF) << 48) | ((static_cast<uint64_t>(datagrams[0]->data[17]) & 0xFF) << 56);
-    delete datagrams.back();
-    datagrams.pop_back();
     
-    return value;
+    receiveFrame(frame);
+}
+
+/**
+ * Reads an EtherCAT frame from the communication channel. Ethernet frames of other
+ * types are discarded. This method must be called with a locked receiver mutex.
+ * @param data a buffer to read the frame into.
+ * @param length the size of the buffer, given in [bytes].
+ * @return the number of bytes received, or 0 if no EtherCAT frame was received.
+ */
+uint16_t EtherCAT::receive(uint8_t data[], uint16_t length) {
+    
+    if (ethernet != NULL) {
+        
+        // use the Ethernet driver
+        
+        uint8_t sourceMACAddress[6];
+        uint16_t etherType = 0;
+        uint16_t receivedBytes = ethernet->receive(sourceMACAddress, etherType, data, length);
+        
+        return (etherType == Ethernet::ETHERTYPE_ETHER_CAT) ? receivedBytes : 0;
+        
+    } else {
+        
+        // use UDP datagrams
+        
+        try {
+            
+            ssize_t receivedBytes = receiveMulticastDatagram(data, length);
+            
+            return (receivedBytes > 0) ? static_cast<uint16_t>(receivedBytes) : 0;
+            
+        } catch (exception& e) {
+            
+            cerr << e.what() << endl;
+        }
+        
+        return 0;
+    }
+}
+
+/**
+ * Hands a received EtherCAT frame over to the frame in flight with the same index.
+ * The received frame is copied only if it was read into the buffer of another frame.
+ * This method must be called with a locked pipeline mutex.
+ * @param data the received frame.
+ * @param length the number of bytes received.
+ */
+void EtherCAT::dispatch(uint8_t data[], uint16_t length) {
+    
+    if (length < 4) return;
+    
+    Frame* frame = frames[data[3]];
+    
+    if ((frame == NULL) || (length < frame->length)) return;
+    
+    uint8_t* received = frame->buffers[frame->active^1];
+    if (received != data) memcpy((void*)received, (void*)data, frame->length);
+    
+    // redirect datagrams to the received frame
+    
+    frame->swap();
+    
+    if (--frame->responses == 0) {
+        frames[frame->index] = NULL;
+        frame->pending = false;
+    }
 }
 
 /**
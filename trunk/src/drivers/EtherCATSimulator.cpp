@@ -0,0 +1,1253 @@
+/*
+ * EtherCATSimulator.cpp
+ * Copyright (c) 2026, ZHAW
+ * All rights reserved.
+ *
+ *  Created on: 17.10.2026
+ *      Author: Marcel Honegger
+ */
+
+#include <cstring>
+#include <cmath>
+#include <ctime>
+#include "EtherCAT.h"
+#include "EtherCATSimulator.h"
+
+using namespace std;
+
+const double EtherCATSimulator::SlaveDevice::PI = 3.14159265358979323846;                // ratio of the circumference of a circle to its diameter
+const uint8_t EtherCATSimulator::MAC_ADDRESS[] = {0x02, 0x00, 0x00, 0x00, 0x88, 0xA4};    // locally administered ethernet address
+
+/**
+ * Creates a simulated slave device with a given identity. The slave device is in the state
+ * INIT, and its object dictionary contains the device type and the identity object. Slave
+ * devices with the product code of a predefined Beckhoff terminal also contain the objects
+ * and simulate the process data of that terminal.
+ * @param vendorID the vendor ID of this slave device.
+ * @param productCode the product code of this slave device.
+ */
+EtherCATSimulator::SlaveDevice::SlaveDevice(uint32_t vendorID, uint32_t productCode) {
+    
+    this->vendorID = vendorID;
+    this->productCode = productCode;
+    
+    memory = new uint8_t[MEMORY_SIZE];
+    memset(memory, 0, MEMORY_SIZE);
+    
+    mailboxFull = false;
+    counter = 0;
+    segmentKey = 0;
+    segmentOffset = 0;
+    completeAccess = false;
+    clockOffset = 0;
+    updateTime = 0;
+    positions[0] = 0.0;
+    positions[1] = 0.0;
+    
+    // initialize registers of the slave controller
+    
+    memory[EtherCAT::ESC_INFORMATION_TYPE] = 0x11;
+    memory[EtherCAT::ESC_INFORMATION_BUILD] = 0x02;
+    memory[EtherCAT::ESC_INFORMATION_FMMUS_SUPPORTED] = FMMUS;
+    memory[EtherCAT::ESC_INFORMATION_SYNC_MANAGERS_SUPPORTED] = SYNC_MANAGERS;
+    memory[EtherCAT::ESC_INFORMATION_RAM_SIZE] = 8;
+    memory[EtherCAT::ESC_INFORMATION_PORT_DESCRIPTOR] = 0x0F;
+    memory[EtherCAT::ESC_INFORMATION_FEATURES_SUPPORTED] = 0x0C;       // distributed clocks with 64 bit system time
+    memory[EtherCAT::DATA_LINK_LAYER_STATUS+1] = 0x02;                  // communication established on port 0
+    memory[EtherCAT::APPLICATION_LAYER_STATUS] = EtherCAT::STATE_INIT;
+    
+    // initialize the object dictionary
+    
+    writeObject(0x1000, 0x00, 0x00001389, 4);   // device type: modular device profile
+    writeObject(0x1018, 0x00, 4, 1);            // identity
+    writeObject(0x1018, 0x01, vendorID, 4);
+    writeObject(0x1018, 0x02, productCode, 4);
+    writeObject(0x1018, 0x03, 0x00100000, 4);
+    writeObject(0x1018, 0x04, 0, 4);
+    
+    if ((productCode == PRODUCT_CODE_EL3104) || (productCode == PRODUCT_CODE_EL5101) || (productCode == PRODUCT_CODE_EL7342)) {
+        
+        writeObject(0x1C32, 0x00, 2, 1);        // SM output parameter
+        writeObject(0x1C32, 0x01, 0, 2);
+        writeObject(0x1C32, 0x02, 0, 4);
+        writeObject(0x1C33, 0x00, 2, 1);        // SM input parameter
+        writeObject(0x1C33, 0x01, 0, 2);
+        writeObject(0x1C33, 0x02, 0, 4);
+    }
+}
+
+/**
+ * Deletes the simulated slave device.
+ */
+EtherCATSimulator::SlaveDevice::~SlaveDevice() {
+    
+    delete[] memory;
+}
+
+/**
+ * Gets the vendor ID of this slave device.
+ * @return the vendor ID of this slave device.
+ */
+uint32_t EtherCATSimulator::SlaveDevice::getVendorID() {
+    
+    return vendorID;
+}
+
+/**
+ * Gets the product code of this slave device.
+ * @return the product code of this slave device.
+ */
+uint32_t EtherCATSimulator::SlaveDevice::getProductCode() {
+    
+    return productCode;
+}
+
+/**
+ * Writes a value into the memory of this slave device, i.e. to change a register or an input value.
+ * @param address the address within the slave controller.
+ * @param value the value to write.
+ */
+void EtherCATSimulator::SlaveDevice::write8(uint16_t address, uint8_t value) {
+    
+    mutex.lock();
+    
+    memory[address] = value;
+    
+    mutex.unlock();
+}
+
+/**
+ * Reads a value from the memory of this slave device, i.e. a register or an output value.
+ * @param address the address within the slave controller.
+ * @return the value at the given address.
+ */
+uint8_t EtherCATSimulator::SlaveDevice::read8(uint16_t address) {
+    
+    mutex.lock();
+    
+    uint8_t value = memory[address];
+    
+    mutex.unlock();
+    
+    return value;
+}
+
+/**
+ * Writes a value into the memory of this slave device, i.e. to change a register or an input value.
+ * @param address the address within the slave controller.
+ * @param value the value to write.
+ */
+void EtherCATSimulator::SlaveDevice::write16(uint16_t address, uint16_t value) {
+    
+    mutex.lock();
+    
+    for (uint16_t i = 0; (i < 2) && (address+i < MEMORY_SIZE); i++) memory[address+i] = static_cast<uint8_t>((value >> (8*i)) & 0xFF);
+    
+    mutex.unlock();
+}
+
+/**
+ * Reads a value from the memory of this slave device, i.e. a register or an output value.
+ * @param address the address within the slave controller.
+ * @return the value at the given address.
+ */
+uint16_t EtherCATSimulator::SlaveDevice::read16(uint16_t address) {
+    
+    mutex.lock();
+    
+    uint16_t value = 0;
+    for (uint16_t i = 0; (i < 2) && (address+i < MEMORY_SIZE); i++) value |= static_cast<uint16_t>(memory[address+i]) << (8*i);
+    
+    mutex.unlock();
+    
+    return value;
+}
+
+/**
+ * Writes a value into the memory of this slave device, i.e. to change a register or an input value.
+ * @param address the address within the slave controller.
+ * @param value the value to write.
+ */
+void EtherCATSimulator::SlaveDevice::write32(uint16_t address, uint32_t value) {
+    
+    mutex.lock();
+    
+    for (uint16_t i = 0; (i < 4) && (address+i < MEMORY_SIZE); i++) memory[address+i] = static_cast<uint8_t>((value >> (8*i)) & 0xFF);
+    
+    mutex.unlock();
+}
+
+/**
+ * Reads a value from the memory of this slave device, i.e. a register or an output value.
+ * @param address the address within the slave controller.
+ * @return the value at the given address.
+ */
+uint32_t EtherCATSimulator::SlaveDevice::read32(uint16_t address) {
+    
+    mutex.lock();
+    
+    uint32_t value = 0;
+    for (uint16_t i = 0; (i < 4) && (address+i < MEMORY_SIZE); i++) value |= static_cast<uint32_t>(memory[address+i]) << (8*i);
+    
+    mutex.unlock();
+    
+    return value;
+}
+
+/**
+ * Writes a simple value into the object dictionary of this slave device.
+ * The object is created if it doesn't exist yet.
+ * @param index the index of the CANopen object (16 bit).
+ * @param subindex the subindex of the CANopen object (8 bit).
+ * @param value the value of the object (8 - 32 bit).
+ * @param length the number of bytes the value consists of, usually 1, 2 or 4.
+ */
+void EtherCATSimulator::SlaveDevice::writeObject(uint16_t index, uint8_t subindex, uint32_t value, uint16_t length) {
+    
+    vector<uint8_t> data;
+    for (uint16_t i = 0; (i < length) && (i < 4); i++) data.push_back(static_cast<uint8_t>((value >> (8*i)) & 0xFF));
+    
+    mutex.lock();
+    
+    objects[(static_cast<uint32_t>(index) << 8) | subindex] = data;
+    
+    mutex.unlock();
+}
+
+/**
+ * Reads a simple value from the object dictionary of this slave device.
+ * @param index the index of the CANopen object (16 bit).
+ * @param subindex the subindex of the CANopen object (8 bit).
+ * @return the value of the object, consisting of up to 4 bytes, or 0 if the object doesn't exist.
+ */
+uint32_t EtherCATSimulator::SlaveDevice::readObject(uint16_t index, uint8_t subindex) {
+    
+    uint32_t value = 0;
+    
+    mutex.lock();
+    
+    map<uint32_t, vector<uint8_t> >::iterator object = objects.find((static_cast<uint32_t>(index) << 8) | subindex);
+    if (object != objects.end()) {
+        for (uint16_t i = 0; (i < object->second.size()) && (i < 4); i++) value |= static_cast<uint32_t>(object->second[i]) << (8*i);
+    }
+    
+    mutex.unlock();
+    
+    return value;
+}
+
+/**
+ * Gets the start address of a SYNC manager, as it was configured by the master.
+ * @param number the number of the SYNC manager, i.e. 2 for outputs or 3 for inputs.
+ * @return the physical start address of the SYNC manager.
+ */
+uint16_t EtherCATSimulator::SlaveDevice::getSyncManagerAddress(uint8_t number) {
+    
+    uint16_t address = EtherCAT::SYNC_MANAGER+number*EtherCAT::SYNC_MANAGER_OFFSET;
+    
+    return static_cast<uint16_t>(memory[address]) | (static_cast<uint16_t>(memory[address+1]) << 8);
+}
+
+/**
+ * Gets the length of a SYNC manager, as it was configured by the master.
+ * @param number the number of the SYNC manager, i.e. 2 for outputs or 3 for inputs.
+ * @return the length of the SYNC manager, given in [bytes].
+ */
+uint16_t EtherCATSimulator::SlaveDevice::getSyncManagerLength(uint8_t number) {
+    
+    uint16_t address = EtherCAT::SYNC_MANAGER_LENGTH+number*EtherCAT::SYNC_MANAGER_OFFSET;
+    
+    return static_cast<uint16_t>(memory[address]) | (static_cast<uint16_t>(memory[address+1]) << 8);
+}
+
+/**
+ * This method is called by the simulator after each processed frame, with the memory of this
+ * slave device locked. It simulates the application of the slave device, which reads outputs
+ * from and writes inputs into the process data RAM, while the slave device is in the state
+ * SAFE OPERATIONAL or OPERATIONAL.
+ * <br/>
+ * This implementation simulates the predefined Beckhoff terminals: an EL3104 produces sine
+ * waves with frequencies of 1 to 4 Hz, an EL5101 counts 1000 encoder pulses per second, and
+ * an EL7342 integrates the velocity values of enabled motors, with 1 count per second and unit.
+ * @param time the time of the simulator, given in [ns].
+ */
+void EtherCATSimulator::SlaveDevice::update(uint64_t time) {
+    
+    uint8_t state = memory[EtherCAT::APPLICATION_LAYER_STATUS] & EtherCAT::STATE_MASK;
+    
+    if ((state != EtherCAT::STATE_SAFE_OPERATIONAL) && (state != EtherCAT::STATE_OPERATIONAL)) {
+        updateTime = time;
+        return;
+    }
+    
+    double period = static_cast<double>(time-updateTime)/1.0e9;
+    updateTime = time;
+    
+    uint8_t* outputs = &memory[getSyncManagerAddress(2)];
+    uint8_t* inputs = &memory[getSyncManagerAddress(3)];
+    
+    if ((productCode == PRODUCT_CODE_EL3104) && (getSyncManagerLength(3) >= 16)) {
+        
+        for (uint16_t i = 0; i < 4; i++) {
+            int16_t value = static_cast<int16_t>(16000.0*sin(2.0*PI*static_cast<double>(i+1)*static_cast<double>(time)/1.0e9));
+            inputs[4*i+0] = 0x00;
+            inputs[4*i+1] = 0x00;
+            inputs[4*i+2] = static_cast<uint8_t>(value & 0xFF);
+            inputs[4*i+3] = static_cast<uint8_t>((value >> 8) & 0xFF);
+        }
+        
+    } else if ((productCode == PRODUCT_CODE_EL5101) && (getSyncManagerLength(3) >= 5)) {
+        
+        uint16_t value = static_cast<uint16_t>((time/1000000) & 0xFFFF);
+        inputs[0] = 0x00;
+        inputs[1] = static_cast<uint8_t>(value & 0xFF);
+        inputs[2] = static_cast<uint8_t>((value >> 8) & 0xFF);
+        
+    } else if ((productCode == PRODUCT_CODE_EL7342) && (getSyncManagerLength(2) >= 16) && (getSyncManagerLength(3) >= 16)) {
+        
+        for (uint16_t i = 0; i < 2; i++) {
+            
+            uint16_t control = static_cast<uint16_t>(outputs[8+4*i]) | (static_cast<uint16_t>(outputs[9+4*i]) << 8);
+            int16_t velocity = static_cast<int16_t>(static_cast<uint16_t>(outputs[10+4*i]) | (static_cast<uint16_t>(outputs[11+4*i]) << 8));
+            
+            if ((control & 0x0001) > 0) positions[i] += static_cast<double>(velocity)*period;
+            
+            uint16_t value = static_cast<uint16_t>(static_cast<int64_t>(floor(positions[i])) & 0xFFFF);
+            inputs[2+6*i] = static_cast<uint8_t>(value & 0xFF);
+            inputs[3+6*i] = static_cast<uint8_t>((value >> 8) & 0xFF);
+            inputs[12+2*i] = static_cast<uint8_t>(control & 0x01);   // ready to enable, or ready
+            inputs[13+2*i] = 0x00;
+        }
+    }
+}
+
+/**
+ * Gets the local time of this slave device.
+ * @param time the time of the simulator, given in [ns].
+ * @return the local time of the slave device, given in [ns].
+ */
+uint64_t EtherCATSimulator::SlaveDevice::getLocalTime(uint64_t time) {
+    
+    return time+static_cast<uint64_t>(clockOffset);
+}
+
+/**
+ * Reads data from the memory of this slave device, as it is done with a datagram of a read command.
+ * The system time is updated before it is read, and mailboxes only return data when they are full.
+ * @param address the address within the slave controller.
+ * @param data a buffer to copy the data into.
+ * @param length the number of bytes to read.
+ * @param time the time the datagram passes this slave device, given in [ns].
+ * @return <code>true</code> if the data was read, <code>false</code> otherwise.
+ */
+bool EtherCATSimulator::SlaveDevice::read(uint16_t address, uint8_t data[], uint16_t length, uint64_t time) {
+    
+    if (static_cast<uint32_t>(address)+length > MEMORY_SIZE) return false;
+    
+    // update the system time register
+    
+    if ((address < EtherCAT::DC_SYSTEM_TIME+8) && (address+length > EtherCAT::DC_SYSTEM_TIME)) {
+        
+        uint64_t offset = 0;
+        for (uint16_t i = 0; i < 8; i++) offset |= static_cast<uint64_t>(memory[EtherCAT::DC_SYSTEM_TIME_OFFSET+i]) << (8*i);
+        
+        uint64_t systemTime = getLocalTime(time)+offset;
+        for (uint16_t i = 0; i < 8; i++) memory[EtherCAT::DC_SYSTEM_TIME+i] = static_cast<uint8_t>((systemTime >> (8*i)) & 0xFF);
+    }
+    
+    // read a mailbox only if it contains a response
+    
+    int16_t number = getMailbox(address, length, false);
+    
+    if (number >= 0) {
+        
+        if (!mailboxFull) return false;
+        
+        memcpy(data, &memory[address], length);
+        
+        uint16_t end = getSyncManagerAddress(number)+getSyncManagerLength(number);
+        
+        if (address+length >= end) {
+            
+            mailboxFull = false;
+            memory[EtherCAT::SYNC_MANAGER+number*EtherCAT::SYNC_MANAGER_OFFSET+5] &= ~0x08;
+            
+            if (responses.size() > 0) {
+                vector<uint8_t> message = responses.front();
+                responses.pop_front();
+                post(message);
+            }
+        }
+        
+        return true;
+    }
+    
+    memcpy(data, &memory[address], length);
+    
+    return true;
+}
+
+/**
+ * Writes data into the memory of this slave device, as it is done with a datagram of a write command.
+ * Read-only registers are not changed, and writing specific registers triggers their functions,
+ * i.e. writing the application layer control register changes the state of the slave device.
+ * @param address the address within the slave controller.
+ * @param data a buffer with the data to write.
+ * @param length the number of bytes to write.
+ * @param time the time the datagram passes this slave device, given in [ns].
+ * @param receiveTimes the times the frame is received at the 4 ports of this slave device, given in [ns].
+ * @return <code>true</code> if the data was written, <code>false</code> otherwise.
+ */
+bool EtherCATSimulator::SlaveDevice::write(uint16_t address, uint8_t data[], uint16_t length, uint64_t time, uint64_t receiveTimes[4]) {
+    
+    if (static_cast<uint32_t>(address)+length > MEMORY_SIZE) return false;
+    
+    for (uint16_t i = 0; i < length; i++) {
+        
+        uint16_t a = address+i;
+        
+        if (a < EtherCAT::STATION_ADDRESS) continue;
+        if ((a >= EtherCAT::DATA_LINK_LAYER_STATUS) && (a < EtherCAT::DATA_LINK_LAYER_STATUS+2)) continue;
+        if ((a >= EtherCAT::APPLICATION_LAYER_STATUS) && (a < EtherCAT::APPLICATION_LAYER_STATUS+6)) continue;
+        if ((a >= EtherCAT::DC_RECEIVE_TIME_PORT_0) && (a < EtherCAT::DC_SYSTEM_TIME_OFFSET)) continue;
+        if ((a >= EtherCAT::DC_SYSTEM_TIME_DIFFERENCE) && (a < EtherCAT::DC_SYSTEM_TIME_DIFFERENCE+4)) continue;
+        
+        memory[a] = data[i];
+    }
+    
+    // change the state of the application layer
+    
+    if ((address <= EtherCAT::APPLICATION_LAYER_CONTROL) && (address+length > EtherCAT::APPLICATION_LAYER_CONTROL)) {
+        
+        uint8_t control = memory[EtherCAT::APPLICATION_LAYER_CONTROL];
+        uint8_t state = control & EtherCAT::STATE_MASK;
+        uint8_t status = memory[EtherCAT::APPLICATION_LAYER_STATUS];
+        
+        if ((control & EtherCAT::STATE_ERROR_MASK) > 0) status &= ~EtherCAT::STATE_ERROR;
+        
+        if ((state == EtherCAT::STATE_INIT) || (state == EtherCAT::STATE_PRE_OPERATIONAL) || (state == EtherCAT::STATE_BOOTSTRAP) || (state == EtherCAT::STATE_SAFE_OPERATIONAL) || (state == EtherCAT::STATE_OPERATIONAL)) {
+            memory[EtherCAT::APPLICATION_LAYER_STATUS] = (status & ~EtherCAT::STATE_MASK) | state;
+            memory[EtherCAT::APPLICATION_LAYER_STATUS_CODE] = 0x00;
+        } else {
+            memory[EtherCAT::APPLICATION_LAYER_STATUS] = status | EtherCAT::STATE_ERROR;
+            memory[EtherCAT::APPLICATION_LAYER_STATUS_CODE] = 0x11;     // invalid requested state change
+        }
+    }
+    
+    // latch the receive times of all ports
+    
+    if ((address < EtherCAT::DC_RECEIVE_TIME_PORT_0+4) && (address+length > EtherCAT::DC_RECEIVE_TIME_PORT_0)) {
+        
+        for (uint16_t i = 0; i < 4; i++) {
+            uint32_t receiveTime = (receiveTimes[i] > 0) ? static_cast<uint32_t>(getLocalTime(receiveTimes[i]) & 0xFFFFFFFF) : 0;
+            for (uint16_t j = 0; j < 4; j++) memory[EtherCAT::DC_RECEIVE_TIME_PORT_0+4*i+j] = static_cast<uint8_t>((receiveTime >> (8*j)) & 0xFF);
+        }
+        
+        uint64_t localTime = getLocalTime(receiveTimes[0]);
+        for (uint16_t i = 0; i < 8; i++) memory[EtherCAT::DC_RECEIVE_TIME_ECAT_PROCESSING_UNIT+i] = static_cast<uint8_t>((localTime >> (8*i)) & 0xFF);
+    }
+    
+    // compare a received system time with the own system time
+    
+    if ((address <= EtherCAT::DC_SYSTEM_TIME) && (address+length > EtherCAT::DC_SYSTEM_TIME)) {
+        
+        uint64_t receivedTime = 0;
+        for (uint16_t i = 0; (i < 8) && (EtherCAT::DC_SYSTEM_TIME+i < address+length); i++) receivedTime |= static_cast<uint64_t>(data[EtherCAT::DC_SYSTEM_TIME+i-address]) << (8*i);
+        
+        uint64_t offset = 0;
+        for (uint16_t i = 0; i < 8; i++) offset |= static_cast<uint64_t>(memory[EtherCAT::DC_SYSTEM_TIME_OFFSET+i]) << (8*i);
+        
+        uint32_t delay = 0;
+        for (uint16_t i = 0; i < 4; i++) delay |= static_cast<uint32_t>(memory[EtherCAT::DC_SYSTEM_TIME_DELAY+i]) << (8*i);
+        
+        int32_t difference = static_cast<int32_t>(static_cast<uint32_t>((getLocalTime(time)+offset-receivedTime-delay) & 0xFFFFFFFF));
+        uint32_t value = (difference < 0) ? (static_cast<uint32_t>(-difference) | 0x80000000) : static_cast<uint32_t>(difference);
+        
+        for (uint16_t i = 0; i < 4; i++) memory[EtherCAT::DC_SYSTEM_TIME_DIFFERENCE+i] = static_cast<uint8_t>((value >> (8*i)) & 0xFF);
+    }
+    
+    // process a request that was written into a mailbox
+    
+    int16_t number = getMailbox(address, length, true);
+    
+    if ((number >= 0) && (address+length >= getSyncManagerAddress(number)+getSyncManagerLength(number))) processMailbox();
+    
+    return true;
+}
+
+/**
+ * Reads data from the process data RAM of this slave device with logical addressing.
+ * @param address the logical address.
+ * @param data a buffer to copy the data into.
+ * @param length the number of bytes to read.
+ * @return <code>true</code> if any data was mapped by a FMMU and read, <code>false</code> otherwise.
+ */
+bool EtherCATSimulator::SlaveDevice::readLogical(uint32_t address, uint8_t data[], uint16_t length) {
+    
+    bool mapped = false;
+    
+    for (uint16_t i = 0; i < FMMUS; i++) {
+        
+        uint8_t* fmmu = &memory[EtherCAT::FMMU+i*EtherCAT::FMMU_OFFSET];
+        
+        if (((fmmu[12] & 0x01) == 0) || ((fmmu[11] & EtherCAT::FMMU_TYPE_READ) == 0)) continue;
+        
+        uint32_t logicalAddress = static_cast<uint32_t>(fmmu[0]) | (static_cast<uint32_t>(fmmu[1]) << 8) | (static_cast<uint32_t>(fmmu[2]) << 16) | (static_cast<uint32_t>(fmmu[3]) << 24);
+        uint16_t size = static_cast<uint16_t>(fmmu[4]) | (static_cast<uint16_t>(fmmu[5]) << 8);
+        uint16_t physicalAddress = static_cast<uint16_t>(fmmu[8]) | (static_cast<uint16_t>(fmmu[9]) << 8);
+        
+        for (uint16_t j = 0; j < size; j++) {
+            if ((logicalAddress+j < address) || (logicalAddress+j >= address+length) || (physicalAddress+j >= MEMORY_SIZE)) continue;
+            data[logicalAddress+j-address] = memory[physicalAddress+j];
+            mapped = true;
+        }
+    }
+    
+    return mapped;
+}
+
+/**
+ * Writes data into the process data RAM of this slave device with logical addressing.
+ * @param address the logical address.
+ * @param data a buffer with the data to write.
+ * @param length the number of bytes to write.
+ * @return <code>true</code> if any data was mapped by a FMMU and written, <code>false</code> otherwise.
+ */
+bool EtherCATSimulator::SlaveDevice::writeLogical(uint32_t address, uint8_t data[], uint16_t length) {
+    
+    bool mapped = false;
+    
+    for (uint16_t i = 0; i < FMMUS; i++) {
+        
+        uint8_t* fmmu = &memory[EtherCAT::FMMU+i*EtherCAT::FMMU_OFFSET];
+        
+        if (((fmmu[12] & 0x01) == 0) || ((fmmu[11] & EtherCAT::FMMU_TYPE_WRITE) == 0)) continue;
+        
+        uint32_t logicalAddress = static_cast<uint32_t>(fmmu[0]) | (static_cast<uint32_t>(fmmu[1]) << 8) | (static_cast<uint32_t>(fmmu[2]) << 16) | (static_cast<uint32_t>(fmmu[3]) << 24);
+        uint16_t size = static_cast<uint16_t>(fmmu[4]) | (static_cast<uint16_t>(fmmu[5]) << 8);
+        uint16_t physicalAddress = static_cast<uint16_t>(fmmu[8]) | (static_cast<uint16_t>(fmmu[9]) << 8);
+        
+        for (uint16_t j = 0; j < size; j++) {
+            if ((logicalAddress+j < address) || (logicalAddress+j >= address+length) || (physicalAddress+j >= MEMORY_SIZE)) continue;
+            memory[physicalAddress+j] = data[logicalAddress+j-address];
+            mapped = true;
+        }
+    }
+    
+    return mapped;
+}
+
+/**
+ * Gets the SYNC manager of a mailbox that is accessed with a given address range.
+ * @param address the address within the slave controller.
+ * @param length the number of bytes accessed.
+ * @param out <code>true</code> for the mailbox written by the master, <code>false</code> for the mailbox read by the master.
+ * @return the number of the SYNC manager, or -1 if no mailbox is accessed.
+ */
+int16_t EtherCATSimulator::SlaveDevice::getMailbox(uint16_t address, uint16_t length, bool out) {
+    
+    for (uint16_t i = 0; i < SYNC_MANAGERS; i++) {
+        
+        uint8_t* syncManager = &memory[EtherCAT::SYNC_MANAGER+i*EtherCAT::SYNC_MANAGER_OFFSET];
+        
+        if (((syncManager[6] & 0x01) == 0) || ((syncManager[4] & 0x03) != 0x02)) continue;
+        if (((syncManager[4] & 0x0C) == 0x04) != out) continue;
+        
+        uint16_t start = getSyncManagerAddress(i);
+        uint16_t size = getSyncManagerLength(i);
+        
+        if ((address < start+size) && (address+length > start)) return i;
+    }
+    
+    return -1;
+}
+
+/**
+ * Processes a request in the mailbox written by the master. This method implements a CoE
+ * server for service data objects, which responds to SDO requests.
+ */
+void EtherCATSimulator::SlaveDevice::processMailbox() {
+    
+    int16_t number = -1;
+    for (uint16_t i = 0; (i < SYNC_MANAGERS) && (number < 0); i++) {
+        uint8_t* syncManager = &memory[EtherCAT::SYNC_MANAGER+i*EtherCAT::SYNC_MANAGER_OFFSET];
+        if (((syncManager[6] & 0x01) > 0) && ((syncManager[4] & 0x0F) == 0x06)) number = i;
+    }
+    if (number < 0) return;
+    
+    uint8_t* request = &memory[getSyncManagerAddress(number)];
+    uint16_t length = static_cast<uint16_t>(request[0]) | (static_cast<uint16_t>(request[1]) << 8);
+    uint8_t type = request[5] & 0x0F;
+    
+    if (type != EtherCAT::MAILBOX_TYPE_COE) {
+        
+        // mailbox error: unsupported protocol
+        
+        uint8_t response[] = {0x01, 0x00, 0x02, 0x00};
+        
+        vector<uint8_t> message(6+sizeof(response), 0);
+        message[0] = sizeof(response);
+        message[5] = EtherCAT::MAILBOX_TYPE_MAILBOX_ERROR;
+        memcpy(&message[6], response, sizeof(response));
+        
+        post(message);
+        
+        return;
+    }
+    
+    if ((length < 10) || (((request[7] >> 4) & 0x0F) != 0x02)) return;     // only SDO requests are processed
+    
+    uint8_t* sdo = &request[8];
+    uint8_t command = sdo[0];
+    uint16_t index = static_cast<uint16_t>(sdo[1]) | (static_cast<uint16_t>(sdo[2]) << 8);
+    uint8_t subindex = sdo[3];
+    
+    if ((command & 0xE0) == 0x20) {
+        
+        // initiate download, either expedited or normal
+        
+        uint32_t abortCode = 0;
+        
+        if ((command & 0x02) > 0) {
+            
+            uint16_t n = ((command & 0x01) > 0) ? 4-((command >> 2) & 0x03) : 4;
+            vector<uint8_t> value(&sdo[4], &sdo[4+n]);
+            abortCode = setObject(index, subindex, (command & 0x10) > 0, value);
+            
+        } else {
+            
+            uint32_t size = static_cast<uint32_t>(sdo[4]) | (static_cast<uint32_t>(sdo[5]) << 8) | (static_cast<uint32_t>(sdo[6]) << 16) | (static_cast<uint32_t>(sdo[7]) << 24);
+            uint32_t n = length-10;
+            if (n > size) n = size;
+            
+            segments.assign(&sdo[8], &sdo[8+n]);
+            segmentKey = (static_cast<uint32_t>(index) << 8) | subindex;
+            segmentOffset = size;
+            completeAccess = (command & 0x10) > 0;
+            
+            if (n >= size) {
+                abortCode = setObject(index, subindex, completeAccess, segments);
+                segments.clear();
+            }
+        }
+        
+        if (abortCode != 0) {
+            abort(index, subindex, abortCode);
+        } else {
+            uint8_t response[] = {0x60, sdo[1], sdo[2], sdo[3], 0x00, 0x00, 0x00, 0x00};
+            respond(response, sizeof(response));
+        }
+        
+    } else if ((command & 0xE0) == 0x00) {
+        
+        // download segment
+        
+        uint32_t n = (length > 10) ? length-3 : 7-((command >> 1) & 0x07);
+        segments.insert(segments.end(), &sdo[1], &sdo[1+n]);
+        
+        uint32_t abortCode = 0;
+        
+        if (((command & 0x01) > 0) || (segments.size() >= segmentOffset)) {
+            abortCode = setObject(static_cast<uint16_t>(segmentKey >> 8), static_cast<uint8_t>(segmentKey & 0xFF), completeAccess, segments);
+            segments.clear();
+        }
+        
+        if (abortCode != 0) {
+            abort(static_cast<uint16_t>(segmentKey >> 8), static_cast<uint8_t>(segmentKey & 0xFF), abortCode);
+        } else {
+            uint8_t response[] = {static_cast<uint8_t>(0x20 | (command & 0x10)), 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+            respond(response, sizeof(response));
+        }
+        
+    } else if ((command & 0xE0) == 0x40) {
+        
+        // initiate upload
+        
+        upload(index, subindex, (command & 0x10) > 0);
+        
+    } else if ((command & 0xE0) == 0x60) {
+        
+        // upload segment
+        
+        int16_t in = -1;
+        for (uint16_t i = 0; (i < SYNC_MANAGERS) && (in < 0); i++) {
+            uint8_t* syncManager = &memory[EtherCAT::SYNC_MANAGER+i*EtherCAT::SYNC_MANAGER_OFFSET];
+            if (((syncManager[6] & 0x01) > 0) && ((syncManager[4] & 0x0F) == 0x02)) in = i;
+        }
+        if (in < 0) return;
+        
+        uint32_t n = segments.size()-segmentOffset;
+        if (n > static_cast<uint32_t>(getSyncManagerLength(in)-6-3)) n = getSyncManagerLength(in)-6-3;
+        
+        bool last = (segmentOffset+n >= segments.size());
+        
+        vector<uint8_t> response((n < 7) ? 8 : 1+n, 0);
+        response[0] = static_cast<uint8_t>((command & 0x10) | ((n < 7) ? ((7-n) << 1) : 0) | (last ? 0x01 : 0x00));
+        if (n > 0) memcpy(&response[1], &segments[segmentOffset], n);
+        segmentOffset += n;
+        
+        respond(&response[0], response.size());
+        
+    } else if (command == 0x80) {
+        
+        // abort transfer
+        
+        segments.clear();
+        
+    } else {
+        
+        abort(index, subindex, 0x05040001);     // command specifier not valid
+    }
+}
+
+/**
+ * Sends an SDO response with the mailbox read by the master.
+ * @param data the SDO response, without mailbox and CoE headers.
+ * @param length the length of the SDO response, given in [bytes].
+ */
+void EtherCATSimulator::SlaveDevice::respond(uint8_t data[], uint16_t length) {
+    
+    counter = (counter % 7)+1;
+    
+    vector<uint8_t> message(6+2+length, 0);
+    message[0] = static_cast<uint8_t>((2+length) & 0xFF);
+    message[1] = static_cast<uint8_t>(((2+length) >> 8) & 0xFF);
+    message[5] = static_cast<uint8_t>((counter << 4) | EtherCAT::MAILBOX_TYPE_COE);
+    message[7] = 0x30;      // SDO response
+    memcpy(&message[8], data, length);
+    
+    post(message);
+}
+
+/**
+ * Writes a message into the mailbox read by the master, or queues the message
+ * if that mailbox still contains a message that wasn't read yet.
+ * @param message the message, including the mailbox header.
+ */
+void EtherCATSimulator::SlaveDevice::post(vector<uint8_t>& message) {
+    
+    if (mailboxFull) {
+        responses.push_back(message);
+        return;
+    }
+    
+    for (uint16_t i = 0; i < SYNC_MANAGERS; i++) {
+        
+        uint8_t* syncManager = &memory[EtherCAT::SYNC_MANAGER+i*EtherCAT::SYNC_MANAGER_OFFSET];
+        
+        if (((syncManager[6] & 0x01) > 0) && ((syncManager[4] & 0x0F) == 0x02)) {
+            
+            uint16_t size = getSyncManagerLength(i);
+            if (message.size() > size) return;
+            
+            memset(&memory[getSyncManagerAddress(i)], 0, size);
+            memcpy(&memory[getSyncManagerAddress(i)], &message[0], message.size());
+            syncManager[5] |= 0x08;     // mailbox full
+            
+            mailboxFull = true;
+            
+            return;
+        }
+    }
+}
+
+/**
+ * Responds to an SDO request with an abort transfer request.
+ * @param index the index of the CANopen object.
+ * @param subindex the subindex of the CANopen object.
+ * @param abortCode the CANopen abort code.
+ */
+void EtherCATSimulator::SlaveDevice::abort(uint16_t index, uint8_t subindex, uint32_t abortCode) {
+    
+    uint8_t response[8];
+    response[0] = 0x80;
+    response[1] = static_cast<uint8_t>(index & 0xFF);
+    response[2] = static_cast<uint8_t>((index >> 8) & 0xFF);
+    response[3] = subindex;
+    for (uint16_t i = 0; i < 4; i++) response[4+i] = static_cast<uint8_t>((abortCode >> (8*i)) & 0xFF);
+    
+    segments.clear();
+    
+    respond(response, sizeof(response));
+}
+
+/**
+ * Responds to an initiate upload request with the value of an object,
+ * either expedited or with the first part of a normal or segmented transfer.
+ * @param index the index of the CANopen object.
+ * @param subindex the subindex of the CANopen object.
+ * @param completeAccess a flag indicating an upload with complete access.
+ */
+void EtherCATSimulator::SlaveDevice::upload(uint16_t index, uint8_t subindex, bool completeAccess) {
+    
+    vector<uint8_t> value;
+    uint32_t abortCode = getObject(index, subindex, completeAccess, value);
+    
+    if (abortCode != 0) {
+        abort(index, subindex, abortCode);
+        return;
+    }
+    
+    if ((value.size() > 0) && (value.size() <= 4)) {
+        
+        uint8_t response[] = {static_cast<uint8_t>(0x43 | ((4-value.size()) << 2) | (completeAccess ? 0x10 : 0x00)), static_cast<uint8_t>(index & 0xFF), static_cast<uint8_t>((index >> 8) & 0xFF), subindex, 0x00, 0x00, 0x00, 0x00};
+        memcpy(&response[4], &value[0], value.size());
+        respond(response, sizeof(response));
+        
+    } else {
+        
+        int16_t in = -1;
+        for (uint16_t i = 0; (i < SYNC_MANAGERS) && (in < 0); i++) {
+            uint8_t* syncManager = &memory[EtherCAT::SYNC_MANAGER+i*EtherCAT::SYNC_MANAGER_OFFSET];
+            if (((syncManager[6] & 0x01) > 0) && ((syncManager[4] & 0x0F) == 0x02)) in = i;
+        }
+        if (in < 0) return;
+        
+        uint32_t n = value.size();
+        if (n > static_cast<uint32_t>(getSyncManagerLength(in)-6-10)) n = getSyncManagerLength(in)-6-10;
+        
+        vector<uint8_t> response(8+n, 0);
+        response[0] = 0x41 | (completeAccess ? 0x10 : 0x00);
+        response[1] = static_cast<uint8_t>(index & 0xFF);
+        response[2] = static_cast<uint8_t>((index >> 8) & 0xFF);
+        response[3] = subindex;
+        for (uint16_t i = 0; i < 4; i++) response[4+i] = static_cast<uint8_t>((value.size() >> (8*i)) & 0xFF);
+        if (n > 0) memcpy(&response[8], &value[0], n);
+        
+        segments = value;
+        segmentOffset = n;
+        
+        respond(&response[0], response.size());
+    }
+}
+
+/**
+ * Gets the value of an object from the object dictionary. With complete access, the values
+ * of all entries starting with the given subindex are concatenated, and the value of the
+ * subindex 0 is extended to 16 bit.
+ * @param index the index of the CANopen object.
+ * @param subindex the subindex of the CANopen object, or of the first entry with complete access.
+ * @param completeAccess a flag indicating an access to all entries of the object.
+ * @param value a reference to a buffer to copy the value into.
+ * @return 0 if the object exists, or a CANopen abort code otherwise.
+ */
+uint32_t EtherCATSimulator::SlaveDevice::getObject(uint16_t index, uint8_t subindex, bool completeAccess, vector<uint8_t>& value) {
+    
+    uint32_t key = static_cast<uint32_t>(index) << 8;
+    
+    map<uint32_t, vector<uint8_t> >::iterator object = objects.lower_bound(key);
+    if ((object == objects.end()) || ((object->first >> 8) != index)) return 0x06020000;   // object does not exist
+    
+    if (!completeAccess) {
+        
+        object = objects.find(key | subindex);
+        if (object == objects.end()) return 0x06090011;     // subindex does not exist
+        
+        value = object->second;
+        
+    } else {
+        
+        value.clear();
+        
+        for (object = objects.find(key | subindex); (object != objects.end()) && ((object->first >> 8) == index); object++) {
+            value.insert(value.end(), object->second.begin(), object->second.end());
+            if ((object->first & 0xFF) == 0) value.push_back(0x00);
+        }
+        
+        if (value.size() == 0) return 0x06090011;
+    }
+    
+    return 0;
+}
+
+/**
+ * Sets the value of an object in the object dictionary. Objects that don't exist are created.
+ * With complete access, the value is split into the entries of the object according to their
+ * sizes, and the remaining data is written into the next entry.
+ * @param index the index of the CANopen object.
+ * @param subindex the subindex of the CANopen object, or of the first entry with complete access.
+ * @param completeAccess a flag indicating an access to all entries of the object.
+ * @param value the value to write.
+ * @return 0 if the object was written, or a CANopen abort code otherwise.
+ */
+uint32_t EtherCATSimulator::SlaveDevice::setObject(uint16_t index, uint8_t subindex, bool completeAccess, vector<uint8_t>& value) {
+    
+    uint32_t key = static_cast<uint32_t>(index) << 8;
+    
+    if (!completeAccess) {
+        
+        objects[key | subindex] = value;
+        
+    } else {
+        
+        uint32_t offset = 0;
+        
+        for (uint16_t i = subindex; (i < 256) && (offset < value.size()); i++) {
+            
+            map<uint32_t, vector<uint8_t> >::iterator object = objects.find(key | i);
+            
+            uint32_t size = (object != objects.end()) ? object->second.size() : value.size()-offset;
+            if (i == 0) size = 1;
+            if (offset+size > value.size()) return 0x06070010;      // data type does not match
+            
+            objects[key | i] = vector<uint8_t>(value.begin()+offset, value.begin()+offset+size);
+            offset += (i == 0) ? 2 : size;
+        }
+    }
+    
+    return 0;
+}
+
+/**
+ * Creates a simulated EtherCAT segment without slave devices.
+ */
+EtherCATSimulator::EtherCATSimulator() {
+    
+    first = 0;
+    size = 0;
+    
+    resetCounters();
+}
+
+/**
+ * Deletes the simulated EtherCAT segment and the slave devices it created.
+ */
+EtherCATSimulator::~EtherCATSimulator() {
+    
+    for (uint16_t i = 0; i < ownSlaveDevices.size(); i++) delete ownSlaveDevices[i];
+}
+
+/**
+ * Adds a predefined slave device at the end of the simulated segment.
+ * @param productCode the product code of a predefined slave device, i.e. <code>PRODUCT_CODE_EL3104</code>.
+ * @return a pointer to the created slave device, which is owned by this simulator.
+ */
+EtherCATSimulator::SlaveDevice* EtherCATSimulator::addSlaveDevice(uint32_t productCode) {
+    
+    SlaveDevice* slaveDevice = new SlaveDevice(VENDOR_ID_BECKHOFF, productCode);
+    
+    ownSlaveDevices.push_back(slaveDevice);
+    addSlaveDevice(*slaveDevice);
+    
+    return slaveDevice;
+}
+
+/**
+ * Adds a slave device at the end of the simulated segment.
+ * @param slaveDevice a reference to a slave device, which must not be deleted before this simulator.
+ */
+void EtherCATSimulator::addSlaveDevice(SlaveDevice& slaveDevice) {
+    
+    mutex.lock();
+    
+    // every slave device has been powered up at a different time
+    
+    slaveDevice.clockOffset = 1000000000LL*static_cast<int64_t>(slaveDevices.size()+1)+123457LL*static_cast<int64_t>(slaveDevices.size());
+    
+    // close port 1 of the last slave device
+    
+    if (slaveDevices.size() > 0) slaveDevices.back()->memory[EtherCAT::DATA_LINK_LAYER_STATUS+1] |= 0x08;
+    slaveDevices.push_back(&slaveDevice);
+    
+    mutex.unlock();
+}
+
+/**
+ * Gets the number of slave devices on the simulated segment.
+ * @return the number of slave devices.
+ */
+uint16_t EtherCATSimulator::getNumberOfSlaveDevices() {
+    
+    return static_cast<uint16_t>(slaveDevices.size());
+}
+
+/**
+ * Gets a slave device of the simulated segment.
+ * @param position the position of the slave device, 0 being the first slave device.
+ * @return a pointer to the slave device, or <code>NULL</code> if there is no slave device at the given position.
+ */
+EtherCATSimulator::SlaveDevice* EtherCATSimulator::getSlaveDevice(uint16_t position) {
+    
+    return (position < slaveDevices.size()) ? slaveDevices[position] : NULL;
+}
+
+/**
+ * Gets the number of frames processed by the simulated segment since the last reset.
+ * @return the number of frames.
+ */
+uint32_t EtherCATSimulator::getNumberOfFrames() {
+    
+    return numberOfFrames;
+}
+
+/**
+ * Gets the number of datagrams processed by the simulated segment since the last reset.
+ * @return the number of datagrams.
+ */
+uint32_t EtherCATSimulator::getNumberOfDatagrams() {
+    
+    return numberOfDatagrams;
+}
+
+/**
+ * Gets the number of bytes of all frames processed by the simulated segment since the last reset.
+ * @return the number of bytes, excluding the Ethernet headers.
+ */
+uint64_t EtherCATSimulator::getNumberOfBytes() {
+    
+    return numberOfBytes;
+}
+
+/**
+ * Resets the counters of frames, datagrams and bytes.
+ */
+void EtherCATSimulator::resetCounters() {
+    
+    numberOfFrames = 0;
+    numberOfDatagrams = 0;
+    numberOfBytes = 0;
+}
+
+/**
+ * Returns if an ethernet link is present or not.
+ * @return <code>true</code>, because the simulated segment is always connected.
+ */
+bool EtherCATSimulator::link() {
+    
+    return true;
+}
+
+/**
+ * Gives the ethernet MAC address of this simulated interface.
+ * @param macAddress A 6 byte array to copy the ethernet MAC address into.
+ */
+void EtherCATSimulator::address(uint8_t macAddress[6]) {
+    
+    for (uint16_t i = 0; i < 6; i++) macAddress[i] = MAC_ADDRESS[i];
+}
+
+/**
+ * Sends an ethernet frame to the simulated segment. EtherCAT frames are processed by all
+ * slave devices immediately, and they are kept for the <code>receive()</code> method.
+ * Frames of other ether types are discarded.
+ * @param destinationMACAddress an array of 6 bytes representing the MAC address
+ * of the destination of this frame.
+ * @param etherType the ether type value of this frame, i.e. <code>ETHERTYPE_ETHER_CAT</code>.
+ * @param data a buffer with the payload of this frame.
+ * @param length the size of the given buffer pointed to by <code>data</code>, given in [bytes].
+ * @return the number of bytes actually sent, or 0 if too many frames are on the segment.
+ */
+uint16_t EtherCATSimulator::send(uint8_t destinationMACAddress[6], uint16_t etherType, uint8_t data[], uint16_t length) {
+    
+    if (etherType != ETHERTYPE_ETHER_CAT) return length;
+    if (length > FRAME_SIZE) length = FRAME_SIZE;
+    
+    mutex.lock();
+    
+    if (size >= FRAMES) {
+        mutex.unlock();
+        return 0;   // too many frames on the segment
+    }
+    
+    uint16_t last = (first+size)%FRAMES;
+    
+    memcpy(frames[last], data, length);
+    lengths[last] = length;
+    size++;
+    
+    process(frames[last], length);
+    
+    mutex.unlock();
+    
+    return length;
+}
+
+/**
+ * Receives an ethernet frame that was processed by the simulated segment.
+ * @param sourceMACAddress a buffer of 6 bytes to store the MAC address of the source of the frame.
+ * @param etherType the ether type value of the received frame.
+ * @param data a buffer to write the payload of the received frame into.
+ * @param length the size of the given buffer pointed to by <code>data</code>.
+ * @return the number of received bytes, or 0 if no frame was received.
+ */
+uint16_t EtherCATSimulator::receive(uint8_t sourceMACAddress[6], uint16_t& etherType, uint8_t data[], uint16_t length) {
+    
+    mutex.lock();
+    
+    if (size == 0) {
+        mutex.unlock();
+        return 0;
+    }
+    
+    if (length > lengths[first]) length = lengths[first];
+    
+    memcpy(data, frames[first], length);
+    first = (first+1)%FRAMES;
+    size--;
+    
+    mutex.unlock();
+    
+    for (uint16_t i = 0; i < 6; i++) sourceMACAddress[i] = MAC_ADDRESS[i];
+    sourceMACAddress[0] |= 0x02;    // the first slave device marks the frame as processed
+    etherType = ETHERTYPE_ETHER_CAT;
+    
+    return length;
+}
+
+/**
+ * Gets the time of the simulator, which is the monotonic time of the host.
+ * @return the time of the simulator, given in [ns].
+ */
+uint64_t EtherCATSimulator::getTime() {
+    
+    timespec currentTime;
+    clock_gettime(CLOCK_MONOTONIC, &currentTime);
+    
+    return static_cast<uint64_t>(currentTime.tv_sec)*1000000000ULL+static_cast<uint64_t>(currentTime.tv_nsec);
+}
+
+/**
+ * Processes an EtherCAT frame by all slave devices of the simulated segment, in place.
+ * Every slave device processes the datagrams of the frame one after the other, as a
+ * frame passes all slave devices in a line, and increments their working counters.
+ * @param data the EtherCAT frame, including the EtherCAT header.
+ * @param length the length of the frame, given in [bytes].
+ */
+void EtherCATSimulator::process(uint8_t data[], uint16_t length) {
+    
+    uint64_t time = getTime();
+    uint16_t numberOfSlaveDevices = static_cast<uint16_t>(slaveDevices.size());
+    
+    numberOfFrames++;
+    numberOfBytes += length;
+    
+    for (uint16_t i = 0; i < numberOfSlaveDevices; i++) slaveDevices[i]->mutex.lock();
+    
+    uint16_t offset = 2;
+    bool moreDatagrams = true;
+    
+    while (moreDatagrams && (offset+12 <= length)) {
+        
+        uint8_t* datagram = &data[offset];
+        uint8_t command = datagram[0];
+        uint16_t size = (static_cast<uint16_t>(datagram[6]) | (static_cast<uint16_t>(datagram[7]) << 8)) & 0x07FF;
+        moreDatagrams = (datagram[7] & 0x80) > 0;
+        
+        if (offset+10+size+2 > length) break;
+        
+        uint8_t* payload = &datagram[10];
+        uint16_t workingCounter = static_cast<uint16_t>(payload[size]) | (static_cast<uint16_t>(payload[size+1]) << 8);
+        
+        numberOfDatagrams++;
+        
+        for (uint16_t i = 0; i < numberOfSlaveDevices; i++) {
+            
+            SlaveDevice* slaveDevice = slaveDevices[i];
+            
+            uint16_t position = static_cast<uint16_t>(datagram[2]) | (static_cast<uint16_t>(datagram[3]) << 8);
+            uint16_t address = static_cast<uint16_t>(datagram[4]) | (static_cast<uint16_t>(datagram[5]) << 8);
+            uint32_t logicalAddress = static_cast<uint32_t>(position) | (static_cast<uint32_t>(address) << 16);
+            uint16_t stationAddress = static_cast<uint16_t>(slaveDevice->memory[EtherCAT::STATION_ADDRESS_CONFIGURED_ADDRESS]) | (static_cast<uint16_t>(slaveDevice->memory[EtherCAT::STATION_ADDRESS_CONFIGURED_ADDRESS+1]) << 8);
+            
+            uint64_t receiveTimes[4] = {time+i*PROPAGATION_DELAY, 0, 0, 0};
+            if (i+1 < numberOfSlaveDevices) receiveTimes[1] = time+(2*(numberOfSlaveDevices-1)-i)*PROPAGATION_DELAY;
+            
+            bool autoIncrement = (command == EtherCAT::COMMAND_APRD) || (command == EtherCAT::COMMAND_APWR) || (command == EtherCAT::COMMAND_APRW) || (command == EtherCAT::COMMAND_ARMW);
+            bool configured = (command == EtherCAT::COMMAND_FPRD) || (command == EtherCAT::COMMAND_FPWR) || (command == EtherCAT::COMMAND_FPRW) || (command == EtherCAT::COMMAND_FRMW);
+            bool addressed = (autoIncrement && (position == 0)) || (configured && (position == stationAddress));
+            
+            switch (command) {
+                
+                case EtherCAT::COMMAND_APRD:
+                case EtherCAT::COMMAND_FPRD:
+                    if (addressed && slaveDevice->read(address, payload, size, receiveTimes[0])) workingCounter++;
+                    break;
+                
+                case EtherCAT::COMMAND_APWR:
+                case EtherCAT::COMMAND_FPWR:
+                    if (addressed && slaveDevice->write(address, payload, size, receiveTimes[0], receiveTimes)) workingCounter++;
+                    break;
+                
+                case EtherCAT::COMMAND_APRW:
+                case EtherCAT::COMMAND_FPRW:
+                    if (addressed) {
+                        vector<uint8_t> buffer(payload, payload+size);
+                        if (slaveDevice->read(address, payload, size, receiveTimes[0])) workingCounter++;
+                        if (slaveDevice->write(address, &buffer[0], size, receiveTimes[0], receiveTimes)) workingCounter += 2;
+                    }
+                    break;
+                
+                case EtherCAT::COMMAND_ARMW:
+                case EtherCAT::COMMAND_FRMW:
+                    if (addressed) {
+                        if (slaveDevice->read(address, payload, size, receiveTimes[0])) workingCounter++;
+                    } else if (slaveDevice->write(address, payload, size, receiveTimes[0], receiveTimes)) {
+                        workingCounter++;
+                    }
+                    break;
+                
+                case EtherCAT::COMMAND_BRD:
+                    {
+                        vector<uint8_t> buffer(size, 0);
+                        if ((size > 0) && slaveDevice->read(address, &buffer[0], size, receiveTimes[0])) {
+                            for (uint16_t j = 0; j < size; j++) payload[j] |= buffer[j];
+                            workingCounter++;
+                        }
+                    }
+                    break;
+                
+                case EtherCAT::COMMAND_BWR:
+                    if (slaveDevice->write(address, payload, size, receiveTimes[0], receiveTimes)) workingCounter++;
+                    break;
+                
+                case EtherCAT::COMMAND_BRW:
+                    {
+                        vector<uint8_t> buffer(payload, payload+size);
+                        if (slaveDevice->write(address, &buffer[0], size, receiveTimes[0], receiveTimes)) workingCounter += 2;
+                        buffer.assign(size, 0);
+                        if ((size > 0) && slaveDevice->read(address, &buffer[0], size, receiveTimes[0])) {
+                            for (uint16_t j = 0; j < size; j++) payload[j] |= buffer[j];
+                            workingCounter++;
+                        }
+                    }
+                    break;
+                
+                case EtherCAT::COMMAND_LRD:
+                    if (slaveDevice->readLogical(logicalAddress, payload, size)) workingCounter++;
+                    break;
+                
+                case EtherCAT::COMMAND_LWR:
+                    if (slaveDevice->writeLogical(logicalAddress, payload, size)) workingCounter++;
+                    break;
+                
+                case EtherCAT::COMMAND_LRW:
+                    if (slaveDevice->writeLogical(logicalAddress, payload, size)) workingCounter += 2;
+                    if (slaveDevice->readLogical(logicalAddress, payload, size)) workingCounter++;
+                    break;
+                
+                default:
+                    break;
+            }
+            
+            // slave devices increment the address of auto increment and broadcast datagrams
+            
+            if (autoIncrement || (command == EtherCAT::COMMAND_BRD) || (command == EtherCAT::COMMAND_BWR) || (command == EtherCAT::COMMAND_BRW)) {
+                position++;
+                datagram[2] = static_cast<uint8_t>(position & 0xFF);
+                datagram[3] = static_cast<uint8_t>((position >> 8) & 0xFF);
+            }
+        }
+        
+        payload[size] = static_cast<uint8_t>(workingCounter & 0xFF);
+        payload[size+1] = static_cast<uint8_t>((workingCounter >> 8) & 0xFF);
+        
+        offset += 10+size+2;
+    }
+    
+    // simulate the applications of the slave devices
+    
+    for (uint16_t i = 0; i < numberOfSlaveDevices; i++) {
+        slaveDevices[i]->update(time);
+        slaveDevices[i]->mutex.unlock();
+    }
+}
@@ -19,94 +19,47 @@ const int32_t MaxonEPOS4::PRIORITY = RealtimeThread::RT_MAX_PRIORITY-12;    // p
  * @param nodeID the CANopen node ID of this device.
  * @param period the period of the handler thread of this driver, given in [s].
  */
-MaxonEPOS4::MaxonEPOS4(CANopen& canOpen, uint32_t nodeID, double period) : RealtimeThread("MaxonEPOS4", STACK_SIZE, PRIORITY, period), canOpen(canOpen) {
+MaxonEPOS4::MaxonEPOS4(CANopen& canOpen, uint32_t nodeID, double period) : canOpen(canOpen), rpdo1(CANopen::RPDO1), rpdo2(CANopen::RPDO2), rpdo3(CANopen::RPDO3), tpdo1(CANopen::TPDO1) {
     
-    // initialize local values
-    
-    this->nodeID = nodeID;
-    
-    enable = false;
-    newSetpoint = false;
-    modesOfOperation = CYCLIC_SYNCHRONOUS_TORQUE_MODE;
-    modesOfOperationDisplay = 0;
-    targetPosition = 0;
-    targetVelocity = 0;
-    targetTorque = 0;
-    statusword = 0x0000;
-    positionActualValue = 0;
-    
-    // register this device with the CANopen device driver
-    
-    canOpen.registerCANopenSlave(nodeID, this);
-    
-    // set slave into preoperational state
-    
-    canOpen.transmitNMTObject(CANopen::ENTER_PREOPERATIONAL_STATE, nodeID);
-    
-    // configure RPDO1
+    initialize(nodeID, period);
     
-    canOpen.writeSDO(nodeID, 0x1600, 0x00, 0x00, 1);        // disable RPDO1
-    canOpen.writeSDO(nodeID, 0x1600, 0x01, 0x60400010, 4);  // controlword, 2 bytes
-    canOpen.writeSDO(nodeID, 0x1600, 0x02, 0x60600008, 4);  // modes of operation, 1 byte
-    canOpen.writeSDO(nodeID, 0x1600, 0x03, 0x607A0020, 4);  // target position, 4 bytes
-    canOpen.writeSDO(nodeID, 0x1600, 0x00, 0x03, 1);        // enable RPDO1
-    
-    // reconfigure communication with RPDO1
-    
-    canOpen.writeSDO(nodeID, 0x1400, 0x01, CANopen::RPDO1+nodeID, 4);
-    
-    // configure RPDO2
-    
-    canOpen.writeSDO(nodeID, 0x1601, 0x00, 0x00, 1);        // disable RPDO2
-    canOpen.writeSDO(nodeID, 0x1601, 0x01, 0x60400010, 4);  // controlword, 2 bytes
-    canOpen.writeSDO(nodeID, 0x1601, 0x02, 0x60600008, 4);  // modes of operation, 1 byte
-    canOpen.writeSDO(nodeID, 0x1601, 0x03, 0x60FF0020, 4);  // target velocity, 4 bytes
-    canOpen.writeSDO(nodeID, 0x1601, 0x00, 0x03, 1);        // enable RPDO2
-    
-    // reconfigure communication with RPDO2
-    
-    canOpen.writeSDO(nodeID, 0x1401, 0x01, CANopen::RPDO2+nodeID, 4);
-    
-    // configure RPDO3
-    
-    canOpen.writeSDO(nodeID, 0x1602, 0x00, 0x00, 1);        // disable RPDO3
-    canOpen.writeSDO(nodeID, 0x1602, 0x01, 0x60400010, 4);  // controlword, 2 bytes
-    canOpen.writeSDO(nodeID, 0x1602, 0x02, 0x60600008, 4);  // modes of operation, 1 byte
-    canOpen.writeSDO(nodeID, 0x1602, 0x03, 0x60710010, 4);  // target torque, 2 bytes
-    canOpen.writeSDO(nodeID, 0x1602, 0x00, 0x03, 1);        // enable RPDO3
-    
-    // reconfigure communication with RPDO3
+    // start handler
     
-    canOpen.writeSDO(nodeID, 0x1402, 0x01, CANopen::RPDO3+nodeID, 4);
+    handler = new Handler(this, period);
+    handler->start();
+}
 
-    // configure TPDO1
-    
-    canOpen.writeSDO(nodeID, 0x1A00, 0x00, 0x00, 1);        // disable TPDO1
-    canOpen.writeSDO(nodeID, 0x1A00, 0x01, 0x60410010, 4);  // statusword, 2 bytes
-    canOpen.writeSDO(nodeID, 0x1A00, 0x02, 0x60610008, 4);  // modes of operation display, 1 byte
-    canOpen.writeSDO(nodeID, 0x1A00, 0x03, 0x60640020, 4);  // position actual value, 4 bytes
-    canOpen.writeSDO(nodeID, 0x1A00, 0x00, 0x03, 1);        // enable TPDO1
-    
-    // reconfigure communication with TPDO1
-    
-    canOpen.writeSDO(nodeID, 0x1800, 0x01, 0x80000000, 4);
-    canOpen.writeSDO(nodeID, 0x1800, 0x02, 253, 1);
-    canOpen.writeSDO(nodeID, 0x1800, 0x03, static_cast<uint16_t>(period*10000/2), 2);
-    canOpen.writeSDO(nodeID, 0x1800, 0x01, CANopen::TPDO1+nodeID, 4);
-    
-    // read inital object values
-    
-    targetPosition = static_cast<int32_t>(canOpen.readSDO(nodeID, 0x607A, 0x00));
-    targetVelocity = static_cast<int32_t>(canOpen.readSDO(nodeID, 0x60FF, 0x00));
-    targetTorque = static_cast<int16_t>(canOpen.readSDO(nodeID, 0x6071, 0x00));
+/**
+ * Create a MaxonEPOS4 device driver object and initialize the device and local values.
+ * This device driver doesn't use its own handler thread, but transmits its process data
+ * objects when the SYNC producer of the given CANopen stack asks for them, and the device
+ * transmits its actual values after every SYNC object. The SYNC producer must be enabled
+ * with the <code>setSYNCPeriod()</code> method of the CANopen stack.
+ * @param canOpen a reference to a CANopen stack this device driver depends on.
+ * @param nodeID the CANopen node ID of this device.
+ */
+MaxonEPOS4::MaxonEPOS4(CANopen& canOpen, uint32_t nodeID) : canOpen(canOpen), rpdo1(CANopen::RPDO1), rpdo2(CANopen::RPDO2), rpdo3(CANopen::RPDO3), tpdo1(CANopen::TPDO1) {
     
-    // set device into operational state
+    initialize(nodeID, 0.0);
+}
+
+/**
+ * Create a MaxonEPOS4 device driver object and initialize the device and local values.
+ * This device driver doesn't use its own handler thread, but it is executed periodically
+ * by the given cyclic executor.
+ * @param canOpen a reference to a CANopen stack this device driver depends on.
+ * @param cyclicExecutor a reference to a cyclic executor that executes this device driver.
+ * @param nodeID the CANopen node ID of this device.
+ * @param period the period of this driver, given in [s]. This must be a multiple of the period of the cyclic executor.
+ */
+MaxonEPOS4::MaxonEPOS4(CANopen& canOpen, CyclicExecutor& cyclicExecutor, uint32_t nodeID, double period) : canOpen(canOpen), rpdo1(CANopen::RPDO1), rpdo2(CANopen::RPDO2), rpdo3(CANopen::RPDO3), tpdo1(CANopen::TPDO1) {
     
-    canOpen.transmitNMTObject(CANopen::START_REMOTE_NODE, nodeID);
+    initialize(nodeID, period);
     
-    // start handler
+    // register this device driver with the cyclic executor
     
-    start();
+    this->cyclicExecutor = &cyclicExecutor;
+    this->cyclicExecutor->addTask(*this, period);
 }
 
 /**
@@ -116,7 +69,16 @@ MaxonEPOS4::~MaxonEPOS4() {
     
     // stop handler
     
-    stop();
+    if (cyclicExecutor != NULL) cyclicExecutor->removeTask(*this);
+    
+    if (handler != NULL) {
+        handler->stop();
+        delete handler;
+    }
+    
+    // unregister this device from the CANopen device driver
+    
+    canOpen.registerCANopenSlave(nodeID, NULL);
 }
 
 /**
@@ -261,6 +223,88 @@ int32_t MaxonEPOS4::readPosition() {
     return readPositionActualValue();
 }
 
+/**
+ * Initializes local values and configures the process data objects of the device.
+ * @param nodeID the CANopen node ID of this device.
+ * @param period the period of the handler thread of this driver, given in [s], or 0
+ * if the process data objects are transmitted synchronously with the SYNC producer.
+ */
+void MaxonEPOS4::initialize(uint32_t nodeID, double period) {
+    
+    // initialize local values
+    
+    this->nodeID = nodeID;
+    this->handler = NULL;
+    this->cyclicExecutor = NULL;
+    
+    synchronous = (period <= 0.0);
+    enable = false;
+    newSetpoint = false;
+    modesOfOperation = CYCLIC_SYNCHRONOUS_TORQUE_MODE;
+    modesOfOperationDisplay = 0;
+    targetPosition = 0;
+    targetVelocity = 0;
+    targetTorque = 0;
+    statusword = 0x0000;
+    positionActualValue = 0;
+    
+    // register this device with the CANopen device driver
+    
+    canOpen.registerCANopenSlave(nodeID, this);
+    
+    // set slave into preoperational state
+    
+    canOpen.transmitNMTObject(CANopen::ENTER_PREOPERATIONAL_STATE, nodeID);
+    
+    // describe the mapping of the process data objects
+    
+    rpdo1.addEntry(0x6040, 0x00, 16);   // controlword
+    rpdo1.addEntry(0x6060, 0x00, 8);    // modes of operation
+    rpdo1.addEntry(0x607A, 0x00, 32);   // target position
+    
+    rpdo2.addEntry(0x6040, 0x00, 16);   // controlword
+    rpdo2.addEntry(0x6060, 0x00, 8);    // modes of operation
+    rpdo2.addEntry(0x60FF, 0x00, 32);   // target velocity
+    
+    rpdo3.addEntry(0x6040, 0x00, 16);   // controlword
+    rpdo3.addEntry(0x6060, 0x00, 8);    // modes of operation
+    rpdo3.addEntry(0x6071, 0x00, 16);   // target torque
+    
+    tpdo1.addEntry(0x6041, 0x00, 16);   // statusword
+    tpdo1.addEntry(0x6061, 0x00, 8);    // modes of operation display
+    tpdo1.addEntry(0x6064, 0x00, 32);   // position actual value
+    
+    if (period > 0.0) {
+        
+        tpdo1.setTransmissionType(253);     // transmit on remote request only
+        tpdo1.setInhibitTime(static_cast<uint16_t>(period*10000/2));
+        
+    } else {
+        
+        tpdo1.setTransmissionType(1);       // transmit after every SYNC object
+    }
+    
+    // configure the process data objects in bulk
+    
+    vector<CANopen::ProcessDataObject*> processDataObjects;
+    processDataObjects.push_back(&rpdo1);
+    processDataObjects.push_back(&rpdo2);
+    processDataObjects.push_back(&rpdo3);
+    processDataObjects.push_back(&tpdo1);
+    
+    canOpen.configureProcessDataObjects(nodeID, processDataObjects);
+    
+    // read inital object values
+    
+    targetPosition = static_cast<int32_t>(canOpen.readSDO(nodeID, 0x607A, 0x00));
+    targetVelocity = static_cast<int32_t>(canOpen.readSDO(nodeID, 0x60FF, 0x00));
+    targetTorque = static_cast<int16_t>(canOpen.readSDO(nodeID, 0x6071, 0x00));
+    
+    // set device into operational state
+    
+    canOpen.transmitNMTObject(CANopen::START_REMOTE_NODE, nodeID);
+}
+
 /**
  * Implements the interface of the CANopen delegate class to receive
  * CANopen messages targeted to this device driver.
@@ -269,107 +313,137 @@ void MaxonEPOS4::receiveObject(uint32_t functionCode, uint8_t object[]) {
     
     if (functionCode == CANopen::TPDO1) {
         
-        statusword = (static_cast<uint16_t>(object[0]) & 0xFF) | ((static_cast<uint16_t>(object[1]) & 0xFF) << 8);
-        modesOfOperationDisplay = static_cast<int8_t>(object[2]);
-        positionActualValue = (static_cast<int32_t>(object[3]) & 0xFF) | ((static_cast<int32_t>(object[4]) & 0xFF) << 8) | ((static_cast<int32_t>(object[5]) & 0xFF) << 16) | ((static_cast<int32_t>(object[6]) & 0xFF) << 24);
+        statusword = static_cast<uint16_t>(tpdo1.unpack(object, 0));
+        modesOfOperationDisplay = static_cast<int8_t>(tpdo1.unpack(object, 1));
+        positionActualValue = static_cast<int32_t>(tpdo1.unpack(object, 2));
     }
 }
 
 /**
- * This method is the handler of the MaxonEPOS4 device driver.
+ * Implements the interface of the CANopen delegate class to transmit
+ * process data objects when the SYNC producer of the CANopen stack asks for them.
  */
-void MaxonEPOS4::run() {
+void MaxonEPOS4::transmitObjects() {
     
-    while (waitForNextPeriod()) {
+    if (synchronous) transmitRPDO();
+}
+
+/**
+ * Transmits the receive process data object of the current mode of operation.
+ */
+void MaxonEPOS4::transmitRPDO() {
+    
+    // set new controlword
+    
+    uint16_t controlword = 0x0000;
+    
+    if (enable) {
         
-        // set new controlword
+             if ((statusword & NOT_READY_TO_SWITCH_ON_MASK) == NOT_READY_TO_SWITCH_ON) controlword = DISABLE_VOLTAGE;
+        else if ((statusword & SWITCH_ON_DISABLED_MASK) == SWITCH_ON_DISABLED) controlword = SHUTDOWN;
+        else if ((statusword & READY_TO_SWITCH_ON_MASK) == READY_TO_SWITCH_ON) controlword = SWITCH_ON;
+        else if ((statusword & SWITCHED_ON_MASK) == SWITCHED_ON) controlword = ENABLE_OPERATION;
+        else if ((statusword & OPERATION_ENABLED_MASK) == OPERATION_ENABLED) controlword = ENABLE_OPERATION;
+        else if ((statusword & QUICK_STOP_ACTIVE_MASK) == QUICK_STOP_ACTIVE) controlword = DISABLE_VOLTAGE;
+        else if ((statusword & FAULT_REACTION_ACTIVE_MASK) == FAULT_REACTION_ACTIVE) controlword = DISABLE_VOLTAGE;
+        else if ((statusword & FAULT_MASK) == FAULT) controlword = FAULT_RESET;
         
-        uint16_t controlword = 0x0000;
+    } else {
         
-        if (enable) {
-            
-                 if ((statusword & NOT_READY_TO_SWITCH_ON_MASK) == NOT_READY_TO_SWITCH_ON) controlword = DISABLE_VOLTAGE;
-            else if ((statusword & SWITCH_ON_DISABLED_MASK) == SWITCH_ON_DISABLED) controlword = SHUTDOWN;
-            else if ((statusword & READY_TO_SWITCH_ON_MASK) == READY_TO_SWITCH_ON) controlword = SWITCH_ON;
-            else if ((statusword & SWITCHED_ON_MASK) == SWITCHED_ON) controlword = ENABLE_OPERATION;
-            else if ((statusword & OPERATION_ENABLED_MASK) == OPERATION_ENABLED) controlword = ENABLE_OPERATION;
-            else if ((statusword & QUICK_STOP_ACTIVE_MASK) == QUICK_STOP_ACTIVE) controlword = DISABLE_VOLTAGE;
-            else if ((statusword & FAULT_REACTION_ACTIVE_MASK) == FAULT_REACTION_ACTIVE) controlword = DISABLE_VOLTAGE;
-            else if ((statusword & FAULT_MASK) == FAULT) controlword = FAULT_RESET;
+             if ((statusword & NOT_READY_TO_SWITCH_ON_MASK) == NOT_READY_TO_SWITCH_ON) controlword = DISABLE_VOLTAGE;
+        else if ((statusword & SWITCH_ON_DISABLED_MASK) == SWITCH_ON_DISABLED) controlword = DISABLE_VOLTAGE;
+        else if ((statusword & READY_TO_SWITCH_ON_MASK) == READY_TO_SWITCH_ON) controlword = DISABLE_VOLTAGE;
+        else if ((statusword & SWITCHED_ON_MASK) == SWITCHED_ON) controlword = DISABLE_VOLTAGE;
+        else if ((statusword & OPERATION_ENABLED_MASK) == OPERATION_ENABLED) controlword = DISABLE_VOLTAGE;
+        else if ((statusword & QUICK_STOP_ACTIVE_MASK) == QUICK_STOP_ACTIVE) controlword = DISABLE_VOLTAGE;
+        else if ((statusword & FAULT_REACTION_ACTIVE_MASK) == FAULT_REACTION_ACTIVE) controlword = DISABLE_VOLTAGE;
+        else if ((statusword & FAULT_MASK) == FAULT) controlword = FAULT_RESET;
+    }
+    
+    // transmit RPDO
+    
+    if (modesOfOperation == PROFILE_POSITION_MODE) {
+        
+        if (newSetpoint) {
             
-        } else {
+            controlword |= NEW_SETPOINT;
+            controlword |= CHANGE_SET_IMMEDIATELY;
             
-                 if ((statusword & NOT_READY_TO_SWITCH_ON_MASK) == NOT_READY_TO_SWITCH_ON) controlword = DISABLE_VOLTAGE;
-            else if ((statusword & SWITCH_ON_DISABLED_MASK) == SWITCH_ON_DISABLED) controlword = DISABLE_VOLTAGE;
-            else if ((statusword & READY_TO_SWITCH_ON_MASK) == READY_TO_SWITCH_ON) controlword = DISABLE_VOLTAGE;
-            else if ((statusword & SWITCHED_ON_MASK) == SWITCHED_ON) controlword = DISABLE_VOLTAGE;
-            else if ((statusword & OPERATION_ENABLED_MASK) == OPERATION_ENABLED) controlword = DISABLE_VOLTAGE;
-            else if ((statusword & QUICK_STOP_ACTIVE_MASK) == QUICK_STOP_ACTIVE) controlword = DISABLE_VOLTAGE;
-            else if ((statusword & FAULT_REACTION_ACTIVE_MASK) == FAULT_REACTION_ACTIVE) controlword = DISABLE_VOLTAGE;
-            else if ((statusword & FAULT_MASK) == FAULT) controlword = FAULT_RESET;
+            newSetpoint = false;
         }
         
-        // transmit RPDO
+        // transmit RPDO1
         
-        if (modesOfOperation == PROFILE_POSITION_MODE) {
-            
-            if (newSetpoint) {
-                
-                controlword |= NEW_SETPOINT;
-                controlword |= CHANGE_SET_IMMEDIATELY;
-                
-                newSetpoint = false;
-            }
-            
-            // transmit RPDO1
-            
-            uint8_t rpdo1[7];
-            
-            rpdo1[0] = static_cast<uint8_t>(controlword & 0xFF);
-            rpdo1[1] = static_cast<uint8_t>((controlword >> 8) & 0xFF);
-            rpdo1[2] = static_cast<uint8_t>(modesOfOperation);
-            rpdo1[3] = static_cast<uint8_t>(targetPosition & 0xFF);
-            rpdo1[4] = static_cast<uint8_t>((targetPosition >> 8) & 0xFF);
-            rpdo1[5] = static_cast<uint8_t>((targetPosition >> 16) & 0xFF);
-            rpdo1[6] = static_cast<uint8_t>((targetPosition >> 24) & 0xFF);
-            
-            canOpen.transmitObject(CANopen::RPDO1, nodeID, rpdo1, 7);
-            
-        } else if (modesOfOperation == PROFILE_VELOCITY_MODE) {
-            
-            // transmit RPDO2
-            
-            uint8_t rpdo2[7];
-            
-            rpdo2[0] = static_cast<uint8_t>(controlword & 0xFF);
-            rpdo2[1] = static_cast<uint8_t>((controlword >> 8) & 0xFF);
-            rpdo2[2] = static_cast<uint8_t>(modesOfOperation);
-            rpdo2[3] = static_cast<uint8_t>(targetVelocity & 0xFF);
-            rpdo2[4] = static_cast<uint8_t>((targetVelocity >> 8) & 0xFF);
-            rpdo2[5] = static_cast<uint8_t>((targetVelocity >> 16) & 0xFF);
-            rpdo2[6] = static_cast<uint8_t>((targetVelocity >> 24) & 0xFF);
-            
-            canOpen.transmitObject(CANopen::RPDO2, nodeID, rpdo2, 7);
-            
-        } else if (modesOfOperation == CYCLIC_SYNCHRONOUS_TORQUE_MODE) {
-            
-            // transmit RPDO3
-            
-            uint8_t rpdo3[5];
-            
-            rpdo3[0] = static_cast<uint8_t>(controlword & 0xFF);
-            rpdo3[1] = static_cast<uint8_t>((controlword >> 8) & 0xFF);
-            rpdo3[2] = static_cast<uint8_t>(modesOfOperation);
-            rpdo3[3] = static_cast<uint8_t>(targetTorque & 0xFF);
-            rpdo3[4] = static_cast<uint8_t>((targetTorque >> 8) & 0xFF);
-            
-            canOpen.transmitObject(CANopen::RPDO3, nodeID, rpdo3, 5);
-        }
+        uint8_t object[8];
         
-        // request TPDO1
+        rpdo1.pack(object, 0, controlword);
+        rpdo1.pack(object, 1, static_cast<uint8_t>(modesOfOperation));
+        rpdo1.pack(object, 2, static_cast<uint32_t>(targetPosition));
         
-        uint8_t tpdo1[7];
+        canOpen.transmitObject(CANopen::RPDO1, nodeID, object, rpdo1.getLength());
+        
+    } else if (modesOfOperation == PROFILE_VELOCITY_MODE) {
+        
+        // transmit RPDO2
+        
+        uint8_t object[8];
+        
+        rpdo2.pack(object, 0, controlword);
+        rpdo2.pack(object, 1, static_cast<uint8_t>(modesOfOperation));
+        rpdo2.pack(object, 2, static_cast<uint32_t>(targetVelocity));
+        
+        canOpen.transmitObject(CANopen::RPDO2, nodeID, object, rpdo2.getLength());
+        
+    } else if (modesOfOperation == CYCLIC_SYNCHRONOUS_TORQUE_MODE) {
+        
+        // transmit RPDO3
+        
+        uint8_t object[8];
+        
+        rpdo3.pack(object, 0, controlword);
+        rpdo3.pack(object, 1, static_cast<uint8_t>(modesOfOperation));
+        rpdo3.pack(object, 2, static_cast<uint32_t>(targetTorque));
+        
+        canOpen.transmitObject(CANopen::RPDO3, nodeID, object, rpdo3.getLength());
+    }
+}
+
+/**
+ * Transmits the receive process data object, and requests the transmit process data object.
+ * This method is called periodically by the handler of this driver, or by a cyclic executor.
+ */
+void MaxonEPOS4::execute() {
+    
+    // transmit RPDO
+    
+    transmitRPDO();
+    
+    // request TPDO1
+    
+    uint8_t object[8];
+    
+    canOpen.transmitObject(CANopen::TPDO1, nodeID, object, tpdo1.getLength(), CANRemote);
+}
+
+/**
+ * Creates the handler thread of a MaxonEPOS4 device driver.
+ * @param maxonEPOS4 the device driver this handler belongs to.
+ * @param period the period of the handler thread, given in [s].
+ */
+MaxonEPOS4::Handler::Handler(MaxonEPOS4* maxonEPOS4, double period) : RealtimeThread("MaxonEPOS4", STACK_SIZE, PRIORITY, period) {
+    
+    this->maxonEPOS4 = maxonEPOS4;
+}
+
+MaxonEPOS4::Handler::~Handler() {}
+
+/**
+ * This method is the handler of the MaxonEPOS4 device driver.
+ */
+void MaxonEPOS4::Handler::run() {
+    
+    while (waitForNextPeriod()) {
         
-        canOpen.transmitObject(CANopen::TPDO1, nodeID, tpdo1, 7, CANRemote);
+        maxonEPOS4->execute();
     }
 }
@@ -0,0 +1,321 @@
+/*
+ * PacketSocket.cpp
+ * Copyright (c) 2026, ZHAW
+ * All rights reserved.
+ *
+ *  Created on: 17.10.2026
+ *      Author: Marcel Honegger
+ */
+
+#if defined __QNX__
+
+#else
+
+#include <atomic>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <net/if.h>
+#include <arpa/inet.h>
+#include <linux/if_packet.h>
+#include <linux/if_ether.h>
+
+#endif
+
+#include "PacketSocket.h"
+
+using namespace std;
+
+/**
+ * Creates an Ethernet device driver object for a given network interface,
+ * which transmits and receives EtherCAT frames.
+ * @param interfaceName the name of the network interface to use, like 'eth0' or 'eth1'.
+ */
+PacketSocket::PacketSocket(string interfaceName) : interfaceName(interfaceName) {
+    
+    open(ETHERTYPE_ETHER_CAT);
+}
+
+/**
+ * Creates an Ethernet device driver object for a given network interface,
+ * which transmits and receives frames of a given ether type.
+ * @param interfaceName the name of the network interface to use, like 'eth0' or 'eth1'.
+ * @param etherType the ether type of the frames to receive, i.e. <code>ETHERTYPE_ETHER_CAT</code>.
+ */
+PacketSocket::PacketSocket(string interfaceName, uint16_t etherType) : interfaceName(interfaceName) {
+    
+    open(etherType);
+}
+
+/**
+ * Deletes the Ethernet device driver object and releases all allocated resources.
+ */
+PacketSocket::~PacketSocket() {
+    
+    close();
+}
+
+/**
+ * Returns if an ethernet link is present or not.
+ * @return <code>false</code> if no ethernet link is present, <code>true</code> if an ethernet link is present.
+ */
+bool PacketSocket::link() {
+    
+    #if defined __QNX__
+    
+    return false;
+    
+    #else
+    
+    ifreq ifr;
+    memset(&ifr, 0, sizeof(ifr));
+    strncpy(ifr.ifr_name, interfaceName.c_str(), IFNAMSIZ-1);
+    
+    if (ioctl(packetSocket, SIOCGIFFLAGS, &ifr) < 0) return false;
+    
+    return ((ifr.ifr_flags & IFF_UP) != 0) && ((ifr.ifr_flags & IFF_RUNNING) != 0);
+    
+    #endif
+}
+
+/**
+ * Gives the ethernet MAC address of this hardware interface.
+ * @param macAddress A 6 byte array to copy the ethernet MAC address into.
+ */
+void PacketSocket::address(uint8_t macAddress[6]) {
+    
+    for (uint16_t i = 0; i < 6; i++) macAddress[i] = this->macAddress[i];
+}
+
+/**
+ * Sends an ethernet frame to transmit on the network. The frame is written into the next
+ * free slot of the transmit ring, and the kernel is asked to transmit it without waiting.
+ * @param destinationMACAddress an array of 6 bytes representing the MAC address
+ * of the destination of this frame.
+ * @param etherType the ether type value of this frame, i.e. <code>ETHERTYPE_IPV4</code>
+ * for an IPv4 packet.
+ * @param data a buffer with the payload of this frame.
+ * @param length the size of the given buffer pointed to by <code>data</code>, given in [bytes].
+ * @return the number of bytes actually sent, or 0 if the transmit ring is full, the payload is larger
+ * than the MTU, or the frame couldn't be sent.
+ */
+uint16_t PacketSocket::send(uint8_t destinationMACAddress[6], uint16_t etherType, uint8_t data[], uint16_t length) {
+    
+    #if defined __QNX__
+    
+    return 0;
+    
+    #else
+    
+    uint8_t* slot = ring+(FRAME_NUMBER+transmitIndex)*FRAME_SIZE;
+    tpacket2_hdr* header = reinterpret_cast<tpacket2_hdr*>(slot);
+    
+    atomic_thread_fence(memory_order_acquire);
+    
+    if ((header->tp_status & (TP_STATUS_SEND_REQUEST | TP_STATUS_SENDING)) != 0) return 0;   // the transmit ring is full
+    if (length > MTU) return 0;     // the payload doesn't fit into an ethernet frame
+    
+    uint8_t* frame = slot+TPACKET_ALIGN(sizeof(tpacket2_hdr));
+    
+    for (uint16_t i = 0; i < 6; i++) frame[i] = destinationMACAddress[i];
+    for (uint16_t i = 0; i < 6; i++) frame[6+i] = macAddress[i];
+    frame[12] = (etherType >> 8) & 0xFF;
+    frame[13] = etherType & 0xFF;
+    memcpy(frame+14, data, length);
+    
+    uint16_t size = (length < 46) ? 46 : length;
+    if (size > length) memset(frame+14+length, 0, size-length);
+    
+    header->tp_len = 6+6+2+size;
+    
+    atomic_thread_fence(memory_order_release);
+    
+    header->tp_status = TP_STATUS_SEND_REQUEST;
+    
+    if (::send(packetSocket, NULL, 0, MSG_DONTWAIT) < 0) {
+        header->tp_status = TP_STATUS_AVAILABLE;
+        return 0;
+    }
+    
+    transmitIndex = (transmitIndex+1)%FRAME_NUMBER;
+    
+    return length;
+    
+    #endif
+}
+
+/**
+ * Receives an ethernet frame from the network. If the next slot of the receive ring
+ * is empty, this method waits briefly for a frame to arrive. Frames transmitted by
+ * this host are discarded.
+ * @param sourceMACAddress a buffer of 6 bytes to store the MAC address of the source of the frame.
+ * @param etherType the ether type value of the received frame.
+ * @param data a buffer to write the payload of the received frame into.
+ * @param length the size of the given buffer pointed to by <code>data</code>.
+ * @return the number of received bytes, or 0 if no frame was received.
+ */
+uint16_t PacketSocket::receive(uint8_t sourceMACAddress[6], uint16_t& etherType, uint8_t data[], uint16_t length) {
+    
+    #if defined __QNX__
+    
+    return 0;
+    
+    #else
+    
+    uint8_t* slot = ring+receiveIndex*FRAME_SIZE;
+    tpacket2_hdr* header = reinterpret_cast<tpacket2_hdr*>(slot);
+    
+    if ((header->tp_status & TP_STATUS_USER) == 0) {
+        
+        pollfd descriptor;
+        descriptor.fd = packetSocket;
+        descriptor.events = POLLIN;
+        descriptor.revents = 0;
+        
+        poll(&descriptor, 1, RECEIVE_TIMEOUT);
+        
+        if ((header->tp_status & TP_STATUS_USER) == 0) return 0;
+    }
+    
+    atomic_thread_fence(memory_order_acquire);
+    
+    uint8_t* frame = slot+header->tp_mac;
+    sockaddr_ll* address = reinterpret_cast<sockaddr_ll*>(slot+TPACKET_ALIGN(sizeof(tpacket2_hdr)));
+    
+    uint16_t size = 0;
+    
+    if ((address->sll_pkttype != PACKET_OUTGOING) && (header->tp_snaplen >= 6+6+2)) {
+        
+        for (uint16_t i = 0; i < 6; i++) sourceMACAddress[i] = frame[6+i];
+        etherType = (static_cast<uint16_t>(frame[12]) << 8) | static_cast<uint16_t>(frame[13]);
+        size = header->tp_snaplen-6-6-2;
+        if (size > length) size = length;
+        memcpy(data, frame+14, size);
+    }
+    
+    // hand the slot back to the kernel
+    
+    atomic_thread_fence(memory_order_release);
+    
+    header->tp_status = TP_STATUS_KERNEL;
+    
+    receiveIndex = (receiveIndex+1)%FRAME_NUMBER;
+    
+    return size;
+    
+    #endif
+}
+
+/**
+ * Opens the packet socket, binds it to the network interface and maps
+ * the receive and transmit rings into the memory of this process.
+ * @param etherType the ether type of the frames to receive.
+ */
+void PacketSocket::open(uint16_t etherType) {
+    
+    packetSocket = -1;
+    interfaceIndex = 0;
+    for (uint16_t i = 0; i < 6; i++) macAddress[i] = 0;
+    ring = NULL;
+    receiveIndex = 0;
+    transmitIndex = 0;
+    
+    #if defined __QNX__
+    
+    throw runtime_error("PacketSocket: packet sockets are not supported by this operating system.");
+    
+    #else
+    
+    packetSocket = socket(AF_PACKET, SOCK_RAW, htons(etherType));
+    if (packetSocket < 0) throw runtime_error("PacketSocket: couldn't create packet socket (errno="+to_string(errno)+").");
+    
+    try {
+        
+        // get index and address of the network interface
+        
+        ifreq ifr;
+        memset(&ifr, 0, sizeof(ifr));
+        strncpy(ifr.ifr_name, interfaceName.c_str(), IFNAMSIZ-1);
+        
+        if (ioctl(packetSocket, SIOCGIFINDEX, &ifr) < 0) throw runtime_error("PacketSocket: network interface '"+interfaceName+"' not found.");
+        interfaceIndex = ifr.ifr_ifindex;
+        
+        if (ioctl(packetSocket, SIOCGIFHWADDR, &ifr) < 0) throw runtime_error("PacketSocket: couldn't get address of network interface '"+interfaceName+"'.");
+        for (uint16_t i = 0; i < 6; i++) macAddress[i] = static_cast<uint8_t>(ifr.ifr_hwaddr.sa_data[i]);
+        
+        // configure rings with a status word per frame slot
+        
+        int32_t version = TPACKET_V2;
+        if (setsockopt(packetSocket, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0) throw runtime_error("PacketSocket: couldn't set version of rings.");
+        
+        #if defined PACKET_QDISC_BYPASS
+        
+        int32_t bypass = 1;
+        setsockopt(packetSocket, SOL_PACKET, PACKET_QDISC_BYPASS, &bypass, sizeof(bypass));
+        
+        #endif
+        
+        tpacket_req request;
+        request.tp_block_size = BLOCK_SIZE;
+        request.tp_block_nr = FRAME_NUMBER*FRAME_SIZE/BLOCK_SIZE;
+        request.tp_frame_size = FRAME_SIZE;
+        request.tp_frame_nr = FRAME_NUMBER;
+        
+        if (setsockopt(packetSocket, SOL_PACKET, PACKET_RX_RING, &request, sizeof(request)) < 0) throw runtime_error("PacketSocket: couldn't create receive ring.");
+        if (setsockopt(packetSocket, SOL_PACKET, PACKET_TX_RING, &request, sizeof(request)) < 0) throw runtime_error("PacketSocket: couldn't create transmit ring.");
+        
+        void* address = mmap(NULL, 2*FRAME_NUMBER*FRAME_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_LOCKED, packetSocket, 0);
+        if (address == MAP_FAILED) address = mmap(NULL, 2*FRAME_NUMBER*FRAME_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, packetSocket, 0);
+        if (address == MAP_FAILED) throw runtime_error("PacketSocket: couldn't map rings into memory.");
+        
+        ring = static_cast<uint8_t*>(address);
+        
+        // bind the socket to the network interface, and receive frames for other addresses as well
+        
+        sockaddr_ll socketAddress;
+        memset(&socketAddress, 0, sizeof(socketAddress));
+        socketAddress.sll_family = AF_PACKET;
+        socketAddress.sll_protocol = htons(etherType);
+        socketAddress.sll_ifindex = interfaceIndex;
+        
+        if (::bind(packetSocket, (sockaddr*)&socketAddress, sizeof(socketAddress)) < 0) throw runtime_error("PacketSocket: couldn't bind socket to network interface '"+interfaceName+"'.");
+        
+        packet_mreq membership;
+        memset(&membership, 0, sizeof(membership));
+        membership.mr_ifindex = interfaceIndex;
+        membership.mr_type = PACKET_MR_PROMISC;
+        
+        if (setsockopt(packetSocket, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &membership, sizeof(membership)) < 0) throw runtime_error("PacketSocket: couldn't enable promiscuous mode.");
+        
+    } catch (exception& e) {
+        
+        close();
+        
+        throw;
+    }
+    
+    #endif
+}
+
+/**
+ * Unmaps the rings and closes the packet socket.
+ */
+void PacketSocket::close() {
+    
+    #if defined __QNX__
+    
+    #else
+    
+    if (ring != NULL) munmap(ring, 2*FRAME_NUMBER*FRAME_SIZE);
+    if (packetSocket >= 0) ::close(packetSocket);
+    
+    ring = NULL;
+    packetSocket = -1;
+    
+    #endif
+}
@@ -181,168 +181,21 @@ int32_t SMCServoJXCE1::readPosition() {
  */
 void SMCServoJXCE1::initializeEtherCAT(uint16_t deviceAddress) {
     
-    // set EtherCAT state machine to state INIT
-    
-    uint16_t loop = 0;
-    uint16_t state = 0;
-    while ((state != EtherCAT::STATE_INIT) && (loop++ < 100)) try {
-        state = etherCAT.read16(deviceAddress, EtherCAT::APPLICATION_LAYER_STATUS);
-        Thread::sleep(10);
-        if ((state & EtherCAT::STATE_ERROR_MASK) == EtherCAT::STATE_ERROR) {
-            etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, state & EtherCAT::STATE_MASK);
-            Thread::sleep(10);
-            etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, state);
-        } else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_BOOTSTRAP) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_INIT);
-        else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_PRE_OPERATIONAL) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_INIT);
-        else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_SAFE_OPERATIONAL) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_PRE_OPERATIONAL);
-        else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_OPERATIONAL) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_SAFE_OPERATIONAL);
-        Thread::sleep(10);
-    } catch (exception& e) {
-        cerr << e.what() << endl;
-    }
-    if (state != EtherCAT::STATE_INIT) {
-        try {
-            uint16_t statusCode = etherCAT.read16(deviceAddress, EtherCAT::APPLICATION_LAYER_STATUS_CODE);
-            cerr << "SMCServoJXCE1: APPLICATION_LAYER_STATUS_CODE=0x" << hex << statusCode << endl;
-        } catch (exception& e) {}
-        throw runtime_error("SMCServoJXCE1: couldn't enter state INIT.");
-    }
+    // configure SYNC managers
     
-    Thread::sleep(10);
-    
-    // initialize SYNC managers
-    
-    etherCAT.write8(deviceAddress, EtherCAT::SYNC_MANAGER_ACTIVATE+0*EtherCAT::SYNC_MANAGER_OFFSET, 0);
-    Thread::sleep(10);
-    etherCAT.write16(deviceAddress, EtherCAT::SYNC_MANAGER+0*EtherCAT::SYNC_MANAGER_OFFSET, MAILBOX_OUT_ADDRESS);
-    Thread::sleep(10);
-    etherCAT.write16(deviceAddress, EtherCAT::SYNC_MANAGER_LENGTH+0*EtherCAT::SYNC_MANAGER_OFFSET, MAILBOX_OUT_SIZE);
-    Thread::sleep(10);
-    etherCAT.write8(deviceAddress, EtherCAT::SYNC_MANAGER_CONTROL+0*EtherCAT::SYNC_MANAGER_OFFSET, 0x26);	// mailbox, write, interrupt in PDI
-    Thread::sleep(10);
-    etherCAT.write8(deviceAddress, EtherCAT::SYNC_MANAGER_ACTIVATE+0*EtherCAT::SYNC_MANAGER_OFFSET, 1);
-    Thread::sleep(10);
-    
-    etherCAT.write8(deviceAddress, EtherCAT::SYNC_MANAGER_ACTIVATE+1*EtherCAT::SYNC_MANAGER_OFFSET, 0);
-    Thread::sleep(10);
-    etherCAT.write16(deviceAddress, EtherCAT::SYNC_MANAGER+1*EtherCAT::SYNC_MANAGER_OFFSET, 0x1200);
-    Thread::sleep(10);
-    etherCAT.write16(deviceAddress, EtherCAT::SYNC_MANAGER_LENGTH+1*EtherCAT::SYNC_MANAGER_OFFSET, MAILBOX_IN_SIZE);
-    Thread::sleep(10);
-    etherCAT.write8(deviceAddress, EtherCAT::SYNC_MANAGER_CONTROL+1*EtherCAT::SYNC_MANAGER_OFFSET, 0x22);	// mailbox, read, interrupt in PDI
-    Thread::sleep(10);
-    etherCAT.write8(deviceAddress, EtherCAT::SYNC_MANAGER_ACTIVATE+1*EtherCAT::SYNC_MANAGER_OFFSET, 1);
-    Thread::sleep(10);
-    
-    etherCAT.write8(deviceAddress, EtherCAT::SYNC_MANAGER_ACTIVATE+2*EtherCAT::SYNC_MANAGER_OFFSET, 0);
-    Thread::sleep(10);
-    etherCAT.write16(deviceAddress, EtherCAT::SYNC_MANAGER+2*EtherCAT::SYNC_MANAGER_OFFSET, 0x1400);
-    Thread::sleep(10);
-    etherCAT.write16(deviceAddress, EtherCAT::SYNC_MANAGER_LENGTH+2*EtherCAT::SYNC_MANAGER_OFFSET, BUFFERED_OUT_SIZE);
-    Thread::sleep(10);
-    etherCAT.write8(deviceAddress, EtherCAT::SYNC_MANAGER_CONTROL+2*EtherCAT::SYNC_MANAGER_OFFSET, 0x24);	// buffered, write, interrupt in PDI
-    Thread::sleep(10);
-    etherCAT.write8(deviceAddress, EtherCAT::SYNC_MANAGER_ACTIVATE+2*EtherCAT::SYNC_MANAGER_OFFSET, 1);
-    Thread::sleep(10);
-    
-    etherCAT.write8(deviceAddress, EtherCAT::SYNC_MANAGER_ACTIVATE+3*EtherCAT::SYNC_MANAGER_OFFSET, 0);
-    Thread::sleep(10);
-    etherCAT.write16(deviceAddress, EtherCAT::SYNC_MANAGER+3*EtherCAT::SYNC_MANAGER_OFFSET, 0x1600);
-    Thread::sleep(10);
-    etherCAT.write16(deviceAddress, EtherCAT::SYNC_MANAGER_LENGTH+3*EtherCAT::SYNC_MANAGER_OFFSET, BUFFERED_IN_SIZE);
-    Thread::sleep(10);
-    etherCAT.write8(deviceAddress, EtherCAT::SYNC_MANAGER_CONTROL+3*EtherCAT::SYNC_MANAGER_OFFSET, 0x20);	// buffered, read, interrupt in PDI
-    Thread::sleep(10);
-    etherCAT.write8(deviceAddress, EtherCAT::SYNC_MANAGER_ACTIVATE+3*EtherCAT::SYNC_MANAGER_OFFSET, 1);
-    Thread::sleep(10);
-    
-    // set EtherCAT state machine to state PRE OPERATIONAL
-    
-    loop = 0;
-    state = 0;
-    while ((state != EtherCAT::STATE_PRE_OPERATIONAL) && (loop++ < 100)) try {
-        state = etherCAT.read16(deviceAddress, EtherCAT::APPLICATION_LAYER_STATUS);
-        Thread::sleep(10);
-        if ((state & EtherCAT::STATE_ERROR_MASK) == EtherCAT::STATE_ERROR) {
-            etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, state & EtherCAT::STATE_MASK);
-            Thread::sleep(10);
-            etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, state);
-        } else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_INIT) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_PRE_OPERATIONAL);
-        else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_BOOTSTRAP) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_INIT);
-        else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_SAFE_OPERATIONAL) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_PRE_OPERATIONAL);
-        else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_OPERATIONAL) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_SAFE_OPERATIONAL);
-        Thread::sleep(10);
-    } catch (exception& e) {
-        cerr << e.what() << endl;
-    }
-    if (state != EtherCAT::STATE_PRE_OPERATIONAL) {
-        try {
-            uint16_t statusCode = etherCAT.read16(deviceAddress, EtherCAT::APPLICATION_LAYER_STATUS_CODE);
-            cerr << "SMCServoJXCE1: APPLICATION_LAYER_STATUS_CODE=0x" << hex << statusCode << endl;
-        } catch (exception& e) {}
-        throw runtime_error("SMCServoJXCE1: couldn't enter state PRE OPERATIONAL.");
-    }
+    coe.configureSyncManager(deviceAddress, 0, MAILBOX_OUT_ADDRESS, MAILBOX_OUT_SIZE, 0x26, true);   // mailbox, write, interrupt in PDI
+    coe.configureSyncManager(deviceAddress, 1, 0x1200, MAILBOX_IN_SIZE, 0x22, true);   // mailbox, read, interrupt in PDI
+    coe.configureSyncManager(deviceAddress, 2, 0x1400, BUFFERED_OUT_SIZE, 0x24, true);   // buffered, write, interrupt in PDI
+    coe.configureSyncManager(deviceAddress, 3, 0x1600, BUFFERED_IN_SIZE, 0x20, true);   // buffered, read, interrupt in PDI
     
-    // register process datagrams
-    
-    coe.registerDatagram(rxPDO = new EtherCAT::Datagram(EtherCAT::COMMAND_APWR, deviceAddress, BUFFERED_OUT_ADDRESS, BUFFERED_OUT_SIZE));
-    coe.registerDatagram(txPDO = new EtherCAT::Datagram(EtherCAT::COMMAND_APRD, deviceAddress, BUFFERED_IN_ADDRESS, BUFFERED_IN_SIZE));
-    
-    coe.addSlaveDevice(this);
-    
-    // set EtherCAT state machine to state SAFE OPERATIONAL
-    
-    loop = 0;
-    state = 0;
-    while ((state != EtherCAT::STATE_SAFE_OPERATIONAL) && (loop++ < 100)) try {
-        state = etherCAT.read16(deviceAddress, EtherCAT::APPLICATION_LAYER_STATUS);
-        Thread::sleep(10);
-        if ((state & EtherCAT::STATE_ERROR_MASK) == EtherCAT::STATE_ERROR) {
-            etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, state & EtherCAT::STATE_MASK);
-            Thread::sleep(10);
-            etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, state);
-        } else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_INIT) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_PRE_OPERATIONAL);
-        else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_BOOTSTRAP) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_INIT);
-        else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_PRE_OPERATIONAL) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_SAFE_OPERATIONAL);
-        else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_OPERATIONAL) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_SAFE_OPERATIONAL);
-        Thread::sleep(10);
-    } catch (exception& e) {
-        cerr << e.what() << endl;
-    }
-    if (state != EtherCAT::STATE_SAFE_OPERATIONAL) {
-        try {
-            uint16_t statusCode = etherCAT.read16(deviceAddress, EtherCAT::APPLICATION_LAYER_STATUS_CODE);
-            cerr << "SMCServoJXCE1: APPLICATION_LAYER_STATUS_CODE=0x" << hex << statusCode << endl;
-        } catch (exception& e) {}
-        throw runtime_error("SMCServoJXCE1: couldn't enter state SAFE OPERATIONAL.");
-    }
+    // register process data
     
-    // set EtherCAT state machine to state OPERATIONAL
-    
-    loop = 0;
-    state = 0;
-    while ((state != EtherCAT::STATE_OPERATIONAL) && (loop++ < 100)) try {
-        state = etherCAT.read16(deviceAddress, EtherCAT::APPLICATION_LAYER_STATUS);
-        Thread::sleep(10);
-        if ((state & EtherCAT::STATE_ERROR_MASK) == EtherCAT::STATE_ERROR) {
-            etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, state & EtherCAT::STATE_MASK);
-            Thread::sleep(10);
-            etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, state);
-        } else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_INIT) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_PRE_OPERATIONAL);
-        else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_BOOTSTRAP) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_INIT);
-        else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_PRE_OPERATIONAL) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_SAFE_OPERATIONAL);
-        else if ((state & EtherCAT::STATE_MASK) == EtherCAT::STATE_SAFE_OPERATIONAL) etherCAT.write16(deviceAddress, EtherCAT::APPLICATION_LAYER_CONTROL, EtherCAT::STATE_OPERATIONAL);
-        Thread::sleep(10);
-    } catch (exception& e) {
-        cerr << e.what() << endl;
-    }
-    if (state != EtherCAT::STATE_OPERATIONAL) {
-        try {
-            uint16_t statusCode = etherCAT.read16(deviceAddress, EtherCAT::APPLICATION_LAYER_STATUS_CODE);
-            cerr << "SMCServoJXCE1: APPLICATION_LAYER_STATUS_CODE=0x" << hex << statusCode << endl;
-        } catch (exception& e) {}
-        throw runtime_error("SMCServoJXCE1: couldn't enter state OPERATIONAL.");
-    }
+    rxPDO = coe.registerProcessData(deviceAddress, BUFFERED_OUT_ADDRESS, BUFFERED_OUT_SIZE, EtherCAT::FMMU_TYPE_WRITE);
+    txPDO = coe.registerProcessData(deviceAddress, BUFFERED_IN_ADDRESS, BUFFERED_IN_SIZE, EtherCAT::FMMU_TYPE_READ);
+    
+    // register this slave device and bring it up
+    
+    coe.addSlaveDevice(this, deviceAddress);
 }
 
 /**
@@ -354,42 +207,21 @@ void SMCServoJXCE1::writeDatagram() {
     
     mutex.lock();
     
-    rxPDO->data[10] = static_cast<uint8_t>(outputPort & 0xFF);
-	rxPDO->data[11] = static_cast<uint8_t>((outputPort >> 8) & 0xFF);
-    rxPDO->data[12] = static_cast<uint8_t>(numericalDataFlag & 0xFF);
-	rxPDO->data[13] = static_cast<uint8_t>((numericalDataFlag >> 8) & 0xFF);
-    rxPDO->data[14] = startFlag;
-    rxPDO->data[15] = movementMode;
-    rxPDO->data[16] = static_cast<uint8_t>(speed & 0xFF);
-	rxPDO->data[17] = static_cast<uint8_t>((speed >> 8) & 0xFF);
-    rxPDO->data[18] = static_cast<uint8_t>(targetPosition & 0xFF);
-	rxPDO->data[19] = static_cast<uint8_t>((targetPosition >> 8) & 0xFF);
-    rxPDO->data[20] = static_cast<uint8_t>((targetPosition >> 16) & 0xFF);
-	rxPDO->data[21] = static_cast<uint8_t>((targetPosition >> 24) & 0xFF);
-    rxPDO->data[22] = static_cast<uint8_t>(acceleration & 0xFF);
-	rxPDO->data[23] = static_cast<uint8_t>((acceleration >> 8) & 0xFF);
-    rxPDO->data[24] = static_cast<uint8_t>(deceleration & 0xFF);
-	rxPDO->data[25] = static_cast<uint8_t>((deceleration >> 8) & 0xFF);
-    rxPDO->data[26] = static_cast<uint8_t>(pushingForce & 0xFF);
-	rxPDO->data[27] = static_cast<uint8_t>((pushingForce >> 8) & 0xFF);
-    rxPDO->data[28] = static_cast<uint8_t>(triggerLV & 0xFF);
-	rxPDO->data[29] = static_cast<uint8_t>((triggerLV >> 8) & 0xFF);
-    rxPDO->data[30] = static_cast<uint8_t>(pushingSpeed & 0xFF);
-	rxPDO->data[31] = static_cast<uint8_t>((pushingSpeed >> 8) & 0xFF);
-    rxPDO->data[32] = static_cast<uint8_t>(movingForce & 0xFF);
-	rxPDO->data[33] = static_cast<uint8_t>((movingForce >> 8) & 0xFF);
-    rxPDO->data[34] = static_cast<uint8_t>(area1 & 0xFF);
-	rxPDO->data[35] = static_cast<uint8_t>((area1 >> 8) & 0xFF);
-    rxPDO->data[36] = static_cast<uint8_t>((area1 >> 16) & 0xFF);
-	rxPDO->data[37] = static_cast<uint8_t>((area1 >> 24) & 0xFF);
-    rxPDO->data[38] = static_cast<uint8_t>(area2 & 0xFF);
-	rxPDO->data[39] = static_cast<uint8_t>((area2 >> 8) & 0xFF);
-    rxPDO->data[40] = static_cast<uint8_t>((area2 >> 16) & 0xFF);
-	rxPDO->data[41] = static_cast<uint8_t>((area2 >> 24) & 0xFF);
-    rxPDO->data[42] = static_cast<uint8_t>(inPosition & 0xFF);
-	rxPDO->data[43] = static_cast<uint8_t>((inPosition >> 8) & 0xFF);
-    rxPDO->data[44] = static_cast<uint8_t>((inPosition >> 16) & 0xFF);
-	rxPDO->data[45] = static_cast<uint8_t>((inPosition >> 24) & 0xFF);
+    rxPDO->write16(0, outputPort);
+    rxPDO->write16(2, numericalDataFlag);
+    rxPDO->write8(4, startFlag);
+    rxPDO->write8(5, movementMode);
+    rxPDO->write16(6, speed);
+    rxPDO->write32(8, targetPosition);
+    rxPDO->write16(12, acceleration);
+    rxPDO->write16(14, deceleration);
+    rxPDO->write16(16, pushingForce);
+    rxPDO->write16(18, triggerLV);
+    rxPDO->write16(20, pushingSpeed);
+    rxPDO->write16(22, movingForce);
+    rxPDO->write32(24, area1);
+    rxPDO->write32(28, area2);
+    rxPDO->write32(32, inPosition);
     
     mutex.unlock();
 }
@@ -403,16 +235,16 @@ void SMCServoJXCE1::readDatagram() {
     
     mutex.lock();
     
-    inputPort = (static_cast<uint16_t>(txPDO->data[10]) & 0xFF) | ((static_cast<uint16_t>(txPDO->data[11]) & 0xFF) << 8);
-    conrollerInputFlag = (static_cast<uint16_t>(txPDO->data[12]) & 0xFF) | ((static_cast<uint16_t>(txPDO->data[13]) & 0xFF) << 8);
-    currentPosition = (static_cast<int32_t>(txPDO->data[14]) & 0xFF) | ((static_cast<int32_t>(txPDO->data[15]) & 0xFF) << 8) | ((static_cast<int32_t>(txPDO->data[16]) & 0xFF) << 16) | ((static_cast<int32_t>(txPDO->data[17]) & 0xFF) << 24);
-    currentSpeed = (static_cast<uint16_t>(txPDO->data[18]) & 0xFF) | ((static_cast<uint16_t>(txPDO->data[19]) & 0xFF) << 8);
-    currentPushingForce = (static_cast<uint16_t>(txPDO->data[20]) & 0xFF) | ((static_cast<uint16_t>(txPDO->data[21]) & 0xFF) << 8);
-    targetPositionDisplay = (static_cast<int32_t>(txPDO->data[22]) & 0xFF) | ((static_cast<int32_t>(txPDO->data[23]) & 0xFF) << 8) | ((static_cast<int32_t>(txPDO->data[24]) & 0xFF) << 16) | ((static_cast<int32_t>(txPDO->data[25]) & 0xFF) << 24);
-    alarm1 = txPDO->data[26];
-    alarm2 = txPDO->data[27];
-    alarm3 = txPDO->data[28];
-    alarm4 = txPDO->data[29];
+    inputPort = txPDO->read16(0);
+    conrollerInputFlag = txPDO->read16(2);
+    currentPosition = static_cast<int32_t>(txPDO->read32(4));
+    currentSpeed = txPDO->read16(8);
+    currentPushingForce = txPDO->read16(10);
+    targetPositionDisplay = static_cast<int32_t>(txPDO->read32(12));
+    alarm1 = txPDO->read8(16);
+    alarm2 = txPDO->read8(17);
+    alarm3 = txPDO->read8(18);
+    alarm4 = txPDO->read8(19);
     
     mutex.unlock();
 }
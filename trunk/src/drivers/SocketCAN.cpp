@@ -13,15 +13,20 @@
 
 #include <iostream>
 #include <cstring>
+#include <cerrno>
+#include <ctime>
 #include <typeinfo>
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/ioctl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <net/if.h>
 #include <linux/can.h>
 #include <linux/can/raw.h>
+#include <linux/net_tstamp.h>
 
 #endif
 
@@ -34,37 +39,31 @@ const double SocketCAN::PERIOD = 0.0005;
 
 /**
  * Creates a CAN device driver object and initializes the CAN socket.
+ * The handler of this device driver polls the CAN socket periodically.
  * @param socketName a file descriptor of the CAN socket to use, like 'can0' or 'can1'.
  */
-SocketCAN::SocketCAN(string socketName) : RealtimeThread("SocketCAN", STACK_SIZE, PRIORITY, PERIOD) {
+SocketCAN::SocketCAN(string socketName) : RealtimeThread("SocketCAN", STACK_SIZE, PRIORITY, PERIOD), messagesToTransmit(BUFFER_SIZE), receivedMessages(BUFFER_SIZE) {
     
-    #if defined __QNX__
-    
-    #else
-    
-    canSocket = socket(PF_CAN, SOCK_RAW, CAN_RAW);
-    
-    cout << "SocketCAN: canSocket=" << canSocket << endl;
+    eventDriven = false;
     
-    ifreq ifr;
-    strcpy(ifr.ifr_name, socketName.c_str());
-    int32_t result = ioctl(canSocket, SIOCGIFINDEX, &ifr);
+    open(socketName);
     
-    cout << "SocketCAN: ioctl(canSocket, SIOCGIFINDEX, &ifr)=" << result << endl;
-    
-    int32_t flags = fcntl(canSocket, F_GETFL, 0);
-    result = fcntl(canSocket, F_SETFL, flags | O_NONBLOCK);
-    
-    cout << "SocketCAN: fcntl(canSocket, F_SETFL, flags | O_NONBLOCK)=" << result << endl;
-    
-    sockaddr_can address;
-    address.can_family = AF_CAN;
-    address.can_ifindex = ifr.ifr_ifindex;
-    result = bind(canSocket, (sockaddr*)&address, sizeof(address));
+    // start handler
+
+    start();
+}
+
+/**
+ * Creates a CAN device driver object and initializes the CAN socket.
+ * @param socketName a file descriptor of the CAN socket to use, like 'can0' or 'can1'.
+ * @param eventDriven <code>true</code> if the handler of this device driver should wait for
+ * messages to transmit or to receive, <code>false</code> if it should poll the CAN socket periodically.
+ */
+SocketCAN::SocketCAN(string socketName, bool eventDriven) : RealtimeThread("SocketCAN", STACK_SIZE, PRIORITY, PERIOD), messagesToTransmit(BUFFER_SIZE), receivedMessages(BUFFER_SIZE) {
     
-    cout << "SocketCAN: bind(...)=" << result << endl;
+    this->eventDriven = eventDriven;
     
-    #endif
+    open(socketName);
     
     // start handler
 
@@ -79,23 +78,43 @@ SocketCAN::~SocketCAN() {
     // stop handler
 
     stop();
+    
+    #if defined __QNX__
+    
+    #else
+    
+    if (epollDescriptor >= 0) close(epollDescriptor);
+    if (eventDescriptor >= 0) close(eventDescriptor);
+    if (canSocket >= 0) close(canSocket);
+    
+    #endif
 }
 
 /**
  * Writes a CAN message for transmission on the CAN bus.
  * This method stores a copy of the given CAN message in a software transmit buffer.
+ * In the event driven mode, the handler is woken up to transmit the message immediately.
  * @param canMessage a CAN message object to transmit.
  * @return 0 if this write command failed, 1 otherwise.
  */
 int32_t SocketCAN::write(CANMessage canMessage) {
 
-    if (messagesToTransmit.size() < BUFFER_SIZE) {
-
-        mutex.lock();
-
-        messagesToTransmit.push_back(canMessage);
-
-        mutex.unlock();
+    if (messagesToTransmit.write(canMessage)) {
+        
+        #if defined __QNX__
+        
+        #else
+        
+        // the handler empties the buffer after it was woken up, so it only needs to be woken up once
+        
+        if (eventDriven && !signaled.exchange(true)) {
+            
+            uint64_t value = 1;
+            ssize_t written = ::write(eventDescriptor, &value, sizeof(value));
+            (void)written;
+        }
+        
+        #endif
 
         return 1;
 
@@ -112,102 +131,321 @@ int32_t SocketCAN::write(CANMessage canMessage) {
  */
 
 int32_t SocketCAN::read(CANMessage& canMessage) {
+    
+    return receivedMessages.read(canMessage) ? 1 : 0;
+}
 
-    if (receivedMessages.size() > 0) {
-
-        mutex.lock();
-
-        CANMessage canMessageOnStack = receivedMessages.front();
-        canMessage.id = canMessageOnStack.id;
-        for (uint8_t i = 0; i < 8; i++) canMessage.data[i] = canMessageOnStack.data[i];
-        canMessage.len = canMessageOnStack.len;
-        canMessage.type = canMessageOnStack.type;
-        receivedMessages.pop_front();
-
-        mutex.unlock();
+/**
+ * Reads a CAN message received from the CAN bus, together with its time of reception.
+ * @param canMessage a reference to a CAN message object to overwrite.
+ * @param timestamp a reference to the time the message was received by the kernel, given in [ns]
+ * since the epoch, i.e. measured with <code>CLOCK_REALTIME</code>. This value is 0 if the kernel
+ * didn't provide a timestamp.
+ * @return 0 if no message was received, 1 if a message could be read successfully.
+ */
+int32_t SocketCAN::read(CANMessage& canMessage, uint64_t& timestamp) {
+    
+    return receivedMessages.read(canMessage, timestamp) ? 1 : 0;
+}
 
-        return 1;
+/**
+ * Gets the number of messages that couldn't be written for transmission because
+ * the software transmit buffer of this CAN driver was full.
+ * @return the number of rejected messages to transmit.
+ */
+uint32_t SocketCAN::getTransmitOverflows() {
+    
+    return messagesToTransmit.getOverflows();
+}
 
-    } else {
+/**
+ * Gets the number of received messages that were discarded because
+ * the software receive buffer of this CAN driver was full.
+ * @return the number of discarded received messages.
+ */
+uint32_t SocketCAN::getReceiveOverflows() {
+    
+    return receivedMessages.getOverflows();
+}
 
-        return 0;
+/**
+ * Stops the handler of this CAN device driver. In the event driven mode,
+ * the handler is woken up to let it terminate.
+ */
+void SocketCAN::stop() {
+    
+    #if defined __QNX__
+    
+    #else
+    
+    if (eventDriven && isAlive()) {
+        
+        running = false;
+        
+        uint64_t value = 1;
+        ssize_t written = ::write(eventDescriptor, &value, sizeof(value));
+        (void)written;
     }
+    
+    #endif
+    
+    RealtimeThread::stop();
 }
 
 /**
- * This method is the handler of this CAN device driver.
+ * Opens and configures the CAN socket, and creates the descriptors the event driven handler waits on.
+ * @param socketName a file descriptor of the CAN socket to use, like 'can0' or 'can1'.
  */
-void SocketCAN::run() {
-
-    while (waitForNextPeriod()) {
+void SocketCAN::open(string socketName) {
+    
+    numberOfPendingMessages = 0;
+    canSocket = -1;
+    running = true;
+    signaled = false;
+    eventDescriptor = -1;
+    epollDescriptor = -1;
+    
+    #if defined __QNX__
+    
+    #else
+    
+    canSocket = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+    
+    cout << "SocketCAN: canSocket=" << canSocket << endl;
+    
+    ifreq ifr;
+    strcpy(ifr.ifr_name, socketName.c_str());
+    int32_t result = ioctl(canSocket, SIOCGIFINDEX, &ifr);
+    
+    cout << "SocketCAN: ioctl(canSocket, SIOCGIFINDEX, &ifr)=" << result << endl;
+    
+    int32_t flags = fcntl(canSocket, F_GETFL, 0);
+    result = fcntl(canSocket, F_SETFL, flags | O_NONBLOCK);
+    
+    cout << "SocketCAN: fcntl(canSocket, F_SETFL, flags | O_NONBLOCK)=" << result << endl;
+    
+    // let the kernel time stamp received frames
+    
+    int32_t timestamping = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+    setsockopt(canSocket, SOL_SOCKET, SO_TIMESTAMPING, &timestamping, sizeof(timestamping));
+    
+    sockaddr_can address;
+    address.can_family = AF_CAN;
+    address.can_ifindex = ifr.ifr_ifindex;
+    result = bind(canSocket, (sockaddr*)&address, sizeof(address));
+    
+    cout << "SocketCAN: bind(...)=" << result << endl;
+    
+    if (eventDriven) {
         
-        #if defined __QNX__
+        eventDescriptor = eventfd(0, EFD_NONBLOCK);
+        epollDescriptor = epoll_create1(0);
         
-        #else
+        if ((eventDescriptor < 0) || (epollDescriptor < 0)) throw runtime_error("SocketCAN: couldn't create event descriptors for the handler.");
         
-        // tries to write a message from the software transmit buffer to the CAN socket interface
-
-        if (messagesToTransmit.size() > 0) {
+        epoll_event event;
+        event.events = EPOLLIN;
+        event.data.fd = canSocket;
+        epoll_ctl(epollDescriptor, EPOLL_CTL_ADD, canSocket, &event);
+        
+        event.events = EPOLLIN;
+        event.data.fd = eventDescriptor;
+        epoll_ctl(epollDescriptor, EPOLL_CTL_ADD, eventDescriptor, &event);
+    }
+    
+    #endif
+}
 
-            mutex.lock();
+/**
+ * Writes messages from the software transmit buffer to the CAN socket interface,
+ * in batches of up to <code>BATCH_SIZE</code> messages per system call.
+ * @return <code>true</code> if the software transmit buffer was emptied, <code>false</code>
+ * if the transmit queue of the CAN socket interface is full.
+ */
+bool SocketCAN::transmit() {
+    
+    #if defined __QNX__
+    
+    return true;
+    
+    #else
+    
+    can_frame frames[BATCH_SIZE];
+    iovec vectors[BATCH_SIZE];
+    mmsghdr messages[BATCH_SIZE];
+    
+    while (true) {
+        
+        // fill up the batch of pending messages from the software transmit buffer
+        
+        while ((numberOfPendingMessages < BATCH_SIZE) && messagesToTransmit.read(pendingMessages[numberOfPendingMessages])) numberOfPendingMessages++;
+        
+        if (numberOfPendingMessages == 0) return true;
+        
+        for (uint16_t i = 0; i < numberOfPendingMessages; i++) {
+            
+            CANMessage& canMessage = pendingMessages[i];
+            
+            memset(&frames[i], 0, sizeof(can_frame));
+            frames[i].can_id = canMessage.id;
+            if (canMessage.type == CANRemote) frames[i].can_id |= CAN_RTR_FLAG;
+            frames[i].can_dlc = (canMessage.len <= 8) ? canMessage.len : 8;
+            for (uint8_t j = 0; j < frames[i].can_dlc; j++) frames[i].data[j] = canMessage.data[j];
+            
+            vectors[i].iov_base = &frames[i];
+            vectors[i].iov_len = sizeof(can_frame);
+            
+            memset(&messages[i], 0, sizeof(mmsghdr));
+            messages[i].msg_hdr.msg_iov = &vectors[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+        }
+        
+        int32_t sent = sendmmsg(canSocket, messages, numberOfPendingMessages, MSG_DONTWAIT);
+        
+        // remove the sent messages from the batch, and keep the others in their order
+        
+        if (sent > 0) {
+            
+            for (uint16_t i = sent; i < numberOfPendingMessages; i++) pendingMessages[i-sent] = pendingMessages[i];
+            numberOfPendingMessages -= sent;
+        }
+        
+        if (numberOfPendingMessages > 0) return false;
+    }
+    
+    #endif
+}
 
-            CANMessage canMessage(messagesToTransmit.front());
+/**
+ * Reads all pending messages from the CAN socket interface, in batches of up to
+ * <code>BATCH_SIZE</code> messages per system call, and stores them with their
+ * timestamps in the software receive buffer.
+ */
+void SocketCAN::receive() {
+    
+    #if defined __QNX__
+    
+    #else
+    
+    can_frame frames[BATCH_SIZE];
+    iovec vectors[BATCH_SIZE];
+    mmsghdr messages[BATCH_SIZE];
+    uint8_t controls[BATCH_SIZE][CMSG_SPACE(3*sizeof(timespec))];
+    
+    int32_t received = BATCH_SIZE;
+    
+    while (received == BATCH_SIZE) {
+        
+        for (uint16_t i = 0; i < BATCH_SIZE; i++) {
             
-            can_frame frame;
-            frame.can_id = static_cast<int32_t>(canMessage.id);
-            if (canMessage.type == CANRemote) frame.can_id |= CAN_RTR_FLAG;
-            frame.can_dlc = static_cast<int32_t>(canMessage.len);
-            for (int32_t i = 0; i < frame.can_dlc; i++) frame.data[i] = canMessage.data[i];
+            vectors[i].iov_base = &frames[i];
+            vectors[i].iov_len = sizeof(can_frame);
             
-            int32_t written = ::write(canSocket, &frame, sizeof(can_frame));
+            memset(&messages[i], 0, sizeof(mmsghdr));
+            messages[i].msg_hdr.msg_iov = &vectors[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+            messages[i].msg_hdr.msg_control = controls[i];
+            messages[i].msg_hdr.msg_controllen = sizeof(controls[i]);
+        }
+        
+        received = recvmmsg(canSocket, messages, BATCH_SIZE, MSG_DONTWAIT, NULL);
+        
+        if (received <= 0) return;
+        
+        for (int32_t i = 0; i < received; i++) {
             
-            if (written > 0) {
-                
-                // remove message from buffer
-                
-                messagesToTransmit.pop_front();
+            if (messages[i].msg_len < sizeof(can_frame)) continue;
+            
+            CANMessage canMessage;
+            
+            canMessage.id = static_cast<uint32_t>(frames[i].can_id & CAN_SFF_MASK);
+            canMessage.type = (frames[i].can_id & CAN_RTR_FLAG) > 0 ? CANRemote : CANData;
+            canMessage.len = (frames[i].can_dlc <= 8) ? static_cast<uint8_t>(frames[i].can_dlc) : 8;
+            
+            for (uint8_t j = 0; j < canMessage.len; j++) {
                 
-            } else {
+                canMessage.data[j] = frames[i].data[j];
+            }
+            
+            // the first of the three timestamps is the software timestamp of the kernel
+            
+            uint64_t timestamp = 0;
+            
+            for (cmsghdr* control = CMSG_FIRSTHDR(&messages[i].msg_hdr); control != NULL; control = CMSG_NXTHDR(&messages[i].msg_hdr, control)) {
                 
-                // leave message in buffer
+                if ((control->cmsg_level == SOL_SOCKET) && (control->cmsg_type == SCM_TIMESTAMPING)) {
+                    
+                    timespec times[3];
+                    memcpy(times, CMSG_DATA(control), sizeof(times));
+                    
+                    timestamp = static_cast<uint64_t>(times[0].tv_sec)*1000000000ULL+static_cast<uint64_t>(times[0].tv_nsec);
+                }
             }
             
-            mutex.unlock();
+            receivedMessages.write(canMessage, timestamp);   // the message is discarded if the software receive buffer is full
         }
+    }
+    
+    #endif
+}
 
-        // tries to read messages from the CAN socket interface
+/**
+ * This method is the handler of this CAN device driver.
+ */
+void SocketCAN::run() {
+    
+    if (!eventDriven) {
+        
+        while (waitForNextPeriod()) {
+            
+            // writes messages from the software transmit buffer to the CAN socket interface
+            
+            transmit();
+            
+            // reads messages from the CAN socket interface
+            
+            receive();
+        }
+        
+    } else {
         
-        can_frame frame;
+        #if defined __QNX__
+        
+        #else
         
-        int32_t bytesRead = ::read(canSocket, &frame, sizeof(frame));
+        bool transmitQueueFull = false;
         
-        while (bytesRead > 0) {
+        while (running) {
             
-            CANMessage canMessage;
+            // waits for received messages or for messages to transmit, and retries
+            // shortly if the transmit queue of the CAN socket interface was full
             
-            canMessage.id = static_cast<uint32_t>(frame.can_id & CAN_SFF_MASK);
-            canMessage.type = (frame.can_id & CAN_RTR_FLAG) > 0 ? CANRemote : CANData;
-            canMessage.len = static_cast<uint8_t>(frame.can_dlc);
+            epoll_event events[2];
             
-            for (uint8_t i = 0; i < canMessage.len; i++) {
+            int32_t numberOfEvents = epoll_wait(epollDescriptor, events, 2, transmitQueueFull ? RETRY_TIMEOUT : -1);
+            
+            if ((numberOfEvents < 0) && (errno != EINTR)) {
+                
+                cerr << "SocketCAN: epoll_wait() failed (errno=" << errno << ")." << endl;
                 
-                canMessage.data[i] = frame.data[i];
+                break;
             }
             
-            if (receivedMessages.size() < BUFFER_SIZE) {
-
-                mutex.lock();
-
-                receivedMessages.push_back(canMessage);
-
-                mutex.unlock();
-
-            } else {
-
-                // software receive buffer is full, discard message
+            for (int32_t i = 0; i < numberOfEvents; i++) {
+                
+                if (events[i].data.fd == eventDescriptor) {
+                    
+                    signaled = false;
+                    
+                    uint64_t value = 0;
+                    ssize_t bytesRead = ::read(eventDescriptor, &value, sizeof(value));
+                    (void)bytesRead;
+                }
             }
             
-            bytesRead = ::read(canSocket, &frame, sizeof(frame));
+            transmitQueueFull = !transmit();
+            
+            receive();
         }
         
         #endif
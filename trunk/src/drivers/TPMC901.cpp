@@ -24,7 +24,7 @@ const uint16_t TPMC901::CHIP_OFFSET[] = {0x0000, 0x0100, 0x0200, 0x0300, 0x0400,
  * bus. '0' is the first board of this type, '1' the second, and so on.
  * @param port the port number to use, either 0, 1, 2, 3, 4 or 5.
  */
-TPMC901::TPMC901(PCI& pci, uint16_t number, uint16_t port) : RealtimeThread("TPMC901", STACK_SIZE, PRIORITY, PERIOD), pci(pci) {
+TPMC901::TPMC901(PCI& pci, uint16_t number, uint16_t port) : RealtimeThread("TPMC901", STACK_SIZE, PRIORITY, PERIOD), pci(pci), messagesToTransmit(BUFFER_SIZE), receivedMessages(BUFFER_SIZE) {
 
     // get base address
 
@@ -172,20 +172,7 @@ void TPMC901::frequency(uint32_t hz) {
  */
 int32_t TPMC901::write(CANMessage canMessage) {
 
-    if (messagesToTransmit.size() < BUFFER_SIZE) {
-
-        mutex.lock();
-
-        messagesToTransmit.push_back(canMessage);
-
-        mutex.unlock();
-
-        return 1;
-
-    } else {
-
-        return 0;
-    }
+    return messagesToTransmit.write(canMessage) ? 1 : 0;
 }
 
 /**
@@ -195,25 +182,27 @@ int32_t TPMC901::write(CANMessage canMessage) {
  */
 int32_t TPMC901::read(CANMessage& canMessage) {
 
-    if (receivedMessages.size() > 0) {
-
-        mutex.lock();
-
-        CANMessage canMessageOnStack = receivedMessages.front();
-        canMessage.id = canMessageOnStack.id;
-        for (uint8_t i = 0; i < 8; i++) canMessage.data[i] = canMessageOnStack.data[i];
-        canMessage.len = canMessageOnStack.len;
-        canMessage.type = canMessageOnStack.type;
-        receivedMessages.pop_front();
+    return receivedMessages.read(canMessage) ? 1 : 0;
+}
 
-        mutex.unlock();
+/**
+ * Gets the number of messages that couldn't be written for transmission because
+ * the software transmit buffer of this CAN driver was full.
+ * @return the number of rejected messages to transmit.
+ */
+uint32_t TPMC901::getTransmitOverflows() {
 
-        return 1;
+    return messagesToTransmit.getOverflows();
+}
 
-    } else {
+/**
+ * Gets the number of received messages that were discarded because
+ * the software receive buffer of this CAN driver was full.
+ * @return the number of discarded received messages.
+ */
+uint32_t TPMC901::getReceiveOverflows() {
 
-        return 0;
-    }
+    return receivedMessages.getOverflows();
 }
 
 /**
@@ -269,19 +258,11 @@ void TPMC901::run() {
 
         // tries to write a message from the software transmit buffer to the CAN bus
 
-        if (messagesToTransmit.size() > 0) {
-
-            if ((pci.in8(baseAddress+SR) & 0x04) != 0) {
+        if ((pci.in8(baseAddress+SR) & 0x04) != 0) {
 
-                mutex.lock();
+            CANMessage canMessage;
 
-                CANMessage canMessage(messagesToTransmit.front());
-                messagesToTransmit.pop_front();
-
-                mutex.unlock();
-
-                transmit(canMessage);
-            }
+            if (messagesToTransmit.read(canMessage)) transmit(canMessage);
         }
 
         // tries to read a messages from the hardware receive buffer
@@ -291,18 +272,7 @@ void TPMC901::run() {
 
         while (received) {
 
-            if (receivedMessages.size() < BUFFER_SIZE) {
-
-                mutex.lock();
-
-                receivedMessages.push_back(canMessage);
-
-                mutex.unlock();
-
-            } else {
-
-                // software receive buffer is full, discard message
-            }
+            receivedMessages.write(canMessage);   // the message is discarded if the software receive buffer is full
 
             received = receive(canMessage);
         }